@@ -35,6 +35,26 @@
  * - added functions : getForceRecalibration, getMeasurementInterval, 
  *   getTemperatureOffset, getAltitudeCompensation, getFirmwareLevel
  * 
+ * Version 3.2.0 : October 2026
+ * - added driver statistics (getStats)
+ * - measured values and settings are kept per SCD30 instance
+ * - added support for multiple SCD30 on shared busses and I2C multiplexer
+ * - added I2C transaction timing to statistics
+ * - added advisory bus lock to share a bus with other programs
+ * - added probe() as cheap presence check for hot-plug detection
+ * - added reinit() and NACK statistics for the health supervisor
+ * - removed RESET_RETRY (replaced by the health supervisor)
+ * - added Burst() : single-shot / N-sample burst with sub-second polling
+ * - StartSingleMeasurement() uses the burst fast path
+ * - command #defines replaced by a descriptor table (scd30_cmd.h) with
+ *   typed send<Cmd>() / read<Cmd>()
+ * - added getMeasurement() for the asynchronous API (scd30_async.h)
+ * - clock stretch limit per command, adapted from the observed
+ *   transaction times (getStretch())
+ * - soft_I2C can use the built-in engine (settings.engine, scd30_gpio.h)
+ * - the SCD30 can be on Modbus over UART (settings.modbus, scd30_modbus.h)
+ * - the bus can be an emulated SCD30 for checks (settings.emul, scd30_emul.h)
+ * 
  * Resources / dependencies:
  * BCM2835 library (http://www.airspayce.com/mikem/bcm2835/)
  * twowire library (https://github.com/paulvha/twowire)
@@ -73,7 +93,7 @@
 
 /* set version number */
 # define VERSIONMAJOR 3
-# define VERSIONMINOR 1
+# define VERSIONMINOR 2
 
 /* The default I2C address for the SCD30 is 0x61 */
 #define SCD30_ADDRESS 0x61
@@ -85,25 +105,111 @@
 #define DEF_SDA 2
 #define DEF_SCL 3
 
+/* I2C multiplexer (TCA9548A). October 2026 */
+#define NO_MUX  0x0             // no multiplexer in use
+#define DEF_MUX 0x70            // default multiplexer address
+#define MUX_CHANNELS 8          // channels on multiplexer
+
+/* max. number of different I2C busses (sharing a bus is allowed) */
+#define SCD30_MAXBUS 4
+
+/* advisory lock to share a bus with other programs. October 2026 */
+#define SCD30_LOCKDIR "/var/lock"
+#define SCD30_LOCK_TIMEOUT 1000     // default max. wait in mS (0 = no lock)
+
 # define MAXBUF 100
-# define RESET_RETRY 5
-
-/* Available commands */
-#define COMMAND_CONTINUOUS_MEASUREMENT      0x0010
-#define COMMAND_SET_MEASUREMENT_INTERVAL    0x4600
-#define COMMAND_GET_DATA_READY              0x0202
-#define COMMAND_READ_MEASUREMENT            0x0300
-#define COMMAND_AUTOMATIC_SELF_CALIBRATION  0x5306
-#define COMMAND_SET_FORCED_RECALIBRATION_FACTOR 0x5204
-#define COMMAND_SET_TEMPERATURE_OFFSET      0x5403
-#define COMMAND_SET_ALTITUDE_COMPENSATION   0x5102
-#define CMD_READ_SERIALNBR                  0xD033
-//#define CMD_READ_ARTICLECODE              0XD025  // ONLY ZERO'S
-//#define CMD_START_SINGLE_MEAS             0x0006  // NOT used due to issues
-#define CMD_STOP_MEAS                       0x0104
-#define CMD_SOFT_RESET                      0xD304
-#define CMD_GET_FW_LEVEL                    0xD100  // added August 2020
-#define SCD30_SERIAL_NUM_WORDS              16      // added August 2020
+
+/* Available commands (table with codes, ranges and answer sizes) */
+# include "scd30_cmd.h"
+
+/* built-in soft-I2C engine */
+# include "scd30_gpio.h"
+
+/* Modbus over UART */
+# include "scd30_modbus.h"
+
+/* driver statistics, added October 2026 */
+struct scd30_stats
+{
+    uint32_t    commands;           // commands sent
+    uint32_t    reads;              // read transactions
+    uint32_t    retries;            // I2C retries
+    uint32_t    write_errors;       // failed writes (after retry)
+    uint32_t    read_errors;        // failed reads (after retry)
+    uint32_t    nack_errors;        // SCD30 did not acknowledge (of the errors)
+    uint32_t    crc_errors;         // CRC mismatch on received data
+    uint32_t    samples;            // measurements read
+    uint32_t    not_ready;          // data ready checks without data
+    uint32_t    soft_resets;        // soft resets performed
+    
+    /* I2C transaction timing (write or read incl. retries) in uS */
+    uint32_t    tr_count;           // transactions timed
+    uint32_t    tr_min;             // shortest
+    uint32_t    tr_max;             // longest
+    uint64_t    tr_sum;             // total
+    uint64_t    tr_sumsq;           // sum of squares (for jitter)
+    
+    /* bus lock shared with other programs */
+    uint32_t    lock_taken;         // bus lock obtained
+    uint32_t    lock_contended;     // had to wait for other program
+    uint32_t    lock_timeouts;      // gave up waiting
+    uint32_t    lock_foreign;       // bus was used by other program
+    uint64_t    lock_wait;          // total time waiting in uS
+    uint32_t    lock_wait_max;      // longest wait in uS
+    
+    /* presence check */
+    uint32_t    probes;             // probe() calls
+    uint32_t    probe_failures;     // SCD30 did not respond
+    
+    /* clock stretch budget */
+    uint32_t    stretch_timeouts;   // stretch limit reached (not retried)
+    uint32_t    stretch_changes;    // budget changed on adapt or timeout
+};
+
+/* clock stretch budget per command, added October 2026 */
+#define STRETCH_MAX 200000          // max. uS (interface guide : up to 150 mS)
+#define STRETCH_BUCKETS 18          // histogram, bucket i : 2^i - 2^(i+1) uS
+#define STRETCH_ADAPT 64            // transactions between budget updates
+#define STRETCH_PERMILLE 999        // budget covers this part of the transactions
+#define STRETCH_MARGIN 2            // budget = margin * observed
+
+struct scd30_stretch
+{
+    uint32_t    budget;             // current limit in uS
+    uint32_t    count;              // transactions timed
+    uint32_t    timeouts;           // stretch limit reached
+    uint32_t    hist[STRETCH_BUCKETS]; // transaction times (halved on adapt)
+};
+
+/* burst measurement, added October 2026 */
+#define BURST_MAX 32                // max. samples in a burst
+#define BURST_FIRST 2000            // initial expected mS to first sample
+#define BURST_PERIOD 2000           // mS between samples (interval 2)
+#define BURST_POLL_MIN 20           // min. mS between data ready polls
+#define BURST_POLL_MAX 500          // max. mS between data ready polls
+#define BURST_TIMEOUT 5000          // max. mS to wait for a sample
+
+/* how to reduce the samples of a burst */
+enum burst_reduce
+{
+    BURST_LAST = 0,                 // last sample
+    BURST_AVERAGE,                  // average
+    BURST_MEDIAN                    // median
+};
+
+/* result of a burst */
+struct scd30_burst
+{
+    uint8_t     count;              // samples read
+    float       co2[BURST_MAX];     // samples
+    float       temperature[BURST_MAX];
+    float       humidity[BURST_MAX];
+    
+    uint32_t    first_ms;           // mS from start to first sample
+    uint32_t    on_ms;              // mS from start to stop
+    uint16_t    polls;              // data ready polls
+    bool        configured;         // SCD30 had to be configured
+};
 
 struct scd30_p
 {
@@ -115,6 +221,35 @@ struct scd30_p
     uint8_t     sda;                // SDA GPIO (soft_I2C only)
     uint8_t     scl;                // SCL GPIO (soft_I2C only)
     bool         pullup;             // enable internal BCM2835 resistor
+    uint8_t     mux_address;        // I2C multiplexer address or NO_MUX
+    uint8_t     mux_channel;        // channel on multiplexer 0 - 7
+    uint16_t    lock_timeout;       // max. mS to wait on bus lock (0 = no lock)
+    bool         engine;             // soft_I2C with the built-in engine (scd30_gpio.h)
+    const char  *modbus;            // Modbus over this UART port instead of I2C (NULL = I2C)
+    struct scd30_emul *emul;        // emulated SCD30 instead of a bus (NULL = bus)
+};
+
+/* I2C bus that can be shared by multiple SCD30 (October 2026) */
+struct scd30_bus
+{
+    int         users;              // number of SCD30 using this bus
+    bool        I2C_interface;      // hard_I2C or soft_I2C
+    uint8_t     sda;                // SDA GPIO (soft_I2C only)
+    uint8_t     scl;                // SCL GPIO (soft_I2C only)
+    uint16_t    baudrate;           // current speed
+    uint8_t     mux_address;        // last selected multiplexer
+    uint8_t     mux_channel;        // last selected channel
+    uint32_t    stretch;            // clock stretch limit set on twowire (uS, 0 = set again)
+    int         lock_fd;            // lock file (-1 = none)
+    int         lock_depth;         // nested lock count
+    uint32_t    lock_gen;           // generation written at last unlock
+    bool        engine;             // built-in engine instead of twowire
+    TwoWire     twi;                // I2C driver
+    SoftI2c<MmapGpio> soft;         // built-in soft-I2C engine
+    bool        modbus;             // Modbus over UART instead of I2C
+    char        port[MODBUS_PORTLEN]; // UART port (modbus only)
+    ModbusTransport mb;             // Modbus transport
+    struct scd30_emul *emul;        // emulated SCD30 (no hardware, no lock)
 };
 
 class SCD30
@@ -164,6 +299,28 @@ class SCD30
          * @return  true = OK, false is error 
          */
         bool StartSingleMeasurement(void);
+        
+        /*! perform a burst of measurements (added October 2026)
+         * 
+         * Starts continuous measurement at a 2 second interval, reads
+         * 'num' samples and stops the measurement. The data ready
+         * status is polled with a spacing that shrinks towards the
+         * expected arrival (learned from earlier bursts).
+         * 
+         * The SCD30 is configured on the first burst only (interval
+         * 2, no ASC). Next bursts only start and stop the measurement,
+         * until begin() or a setting call changes the configuration.
+         * 
+         * The reduced values are obtained with getCO2(), 
+         * getTemperature() and getHumidity() after a true return.
+         * 
+         * @param num : number of samples (1 - BURST_MAX)
+         * @param reduce : how to reduce the samples
+         * @param b : to store the samples and timing (can be NULL)
+         * 
+         * @return  true = OK, false is error 
+         */
+        bool Burst(uint8_t num, burst_reduce reduce, scd30_burst *b);
 
         /*! get serial number of the SCD30
          * 
@@ -182,6 +339,14 @@ class SCD30
          */
         bool dataAvailable();
         
+        /*! read the latest measurement without checking data ready
+         * (added October 2026). Call after dataAvailable() returned
+         * true, e.g. from a scheduler that polls the status itself.
+         * 
+         * @return true = OK, false is error
+         */
+        bool getMeasurement(float *co2, float *temperature, float *humidity);
+        
         /*! get latest CO2 value 
          *  between 0 and 10.000 PPM
          * 
@@ -210,6 +375,21 @@ class SCD30
          */        
         float getTemperatureF(void);
 
+        /*! re-initialize the bus and the SCD30 with the ASC and interval
+         * of the last begin()
+         * 
+         * @return  true = OK, false is error
+         */
+        bool reinit();
+        
+        /*! check the SCD30 is present with a single (cheap) read of 
+         * the firmware level. The bus must have been initialized with
+         * begin(), also if the SCD30 did not respond at that time.
+         * 
+         * @return  true = SCD30 responded, false = not present or error
+         */
+        bool probe();
+        
         /*!read 16 bit value from a register
          * @param command :  command to sent
          * @param val : return the read 16 bit value
@@ -281,12 +461,137 @@ class SCD30
         
         /*! display the clock stretch statistics */
         void DispClockStretch();
+        
+        /*! obtain the driver statistics 
+         * @param st : to store the statistics
+         */
+        void getStats(scd30_stats *st);
+        
+        /*! obtain the clock stretch budget and histogram of a command
+         * @param id : command
+         * @param st : to store the budget
+         */
+        void getStretch(scd30_cmd_id id, scd30_stretch *st);
 
   private:
         
+        /*! driver statistics */
+        scd30_stats _stats;
+        
+        /*! add a transaction time to the statistics
+         * @param start : start time of transaction
+         * @return transaction time in uS */
+        uint32_t timeTransaction(struct timespec *start);
+        
+        /*! clock stretch budget per command, command in progress */
+        scd30_stretch _stretch[SCD30_CMD_NUM];
+        int     _stretch_cmd;
+        
+        /*! I2C through twowire, the built-in engine, Modbus or the emulator */
+        Wstatus busWrite(const char *buf, uint32_t len);
+        Wstatus busRead(char *buf, uint32_t len);
+        void busSlave(uint8_t address);
+        void busClock(uint16_t khz);
+        void busStretch(uint32_t us);
+        bool busReopen();
+        
+        /*! the bus as transport policy for the retry shared with the 
+         * protocol layer (scd30_retry() in scd30_proto.h) */
+        class BusTransport
+        {
+          public:
+            SCD30   *dev;
+            BusTransport(SCD30 *d) { dev = d; }
+            Wstatus write(const char *buf, uint32_t len) { return(dev->busWrite(buf, len)); }
+            Wstatus read(char *buf, uint32_t len) { return(dev->busRead(buf, len)); }
+        };
+        
+        /*! set the clock stretch limit for the command in progress */
+        void stretchSet();
+        
+        /*! add a transaction to the budget of the command in progress
+         * @param us : transaction time
+         * @param result : twowire status */
+        void stretchDone(uint32_t us, Wstatus result);
+        
+        /*! I2C bus in use */
+        scd30_bus *_bus;
+        
+        /*! latest values read */
+        float   _co2;
+        float   _temperature;
+        float   _humidity;
+        
+        /*! These track the staleness of the current data
+         * This allows us to avoid calling readMeasurement() every time 
+         * individual datums are requested */
+        bool    _co2HasBeenReported;
+        bool    _humidityHasBeenReported;
+        bool    _temperatureHasBeenReported;
+        
+        /*! requested settings */
+        bool    _asc;
+        uint16_t _interval;
+        
+        /*! burst : SCD30 configured for bursts, expected mS to first sample */
+        bool    _burst_ready;
+        uint32_t _burst_first;
+        
+        /*! obtain the advisory bus lock (shared with other programs)
+         * waits max. settings.lock_timeout mS
+         * 
+         * @return  true = OK, false is timeout
+         */
+        bool lockBus();
+        
+        /*! release the advisory bus lock */
+        void unlockBus();
+        
+        /*! select the bus, multiplexer channel and slave address 
+         * before a transaction
+         * 
+         * @return  true = OK, false is error.
+         */
+        bool selectBus();
+        
         /*! display debug messages */
         void debug_cmd(uint16_t command);
         
+        /*! send a command without argument
+         * @return  true = OK, false is error. */
+        template <scd30_cmd_id C> bool send()
+        {
+            static_assert(! scd30_cmds[C].arg, "command needs an argument");
+            return(sendCommand(scd30_cmds[C].code));
+        }
+        
+        /*! send a command with argument (user units, range checked)
+         * @return  true = OK, false is error or out of range. */
+        template <scd30_cmd_id C> bool send(double val)
+        {
+            static_assert(scd30_cmds[C].arg, "command has no argument");
+            if (! scd30_cmd_valid(C, val)) return(false);
+            return(sendCommand(scd30_cmds[C].code, (uint16_t) (int32_t) (val * scd30_cmds[C].scale)));
+        }
+        
+        /*! send a command with a constant argument (range checked at
+         * compile time)
+         * @return  true = OK, false is error. */
+        template <scd30_cmd_id C, int32_t V> bool send()
+        {
+            static_assert(scd30_cmd_valid(C, V), "argument out of range");
+            return(sendCommand(scd30_cmds[C].code, (uint16_t) (V * scd30_cmds[C].scale)));
+        }
+        
+        /*! read the answer of a command (CRC removed)
+         * @param val : buffer of exactly the answer size
+         * @return  true = OK, false is error. */
+        template <scd30_cmd_id C> bool read(uint8_t (&val)[scd30_cmds[C].words * 2])
+        {
+            static_assert(scd30_cmds[C].words > 0, "command has no answer");
+            return(ReadFromSCD30(scd30_cmds[C].code, val, sizeof(val)) == sizeof(val));
+        }
+        
         /*! perform a read a store the values in the driver
          * It is triggered bygetTemperature(),getHumidity() or
          * getCO2();
@@ -295,6 +600,11 @@ class SCD30
          */
         bool readMeasurement();
         
+        /*! read the measurement without checking data ready
+         * @return  true = OK, false is error.
+         */
+        bool readValues();
+        
         /*! Read from SCD30 the amount of requested bytes
          * @param val : to store the data received
          * @param cnt : number of data bytes requested
@@ -24,6 +24,13 @@
  * December 2017 / paulvha 
  * version 1.1  This is a scaled down version of the Dylosmonitor.
  * 
+ * October 2026 / paulvha
+ * version 1.2  added stop_dylos() to restart with an other port.
+ *              fixed buffer overflows in constant_read()
+ *              added request_dylos() / fetch_dylos() to read without
+ *              waiting for the child.
+ *              added dylos_pid() for the resource usage of the child.
+ * 
  *********************************************************************/
 
 #include <stdio.h>
@@ -34,6 +41,8 @@
 #include <fcntl.h>
 #include <stdlib.h>
 #include <signal.h>
+#include <sys/wait.h>
+#include "dylos.h"
 
 /* default device */
 #define DYLOS_USB   "/dev/ttyUSB0"
@@ -79,6 +88,25 @@ void close_dylos()
     }
 }
 
+/****************************************************
+ *  stop the Dylos child without exit of the program
+ *  (as close_dylos() does). open_dylos() can be 
+ *  called again afterwards.
+ ****************************************************/
+void stop_dylos()
+{
+    if (dylos_ch <= 0) return;
+    
+    // request child to stop
+    write(ptoc[1],"s",1);
+    waitpid(dylos_ch, NULL, 0);
+    
+    close(ptoc[1]);
+    close(ctop[0]);
+    
+    dylos_ch = 0;
+}
+
 /******************************************************* 
  * Dylos will sent every minute an update which is
  * captured by child program. The results are passed to
@@ -95,7 +123,7 @@ void constant_read(int verbose)
     while(1)
     {
         /* read from parent (none blocking) */
-        if (read(ptoc[0], cmdbuf, 20) > 0)
+        if (read(ptoc[0], cmdbuf, sizeof(cmdbuf)) > 0)
         {
             switch(cmdbuf[0])
             {
@@ -123,14 +151,15 @@ void constant_read(int verbose)
         /* clear buffer */
         memset(buf, 0x0, 20);
 
-        /* try to read Dylos data (max 20 characters) */
-        if (read(fd, buf, 20) > 0)
+        /* try to read Dylos data (max 19 characters) */
+        if (read(fd, buf, sizeof(buf) - 1) > 0)
         {
             // if an incomplete received message was stored : append
-            if (sbuf[strlen(sbuf) -1] != 0x0a) sprintf(sbuf,"%s%s",sbuf,buf);
+            if (sbuf[strlen(sbuf) -1] != 0x0a) 
+                strncat(sbuf, buf, sizeof(sbuf) - strlen(sbuf) - 1);
             
             // else write new (start)
-            else strncpy(sbuf,buf,20);
+            else snprintf(sbuf, sizeof(sbuf), "%s", buf);
         }
     }
 }
@@ -319,3 +348,59 @@ int read_dylos (char * buf, int len, int wait, int verbose)
         }
     } 
 }
+
+/***********************************************************
+ * Ask the child for the latest data without waiting for the 
+ * answer. The returned descriptor becomes readable once the 
+ * answer is there, after which fetch_dylos() will collect it
+ * 
+ * @param verbose : display progress messages
+ * 
+ * returns the descriptor to wait for or -1 if no child
+ **********************************************************/
+int request_dylos(int verbose)
+{
+    if (dylos_ch <= 0) return(-1);
+    
+    if (write(ptoc[1],"b",1) != 1) return(-1);
+    
+    if (verbose > 1) printf("Dylos reader requested data\n");
+    
+    return(ctop[0]);
+}
+
+/***********************************************************
+ * Collect the answer to request_dylos(). Only call once the 
+ * descriptor is readable, else this will block.
+ * 
+ * @param buf : pointer to buffer allocated by user 
+ * @param len : length of allocated buffer 
+ * @param verbose : display progress messages
+ * 
+ * returns number of characters read into buffer or 0 
+ **********************************************************/
+int fetch_dylos(char * buf, int len, int verbose)
+{
+    int     num;
+    
+    /* clear buffer */
+    memset(buf, 0x0, len);
+    
+    num = read(ctop[0], buf, len - 1);
+    
+    if (num > 0 && verbose > 1) printf("Dylos reader got : %s\n", buf);
+    
+    /* got empty or something. expected format like 2240,126*/
+    if (num < 7) return(0);
+    
+    return(num);
+}
+
+/***********************************************************
+ * returns the process id of the child reading the Dylos
+ * device or 0 if not running
+ **********************************************************/
+int dylos_pid()
+{
+    return(dylos_ch > 0 ? dylos_ch : 0);
+}
@@ -0,0 +1,43 @@
+/*********************************************************************
+ * Supporting routines to access and read Dylos information and measured
+ * values. 
+ * 
+ * Dylos is registered trademark Dylos Corporation
+ * 2900 Adams St#C38, Riverside, CA92504 PH:877-351-2730
+ * 
+ * Copyright (c) 2017 Paul van Haastrecht <paulvha@hotmail.com>
+ *
+ * *******************************************************************
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software. If not, see <http://www.gnu.org/licenses/>. 
+ *********************************************************************/
+
+#ifndef __DYLOS_H__
+#define __DYLOS_H__
+
+/* indicate these are C-programs and not to be linked */
+#ifdef __cplusplus
+extern "C" {
+#endif
+    void close_dylos();
+    void stop_dylos();
+    int read_dylos (char * buf, int len, int wait, int verbose);
+    int request_dylos(int verbose);
+    int fetch_dylos(char * buf, int len, int verbose);
+    int open_dylos(char * device, int verbose);
+    int dylos_pid();
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // End of definition check
@@ -32,6 +32,27 @@
  * - added functions : getForceRecalibration, getMeasurementInterval, 
  *   getTemperatureOffset, getAltitudeCompensation, getFirmwareLevel
  * 
+ * Version 3.2.0 : October 2026
+ * - added daemon mode with control socket (-Z)
+ * - added fleet of sensors from a configuration file with reload (-C)
+ * - added real-time profile for jitter-free soft_I2C (-R)
+ * - added advisory bus lock shared with other programs (-K)
+ * - added hot-plug : a sensor that is gone is detached and re-attached
+ * - added identity cache for device information (-I)
+ * - replaced the soft reset after RESET_RETRY misses by a health supervisor
+ * - added lossless capture mode with sequence numbers and gap events (-L)
+ * - added adaptive measurement interval (-A)
+ * - added ambient pressure compensation from an external source (-E)
+ * - added burst measurement with average or median (-N)
+ * - added transport overhead benchmark (-T)
+ * - added check of the asynchronous API on emulated sensors (-J)
+ * - added work-stealing pipeline benchmark on emulated sensors (-W)
+ * - added resource usage per stage in stats and summary line (-U)
+ * - added steady state allocation check on emulated samples (-M)
+ * - added built-in soft-I2C engine (-O) and its check on a mock (-G)
+ * - added SCD30 on Modbus over UART (-Y) and its check on a pty (-X)
+ * - added bit-level bus simulator with waveform for soft-I2C timing (-V)
+ * 
  * Resources / dependencies:
  * BCM2835 library (http://www.airspayce.com/mikem/bcm2835/)
  * twowire library (https://github.com/paulvha/twowire)
@@ -61,20 +82,34 @@
  **********************************************************************/
 
 # include "SCD30.h"
+# include "scd30_ctrl.h"
+# include "scd30_fleet.h"
+# include "scd30_usage.h"
+# include "scd30_trace.h"
+# include "scd30_alloc.h"
+# include "scd30_ident.h"
+# include "scd30_health.h"
+# include "scd30_capture.h"
+# include "scd30_adapt.h"
+# include "scd30_press.h"
+# include "scd30_speed.h"
+# include "scd30_sim.h"
+# include "scd30_transport.h"
+# include "scd30_steal.h"
+# include "scd30_async.h"
+# include "scd30_rt.h"
 
 /* global constructor */ 
 SCD30 MySensor;
 
+/* health supervisor of MySensor */
+struct scd30_health MyHealth;
+
 char progname[20];
 
 #ifdef DYLOS        // DYLOS monitor option
 
-/* indicate these are C-programs and not to be linked */
-extern "C" {
-    void close_dylos();
-    int read_dylos (char * buf, int len, int wait, int verbose);
-    int open_dylos(char * device, int verbose);
-}
+# include "dylos.h"
 
 typedef struct dylos
 {
@@ -91,6 +126,8 @@ typedef struct scd_par
     /* option SCD30 parameters */
     bool stop_cm;              // stop continuous measurement
     bool perform_single;       // perform a single measurement
+    uint8_t burst;             // samples in burst (0 = no burst)
+    burst_reduce reduce;       // reduce burst to average or median
     uint16_t interval;          // sample interval. 2 <> 1800 seconds
     int16_t frc;               // SCD30 forced recalibration  400 <>2000 ppm
     int16_t temp_offset;       // Temperature offset. 0 <> 25C
@@ -113,6 +150,37 @@ typedef struct scd_par
     bool dewpoint;              // add dewpoint in output
     int verbose;                // verbose level
     
+    /* daemon mode (added October 2026) */
+    bool daemon;                // run endless with control socket
+    char ctrl_socket[MAXBUF];   // control socket path
+    char config[MAXBUF];        // fleet configuration file (or empty)
+    char ident[MAXBUF];         // identity cache file
+    
+    /* lossless capture (added October 2026) */
+    bool capture;               // reads locked to the measurement interval
+    uint32_t seq;               // sequence number of the sample to output
+    struct scd30_capture cap;
+    
+    /* adaptive measurement interval (added October 2026) */
+    uint16_t adapt_min;         // shortest interval (0 = not adaptive)
+    uint16_t adapt_max;         // longest interval
+    uint16_t adapt_hold;        // seconds between changes to longer
+    uint16_t co2;               // last CO2 output
+    struct scd30_adapt adapt;
+    
+    /* ambient pressure from external source (added October 2026) */
+    char press_src[PRESS_SPECLEN];  // source spec (or empty)
+    struct scd30_press press;
+    
+    /* I2C speed tuning (added October 2026) */
+    struct scd30_speed speed;
+    
+    /* real-time profile (added October 2026) */
+    int rt_prio;                // SCHED_FIFO priority (0 = not set)
+    int rt_cpu;                 // CPU to pin to (-1 = not pinned)
+    uint32_t outputs;           // number of results displayed
+    time_t started;             // start time of measurement loop
+    
 #ifdef DYLOS                    // DYLOS monitor option
     /* include Dylos info */
     struct dylos dylos;
@@ -125,6 +193,12 @@ typedef struct scd_par
 **********************************************************************/
 void closeout()
 {
+   /* remove control socket */
+   ctrl_close();
+   
+   /* stop fleet sensors (if any) */
+   fleet_close();
+   
    /* reset pins in Raspberry Pi */
    MySensor.close();
    
@@ -182,14 +256,17 @@ void set_signals()
  * @brief generate timestamp
  * 
  * @param buf : returned the timestamp
+ * 
+ * localtime_r() reads the time zone only once, localtime() checks
+ * it (and allocates memory) on each call.
  *********************************************/  
 void get_time_stamp(char * buf)
 {
     time_t ltime;
-    struct tm *tm ;
+    struct tm tm_buf, *tm = &tm_buf;
     
     ltime = time(NULL);
-    tm = localtime(&ltime);
+    localtime_r(&ltime, tm);
     
     static const char wday_name[][4] = {
     "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
@@ -214,6 +291,8 @@ void init_variables(struct scd_par *scd)
     scd->asc = true;                // set Automatic Self Calibration (ASC)
     scd->stop_cm = false;           // NOT stop continuous measurement
     scd->perform_single = false;    // NOT perform a single measurement
+    scd->burst = 0;                 // NO burst
+    scd->reduce = BURST_AVERAGE;
     scd->interval = 2;               // sample interval. 2 <> 1800 seconds
     scd->frc = -1;                  // SCD30 forced recalibration  400 <>2000 ppm
     scd->temp_offset = -1;          // Temperature offset. 0 <> 25C
@@ -235,6 +314,22 @@ void init_variables(struct scd_par *scd)
     scd->heatindex = false;        // NOT include heatindex in output
     scd->tempCel = true;            // display temperarure in Celsius
     scd->verbose = 0;               // No verbose level
+    
+    scd->daemon = false;            // NOT in daemon mode
+    strncpy(scd->ctrl_socket, CTRL_SOCKET, MAXBUF);
+    scd->config[0] = 0x0;           // NO fleet configuration
+    strncpy(scd->ident, IDENT_FILE, MAXBUF);
+    scd->capture = false;           // NO lossless capture
+    memset(&scd->cap, 0x0, sizeof(struct scd30_capture));
+    scd->adapt_min = scd->adapt_max = 0;    // NO adaptive interval
+    scd->adapt_hold = ADAPT_HOLD;
+    memset(&scd->adapt, 0x0, sizeof(struct scd30_adapt));
+    scd->press_src[0] = 0x0;        // NO pressure source
+    memset(&scd->press, 0x0, sizeof(struct scd30_press));
+    memset(&scd->speed, 0x0, sizeof(struct scd30_speed));  // NO speed tuning
+    scd->rt_prio = 0;               // NO real-time profile
+    scd->rt_cpu = -1;
+    scd->outputs = 0;
 
 #ifdef DYLOS                        // DYLOS monitor option
     /* Dylos values */
@@ -292,7 +387,7 @@ void init_hw(struct scd_par *scd)
 /* Dylos monitor MUST be started as ROOT (/dev/tty* permission) */
 #ifndef DYLOS
     /* hard_I2C requires  root permission */    
-    if (MySensor.settings.I2C_interface == hard_I2C)
+    if (MySensor.settings.I2C_interface == hard_I2C && MySensor.settings.modbus == NULL)
 #endif
     {
         if (geteuid() != 0)
@@ -326,6 +421,9 @@ void init_hw(struct scd_par *scd)
         exit(-1);
     }
     
+    /* fastest I2C speed under the error budget */
+    if (scd->speed.max) speed_calibrate(&scd->speed, &MySensor);
+    
     /* frc, altitude, pressure */
     if (scd->altitude != -1)
     {
@@ -376,33 +474,39 @@ void init_hw(struct scd_par *scd)
         if(scd->verbose) p_printf (YELLOW, (char *) "initialize Dylos\n");
         
         if (open_dylos(scd->dylos.port, scd->verbose) != 0)   closeout();
+        
+        /* the CPU time of the reader is charged to the dylos stage */
+        usage_child(dylos_pid());
     }
 #endif
+
+    /* open control socket for daemon mode */
+    if (scd->daemon)
+    {
+        if(scd->verbose) p_printf (YELLOW, (char *) "open control socket %s\n", scd->ctrl_socket);
+        
+        if (! ctrl_open(scd->ctrl_socket)) closeout();
+    }
 }
 
 #ifdef DYLOS        // DYLOS monitor option
 
 /*****************************************************************
- * @brief Try to read from Dylos DC1700 monitor
+ * @brief parse the values received from Dylos DC1700 monitor
  * 
- * @param scd : pointer to SCD30 parameters and Dylos values
+ * @param buf : received data, like 2240,126
+ * @param ret : number of characters received
+ * @param pm1 : to store PM1 value
+ * @param pm10 : to store PM10 value
  ****************************************************************/
-bool do_dylos(struct scd_par *scd)
+void parse_dylos_values(char *buf, int ret, uint16_t *pm1, uint16_t *pm10)
 {
-    char    buf[MAXBUF], t_buf[MAXBUF];
-    int     ret, i, offset =0 ;
-    
-    /* if no Dylos device specified */
-    if ( ! scd->dylos.include) return(false);
-    
-    if(scd->verbose > 0 ) printf("\nReading Dylos data ");
+    char    t_buf[MAXBUF];
+    int     i, offset =0;
     
     /* reset values */
-    scd->dylos.value_pm1 = scd->dylos.value_pm10 = 0;
+    *pm1 = *pm10 = 0;
     
-    /* try to read from Dylos and wait max 2 seconds */
-    ret = read_dylos(buf, MAXBUF, 2, scd->verbose);
-
     /* if data received : parse it */
     for(i = 0; i < ret; i++)
     {
@@ -411,7 +515,7 @@ bool do_dylos(struct scd_par *scd)
         {
             /* terminate & get PM10 */
             t_buf[offset] = 0x0;
-            scd->dylos.value_pm10 = (uint16_t)strtod(t_buf, NULL);
+            *pm10 = (uint16_t)strtod(t_buf, NULL);
             
             // break
             i = ret;        
@@ -426,17 +530,92 @@ bool do_dylos(struct scd_par *scd)
             if (t_buf[offset] == ',')
             {
                 t_buf[offset] = 0x0;
-                scd->dylos.value_pm1 = (uint16_t)strtod(t_buf, NULL);
+                *pm1 = (uint16_t)strtod(t_buf, NULL);
                 offset=0;
             }
             else
                 offset++;
         }
     }
+}
+
+/*****************************************************************
+ * @brief Try to read values from Dylos DC1700 monitor
+ * 
+ * @param pm1 : to store PM1 value
+ * @param pm10 : to store PM10 value
+ * @param verbose : verbose level
+ * 
+ * @return true (values are zero if nothing received)
+ ****************************************************************/
+bool read_dylos_values(uint16_t *pm1, uint16_t *pm10, int verbose)
+{
+    char    buf[MAXBUF];
+    int     ret, prev;
+    
+    SCD30_TRACE_CLOCK(start);
+    
+    prev = usage_enter(USAGE_DYLOS);
+    
+    if(verbose > 0 ) printf("\nReading Dylos data ");
+    
+    /* try to read from Dylos and wait max 2 seconds */
+    ret = read_dylos(buf, MAXBUF, 2, verbose);
+
+    parse_dylos_values(buf, ret, pm1, pm10);
+    
+    SCD30_TRACE4(dylos, *pm1, *pm10, ret, SCD30_TRACE_US(start));
+    
+    usage_leave(prev);
     
     return(true);
 }
 
+/*****************************************************************
+ * @brief collect the values requested with request_dylos()
+ * 
+ * Only to be called once the descriptor returned by request_dylos() 
+ * is readable : this will not wait.
+ * 
+ * @param pm1 : to store PM1 value
+ * @param pm10 : to store PM10 value
+ * @param verbose : verbose level
+ * 
+ * @return true (values are zero if nothing received)
+ ****************************************************************/
+bool fetch_dylos_values(uint16_t *pm1, uint16_t *pm10, int verbose)
+{
+    char    buf[MAXBUF];
+    int     ret, prev;
+    
+    SCD30_TRACE_CLOCK(start);
+    
+    prev = usage_enter(USAGE_DYLOS);
+    
+    ret = fetch_dylos(buf, MAXBUF, verbose);
+
+    parse_dylos_values(buf, ret, pm1, pm10);
+    
+    SCD30_TRACE4(dylos, *pm1, *pm10, ret, SCD30_TRACE_US(start));
+    
+    usage_leave(prev);
+    
+    return(true);
+}
+
+/*****************************************************************
+ * @brief Try to read from Dylos DC1700 monitor
+ * 
+ * @param scd : pointer to SCD30 parameters and Dylos values
+ ****************************************************************/
+bool do_dylos(struct scd_par *scd)
+{
+    /* if no Dylos device specified */
+    if ( ! scd->dylos.include) return(false);
+    
+    return(read_dylos_values(&scd->dylos.value_pm1, &scd->dylos.value_pm10, scd->verbose));
+}
+
 #endif
 
 
@@ -450,6 +629,7 @@ void do_output(struct scd_par *scd)
     char buf[30],t;
     float index, dew, temp, hum;
     uint16_t co2;
+    int prev = usage_enter(USAGE_FORMAT);
     
     if (scd->timestamp) 
     {
@@ -457,7 +637,10 @@ void do_output(struct scd_par *scd)
         printf("%s: ",buf);
     }
     
+    if (scd->capture) printf("seq %u: ", scd->seq);
+    
     co2 = (uint16_t) MySensor.getCO2();
+    scd->co2 = co2;
     hum = MySensor.getHumidity();
     
     if (scd->tempCel)   // Celsius
@@ -475,6 +658,8 @@ void do_output(struct scd_par *scd)
         t= 'F';
     }
     
+     usage_enter(USAGE_SINK);
+     
      p_printf(WHITE, (char *) "CO2: %4d PPM\tHumidity: %3.2f %%RH  Temperature: %3.2f *%c  ",co2, hum,temp,t);
      
      if (scd->heatindex) p_printf(WHITE, (char *) "heatindex: %3.2f *%c ", index, t);
@@ -490,6 +675,196 @@ void do_output(struct scd_par *scd)
        
     /* display debug information on highest verbose level */
     if(scd->verbose == 2) MySensor.DispClockStretch();
+    
+    usage_leave(prev);
+    usage_sample();
+    
+    scd->outputs++;
+}
+
+/*****************************************************************
+ * @brief execute a command received on the control socket
+ * 
+ * The command is executed in between the acquisition cycles with
+ * the same setters as used during startup. There is no
+ * re-initialization of the I2C bus.
+ * 
+ * @param cmd : command to execute
+ * @param reply : to store the reply
+ * @param len : length of reply buffer
+ * @param ctx : pointer to SCD30 parameters
+ ****************************************************************/
+void do_control(struct ctrl_cmd *cmd, char *reply, int len, void *ctx)
+{
+    struct scd_par *scd = (struct scd_par *) ctx;
+    scd30_stats st;
+    scd30_stretch ready, meas;
+    uint16_t interval, frc, offset, altitude, asc, fw;
+    bool ret = false;
+    int off;
+
+    /* these need a value */
+    if (cmd->type != CTRL_HELP && cmd->type != CTRL_GET && cmd->type != CTRL_STATS && 
+        cmd->type != CTRL_RELOAD && cmd->type != CTRL_UNKNOWN)
+    {
+        if (! cmd->has_value)
+        {
+            snprintf(reply, len, "ERR missing value");
+            return;
+        }
+    }
+    
+    switch(cmd->type)
+    {
+    case CTRL_INTERVAL:
+        if (! scd30_cmd_valid(SCD30_CMD_INTERVAL, cmd->value)) break;
+        
+        ret = MySensor.setMeasurementInterval(cmd->value);
+        if (ret) scd->interval = cmd->value;
+        if (ret && scd->adapt_max) adapt_set(&scd->adapt, cmd->value);
+        break;
+    
+    case CTRL_WAIT:
+        if (cmd->value < 0 || cmd->value > 0xffff) break;
+        
+        scd->loop_delay = cmd->value;
+        ret = true;
+        break;
+        
+    case CTRL_FRC:
+        if (! scd30_cmd_valid(SCD30_CMD_FRC, cmd->value)) break;
+        
+        // as with -f : a forced recalibration value switches ASC off
+        ret = MySensor.setForceRecalibration(cmd->value) &&
+              MySensor.setAutoSelfCalibration(false);
+        if (ret)
+        {
+            scd->frc = cmd->value;
+            scd->asc = false;
+        }
+        break;
+    
+    case CTRL_ASC:
+        if (! scd30_cmd_valid(SCD30_CMD_ASC, cmd->value)) break;
+        
+        ret = MySensor.setAutoSelfCalibration(cmd->value == 1);
+        if (ret) scd->asc = cmd->value == 1;
+        break;
+    
+    case CTRL_ALTITUDE:
+        if (! scd30_cmd_valid(SCD30_CMD_ALTITUDE, cmd->value)) break;
+        
+        ret = MySensor.setAltitudeCompensation(cmd->value);
+        if (ret) scd->altitude = cmd->value;
+        break;
+    
+    case CTRL_PRESSURE:
+        // setting to zero will de-activate
+        if (! scd30_cmd_valid(SCD30_CMD_START, cmd->value)) break;
+        
+        ret = MySensor.setAmbientPressure(cmd->value);
+        if (ret) scd->pressure = cmd->value;
+        break;
+        
+    case CTRL_TEMPOFFSET:
+        if (! scd30_cmd_valid(SCD30_CMD_TEMP_OFFSET, cmd->value)) break;
+        
+        ret = MySensor.setTemperatureOffset(cmd->value);
+        if (ret) scd->temp_offset = cmd->value;
+        break;
+        
+    case CTRL_GET:
+        if (MySensor.getSettingValue(COMMAND_SET_MEASUREMENT_INTERVAL, &interval) &&
+            MySensor.getSettingValue(COMMAND_SET_FORCED_RECALIBRATION_FACTOR, &frc) &&
+            MySensor.getSettingValue(COMMAND_SET_TEMPERATURE_OFFSET, &offset) &&
+            MySensor.getSettingValue(COMMAND_SET_ALTITUDE_COMPENSATION, &altitude) &&
+            MySensor.getSettingValue(COMMAND_AUTOMATIC_SELF_CALIBRATION, &asc) &&
+            MySensor.getSettingValue(CMD_GET_FW_LEVEL, &fw))
+        {
+            snprintf(reply, len, "OK interval %d frc %d tempoffset %d altitude %d asc %d wait %d firmware %d.%d",
+            interval, frc, offset, altitude, asc, scd->loop_delay, fw >> 8 & 0xff, fw & 0xff);
+        }
+        else
+            snprintf(reply, len, "ERR could not read settings");
+        return;
+    
+    case CTRL_STATS:
+        MySensor.getStats(&st);
+        MySensor.getStretch(SCD30_CMD_DATA_READY, &ready);
+        MySensor.getStretch(SCD30_CMD_READ_MEAS, &meas);
+        off = snprintf(reply, len, "OK uptime %ld outputs %u samples %u not_ready %u commands %u reads %u "
+        "retries %u write_errors %u read_errors %u crc_errors %u soft_resets %u "
+        "tr_count %u tr_min %u tr_max %u tr_mean %u "
+        "lock_taken %u lock_contended %u lock_timeouts %u lock_foreign %u lock_wait_max %u "
+        "probes %u probe_failures %u nack_errors %u "
+        "stretch_timeouts %u stretch_changes %u stretch_ready %u stretch_read %u "
+        "speed %u speed_calibrations %u speed_stepdowns %u "
+        "fault_bus %u fault_sensor %u fault_stale %u fault_crc %u "
+        "step_retry %u step_probe %u step_reset %u step_reinit %u step_detach %u "
+        "captured %u missed %u gaps %u "
+        "interval %u shorter %u longer %u suppressed %u "
+        "pressure %u pressure_reads %u pressure_errors %u pressure_applies %u pressure_limited %u",
+        (long) (time(NULL) - scd->started), scd->outputs, st.samples, st.not_ready, st.commands, st.reads,
+        st.retries, st.write_errors, st.read_errors, st.crc_errors, st.soft_resets,
+        st.tr_count, st.tr_count ? st.tr_min : 0, st.tr_max, st.tr_count ? (uint32_t) (st.tr_sum / st.tr_count) : 0,
+        st.lock_taken, st.lock_contended, st.lock_timeouts, st.lock_foreign, st.lock_wait_max,
+        st.probes, st.probe_failures, st.nack_errors,
+        st.stretch_timeouts, st.stretch_changes, ready.budget, meas.budget,
+        MySensor.settings.baudrate, scd->speed.calibrations, scd->speed.stepdowns,
+        MyHealth.faults[HEALTH_BUS], MyHealth.faults[HEALTH_SENSOR], MyHealth.faults[HEALTH_STALE], MyHealth.faults[HEALTH_CRC],
+        MyHealth.steps[HEALTH_RETRY], MyHealth.steps[HEALTH_PROBE], MyHealth.steps[HEALTH_RESET],
+        MyHealth.steps[HEALTH_REINIT], MyHealth.steps[HEALTH_DETACH],
+        scd->cap.captured, scd->cap.missed, scd->cap.gaps,
+        scd->interval, scd->adapt.shorter, scd->adapt.longer, scd->adapt.suppressed,
+        scd->press.applied, scd->press.reads, scd->press.errors, scd->press.applies, scd->press.limited);
+        if (off < len) usage_stats(reply + off, len - off);
+        return;
+    
+    case CTRL_HELP:
+        snprintf(reply, len, "OK interval # | wait # | frc # | asc 0/1 | altitude # | "
+        "pressure # | tempoffset # | get | stats");
+        return;
+    
+    default:
+        snprintf(reply, len, "ERR unknown command");
+        return;
+    }
+    
+    if (ret) snprintf(reply, len, "OK");
+    else snprintf(reply, len, "ERR invalid value or SCD30 error");
+    
+    if (scd->verbose) p_printf(YELLOW, (char *) "control command %d value %d : %s\n", cmd->type, cmd->value, reply);
+}
+
+/*****************************************************************
+ * @brief attach a SCD30 that was detached (hot-plug)
+ * @param scd : pointer to SCD30 parameters
+ * 
+ * A presence check is done first. Next the SCD30 is initialized and
+ * the altitude, pressure and temperature offset are set again. A FRC 
+ * is not repeated : that is stored in the SCD30.
+ * 
+ * After a failed begin() there is no bus to probe on : begin() is
+ * the presence check then (as in the fleet).
+ * 
+ * @return true if attached, false if not present or error
+ ****************************************************************/
+bool attach_sensor(struct scd_par *scd)
+{
+    if (MySensor.settings.hw_initialized && ! MySensor.probe()) return(false);
+    
+    if (! MySensor.begin(scd->asc, scd->interval)) return(false);
+    
+    /* cable or sensor can be different */
+    if (scd->speed.max) speed_calibrate(&scd->speed, &MySensor);
+    
+    if (scd->altitude != -1 && ! MySensor.setAltitudeCompensation(scd->altitude)) return(false);
+    
+    if (scd->pressure != -1 && ! MySensor.setAmbientPressure(scd->pressure)) return(false);
+    
+    if (scd->temp_offset != -1 && ! MySensor.setTemperatureOffset(scd->temp_offset)) return(false);
+    
+    return(true);
 }
 
 /*****************************************************************
@@ -498,25 +873,35 @@ void do_output(struct scd_par *scd)
  ****************************************************************/
 void main_loop(struct scd_par *scd)
 {
-    char    buf[(SCD30_SERIAL_NUM_WORDS * 2) + 1];  // 3.1
-    int     loop_set, reset_retry = RESET_RETRY;
-    bool    first=true;
-    uint16_t val;
+    struct scd30_ident id;
+    int     loop_set;
+    bool    first=true, cached, sample;
+    uint32_t gap, wait;
+    uint16_t backoff = 0, interval, mbar;
+    int     prev;
        
     // include device information
     if (scd->d_deviceinfo)
     {
-        /* get the serial number (check that communication works) */
-        if(MySensor.getSerialNumber(buf) )
-            p_printf(YELLOW, (char *) "Serialnumber\t%s\n", buf);
-        else
-           p_printf (RED, (char *) "Error during getting serial number\n");
+        /* serial number and firmware level, from cache if still valid */
+        ident_open(scd->ident);
         
-        /* 3.1 add firmware level */
-        if (MySensor.getSettingValue(CMD_GET_FW_LEVEL, &val))
-            p_printf(YELLOW,(char *)"Firmware level\t%d.%d\n", val>>8 & 0xff, val & 0xff);
+        if (ident_get(&MySensor, &id, &cached, false))
+        {
+            p_printf(YELLOW, (char *) "Serialnumber\t%s%s\n", id.serial, cached ? " (cached)" : "");
+            p_printf(YELLOW,(char *)"Firmware level\t%d.%d\n", id.fw >> 8 & 0xff, id.fw & 0xff);
+            
+            /* remember the settings that were sent */
+            id.interval = scd->interval;
+            id.asc = scd->asc;
+            if (scd->altitude != -1) id.altitude = scd->altitude;
+            if (scd->pressure != -1) id.pressure = scd->pressure;
+            if (scd->temp_offset != -1) id.temp_offset = scd->temp_offset;
+            if (scd->frc != -1) id.frc = scd->frc;
+            ident_put(&id);
+        }
         else
-            p_printf(RED,(char *)"Could not read firmware level\n");
+           p_printf (RED, (char *) "Error during getting serial number and firmware level\n");
     }
     
     /* single measurement requested */
@@ -535,46 +920,180 @@ void main_loop(struct scd_par *scd)
         return;
     }
     
+    /* burst measurement requested : repeated -l times every -w seconds */
+    if (scd->burst)
+    {
+        struct scd30_burst b;
+        
+        /* daemon mode runs endless */
+        if (scd->daemon) scd->loop_count = 0;
+        
+        if (scd->loop_count > 0 ) loop_set = scd->loop_count;
+        else loop_set = 1;
+        
+        while (loop_set > 0)
+        {
+            if (MySensor.Burst(scd->burst, scd->reduce, &b))
+            {
+                do_output(scd);
+                
+                if (scd->verbose)
+                    p_printf(YELLOW, (char *) "%d samples, first after %u mS, on-time %u mS, %u polls%s\n",
+                    b.count, b.first_ms, b.on_ms, b.polls, b.configured ? " (configured)" : "");
+            }
+            else
+                p_printf(RED, (char *) "Can not perform burst measurement\n");
+            
+            if (scd->loop_count > 0) loop_set--;
+            
+            if (loop_set > 0)
+            {
+                if (scd->daemon) ctrl_wait(scd->loop_delay * 1000, do_control, scd);
+                else sleep(scd->loop_delay);
+            }
+        }
+        
+        return;
+    }
+    
     p_printf(GREEN,(char *)  "Starting SCD30 measurement:\n");
+    
+    scd->started = time(NULL);
+    
+    /* daemon mode runs endless */
+    if (scd->daemon) scd->loop_count = 0;
             
     /*  check for endless loop */
     if (scd->loop_count > 0 ) loop_set = scd->loop_count;
     else loop_set = 1;
     
+    health_init(&MyHealth, &MySensor, "SCD30", scd->interval);
+    
+    if (scd->capture) capture_init(&scd->cap, scd->interval);
+    
+    if (scd->adapt_max) adapt_init(&scd->adapt, scd->adapt_min, scd->adapt_max, scd->adapt_hold, scd->interval);
+    
+    if (scd->press_src[0] != 0x0 && ! press_open(&scd->press, scd->press_src, 0, 0)) closeout();
+    
     /* loop requested */
     while (loop_set > 0)
     {
-        if(MySensor.dataAvailable() == true)
+        sample = false;
+        prev = usage_enter(USAGE_ACQ);
+        
+        /* detached : check whether the SCD30 is back */
+        if (backoff)
         {
-            reset_retry = RESET_RETRY;
-            do_output(scd);
+            if (attach_sensor(scd))
+            {
+                p_printf(GREEN, (char *) "SCD30 attached\n");
+                health_init(&MyHealth, &MySensor, "SCD30", scd->interval);
+                if (scd->capture) capture_interval(&scd->cap, scd->interval);
+                press_reset(&scd->press);
+                backoff = 0;
+                first = true;
+            }
+            else if (backoff * 2 > FLEET_RETRY) backoff = FLEET_RETRY;
+            else backoff *= 2;
         }
-        else
+        else 
         {
-            if (reset_retry-- == 0)
+            sample = MySensor.dataAvailable();
+            
+            if (scd->capture)
+            {
+                /* interval can be changed with the control socket */
+                if (scd->cap.interval != scd->interval) capture_interval(&scd->cap, scd->interval);
+                
+                scd->seq = capture_poll(&scd->cap, sample, &gap);
+                
+                if (gap) 
+                    p_printf(YELLOW, (char *) "GAP: %u samples missed before seq %u\n", gap, scd->seq);
+            }
+            
+            if (sample) do_output(scd);
+            
+            /* Prevent message when previous mode of the SCD30 was 
+             * STOP continuous measurement. It needs 4 seconds 
+             * at least for the first results in that case */
+            else if (first) first = false;
+            else if (! scd->capture) printf("no data available\n");
+            
+            /* adaptive interval : follow the rate of change of CO2 */
+            if (sample && scd->adapt_max && (interval = adapt_sample(&scd->adapt, scd->co2)))
             {
-                p_printf (RED, (char *) "Retry count exceeded. perform softreset\n");
-                MySensor.SoftReset();
-                reset_retry = RESET_RETRY;
+                if (MySensor.setMeasurementInterval(interval))
+                {
+                    p_printf(YELLOW, (char *) "interval %d -> %d seconds (rate %3.1f ppm/min, spread %3.1f ppm)\n",
+                        scd->interval, interval, scd->adapt.rate, scd->adapt.spread);
+                    
+                    adapt_set(&scd->adapt, interval);
+                    scd->interval = interval;
+                }
+                else
+                    p_printf(RED, (char *) "Could not set measurement interval %d\n", interval);
+            }
+            
+            /* interval can be changed with the control socket */
+            MyHealth.interval = scd->interval;
+            
+            switch(health_check(&MyHealth, &MySensor, sample))
+            {
+            case HEALTH_RESET:
+            case HEALTH_REINIT:
+                if (scd->capture) capture_interval(&scd->cap, scd->interval);
+                press_reset(&scd->press);
                 first = true;
+                break;
+            
+            case HEALTH_DETACH:
+                p_printf (RED, (char *) "SCD30 is not responding : detached\n");
+                backoff = FLEET_BACKOFF;
+                break;
+            
+            default:
+                break;
             }
-            else
+            
+            /* errors rising : lower the I2C speed */
+            if (! backoff) speed_check(&scd->speed, &MySensor);
+            
+            /* ambient pressure : restarts the measurement, only on a change */
+            if (! backoff && (mbar = press_check(&scd->press)))
             {
-                /* Prevent message when previous mode of the SCD30 was 
-                 * STOP continuous measurement. It needs 4 seconds 
-                 * at least for the first results in that case */
-                 
-                if (first)  first = false;
-                else printf("no data available\n");
+                if (MySensor.setAmbientPressure(mbar))
+                {
+                    if (scd->verbose) p_printf(YELLOW, (char *) "ambient pressure %d mbar\n", mbar);
+                    
+                    press_applied(&scd->press, mbar);
+                    scd->pressure = mbar;
+                    if (scd->capture) capture_interval(&scd->cap, scd->interval);
+                }
+                else
+                    p_printf(RED, (char *) "Could not set ambient pressure %d\n", mbar);
             }
         }
         
-        /* delay for seconds */
-        sleep(scd->loop_delay);
+        usage_leave(prev);
         
-        /* check for endless loop */
-        if (scd->loop_count > 0) loop_set--;
+        /* delay (servicing control commands in daemon mode) */
+        if (backoff) wait = backoff * 1000;
+        else if (scd->capture) wait = capture_wait(&scd->cap);
+        else if (scd->adapt_max) wait = scd->interval * 1000;
+        else wait = scd->loop_delay * 1000;
+        
+        if (scd->daemon) ctrl_wait(wait, do_control, scd);
+        else usleep(wait * 1000);
+        
+        usage_wakeup();
+        
+        /* check for endless loop (capture counts the samples) */
+        if (scd->loop_count > 0 && (sample || ! scd->capture)) loop_set--;
     }
+    
+    if (scd->capture)
+        p_printf(GREEN, (char *) "captured %u samples, missed %u in %u gaps : %3.2f%% complete\n", 
+        scd->cap.captured, scd->cap.missed, scd->cap.gaps, capture_completeness(&scd->cap));
 }       
 
 /*********************************************************************
@@ -598,6 +1117,8 @@ void usage(struct scd_par *scd)
     "-k         stop continuous measurement             (No default)\n"
     "-c         set for continuous measurement          (default)\n"
     "-S         perform single measurement              (No default)\n"
+    "-N #[,a|m] burst of # samples, average (a) or median (m). Repeated -l\n"
+    "           times every -w seconds                  (No default)\n"
     "-b         Only display measurement interval\n"
     "-r         Only display forced recalibration factor\n"
     "-e         Only display temperature offset\n"
@@ -612,6 +1133,22 @@ void usage(struct scd_par *scd)
     "-x         add dew-point to output\n"
     "-u         add heat-index to output\n"
     "-F         show temperature in Fahrenheit\n"
+    "-Z path    daemon mode: run endless with control socket (default %s)\n"
+    "-C file    run the fleet of sensors in configuration file\n"
+    "-R p[,c]   real-time profile: SCHED_FIFO priority p (1 - 99), pin to CPU c\n"
+    "-I file    identity cache for -j and fleet         (default %s)\n"
+    "-T #       benchmark transport overhead with # transactions and exit\n"
+    "-J #       check the asynchronous API with # emulated sensors (1 - %d) and exit\n"
+    "-W #[,s,n] pipeline throughput with max. # workers, s emulated sensors\n"
+    "           (256) x n samples (2000) and exit\n"
+    "-L         lossless capture: read every sample (-w is ignored), report gaps\n"
+    "-A n,x[,h] adaptive interval n - x seconds, h seconds between increases\n"
+    "           (default h is %d, -w is ignored)\n"
+    "-E source  ambient pressure from file:path[,scale] or udp:[addr:]port\n"
+    "-U #       resource usage per stage in stats, summary every # seconds (0 = none)\n"
+    "-M #[,f]   check # emulated samples to file f (/dev/null) allocate no memory\n"
+    "           (needs a build with make ALLOC=1)\n"
+    "           after warm-up and exit\n"
     
 #ifdef DYLOS 
     "\nDylos DC1700: \n"
@@ -619,13 +1156,21 @@ void usage(struct scd_par *scd)
 #endif    
     "\nI2C settings: \n"
     "-H         use hardware I2C                        (default:soft_I2C)\n"
+    "-O         soft_I2C with the built-in engine       (default twowire)\n"
+    "-G #       check the built-in engine at # Khz on a mock and exit\n"
+    "-V #[,s,f] simulate the built-in engine at # Khz on a bit-level SCD30,\n"
+    "           s uS clock stretch (%d), waveform to VCD file f, and exit\n"
+    "-Y port    SCD30 on Modbus over UART port (e.g. /dev/ttyUSB0) instead of I2C\n"
+    "-X #       check Modbus with # samples on an emulated SCD30 (pty) and exit\n"
     "-q #       set I2C speed                           (default is %dkhz)\n"
+    "-Q #[,e]   tune I2C speed up to # Khz, max. e errors per 1000 (default %d)\n"
     "-s #       set SDA GPIO for soft_I2C               (default GPIO %d)\n"
     "-d #       set SCL GPIO for soft_I2C               (default GPIO %d)\n"
     "-P         set internal pullup resistor on SDA/SCL (default not set)\n"
+    "-K #       max. mS to wait on the bus lock (0 = no lock) (default %d)\n"
     
    ,progname, VERSIONMAJOR, VERSIONMINOR, scd->interval, scd->loop_count, scd->loop_delay, scd->verbose,
-   SCD30_SPEED, DEF_SDA, DEF_SCL);
+   CTRL_SOCKET, IDENT_FILE, SCD30_MAXBUS, ADAPT_HOLD, SIM_STRETCH, SCD30_SPEED, SPEED_BUDGET, DEF_SDA, DEF_SCL, SCD30_LOCK_TIMEOUT);
 }
 
 /*********************************************************************
@@ -636,6 +1181,8 @@ void usage(struct scd_par *scd)
 
 void parse_cmdline(int opt, char *option, struct scd_par *scd)
 {
+    char *p;
+    
     switch (opt) {
         
     case 'a':   // set Automatic Self Calibration (ASC)
@@ -669,10 +1216,10 @@ void parse_cmdline(int opt, char *option, struct scd_par *scd)
     case 'm':   // altitude in meters
         scd->altitude = (int16_t) strtod(option, NULL);
       
-        // 700 mbar ~ 3040M altitude, 1200mbar ~ -1520
-        if (scd->altitude < -1520 || scd->altitude > 3040)
+        if (! scd30_cmd_valid(SCD30_CMD_ALTITUDE, scd->altitude))
         {
-            p_printf (RED, (char *) "Incorrect altitude. Must be between -1520 and 3040 meter\n");
+            p_printf (RED, (char *) "Incorrect altitude. Must be between %d and %d meter\n",
+                scd30_cmds[SCD30_CMD_ALTITUDE].min, scd30_cmds[SCD30_CMD_ALTITUDE].max);
             exit(EXIT_FAILURE);
         }
       
@@ -687,14 +1234,11 @@ void parse_cmdline(int opt, char *option, struct scd_par *scd)
         scd->pressure = (int16_t) strtod(option, NULL);
         
         // setting to zero will de-activate
-        if (scd->pressure != 0)
+        if (! scd30_cmd_valid(SCD30_CMD_START, scd->pressure))
         {
-            // must be between 700 and 1200 mbar
-            if (scd->pressure < 700 || scd->pressure > 1200)
-            {
-                p_printf (RED, (char *) "Incorrect pressure. Must be between 700 and 1200 mbar\n");
-                exit(EXIT_FAILURE);
-            }
+            p_printf (RED, (char *) "Incorrect pressure. Must be between %d and %d mbar\n",
+                scd30_cmds[SCD30_CMD_START].min, scd30_cmds[SCD30_CMD_START].max);
+            exit(EXIT_FAILURE);
         }
                     
         if (scd->altitude != -1)
@@ -707,10 +1251,10 @@ void parse_cmdline(int opt, char *option, struct scd_par *scd)
     case 'i':   // SCD30 interval 
         scd->interval = (uint16_t) strtod(option, NULL);
         
-        // must be between 2 and 1800 seconds
-        if (scd->interval < 2 || scd->interval > 1800)
+        if (! scd30_cmd_valid(SCD30_CMD_INTERVAL, scd->interval))
         {
-            p_printf (RED, (char *) "Incorrect interval %d. Must be between 2 and 1800 seconds\n", scd->interval);
+            p_printf (RED, (char *) "Incorrect interval %d. Must be between %d and %d seconds\n", scd->interval,
+                scd30_cmds[SCD30_CMD_INTERVAL].min, scd30_cmds[SCD30_CMD_INTERVAL].max);
             exit(EXIT_FAILURE);
         }
         break;
@@ -718,10 +1262,10 @@ void parse_cmdline(int opt, char *option, struct scd_par *scd)
      case 'o':   // temperature offset
         scd->temp_offset = (uint16_t) strtod(option, NULL);
         
-        // must be between 0 and 25 degrees
-        if (scd->temp_offset < 0 || scd->temp_offset > 25)
+        if (! scd30_cmd_valid(SCD30_CMD_TEMP_OFFSET, scd->temp_offset))
         {
-            p_printf (RED, (char *) "Incorrect temperature offset %d. Must be between 0 and 25C degrees\n",scd->temp_offset );
+            p_printf (RED, (char *) "Incorrect temperature offset %d. Must be between %d and %dC degrees\n",scd->temp_offset,
+                scd30_cmds[SCD30_CMD_TEMP_OFFSET].min, scd30_cmds[SCD30_CMD_TEMP_OFFSET].max);
             exit(EXIT_FAILURE);
         }
         break;
@@ -730,10 +1274,10 @@ void parse_cmdline(int opt, char *option, struct scd_par *scd)
         scd->frc = (uint16_t) strtod(option, NULL);
         scd->asc = false;
         
-        // must be between 400 and 2000 ppm
-        if (scd->frc < 400 || scd->frc > 2000)
+        if (! scd30_cmd_valid(SCD30_CMD_FRC, scd->frc))
         {
-            p_printf (RED, (char *) "Incorrect recalibration value (FRC) %d. Must be between 400 and 2000 ppm\n", scd->frc);
+            p_printf (RED, (char *) "Incorrect recalibration value (FRC) %d. Must be between %d and %d ppm\n", scd->frc,
+                scd30_cmds[SCD30_CMD_FRC].min, scd30_cmds[SCD30_CMD_FRC].max);
             exit(EXIT_FAILURE);
         }
         
@@ -778,6 +1322,10 @@ void parse_cmdline(int opt, char *option, struct scd_par *scd)
         }
         break;
 
+    case 'L':   // lossless capture
+        scd->capture = true;
+        break;
+        
     case 'u':   // add heatindex to output
         scd->heatindex = true;
         break;
@@ -790,6 +1338,14 @@ void parse_cmdline(int opt, char *option, struct scd_par *scd)
     case 'H':   // i2C interface 
         MySensor.settings.I2C_interface = hard_I2C; 
         break;
+    
+    case 'O':   // soft_I2C with the built-in engine
+        MySensor.settings.engine = true;
+        break;
+    
+    case 'Y':   // Modbus over UART
+        MySensor.settings.modbus = option;
+        break;
  
     case 'P':   // enable internal BCM2835 pullup resistor 
         MySensor.settings.pullup = true; 
@@ -805,6 +1361,23 @@ void parse_cmdline(int opt, char *option, struct scd_par *scd)
         }
         break; 
       
+    case 'Q':   // I2C speed tuning : max[,budget]
+    {
+        uint16_t max, budget = SPEED_BUDGET;
+        
+        max = (uint16_t) strtol(option, &p, 10);
+        if (*p == ',') budget = (uint16_t) strtol(p + 1, &p, 10);
+        
+        if (*p != 0x0 || max < 10 || max > 400 || budget < 1 || budget > 1000)
+        {
+            p_printf(RED, (char *) "Invalid %s. Must be max. speed 10 - 400 Khz[,errors per 1000]\n", option);
+            exit(EXIT_FAILURE);
+        }
+        
+        speed_init(&scd->speed, "SCD30", max, budget);
+        break;
+    }
+    
     case 'd':   // change default SCL line for soft_I2C
         MySensor.settings.scl = (int)strtod(option, NULL);
       
@@ -827,14 +1400,184 @@ void parse_cmdline(int opt, char *option, struct scd_par *scd)
         }   
         break;       
 
+    case 'K':   // bus lock timeout
+        MySensor.settings.lock_timeout = (uint16_t) strtod(option, NULL);
+        break;
+        
     case 'D':   // include Dylos read
 #ifdef DYLOS
-        strncpy(scd->dylos.port, option, MAXBUF);
+        strncpy(scd->dylos.port, option, MAXBUF - 1);
+        scd->dylos.port[MAXBUF - 1] = 0x0;
         scd->dylos.include = true;
 #else
         p_printf(RED, (char *) "Dylos is not supported in this build\n");
 #endif
         break;
+    case 'Z':   // daemon mode with control socket
+        strncpy(scd->ctrl_socket, option, MAXBUF - 1);
+        scd->daemon = true;
+        break;
+        
+    case 'I':   // identity cache file
+        strncpy(scd->ident, option, MAXBUF - 1);
+        break;
+        
+    case 'C':   // fleet configuration file
+        if (strlen(option) >= MAXBUF)
+        {
+            p_printf(RED, (char *) "Configuration file name too long : %s\n", option);
+            exit(EXIT_FAILURE);
+        }
+        strcpy(scd->config, option);
+        break;
+        
+    case 'R':   // real-time profile : priority[,cpu]
+        scd->rt_prio = (int) strtol(option, &p, 10);
+        
+        if (*p == ',') scd->rt_cpu = (int) strtol(p + 1, &p, 10);
+        
+        if (*p != 0x0 || scd->rt_prio < 1 || scd->rt_prio > 99 || scd->rt_cpu < -1)
+        {
+            p_printf(RED, (char *) "Invalid real-time option %s. Must be priority 1 - 99 [,cpu]\n", option);
+            exit(EXIT_FAILURE);
+        }
+        break;
+        
+    case 'A':   // adaptive interval : min,max[,hold]
+        scd->adapt_min = (uint16_t) strtol(option, &p, 10);
+        
+        if (*p == ',') scd->adapt_max = (uint16_t) strtol(p + 1, &p, 10);
+        if (*p == ',') scd->adapt_hold = (uint16_t) strtol(p + 1, &p, 10);
+        
+        if (*p != 0x0 || ! scd30_cmd_valid(SCD30_CMD_INTERVAL, scd->adapt_min) ||
+            ! scd30_cmd_valid(SCD30_CMD_INTERVAL, scd->adapt_max) || scd->adapt_min >= scd->adapt_max)
+        {
+            p_printf(RED, (char *) "Invalid adaptive interval %s. Must be min,max[,hold] between %d and %d seconds\n", option,
+                scd30_cmds[SCD30_CMD_INTERVAL].min, scd30_cmds[SCD30_CMD_INTERVAL].max);
+            exit(EXIT_FAILURE);
+        }
+        break;
+        
+    case 'E':   // ambient pressure source
+        if (strlen(option) >= PRESS_SPECLEN)
+        {
+            p_printf(RED, (char *) "Pressure source too long : %s\n", option);
+            exit(EXIT_FAILURE);
+        }
+        strcpy(scd->press_src, option);
+        break;
+        
+    case 'N':   // burst : samples[,a|m]
+        scd->burst = (uint8_t) strtol(option, &p, 10);
+        
+        if (*p == ',' && (p[1] == 'a' || p[1] == 'm') && p[2] == 0x0)
+        {
+            scd->reduce = p[1] == 'a' ? BURST_AVERAGE : BURST_MEDIAN;
+            p += 2;
+        }
+        
+        if (*p != 0x0 || scd->burst < 1 || scd->burst > BURST_MAX)
+        {
+            p_printf(RED, (char *) "Invalid burst %s. Must be 1 - %d samples [,a|m]\n", option, BURST_MAX);
+            exit(EXIT_FAILURE);
+        }
+        
+        scd->interval = 0;       // stopped in between bursts
+        break;
+        
+    case 'U':   // resource usage : seconds between summaries
+        usage_init((uint32_t) strtoul(option, &p, 10));
+        
+        if (*p != 0x0)
+        {
+            p_printf(RED, (char *) "Invalid %s. Must be seconds between summaries\n", option);
+            exit(EXIT_FAILURE);
+        }
+        break;
+        
+    case 'M':   // allocation check (no hardware needed)
+    {
+        uint32_t samples = (uint32_t) strtoul(option, &p, 10);
+        
+        if (*p != 0x0 && *p != ',')
+        {
+            p_printf(RED, (char *) "Invalid %s. Must be samples[,file]\n", option);
+            exit(EXIT_FAILURE);
+        }
+        
+        exit(alloc_check(samples ? : 100000, *p == ',' ? p + 1 : "/dev/null") ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+        
+    case 'G':   // built-in engine check (no hardware needed)
+    {
+        uint32_t khz = (uint32_t) strtoul(option, &p, 10);
+        
+        if (*p != 0x0 || khz < 1 || khz > 400)
+        {
+            p_printf(RED, (char *) "Invalid %s. Must be 1 - 400 Khz\n", option);
+            exit(EXIT_FAILURE);
+        }
+        
+        exit(gpio_check(khz) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    
+    case 'V':   // bit-level bus simulator (no hardware needed)
+    {
+        uint32_t khz, stretch = SIM_STRETCH;
+        
+        khz = (uint32_t) strtoul(option, &p, 10);
+        if (*p == ',') stretch = (uint32_t) strtoul(p + 1, &p, 10);
+        
+        /* within the clock stretch limit of the commands that are used */
+        if ((*p != 0x0 && *p != ',') || khz < 1 || khz > 400 || 
+            stretch >= scd30_cmds[SCD30_CMD_DATA_READY].stretch_us)
+        {
+            p_printf(RED, (char *) "Invalid %s. Must be 1 - 400 Khz[,stretch uS < %u[,file]]\n", option,
+                scd30_cmds[SCD30_CMD_DATA_READY].stretch_us);
+            exit(EXIT_FAILURE);
+        }
+        
+        exit(sim_run(khz, stretch, *p == ',' ? p + 1 : NULL) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    
+    case 'X':   // Modbus check (no hardware needed)
+        exit(modbus_check((uint32_t) strtoul(option, NULL, 10) ? : 100) ? EXIT_SUCCESS : EXIT_FAILURE);
+    
+    case 'J':   // asynchronous API check (no hardware needed)
+    {
+        int sensors = (int) strtol(option, &p, 10);
+        
+        if (*p != 0x0 || sensors < 1 || sensors > SCD30_MAXBUS)
+        {
+            p_printf(RED, (char *) "Invalid %s. Must be 1 - %d sensors\n", option, SCD30_MAXBUS);
+            exit(EXIT_FAILURE);
+        }
+        
+        exit(async_check(sensors) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    
+    case 'T':   // transport benchmark (no hardware needed)
+        transport_bench((uint32_t) strtoul(option, NULL, 10) ? : 100000);
+        exit(EXIT_SUCCESS);
+    
+    case 'W':   // work-stealing pipeline benchmark (no hardware needed)
+    {
+        int workers, sensors = 256, samples = 2000;
+        
+        workers = (int) strtol(option, &p, 10);
+        if (*p == ',') sensors = (int) strtol(p + 1, &p, 10);
+        if (*p == ',') samples = (int) strtol(p + 1, &p, 10);
+        
+        if (*p != 0x0 || workers < 1 || workers > STEAL_MAXWORKER || sensors < 1 || samples < 1)
+        {
+            p_printf(RED, (char *) "Invalid %s. Must be workers (1 - %d)[,sensors,samples]\n", option, STEAL_MAXWORKER);
+            exit(EXIT_FAILURE);
+        }
+        
+        steal_bench(workers, sensors, samples);
+        exit(EXIT_SUCCESS);
+    }
+        
     case 'h':   // help  (No break)
     
     default: /* '?' */
@@ -856,19 +1599,63 @@ int main(int argc, char *argv[])
     set_signals(); 
  
     /* save name for (potential) usage display */
-    strncpy(progname,argv[0],20);
+    strncpy(progname,argv[0],sizeof(progname) - 1);
     
     /* set the initial values */
     init_variables(&scd);
 
     /* parse commandline */
-    while ((opt = getopt(argc, argv, "abregjni:f:m:o:p:kcSBl:v:w:tHs:d:q:PD:hFxu")) != -1)
+    while ((opt = getopt(argc, argv, "abregjni:f:m:o:p:kcSBl:v:w:tHs:d:q:PD:hFxuZ:C:R:K:I:LA:E:N:T:W:U:M:Q:OG:Y:X:V:J:")) != -1)
     {
         parse_cmdline(opt, optarg, &scd);
     }
+    
+    /* start within the adaptive bounds (0 is stop measurement) */
+    if (scd.adapt_max && scd.interval)
+    {
+        if (scd.interval < scd.adapt_min) scd.interval = scd.adapt_min;
+        if (scd.interval > scd.adapt_max) scd.interval = scd.adapt_max;
+    }
 
+    /* fleet of sensors from configuration file */
+    if (scd.config[0] != 0x0)
+    {
+        struct fleet_opt opt;
+        
+        opt.timestamp = scd.timestamp;
+        opt.tempCel = scd.tempCel;
+        opt.heatindex = scd.heatindex;
+        opt.dewpoint = scd.dewpoint;
+        opt.verbose = scd.verbose;
+        opt.daemon = scd.daemon;
+        opt.ctrl_socket = scd.ctrl_socket;
+        opt.ident = scd.ident;
+        
+        if (scd.rt_prio && ! rt_enable(scd.rt_prio, scd.rt_cpu)) closeout();
+        
+        fleet_run(scd.config, &opt);
+        
+        /* only returns in case of error */
+        closeout();
+    }
+    
     /* initialise hardware */
     init_hw(&scd);
+    
+    /* real-time profile : show the impact on the transaction jitter */
+    if (scd.rt_prio)
+    {
+        struct rt_jitter before, after;
+        
+        rt_measure(&MySensor, RT_JITTER_SAMPLES, &before);
+        
+        if (! rt_enable(scd.rt_prio, scd.rt_cpu)) closeout();
+        
+        rt_measure(&MySensor, RT_JITTER_SAMPLES, &after);
+        
+        rt_report("normal", &before);
+        rt_report("real-time", &after);
+    }
   
     /* main loop to read SCD30 results */
     main_loop(&scd);
@@ -0,0 +1,194 @@
+/*******************************************************************
+ *
+ * Adaptive measurement interval for SCD30 sensors.
+ *
+ * The rate is the slope of a least squares line through the samples
+ * in the window, using the time the samples were read. That way the
+ * window stays valid across interval changes. The spread is the
+ * standard deviation of the samples around that line.
+ *
+ * An event only needs 3 samples, so a rise is acted on quickly. An
+ * idle period needs a full window, so a short pause in a rise does
+ * not make the interval longer.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "scd30_adapt.h"
+# include <math.h>
+# include <string.h>
+# include <time.h>
+
+/*********************************************************************
+ * @brief get monotonic time in milli seconds
+ *********************************************************************/
+uint64_t adapt_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return((uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/*********************************************************************
+ * @brief start the controller (all counters are reset)
+ * @param a : controller
+ * @param min : shortest interval in seconds (2 - 1800)
+ * @param max : longest interval in seconds (min - 1800)
+ * @param hold : seconds between changes to longer (0 = ADAPT_HOLD)
+ * @param interval : current measurement interval in seconds
+ *********************************************************************/
+void adapt_init(struct scd30_adapt *a, uint16_t min, uint16_t max, uint16_t hold, uint16_t interval)
+{
+    memset(a, 0x0, sizeof(struct scd30_adapt));
+
+    a->min = min;
+    a->max = max;
+    a->hold = hold ? hold : ADAPT_HOLD;
+    a->interval = interval;
+    a->budget = ADAPT_BUDGET;
+    a->changed = a->refill = adapt_ms();
+}
+
+/*********************************************************************
+ * @brief determine rate and spread of the samples in the window
+ * @param a : controller
+ *********************************************************************/
+void adapt_fit(struct scd30_adapt *a)
+{
+    float   x[ADAPT_WINDOW], mx = 0, my = 0, sxx = 0, sxy = 0, res, sum = 0;
+    uint8_t i, j;
+
+    /* oldest sample is the origin, x in minutes */
+    j = (a->head + ADAPT_WINDOW - a->num) % ADAPT_WINDOW;
+
+    for (i = 0; i < a->num; i++)
+    {
+        x[i] = (float) (a->t[(j + i) % ADAPT_WINDOW] - a->t[j]) / 60000;
+        mx += x[i];
+        my += a->co2[(j + i) % ADAPT_WINDOW];
+    }
+
+    mx /= a->num;
+    my /= a->num;
+
+    for (i = 0; i < a->num; i++)
+    {
+        sxx += (x[i] - mx) * (x[i] - mx);
+        sxy += (x[i] - mx) * (a->co2[(j + i) % ADAPT_WINDOW] - my);
+    }
+
+    a->rate = sxx > 0 ? sxy / sxx : 0;
+
+    for (i = 0; i < a->num; i++)
+    {
+        res = a->co2[(j + i) % ADAPT_WINDOW] - (my + a->rate * (x[i] - mx));
+        sum += res * res;
+    }
+
+    a->spread = sqrt(sum / a->num);
+}
+
+/*********************************************************************
+ * @brief add a sample
+ * @param a : controller
+ * @param co2 : CO2 in ppm
+ *
+ * @return new interval to set, 0 if no change. Call adapt_set()
+ * once the SCD30 accepted it.
+ *********************************************************************/
+uint16_t adapt_sample(struct scd30_adapt *a, float co2)
+{
+    uint64_t now = adapt_ms();
+    uint16_t interval;
+    float   rate;
+
+    /* refill the write budget */
+    while (now - a->refill >= (uint64_t) ADAPT_REFILL * 1000)
+    {
+        a->refill += (uint64_t) ADAPT_REFILL * 1000;
+        if (a->budget < ADAPT_BUDGET) a->budget++;
+    }
+
+    a->t[a->head] = now;
+    a->co2[a->head] = co2;
+    a->head = (a->head + 1) % ADAPT_WINDOW;
+    if (a->num < ADAPT_WINDOW) a->num++;
+
+    if (a->num < 3) return(0);
+
+    adapt_fit(a);
+
+    rate = fabs(a->rate);
+
+    /* event : shorter interval */
+    if (rate >= ADAPT_RATE_FAST || a->spread >= ADAPT_NOISE)
+    {
+        interval = a->interval / 4;
+        if (interval < a->min) interval = a->min;
+
+        if (interval == a->interval) return(0);
+
+        if (a->budget == 0 || now - a->changed < (uint64_t) ADAPT_HOLD_EVENT * 1000)
+        {
+            a->suppressed++;
+            return(0);
+        }
+
+        return(interval);
+    }
+
+    /* idle : longer interval */
+    if (a->num == ADAPT_WINDOW && rate <= ADAPT_RATE_FLAT)
+    {
+        interval = a->interval * 2 > a->max ? a->max : a->interval * 2;
+
+        if (interval == a->interval) return(0);
+
+        /* keep a write for the next event */
+        if (a->budget < 2 || now - a->changed < (uint64_t) a->hold * 1000)
+        {
+            a->suppressed++;
+            return(0);
+        }
+
+        return(interval);
+    }
+
+    return(0);
+}
+
+/*********************************************************************
+ * @brief the measurement interval was set
+ * @param a : controller
+ * @param interval : interval in seconds
+ *
+ * Also used if the interval was set otherwise (control command), as
+ * that is a write to non-volatile memory as well.
+ *********************************************************************/
+void adapt_set(struct scd30_adapt *a, uint16_t interval)
+{
+    if (interval < a->interval) a->shorter++;
+    else if (interval > a->interval) a->longer++;
+
+    a->interval = interval;
+    a->changed = adapt_ms();
+    if (a->budget > 0) a->budget--;
+}
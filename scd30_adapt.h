@@ -0,0 +1,124 @@
+/*******************************************************************
+ *
+ * Adaptive measurement interval for SCD30 sensors.
+ *
+ * The SCD30 accepts a measurement interval of 2 to 1800 seconds. A
+ * fixed interval is either wasting bus traffic and power when the CO2
+ * level is flat, or missing the rise when a room fills up.
+ *
+ * The controller keeps the last ADAPT_WINDOW CO2 samples and fits a
+ * straight line through them. From that it takes the rate of change
+ * (ppm / minute) and the spread around the line (standard deviation) :
+ *
+ *  event : rate >= ADAPT_RATE_FAST or spread >= ADAPT_NOISE
+ *          the interval is divided by 4 (not below the minimum)
+ *  idle  : rate <= ADAPT_RATE_FLAT and spread < ADAPT_NOISE over a
+ *          full window : the interval is doubled (not above the maximum)
+ *
+ * The measurement interval is stored in non-volatile memory of the
+ * SCD30, so the writes are rate limited :
+ *
+ *  - a shorter interval is allowed ADAPT_HOLD_EVENT seconds after the
+ *    previous change, a longer one after 'hold' seconds.
+ *  - a budget of ADAPT_BUDGET writes, refilled with one write every
+ *    ADAPT_REFILL seconds (48 writes / day).
+ *
+ * A change that is not allowed is counted as suppressed.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_ADAPT_H__
+#define __SCD30_ADAPT_H__
+
+# include <stdint.h>
+
+/* number of samples to determine rate and spread */
+# define ADAPT_WINDOW 8
+
+/* ppm / minute considered an event */
+# define ADAPT_RATE_FAST 20
+
+/* ppm / minute considered flat */
+# define ADAPT_RATE_FLAT 2
+
+/* standard deviation in ppm above which the level is not stable */
+# define ADAPT_NOISE 15
+
+/* default seconds between interval changes to a longer interval */
+# define ADAPT_HOLD 600
+
+/* seconds between interval changes to a shorter interval */
+# define ADAPT_HOLD_EVENT 60
+
+/* max. interval writes in a row and seconds to refill one */
+# define ADAPT_BUDGET 6
+# define ADAPT_REFILL 1800
+
+struct scd30_adapt
+{
+    uint16_t    min;                    // shortest interval in seconds
+    uint16_t    max;                    // longest interval in seconds
+    uint16_t    hold;                   // seconds between changes to longer
+    uint16_t    interval;               // current interval in seconds
+    uint64_t    changed;                // mS of last change
+    uint64_t    refill;                 // mS of last budget refill
+    uint8_t     budget;                 // interval writes left
+
+    /* window of samples */
+    uint64_t    t[ADAPT_WINDOW];        // mS of sample
+    float       co2[ADAPT_WINDOW];      // CO2 in ppm
+    uint8_t     head;                   // next entry to write
+    uint8_t     num;                    // entries in use
+
+    /* last evaluation */
+    float       rate;                   // ppm / minute
+    float       spread;                 // standard deviation in ppm
+
+    /* counters */
+    uint32_t    shorter;                // changes to a shorter interval
+    uint32_t    longer;                 // changes to a longer interval
+    uint32_t    suppressed;             // changes not allowed (rate limit)
+};
+
+/*! start the controller (all counters are reset)
+ * @param a : controller
+ * @param min : shortest interval in seconds (2 - 1800)
+ * @param max : longest interval in seconds (min - 1800)
+ * @param hold : seconds between changes to longer (0 = ADAPT_HOLD)
+ * @param interval : current measurement interval in seconds
+ */
+void adapt_init(struct scd30_adapt *a, uint16_t min, uint16_t max, uint16_t hold, uint16_t interval);
+
+/*! add a sample
+ * @param a : controller
+ * @param co2 : CO2 in ppm
+ *
+ * @return new interval to set, 0 if no change. Call adapt_set()
+ * once the SCD30 accepted it.
+ */
+uint16_t adapt_sample(struct scd30_adapt *a, float co2);
+
+/*! the measurement interval was set
+ * @param a : controller
+ * @param interval : interval in seconds
+ */
+void adapt_set(struct scd30_adapt *a, uint16_t interval);
+
+#endif  // End of definition check
@@ -0,0 +1,226 @@
+/*******************************************************************
+ *
+ * Allocation counting and the steady state allocation check.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "scd30_alloc.h"
+# include "scd30_emul.h"
+# include "scd30_sink.h"
+# include "scd30_usage.h"
+# include "scd30_fleet.h"
+# include <errno.h>
+
+/* counters, updated from any thread */
+static struct alloc_count alloc_cnt;
+
+/* fleet with one sensor on an emulated SCD30 for the check */
+static struct scd30_emul emul;
+static struct fleet_conf conf;
+static struct fleet_opt opt;
+
+#ifdef SCD30_ALLOC
+/*********************************************************************
+ * interposed allocator : count and call the C library
+ *********************************************************************/
+extern "C"
+{
+    extern void *__libc_malloc(size_t size) noexcept;
+    extern void *__libc_calloc(size_t num, size_t size) noexcept;
+    extern void *__libc_realloc(void *ptr, size_t size) noexcept;
+    extern void *__libc_memalign(size_t align, size_t size) noexcept;
+    extern void __libc_free(void *ptr) noexcept;
+
+    void *malloc(size_t size) noexcept
+    {
+        __atomic_add_fetch(&alloc_cnt.allocs, 1, __ATOMIC_RELAXED);
+        return(__libc_malloc(size));
+    }
+
+    void *calloc(size_t num, size_t size) noexcept
+    {
+        __atomic_add_fetch(&alloc_cnt.allocs, 1, __ATOMIC_RELAXED);
+        return(__libc_calloc(num, size));
+    }
+
+    void *realloc(void *ptr, size_t size) noexcept
+    {
+        __atomic_add_fetch(&alloc_cnt.reallocs, 1, __ATOMIC_RELAXED);
+        return(__libc_realloc(ptr, size));
+    }
+
+    void *memalign(size_t align, size_t size) noexcept
+    {
+        __atomic_add_fetch(&alloc_cnt.allocs, 1, __ATOMIC_RELAXED);
+        return(__libc_memalign(align, size));
+    }
+
+    void *aligned_alloc(size_t align, size_t size) noexcept
+    {
+        return(memalign(align, size));
+    }
+
+    int posix_memalign(void **ptr, size_t align, size_t size) noexcept
+    {
+        void *p;
+
+        if (align < sizeof(void *) || (align & (align - 1))) return(EINVAL);
+
+        if ((p = memalign(align, size)) == NULL) return(ENOMEM);
+
+        *ptr = p;
+        return(0);
+    }
+
+    void free(void *ptr) noexcept
+    {
+        if (ptr == NULL) return;
+
+        __atomic_add_fetch(&alloc_cnt.frees, 1, __ATOMIC_RELAXED);
+        __libc_free(ptr);
+    }
+}
+#endif
+
+/*********************************************************************
+ * @brief get the allocation counters
+ * @param c : to store the counters
+ *********************************************************************/
+void alloc_get(struct alloc_count *c)
+{
+    c->allocs = __atomic_load_n(&alloc_cnt.allocs, __ATOMIC_RELAXED);
+    c->reallocs = __atomic_load_n(&alloc_cnt.reallocs, __ATOMIC_RELAXED);
+    c->frees = __atomic_load_n(&alloc_cnt.frees, __ATOMIC_RELAXED);
+}
+
+/*********************************************************************
+ * @brief one sample of the emulated SCD30 through the fleet
+ * @param n : sample number
+ *
+ * The sensor is polled as by the fleet loop : bus queue, data ready
+ * and read through the driver, health, fleet_output() to the sink and
+ * the resource usage accounting.
+ *
+ * @return true = a result was written, false is error
+ *********************************************************************/
+static bool alloc_sample(uint32_t n)
+{
+    /* the emulated values drift a little each sample */
+    emul_set(&emul, 600 + (n % 200), 21 + (n % 7) * 0.1, 45 + (n % 11) * 0.2);
+
+    return(fleet_step(true) == n + 1);
+}
+
+/*********************************************************************
+ * @brief check that samples do not allocate memory after the warm-up
+ * @param samples : number of samples
+ * @param path : file sink (e.g. /dev/null)
+ *
+ * @return true = no allocations, false is allocations or error
+ *********************************************************************/
+bool alloc_check(uint32_t samples, const char *path)
+{
+    struct fleet_cfg *cfg = &conf.sensor[0];
+    struct alloc_count warm, end;
+    uint32_t n, errors = 0, step = samples / 10 ? samples / 10 : 1;
+
+#ifndef SCD30_ALLOC
+    p_printf(RED, (char *) "allocations are not counted in this build (make ALLOC=1)\n");
+    return(false);
+#endif
+
+    if (samples <= ALLOC_WARMUP)
+    {
+        p_printf(RED, (char *) "need more than %d samples (warm-up)\n", ALLOC_WARMUP);
+        return(false);
+    }
+
+    if (strlen(path) >= SINK_PATHLEN)
+    {
+        p_printf(RED, (char *) "%s : name too long\n", path);
+        return(false);
+    }
+
+    emul_init(&emul, true);
+
+    /* as a configuration file with one sensor */
+    memset(&conf, 0x0, sizeof(conf));
+    conf.timestamp = conf.tempCel = conf.heatindex = conf.dewpoint = true;
+    conf.dylos_wait = 60;
+    strcpy(conf.dylos_output, SINK_STDOUT);
+    conf.num = 1;
+
+    fleet_default(cfg, (char *) "emul");
+    cfg->emul = &emul;
+    strcpy(cfg->output, path);
+
+    opt.timestamp = opt.tempCel = opt.heatindex = opt.dewpoint = true;
+
+    p_printf(GREEN, (char *) "allocation check : %u emulated samples through the fleet to %s, warm-up %d\n",
+        samples, path, ALLOC_WARMUP);
+
+    fleet_start(&conf, &opt);
+
+    /* first use of stdio, time zone, sink buffer .. */
+    for (n = 0; n < ALLOC_WARMUP; n++)
+    {
+        if (! alloc_sample(n)) errors++;
+    }
+
+    p_printf(YELLOW, (char *) "%u samples\n", n);
+    usage_wakeup();
+
+    alloc_get(&warm);
+
+    for ( ; n < samples; n++)
+    {
+        if (! alloc_sample(n)) errors++;
+
+        if (n % step == 0)
+        {
+            p_printf(YELLOW, (char *) "%u samples\n", n);
+            usage_wakeup();
+        }
+    }
+
+    alloc_get(&end);
+
+    fleet_close();
+
+    p_printf(WHITE, (char *) "after warm-up : %lu allocations, %lu reallocations, %lu frees, %u errors\n",
+        (unsigned long) (end.allocs - warm.allocs), (unsigned long) (end.reallocs - warm.reallocs),
+        (unsigned long) (end.frees - warm.frees), errors);
+
+    if (end.allocs != warm.allocs || end.reallocs != warm.reallocs)
+    {
+        p_printf(RED, (char *) "FAILED : memory allocated in steady state\n");
+        return(false);
+    }
+
+    if (errors)
+    {
+        p_printf(RED, (char *) "FAILED : no result from the emulated SCD30\n");
+        return(false);
+    }
+
+    p_printf(GREEN, (char *) "PASSED : no memory allocated in steady state\n");
+
+    return(true);
+}
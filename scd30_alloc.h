@@ -0,0 +1,70 @@
+/*******************************************************************
+ *
+ * Allocation counting and the steady state allocation check.
+ *
+ * Running for months on a 512 MB Raspberry Pi, the measurement loop
+ * should not allocate memory once it runs : all tables (sensors,
+ * sinks, queues, timers) are static or sized at startup and a file
+ * sink writes through its own buffer.
+ *
+ * Only in a build with 'make ALLOC=1' (SCD30_ALLOC) malloc(), calloc(),
+ * realloc(), free() and the aligned variants are interposed : they
+ * count and call the C library allocator. A normal build uses the C
+ * library directly and alloc_check() is not available.
+ *
+ * alloc_check() (-M #) runs a fleet with one sensor on an emulated
+ * SCD30 (settings.emul) and sends # samples through the code of the
+ * fleet loop : bus queue, data ready and read through the driver,
+ * health supervisor, fleet_output() with heat index, dew point and time
+ * stamp to a file sink, resource usage accounting and a progress line
+ * with p_printf(). After a warm-up it fails if anything was allocated.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_ALLOC_H__
+#define __SCD30_ALLOC_H__
+
+# include <stdint.h>
+
+/* samples before the allocations are checked */
+# define ALLOC_WARMUP 1000
+
+struct alloc_count
+{
+    uint64_t    allocs;                 // malloc, calloc, aligned
+    uint64_t    reallocs;
+    uint64_t    frees;
+};
+
+/*! get the allocation counters (since start of the program)
+ * @param c : to store the counters
+ */
+void alloc_get(struct alloc_count *c);
+
+/*! run samples of an emulated SCD30 to the sink and check that no
+ * memory is allocated after the warm-up
+ * @param samples : number of samples
+ * @param path : file sink (e.g. /dev/null)
+ *
+ * @return true = no allocations, false is allocations or error
+ */
+bool alloc_check(uint32_t samples, const char *path);
+
+#endif  // End of definition check
@@ -0,0 +1,682 @@
+/*******************************************************************
+ *
+ * Asynchronous SCD30 API on a single-threaded executor.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "scd30_async.h"
+# include "scd30_emul.h"
+# include <poll.h>
+
+/*********************************************************************
+ * @brief get monotonic time in milli seconds
+ *********************************************************************/
+uint64_t async_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return((uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/*********************************************************************
+ * @brief initialize an executor
+ * @param l : loop
+ *********************************************************************/
+void async_init(struct async_loop *l)
+{
+    memset(l, 0x0, sizeof(struct async_loop));
+}
+
+/*********************************************************************
+ * @brief run a function at a time
+ * @param l : loop
+ * @param due : mS (async_ms()) to run
+ * @param fn : function to run
+ * @param ctx : passed to fn
+ *
+ * @return timer id or -1 if no timer available
+ *********************************************************************/
+int async_at(struct async_loop *l, uint64_t due, async_fn fn, void *ctx)
+{
+    int i;
+
+    for (i = 0; i < ASYNC_MAXTIMER; i++)
+    {
+        if (l->timer[i].used) continue;
+
+        l->timer[i].used = true;
+        l->timer[i].turn = l->turns;
+        l->timer[i].due = due;
+        l->timer[i].fn = fn;
+        l->timer[i].ctx = ctx;
+
+        return(i);
+    }
+
+    return(-1);
+}
+
+/*********************************************************************
+ * @brief run a function after a delay
+ * @param l : loop
+ * @param ms : delay in mS
+ * @param fn : function to run
+ * @param ctx : passed to fn
+ *
+ * @return timer id or -1 if no timer available
+ *********************************************************************/
+int async_after(struct async_loop *l, uint32_t ms, async_fn fn, void *ctx)
+{
+    return(async_at(l, async_ms() + ms, fn, ctx));
+}
+
+/*********************************************************************
+ * @brief cancel a pending timer
+ * @param l : loop
+ * @param id : timer id
+ *********************************************************************/
+void async_cancel(struct async_loop *l, int id)
+{
+    if (id > -1 && id < ASYNC_MAXTIMER) l->timer[id].used = false;
+}
+
+/*********************************************************************
+ * @brief run a function each time a file descriptor is readable
+ * @param l : loop
+ * @param fd : file descriptor
+ * @param fn : function to run
+ * @param ctx : passed to fn
+ *
+ * @return true = OK, false is no entry available
+ *********************************************************************/
+bool async_watch(struct async_loop *l, int fd, async_fn fn, void *ctx)
+{
+    int i;
+
+    for (i = 0; i < ASYNC_MAXFD; i++)
+    {
+        if (l->watch[i].used) continue;
+
+        l->watch[i].used = true;
+        l->watch[i].fd = fd;
+        l->watch[i].fn = fn;
+        l->watch[i].ctx = ctx;
+
+        return(true);
+    }
+
+    return(false);
+}
+
+/*********************************************************************
+ * @brief stop watching a file descriptor
+ * @param l : loop
+ * @param fd : file descriptor
+ *********************************************************************/
+void async_unwatch(struct async_loop *l, int fd)
+{
+    int i;
+
+    for (i = 0; i < ASYNC_MAXFD; i++)
+    {
+        if (l->watch[i].used && l->watch[i].fd == fd) l->watch[i].used = false;
+    }
+}
+
+/*********************************************************************
+ * @brief one executor turn
+ * @param l : loop
+ * @param max_ms : max. mS to wait
+ *
+ * Waits for the first timer or a readable file descriptor, then runs
+ * the file descriptor functions and the timers that are due. Timers
+ * added during this turn run on a next turn, so a function that
+ * re-schedules itself can not starve the others.
+ *
+ * @return number of functions run
+ *********************************************************************/
+int async_step(struct async_loop *l, uint32_t max_ms)
+{
+    struct pollfd fds[ASYNC_MAXFD];
+    int     idx[ASYNC_MAXFD];
+    int     i, n = 0, run = 0;
+    uint64_t now = async_ms(), next = now + max_ms;
+    async_fn fn;
+
+    for (i = 0; i < ASYNC_MAXTIMER; i++)
+    {
+        if (l->timer[i].used && l->timer[i].due < next) next = l->timer[i].due;
+    }
+
+    for (i = 0; i < ASYNC_MAXFD; i++)
+    {
+        if (! l->watch[i].used) continue;
+
+        fds[n].fd = l->watch[i].fd;
+        fds[n].events = POLLIN;
+        fds[n].revents = 0;
+        idx[n++] = i;
+    }
+
+    l->turns++;
+
+    if (n) poll(fds, n, next > now ? next - now : 0);
+    else if (next > now) usleep((next - now) * 1000);
+
+    for (i = 0; i < n; i++)
+    {
+        if (! (fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+        /* might have been removed by an earlier function */
+        if (! l->watch[idx[i]].used || l->watch[idx[i]].fd != fds[i].fd) continue;
+
+        l->watch[idx[i]].fn(l->watch[idx[i]].ctx);
+        l->fds_run++;
+        run++;
+    }
+
+    now = async_ms();
+
+    for (i = 0; i < ASYNC_MAXTIMER; i++)
+    {
+        if (! l->timer[i].used || l->timer[i].due > now || l->timer[i].turn == l->turns) continue;
+
+        /* free before running : the function can add a timer */
+        l->timer[i].used = false;
+        fn = l->timer[i].fn;
+        fn(l->timer[i].ctx);
+
+        l->timers_run++;
+        run++;
+    }
+
+    return(run);
+}
+
+/*********************************************************************
+ * @brief run the executor until stop is set or no work is left
+ * @param l : loop
+ * @param stop : set to stop (can be NULL)
+ *********************************************************************/
+void async_run(struct async_loop *l, volatile int *stop)
+{
+    int i;
+    bool work;
+
+    while (stop == NULL || ! *stop)
+    {
+        for (i = 0, work = false; i < ASYNC_MAXTIMER && ! work; i++) work = l->timer[i].used;
+        for (i = 0; i < ASYNC_MAXFD && ! work; i++) work = l->watch[i].used;
+
+        if (! work) return;
+
+        async_step(l, 1000);
+    }
+}
+
+/*********************************************************************
+ * @brief end the pending sample request
+ * @param s : sensor
+ * @param ok : the sample was read
+ *********************************************************************/
+static void async_sample_done(struct async_sensor *s, bool ok, float co2, float temperature, float humidity)
+{
+    async_sample_fn fn = s->sample_fn;
+
+    /* single measurement : shortest on-time */
+    if (s->single && ! s->dev->StopMeasurement()) ok = false;
+
+    s->sample_fn = NULL;
+    s->single = false;
+
+    /* the callback can start the next request */
+    fn(s->sample_ctx, s, ok, co2, temperature, humidity);
+}
+
+/*********************************************************************
+ * @brief schedule the next data ready poll
+ * @param s : sensor
+ * @param at : mS of poll
+ *********************************************************************/
+static void async_sensor_poll(void *ctx);
+
+static bool async_schedule(struct async_sensor *s, uint64_t at)
+{
+    s->timer = async_at(s->loop, at, async_sensor_poll, s);
+
+    return(s->timer > -1);
+}
+
+/*********************************************************************
+ * @brief poll the data ready status of a sensor (timer)
+ * @param ctx : sensor
+ *********************************************************************/
+static void async_sensor_poll(void *ctx)
+{
+    struct async_sensor *s = (struct async_sensor *) ctx;
+    float   co2, temperature, humidity;
+    uint64_t now = async_ms();
+
+    s->timer = -1;
+
+    if (! s->sample_fn) return;
+
+    s->polls++;
+
+    if (! s->dev->dataAvailable())
+    {
+        if (now > s->due + ASYNC_TIMEOUT)
+        {
+            s->timeouts++;
+            async_sample_done(s, false, 0, 0, 0);
+            return;
+        }
+
+        if (s->spacing < BURST_POLL_MAX) s->spacing += BURST_POLL_MIN;
+
+        if (! async_schedule(s, now + s->spacing))
+        {
+            s->errors++;
+            async_sample_done(s, false, 0, 0, 0);
+        }
+
+        return;
+    }
+
+    s->spacing = BURST_POLL_MIN;
+    s->due = now + s->interval * 1000;
+
+    if (! s->dev->getMeasurement(&co2, &temperature, &humidity))
+    {
+        s->errors++;
+        async_sample_done(s, false, 0, 0, 0);
+        return;
+    }
+
+    s->samples++;
+    async_sample_done(s, true, co2, temperature, humidity);
+}
+
+/*********************************************************************
+ * @brief add a sensor to an executor
+ * @param s : sensor
+ * @param l : loop
+ * @param dev : SCD30 (begin() done)
+ * @param name : for the caller
+ * @param interval : measurement interval in seconds
+ *********************************************************************/
+void async_sensor_init(struct async_sensor *s, struct async_loop *l, SCD30 *dev,
+    const char *name, uint16_t interval)
+{
+    memset(s, 0x0, sizeof(struct async_sensor));
+
+    s->dev = dev;
+    s->loop = l;
+    s->name = name;
+    s->interval = interval;
+    s->spacing = BURST_POLL_MIN;
+    s->timer = s->set_timer = -1;
+
+    /* the first sample can take up to an interval */
+    s->due = async_ms() + interval * 1000;
+}
+
+/*********************************************************************
+ * @brief request the next sample
+ * @param s : sensor
+ * @param fn : called with the sample
+ * @param ctx : passed to fn
+ *
+ * Polling starts 1/8 of the interval before the sample is expected.
+ *
+ * @return true = started, false is a sample request is pending
+ *********************************************************************/
+bool async_next_sample(struct async_sensor *s, async_sample_fn fn, void *ctx)
+{
+    uint64_t now = async_ms(), at;
+
+    if (s->sample_fn) return(false);
+
+    s->sample_fn = fn;
+    s->sample_ctx = ctx;
+
+    at = s->due - s->interval * 1000 / 8;
+    if (at < now) at = now;
+
+    if (async_schedule(s, at)) return(true);
+
+    s->sample_fn = NULL;
+    return(false);
+}
+
+/*********************************************************************
+ * @brief request a single measurement : start, read one sample, stop
+ * @param s : sensor
+ * @param fn : called with the sample
+ * @param ctx : passed to fn
+ *
+ * @return true = started, false is a request is pending or error
+ *********************************************************************/
+bool async_single(struct async_sensor *s, async_sample_fn fn, void *ctx)
+{
+    uint64_t now = async_ms();
+
+    if (s->sample_fn || ! s->dev->beginMeasuring()) return(false);
+
+    s->sample_fn = fn;
+    s->sample_ctx = ctx;
+    s->single = true;
+    s->due = now + BURST_FIRST;
+
+    if (async_schedule(s, s->due - BURST_FIRST / 8)) return(true);
+
+    s->sample_fn = NULL;
+    s->single = false;
+    s->dev->StopMeasurement();
+
+    return(false);
+}
+
+/*********************************************************************
+ * @brief perform the interval change (timer)
+ * @param ctx : sensor
+ *********************************************************************/
+static void async_sensor_set(void *ctx)
+{
+    struct async_sensor *s = (struct async_sensor *) ctx;
+    async_done_fn fn = s->done_fn;
+    uint64_t at, now = async_ms();
+    bool ok;
+
+    s->set_timer = -1;
+
+    if ((ok = s->dev->setMeasurementInterval(s->new_interval)))
+    {
+        s->interval = s->new_interval;
+
+        /* the next sample follows the new interval */
+        s->due = now + s->interval * 1000;
+
+        /* a pending sample request polls on the new cadence */
+        if (s->sample_fn && ! s->single && s->timer > -1)
+        {
+            async_cancel(s->loop, s->timer);
+
+            at = s->due - s->interval * 1000 / 8;
+
+            if (! async_schedule(s, at))
+            {
+                s->errors++;
+                async_sample_done(s, false, 0, 0, 0);
+            }
+        }
+    }
+
+    s->done_fn = NULL;
+
+    if (fn) fn(s->done_ctx, s, ok);
+}
+
+/*********************************************************************
+ * @brief request a new measurement interval
+ * @param s : sensor
+ * @param interval : measurement interval in seconds
+ * @param fn : called with the result (can be NULL)
+ * @param ctx : passed to fn
+ *
+ * The change is done on the next executor turn, between the reads.
+ *
+ * @return true = started, false is a change is pending or out of range
+ *********************************************************************/
+bool async_set_interval(struct async_sensor *s, uint16_t interval, async_done_fn fn, void *ctx)
+{
+    if (s->set_timer > -1 || ! scd30_cmd_valid(SCD30_CMD_INTERVAL, interval)) return(false);
+
+    s->new_interval = interval;
+    s->done_fn = fn;
+    s->done_ctx = ctx;
+
+    s->set_timer = async_after(s->loop, 0, async_sensor_set, s);
+
+    return(s->set_timer > -1);
+}
+
+/*********************************************************************
+ * @brief cancel the pending requests of a sensor (no callbacks)
+ * @param s : sensor
+ *********************************************************************/
+void async_sensor_stop(struct async_sensor *s)
+{
+    async_cancel(s->loop, s->timer);
+    async_cancel(s->loop, s->set_timer);
+
+    s->timer = s->set_timer = -1;
+    s->sample_fn = NULL;
+    s->done_fn = NULL;
+
+    if (s->single) s->dev->StopMeasurement();
+    s->single = false;
+}
+
+/*********************************************************************
+ * check of the executor with emulated SCD30s
+ *********************************************************************/
+
+/* samples read per sensor */
+# define ASYNC_CHECK_SAMPLES 2
+
+/* interval in seconds after the change of the first sensor */
+# define ASYNC_CHECK_INTERVAL 3
+
+static struct scd30_emul as_emul[SCD30_MAXBUS];
+static SCD30 as_dev[SCD30_MAXBUS];
+static struct async_sensor as_sensor[SCD30_MAXBUS];
+static uint32_t as_got[SCD30_MAXBUS];
+
+static struct async_loop as_loop;
+static int  as_pipe[2];
+static int  as_left, as_failed;
+static uint32_t as_written, as_read;
+static uint64_t as_set_at, as_set_due, as_new_at;
+static bool as_set_ok;
+static volatile int as_stop;
+
+/*********************************************************************
+ * @brief show one result of the check
+ *********************************************************************/
+static bool async_result(bool ok, const char *what)
+{
+    p_printf(ok ? GREEN : RED, (char *) "%-40s %s\n", what, ok ? "PASSED" : "FAILED");
+    return(ok);
+}
+
+/*********************************************************************
+ * @brief interval change of the first sensor is done
+ *********************************************************************/
+static void async_check_set(void *ctx, struct async_sensor *s, bool ok)
+{
+    as_set_ok = ok;
+    as_set_at = async_ms();
+    as_set_due = s->due;
+}
+
+/*********************************************************************
+ * @brief sample of a sensor : request the next until all are read
+ *********************************************************************/
+static void async_check_sample(void *ctx, struct async_sensor *s, bool ok,
+    float co2, float temperature, float humidity)
+{
+    int i = s - as_sensor;
+
+    if (! ok) as_failed++;
+
+    /* first sample after the interval change */
+    if (ok && i == 0 && as_set_at && ! as_new_at) as_new_at = async_ms();
+
+    if (! ok || ++as_got[i] == ASYNC_CHECK_SAMPLES)
+    {
+        if (--as_left == 0) as_stop = 1;
+        return;
+    }
+
+    if (! async_next_sample(s, async_check_sample, NULL))
+    {
+        as_failed++;
+        if (--as_left == 0) as_stop = 1;
+        return;
+    }
+
+    /* change the interval of the first sensor while a request is pending */
+    if (i == 0 && ! as_set_at && ! async_set_interval(s, ASYNC_CHECK_INTERVAL, async_check_set, NULL))
+        as_failed++;
+}
+
+/*********************************************************************
+ * @brief write to the pipe while the sensors are read (timer)
+ *********************************************************************/
+static void async_check_tick(void *ctx)
+{
+    if (as_left == 0) return;
+
+    if (write(as_pipe[1], "x", 1) == 1) as_written++;
+
+    async_after(&as_loop, 500, async_check_tick, NULL);
+}
+
+/*********************************************************************
+ * @brief the pipe is readable (file descriptor watch)
+ *********************************************************************/
+static void async_check_fd(void *ctx)
+{
+    char    c;
+
+    if (read(as_pipe[0], &c, 1) == 1) as_read++;
+}
+
+/*********************************************************************
+ * @brief stop a check that takes too long (timer)
+ *********************************************************************/
+static void async_check_expire(void *ctx)
+{
+    as_stop = 1;
+}
+
+/*********************************************************************
+ * @brief check the executor : sensors emulated SCD30s and a pipe on
+ * one loop
+ * @param sensors : number of emulated SCD30s (1 - SCD30_MAXBUS)
+ *
+ * Each sensor reads ASYNC_CHECK_SAMPLES samples at a 2 seconds interval.
+ * The interval of the first sensor is changed while a sample request
+ * is pending : the next sample must follow the new interval. A timer
+ * writes to a pipe that is watched on the same loop.
+ *
+ * @return true = passed
+ *********************************************************************/
+bool async_check(int sensors)
+{
+    uint32_t polls = 0, samples = 0, timeouts = 0;
+    int     i, started = 0;
+    bool    ok = true;
+
+    memset(as_got, 0x0, sizeof(as_got));
+    as_left = as_failed = 0;
+    as_written = as_read = 0;
+    as_set_at = as_set_due = as_new_at = 0;
+    as_set_ok = false;
+    as_stop = 0;
+
+    if (pipe(as_pipe) != 0) return(async_result(false, "pipe"));
+
+    async_init(&as_loop);
+
+    for (i = 0; i < sensors; i++)
+    {
+        emul_init(&as_emul[i], false);
+        emul_set(&as_emul[i], 400 + i * 100, 21, 50);
+
+        as_dev[i].settings.emul = &as_emul[i];
+        as_dev[i].settings.lock_timeout = 0;
+
+        if (! as_dev[i].begin(true, 2)) break;
+
+        async_sensor_init(&as_sensor[i], &as_loop, &as_dev[i], "emulated", 2);
+
+        if (! async_next_sample(&as_sensor[i], async_check_sample, NULL))
+        {
+            as_dev[i].close();
+            break;
+        }
+
+        started++;
+    }
+
+    as_left = started;
+
+    ok &= async_result(started == sensors, "begin : emulated SCD30s");
+
+    if (started)
+    {
+        ok &= async_result(async_watch(&as_loop, as_pipe[0], async_check_fd, NULL) &&
+            async_after(&as_loop, 500, async_check_tick, NULL) > -1 &&
+            async_after(&as_loop, 30000, async_check_expire, NULL) > -1, "timers and fd watch added");
+
+        async_run(&as_loop, &as_stop);
+
+        /* read the last write */
+        async_step(&as_loop, 0);
+
+        for (i = 0; i < started; i++)
+        {
+            polls += as_sensor[i].polls;
+            samples += as_sensor[i].samples;
+            timeouts += as_sensor[i].timeouts;
+        }
+
+        p_printf(WHITE, (char *) "%d sensors : %u samples, %u polls, %u turns, %u timers, %u fd callbacks\n",
+            started, samples, polls, as_loop.turns, as_loop.timers_run, as_loop.fds_run);
+
+        ok &= async_result(as_failed == 0 && timeouts == 0 &&
+            samples == (uint32_t) started * ASYNC_CHECK_SAMPLES, "samples : all read, no timeouts");
+
+        ok &= async_result(as_set_ok && as_sensor[0].interval == ASYNC_CHECK_INTERVAL &&
+            as_set_due >= as_set_at + ASYNC_CHECK_INTERVAL * 1000 - 100, "set interval : next sample moved");
+
+        ok &= async_result(as_new_at >= as_set_at + ASYNC_CHECK_INTERVAL * 1000 - 100 &&
+            as_new_at < as_set_at + ASYNC_CHECK_INTERVAL * 1000 + 500, "set interval : sample on the new cadence");
+
+        ok &= async_result(as_written > 0 && as_read == as_written, "fd watch : all writes read");
+
+        async_unwatch(&as_loop, as_pipe[0]);
+    }
+
+    for (i = 0; i < started; i++)
+    {
+        async_sensor_stop(&as_sensor[i]);
+        as_dev[i].close();
+    }
+
+    ::close(as_pipe[0]);
+    ::close(as_pipe[1]);
+
+    return(ok);
+}
@@ -0,0 +1,235 @@
+/*******************************************************************
+ *
+ * Asynchronous SCD30 API on a single-threaded executor.
+ *
+ * dataAvailable(), StartSingleMeasurement() and the read loops wait
+ * by sleeping : each sensor driven that way needs its own thread. Here
+ * a request (next sample, set interval, single measurement) is started
+ * and the result is passed to a callback. In between the executor
+ * (async_loop) runs other work : timers of other sensors and file
+ * descriptors that became readable (e.g. serial sources).
+ *
+ *   async_init(&loop);
+ *   async_sensor_init(&s1, &loop, &dev1, "kitchen", 2);
+ *   async_next_sample(&s1, got_sample, NULL);
+ *   async_watch(&loop, serial_fd, serial_data, NULL);
+ *   async_run(&loop, &stop);
+ *
+ * A sensor polls the data ready status shortly before the next sample
+ * is expected, with a spacing that grows on each miss (as Burst()).
+ * A callback can start the next request, e.g. to keep sampling.
+ *
+ * Only the waits between I2C transactions are asynchronous. Clock
+ * stretching within a transaction is handled by the bus driver.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_ASYNC_H__
+#define __SCD30_ASYNC_H__
+
+# include "SCD30.h"
+
+/* max. pending timers on a loop */
+# define ASYNC_MAXTIMER 64
+
+/* max. watched file descriptors on a loop */
+# define ASYNC_MAXFD 16
+
+/* mS a sample may be overdue before the request fails */
+# define ASYNC_TIMEOUT 5000
+
+typedef void (*async_fn)(void *ctx);
+
+struct async_timer
+{
+    bool        used;
+    uint32_t    turn;                   // loop turn it was added
+    uint64_t    due;                    // mS to run
+    async_fn    fn;
+    void        *ctx;
+};
+
+struct async_fdwatch
+{
+    bool        used;
+    int         fd;                     // run fn when readable
+    async_fn    fn;
+    void        *ctx;
+};
+
+struct async_loop
+{
+    struct async_timer   timer[ASYNC_MAXTIMER];
+    struct async_fdwatch watch[ASYNC_MAXFD];
+
+    /* counters */
+    uint32_t    turns;                  // executor turns
+    uint32_t    timers_run;             // timers run
+    uint32_t    fds_run;                // file descriptor callbacks run
+};
+
+struct async_sensor;
+
+/* result of a sample request (values only valid if ok) */
+typedef void (*async_sample_fn)(void *ctx, struct async_sensor *s, bool ok,
+    float co2, float temperature, float humidity);
+
+/* result of a setting request */
+typedef void (*async_done_fn)(void *ctx, struct async_sensor *s, bool ok);
+
+struct async_sensor
+{
+    SCD30       *dev;                   // begin() done
+    struct async_loop *loop;
+    const char  *name;                  // for the caller
+    uint16_t    interval;               // measurement interval in seconds
+    uint64_t    due;                    // mS next sample is expected
+    uint32_t    spacing;                // mS between data ready polls
+    int         timer;                  // pending poll (-1 = none)
+
+    /* pending sample request */
+    async_sample_fn sample_fn;
+    void        *sample_ctx;
+    bool        single;                 // stop measurement after the sample
+
+    /* pending interval change */
+    int         set_timer;              // -1 = none
+    uint16_t    new_interval;
+    async_done_fn done_fn;
+    void        *done_ctx;
+
+    /* counters */
+    uint32_t    polls;                  // data ready polls
+    uint32_t    samples;                // samples read
+    uint32_t    timeouts;               // requests failed on timeout
+    uint32_t    errors;                 // requests failed on I2C error
+};
+
+/*! get monotonic time in milli seconds */
+uint64_t async_ms();
+
+/*! initialize an executor
+ * @param l : loop
+ */
+void async_init(struct async_loop *l);
+
+/*! run a function at a time
+ * @param l : loop
+ * @param due : mS (async_ms()) to run
+ * @param fn : function to run
+ * @param ctx : passed to fn
+ *
+ * @return timer id or -1 if no timer available
+ */
+int async_at(struct async_loop *l, uint64_t due, async_fn fn, void *ctx);
+
+/*! run a function after a delay
+ * @param ms : delay in mS
+ *
+ * @return timer id or -1 if no timer available
+ */
+int async_after(struct async_loop *l, uint32_t ms, async_fn fn, void *ctx);
+
+/*! cancel a pending timer
+ * @param id : timer id
+ */
+void async_cancel(struct async_loop *l, int id);
+
+/*! run a function each time a file descriptor is readable
+ * @param fd : file descriptor
+ *
+ * @return true = OK, false is no entry available
+ */
+bool async_watch(struct async_loop *l, int fd, async_fn fn, void *ctx);
+
+/*! stop watching a file descriptor
+ * @param fd : file descriptor
+ */
+void async_unwatch(struct async_loop *l, int fd);
+
+/*! one executor turn : wait for the first timer or file descriptor
+ * (max. max_ms mS), then run what is due
+ * @param l : loop
+ * @param max_ms : max. mS to wait
+ *
+ * @return number of functions run
+ */
+int async_step(struct async_loop *l, uint32_t max_ms);
+
+/*! run the executor until stop is set or no work is left
+ * @param l : loop
+ * @param stop : set to stop (can be NULL)
+ */
+void async_run(struct async_loop *l, volatile int *stop);
+
+/*! add a sensor to an executor. The continuous measurement must have
+ * been started (begin())
+ * @param s : sensor
+ * @param l : loop
+ * @param dev : SCD30
+ * @param name : for the caller
+ * @param interval : measurement interval in seconds
+ */
+void async_sensor_init(struct async_sensor *s, struct async_loop *l, SCD30 *dev,
+    const char *name, uint16_t interval);
+
+/*! request the next sample
+ * @param s : sensor
+ * @param fn : called with the sample
+ * @param ctx : passed to fn
+ *
+ * @return true = started, false is a sample request is pending
+ */
+bool async_next_sample(struct async_sensor *s, async_sample_fn fn, void *ctx);
+
+/*! request a single measurement : start, read one sample and stop
+ * @param s : sensor
+ * @param fn : called with the sample
+ * @param ctx : passed to fn
+ *
+ * @return true = started, false is a request is pending or error
+ */
+bool async_single(struct async_sensor *s, async_sample_fn fn, void *ctx);
+
+/*! request a new measurement interval (done between reads)
+ * @param s : sensor
+ * @param interval : measurement interval in seconds
+ * @param fn : called with the result (can be NULL)
+ * @param ctx : passed to fn
+ *
+ * @return true = started, false is a change is pending or out of range
+ */
+bool async_set_interval(struct async_sensor *s, uint16_t interval, async_done_fn fn, void *ctx);
+
+/*! cancel the pending requests of a sensor (no callbacks)
+ * @param s : sensor
+ */
+void async_sensor_stop(struct async_sensor *s);
+
+/*! check the executor : emulated SCD30s (own bus each) and a pipe
+ * watch on one loop, including an interval change while a sample is
+ * pending. No hardware needed.
+ * @param sensors : number of emulated SCD30s (1 - SCD30_MAXBUS)
+ *
+ * @return true = passed
+ */
+bool async_check(int sensors);
+
+#endif  // End of definition check
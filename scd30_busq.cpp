@@ -0,0 +1,258 @@
+/*******************************************************************
+ *
+ * Transaction queue with priority classes per I2C bus.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "scd30_busq.h"
+# include <string.h>
+# include <time.h>
+
+/* initial mS per item of a class, until learned */
+static const uint32_t busq_cost[BUSQ_CLASSES] = { 5, 10, 20, 50 };
+
+static const char *busq_names[BUSQ_CLASSES] = { "meas", "probe", "setting", "maint" };
+
+/*********************************************************************
+ * @brief get monotonic time in milli seconds
+ *********************************************************************/
+uint64_t busq_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return((uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/*********************************************************************
+ * @brief get monotonic time in micro seconds
+ *********************************************************************/
+uint64_t busq_us()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return((uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+/*********************************************************************
+ * @brief class name
+ * @param cls : busq_class
+ *********************************************************************/
+const char *busq_name(int cls)
+{
+    if (cls < 0 || cls >= BUSQ_CLASSES) return("unknown");
+
+    return(busq_names[cls]);
+}
+
+/*********************************************************************
+ * @brief initialize a queue
+ * @param q : queue
+ *********************************************************************/
+void busq_init(struct scd30_busq *q)
+{
+    memset(q, 0x0, sizeof(struct scd30_busq));
+
+    memcpy(q->cost, busq_cost, sizeof(q->cost));
+
+    q->started = busq_ms();
+}
+
+/*********************************************************************
+ * @brief submit work
+ * @param q : queue
+ * @param cls : busq_class
+ * @param deadline : mS (busq_ms()) to start before
+ * @param fn : work
+ * @param ctx : passed to fn
+ *
+ * @return true = queued, false is queue full (caller runs it)
+ *********************************************************************/
+bool busq_submit(struct scd30_busq *q, int cls, uint64_t deadline, busq_fn fn, void *ctx)
+{
+    int i, free = -1;
+
+    if (cls < 0 || cls >= BUSQ_CLASSES) return(false);
+
+    for (i = 0; i < BUSQ_MAX; i++)
+    {
+        if (! q->item[i].used)
+        {
+            if (free < 0) free = i;
+            continue;
+        }
+
+        /* already queued : keep the earliest deadline */
+        if (q->item[i].fn == fn && q->item[i].ctx == ctx)
+        {
+            if (deadline < q->item[i].deadline) q->item[i].deadline = deadline;
+            if (cls < q->item[i].cls) q->item[i].cls = cls;
+            return(true);
+        }
+    }
+
+    if (free < 0) return(false);
+
+    q->item[free].used = true;
+    q->item[free].deferred = false;
+    q->item[free].cls = cls;
+    q->item[free].submitted = busq_ms();
+    q->item[free].deadline = deadline;
+    q->item[free].fn = fn;
+    q->item[free].ctx = ctx;
+
+    return(true);
+}
+
+/*********************************************************************
+ * @brief a measurement read is expected
+ * @param q : queue
+ * @param due : mS of the read
+ *********************************************************************/
+void busq_expect(struct scd30_busq *q, uint64_t due)
+{
+    if (q->next_meas == 0 || due < q->next_meas) q->next_meas = due;
+}
+
+/*********************************************************************
+ * @brief account work that was done
+ * @param q : queue
+ * @param cls : busq_class
+ * @param submitted : mS the request arrived
+ * @param start : uS the work started
+ *********************************************************************/
+void busq_account(struct scd30_busq *q, int cls, uint64_t submitted, uint64_t start)
+{
+    struct busq_stats *st = &q->st[cls];
+    uint32_t wait = start / 1000 > submitted ? start / 1000 - submitted : 0;
+    uint32_t busy = busq_us() - start;
+
+    st->runs++;
+    st->wait_sum += wait;
+    if (wait > st->wait_max) st->wait_max = wait;
+
+    q->busy_us += busy;
+
+    /* learn the duration : 3/4 old + 1/4 new */
+    q->cost[cls] = (q->cost[cls] * 3 + (busy + 999) / 1000) / 4;
+}
+
+/*********************************************************************
+ * @brief part of the time the bus was in use since busq_init()
+ * @param q : queue
+ *
+ * @return 0 - 1
+ *********************************************************************/
+double busq_utilization(struct scd30_busq *q)
+{
+    uint64_t elapsed = (busq_ms() - q->started) * 1000;
+
+    if (elapsed == 0) return(0);
+
+    return((double) q->busy_us / elapsed);
+}
+
+/*********************************************************************
+ * @brief select the next item to run
+ * @param q : queue
+ * @param now : mS
+ * @param max_cls : lowest priority class to run
+ *
+ * Measurement reads in order of deadline. Otherwise the highest class,
+ * earliest deadline that fits in the gap before the next measurement
+ * read or is past its deadline.
+ *
+ * @return index or -1 if nothing can run
+ *********************************************************************/
+static int busq_select(struct scd30_busq *q, uint64_t now, int max_cls)
+{
+    struct busq_item *it;
+    int     i, sel = -1;
+    bool    fits;
+
+    for (i = 0; i < BUSQ_MAX; i++)
+    {
+        it = &q->item[i];
+
+        if (! it->used || it->cls > max_cls) continue;
+
+        if (it->cls != BUSQ_MEAS)
+        {
+            fits = q->next_meas == 0 || now + q->cost[it->cls] + BUSQ_GUARD <= q->next_meas;
+
+            if (! fits && now < it->deadline)
+            {
+                if (! it->deferred) q->st[it->cls].deferred++;
+                it->deferred = true;
+                continue;
+            }
+        }
+
+        if (sel < 0 || it->cls < q->item[sel].cls ||
+            (it->cls == q->item[sel].cls && it->deadline < q->item[sel].deadline))
+            sel = i;
+    }
+
+    return(sel);
+}
+
+/*********************************************************************
+ * @brief run the queued work that is allowed now
+ * @param q : queue
+ * @param max_cls : lowest priority class to run
+ *
+ * @return number of items run
+ *********************************************************************/
+int busq_run(struct scd30_busq *q, int max_cls)
+{
+    struct busq_item it;
+    uint64_t start;
+    uint32_t due = 0;
+    int     i, run = 0;
+
+    /* reads contending for the bus */
+    for (i = 0; i < BUSQ_MAX; i++)
+    {
+        if (q->item[i].used && q->item[i].cls == BUSQ_MEAS) due++;
+    }
+
+    if (due > q->peak) q->peak = due;
+
+    while ((i = busq_select(q, (start = busq_us()) / 1000, max_cls)) > -1)
+    {
+        /* free before running : the work can submit again */
+        it = q->item[i];
+        q->item[i].used = false;
+
+        if (start / 1000 > it.deadline) q->st[it.cls].late++;
+
+        it.fn(it.ctx);
+
+        busq_account(q, it.cls, it.submitted, start);
+        run++;
+    }
+
+    q->next_meas = 0;
+
+    return(run);
+}
@@ -0,0 +1,156 @@
+/*******************************************************************
+ *
+ * Transaction queue with priority classes per I2C bus.
+ *
+ * Sensors on a shared bus compete for it : measurement reads, presence
+ * probes (with a full initialization when a sensor is back), settings
+ * queries / changes from the control socket and maintenance such as a
+ * serial number read. A slow one can push a measurement read past the
+ * moment the next sample overwrites it.
+ *
+ * Work for the bus is submitted with a class and a deadline :
+ *
+ *  BUSQ_MEAS    : measurement read, always first (earliest deadline)
+ *  BUSQ_PROBE   : presence check / re-attach of a detached sensor
+ *  BUSQ_SETTING : settings query or change
+ *  BUSQ_MAINT   : maintenance (serial number, settings dump)
+ *
+ * The lower classes only run in the gap before the next measurement
+ * read on the bus (busq_expect()), based on the learned duration of
+ * that class, or once their deadline has passed.
+ *
+ * Per class the time waited in the queue (submit to start), the runs
+ * after the deadline and the times it was deferred are counted. Per
+ * bus the utilization (time busy) and the peak concurrency (most
+ * measurement reads due at the same moment) are kept.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_BUSQ_H__
+#define __SCD30_BUSQ_H__
+
+# include <stdint.h>
+
+/* max. queued items per bus */
+# define BUSQ_MAX 64
+
+/* mS kept free before the next measurement read */
+# define BUSQ_GUARD 20
+
+enum busq_class
+{
+    BUSQ_MEAS = 0,                      // measurement read
+    BUSQ_PROBE,                         // presence check / re-attach
+    BUSQ_SETTING,                       // settings query or change
+    BUSQ_MAINT,                         // maintenance
+    BUSQ_CLASSES
+};
+
+/* work on the bus */
+typedef void (*busq_fn)(void *ctx);
+
+struct busq_item
+{
+    bool        used;
+    bool        deferred;               // counted as deferred
+    uint8_t     cls;                    // busq_class
+    uint64_t    submitted;              // mS
+    uint64_t    deadline;               // mS
+    busq_fn     fn;
+    void        *ctx;
+};
+
+struct busq_stats
+{
+    uint32_t    runs;                   // items run
+    uint64_t    wait_sum;               // mS waited in the queue
+    uint32_t    wait_max;               // max. mS waited
+    uint32_t    late;                   // started after the deadline
+    uint32_t    deferred;               // deferred to a later gap
+};
+
+struct scd30_busq
+{
+    struct busq_item item[BUSQ_MAX];
+    uint64_t    next_meas;              // mS next measurement read (0 = none)
+    uint32_t    cost[BUSQ_CLASSES];     // learned mS per item of a class
+    struct busq_stats st[BUSQ_CLASSES];
+    uint64_t    started;                // mS queue initialized
+    uint64_t    busy_us;                // uS bus in use
+    uint32_t    peak;                   // max. measurement reads due at once
+};
+
+/*! class name */
+const char *busq_name(int cls);
+
+/*! initialize a queue
+ * @param q : queue
+ */
+void busq_init(struct scd30_busq *q);
+
+/*! submit work. The same fn + ctx is only queued once (the earliest
+ * deadline is kept).
+ * @param q : queue
+ * @param cls : busq_class
+ * @param deadline : mS (busq_ms()) to start before
+ * @param fn : work
+ * @param ctx : passed to fn
+ *
+ * @return true = queued, false is queue full (caller runs it)
+ */
+bool busq_submit(struct scd30_busq *q, int cls, uint64_t deadline, busq_fn fn, void *ctx);
+
+/*! a measurement read is expected : the lower classes keep the bus
+ * free before that moment. Cleared by busq_run().
+ * @param q : queue
+ * @param due : mS of the read
+ */
+void busq_expect(struct scd30_busq *q, uint64_t due);
+
+/*! run the queued work that is allowed now
+ * @param q : queue
+ * @param max_cls : lowest priority class to run (e.g. BUSQ_MEAS)
+ *
+ * @return number of items run
+ */
+int busq_run(struct scd30_busq *q, int max_cls);
+
+/*! account work that was done directly (not queued)
+ * @param q : queue
+ * @param cls : busq_class
+ * @param submitted : mS the request arrived
+ * @param start : uS (busq_us()) the work started
+ */
+void busq_account(struct scd30_busq *q, int cls, uint64_t submitted, uint64_t start);
+
+/*! part of the time the bus was in use since busq_init()
+ * @param q : queue
+ *
+ * @return 0 - 1
+ */
+double busq_utilization(struct scd30_busq *q);
+
+/*! get monotonic time in milli seconds */
+uint64_t busq_ms();
+
+/*! get monotonic time in micro seconds */
+uint64_t busq_us();
+
+#endif  // End of definition check
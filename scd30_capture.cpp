@@ -0,0 +1,173 @@
+/*******************************************************************
+ *
+ * Lossless capture of SCD30 measurements.
+ *
+ * The poll schedule follows the sample clock of the SCD30 (which can
+ * differ a few % from the Raspberry Pi clock) : the next poll is
+ * planned from the time the previous sample was found.
+ *
+ * If the sample was already there at the first poll, it might have
+ * been waiting for a while. Polling then starts CAPTURE_POLL mS
+ * earlier on the next sample, until the sample is found on a later
+ * poll. That way the read time stays close to the moment the sample
+ * becomes available.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "scd30_capture.h"
+# include <string.h>
+# include <time.h>
+
+/*********************************************************************
+ * @brief get monotonic time in milli seconds
+ *********************************************************************/
+uint64_t capture_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return((uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/*********************************************************************
+ * @brief start capturing (all counters are reset)
+ * @param c : capture
+ * @param interval : measurement interval in seconds
+ *********************************************************************/
+void capture_init(struct scd30_capture *c, uint16_t interval)
+{
+    memset(c, 0x0, sizeof(struct scd30_capture));
+
+    c->interval = interval;
+    c->early = CAPTURE_EARLY;
+    c->next = capture_ms();
+}
+
+/*********************************************************************
+ * @brief the measurement interval was changed
+ * @param c : capture
+ * @param interval : new measurement interval in seconds
+ *
+ * Also used after the SCD30 was (re)started. The sequence continues,
+ * samples missed in the mean time are reported as a gap. The samples
+ * that were due with the old interval are counted now, as the SCD30
+ * restarts the interval the next gap is counted from here with the new
+ * interval. The next sample is looked for straight away.
+ *********************************************************************/
+void capture_interval(struct scd30_capture *c, uint16_t interval)
+{
+    uint64_t now = capture_ms();
+
+    if (c->last)
+    {
+        c->due += (now - c->last) / ((uint64_t) c->interval * 1000);
+        c->last = now;
+    }
+
+    c->interval = interval;
+    c->early = CAPTURE_EARLY;
+    c->tries = 0;
+    c->next = now;
+}
+
+/*********************************************************************
+ * @brief a poll was done
+ * @param c : capture
+ * @param sample : a sample was read
+ * @param gap : set to the number of samples missed before this sample
+ *
+ * @return sequence number of the sample (0 if no sample)
+ *********************************************************************/
+uint32_t capture_poll(struct scd30_capture *c, bool sample, uint32_t *gap)
+{
+    uint64_t now = capture_ms(), period = (uint64_t) c->interval * 1000;
+    uint32_t n;
+
+    *gap = 0;
+    c->polls++;
+    c->tries++;
+
+    if (! sample)
+    {
+        /* overdue : the sensor might be gone, do not keep the bus busy */
+        if (c->last && now > c->last + period + c->early + CAPTURE_OVERDUE)
+            c->next = now + CAPTURE_OVERDUE;
+        else
+            c->next = now + CAPTURE_POLL;
+
+        return(0);
+    }
+
+    /* number of intervals since the previous sample (rounded) */
+    if (c->last == 0) n = 1;
+    else
+    {
+        n = (now - c->last + period / 2) / period;
+        if (n < 1) n = 1;
+    }
+
+    n += c->due;
+    c->due = 0;
+
+    if (n > 1 && c->seq > 0)
+    {
+        *gap = n - 1;
+        c->gaps++;
+        c->missed += n - 1;
+    }
+
+    /* found on the first poll : start polling earlier */
+    if (c->tries == 1)
+    {
+        if ((uint64_t) c->early + CAPTURE_POLL < period / 2) c->early += CAPTURE_POLL;
+    }
+    else if (c->early > CAPTURE_EARLY) c->early -= CAPTURE_POLL;
+
+    c->seq += n;
+    c->last = now;
+    c->next = now + period - c->early;
+    c->tries = 0;
+    c->captured++;
+
+    return(c->seq);
+}
+
+/*********************************************************************
+ * @brief mS until the next poll
+ *********************************************************************/
+uint32_t capture_wait(struct scd30_capture *c)
+{
+    uint64_t now = capture_ms();
+
+    if (c->next <= now) return(0);
+
+    return(c->next - now);
+}
+
+/*********************************************************************
+ * @brief percentage of the samples that were captured
+ *********************************************************************/
+float capture_completeness(struct scd30_capture *c)
+{
+    if (c->captured + c->missed == 0) return(100.0);
+
+    return((float) c->captured * 100.0 / (c->captured + c->missed));
+}
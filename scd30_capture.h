@@ -0,0 +1,93 @@
+/*******************************************************************
+ *
+ * Lossless capture of SCD30 measurements.
+ *
+ * The SCD30 only keeps the latest measurement. Reading with a wait
+ * time longer than the measurement interval silently drops samples.
+ *
+ * In capture mode the reads are locked to the measurement interval :
+ * shortly before the next sample is expected, the data ready status
+ * is polled every CAPTURE_POLL mS until the sample is there. Each
+ * sample gets a sequence number derived from the expected cadence
+ * (time since the previous sample / interval). If samples were missed
+ * anyway (e.g. the system was busy or the sensor was reset), that is
+ * reported as a gap event with the number of missed samples.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_CAPTURE_H__
+#define __SCD30_CAPTURE_H__
+
+# include <stdint.h>
+
+/* mS to start polling before the next sample is expected */
+# define CAPTURE_EARLY 200
+
+/* mS between polls while waiting for the expected sample */
+# define CAPTURE_POLL 100
+
+/* mS between polls once the sample is overdue */
+# define CAPTURE_OVERDUE 1000
+
+struct scd30_capture
+{
+    uint16_t    interval;               // measurement interval in seconds
+    uint16_t    early;                  // current mS to start polling early
+    uint32_t    seq;                    // sequence number of last sample
+    uint64_t    last;                   // mS of last sample or interval change (0 = none yet)
+    uint32_t    due;                    // samples due before the interval change
+    uint64_t    next;                   // mS of next poll
+    uint8_t     tries;                  // polls for the expected sample
+
+    /* counters */
+    uint32_t    captured;               // samples captured
+    uint32_t    missed;                 // samples missed
+    uint32_t    gaps;                   // gap events
+    uint32_t    polls;                  // data ready polls
+};
+
+/*! start capturing (all counters are reset)
+ * @param c : capture
+ * @param interval : measurement interval in seconds
+ */
+void capture_init(struct scd30_capture *c, uint16_t interval);
+
+/*! the measurement interval was changed or the SCD30 was restarted
+ * @param c : capture
+ * @param interval : (new) measurement interval in seconds
+ */
+void capture_interval(struct scd30_capture *c, uint16_t interval);
+
+/*! a poll was done
+ * @param c : capture
+ * @param sample : a sample was read
+ * @param gap : set to the number of samples missed before this sample
+ *
+ * @return sequence number of the sample (0 if no sample)
+ */
+uint32_t capture_poll(struct scd30_capture *c, bool sample, uint32_t *gap);
+
+/*! mS until the next poll */
+uint32_t capture_wait(struct scd30_capture *c);
+
+/*! percentage of the samples that were captured */
+float capture_completeness(struct scd30_capture *c);
+
+#endif  // End of definition check
@@ -0,0 +1,188 @@
+/*******************************************************************
+ *
+ * SCD30 command descriptors.
+ *
+ * One table describes each command : code, name, argument range,
+ * answer size, wait before the answer can be read and whether it
+ * changes the SCD30 state. The driver, the protocol layer, the
+ * emulator, the option / control / fleet parsers and the debug trace
+ * all use this table, instead of each keeping its own copy.
+ *
+ * The table is constexpr : send<Cmd>() and read<Cmd>() in the driver
+ * and the protocol layer check at compile time that the command takes
+ * an argument or has an answer, and the answer buffer must have the
+ * exact size. With a constant argument (send<Cmd, Value>()) the range
+ * is checked at compile time as well.
+ *
+ * The argument range is in user units, the argument sent is value *
+ * scale (e.g. temperature offset 0 - 25 *C is sent as 0 - 2500).
+ *
+ * stretch is the lowest clock stretch budget in uS for the command. The
+ * SCD30 stretches ~14 mS normally, the calibration commands (ASC, FRC)
+ * up to 150 mS. The driver adapts the budget from what it observes.
+ *
+ * modbus is the holding register of the command when the SCD30 is on
+ * Modbus (scd30_modbus.h), 0 if it has none.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_CMD_H__
+#define __SCD30_CMD_H__
+
+# include <stdint.h>
+
+#define SCD30_SERIAL_NUM_WORDS  16      // added August 2020
+#define SCD30_ANSWER_MAX        60      // max. bytes in an answer (with CRC)
+
+/* index in scd30_cmds[] */
+enum scd30_cmd_id
+{
+    SCD30_CMD_START,                    // continuous measurement
+    SCD30_CMD_STOP,                     // stop measurement
+    SCD30_CMD_INTERVAL,                 // measurement interval
+    SCD30_CMD_DATA_READY,               // data ready status
+    SCD30_CMD_READ_MEAS,                // read measurement
+    SCD30_CMD_ASC,                      // automatic self calibration
+    SCD30_CMD_FRC,                      // forced recalibration
+    SCD30_CMD_TEMP_OFFSET,              // temperature offset
+    SCD30_CMD_ALTITUDE,                 // altitude compensation
+    SCD30_CMD_SERIAL,                   // serial number
+    SCD30_CMD_FW_LEVEL,                 // firmware level
+    SCD30_CMD_SOFT_RESET,               // soft reset
+    SCD30_CMD_ARTICLE,                  // article code (only zero's)
+    SCD30_CMD_SINGLE,                   // single measurement (not used due to issues)
+    SCD30_CMD_NUM
+};
+
+struct scd30_cmd_desc
+{
+    uint16_t    code;                   // command code
+    const char  *name;                  // for debug messages
+    bool        arg;                    // can take an argument word
+    int32_t     min;                    // argument range (user units)
+    int32_t     max;
+    bool        zero;                   // 0 is accepted outside the range (de-activate)
+    uint8_t     scale;                  // argument sent = value * scale
+    uint8_t     words;                  // answer words (CRC not counted), 0 = none
+    uint16_t    wait_us;                // wait between command and reading the answer
+    bool        state;                  // changes the state or stored settings
+    uint32_t    stretch_us;             // min. clock stretch budget (see SCD30::stretchSet())
+    uint16_t    modbus;                 // Modbus register (0 = none)
+};
+
+constexpr scd30_cmd_desc scd30_cmds[SCD30_CMD_NUM] =
+{
+  /* code    name                                      arg    min    max  zero scale words wait  state  stretch modbus */
+    {0x0010, "COMMAND_CONTINUOUS_MEASUREMENT",          true,   700,  1200, true,   1,  0,  0, true,  30000, 0x0036},
+    {0x0104, "CMD_STOP_MEAS",                           false,    0,     0, false,  1,  0,  0, true,  30000, 0x0037},
+    {0x4600, "COMMAND_SET_MEASUREMENT_INTERVAL",        true,     2,  1800, false,  1,  1,  3, true,  30000, 0x0025},
+    {0x0202, "COMMAND_GET_DATA_READY",                  false,    0,     0, false,  1,  1,  3, false, 30000, 0x0027},
+    {0x0300, "COMMAND_READ_MEASUREMENT",                false,    0,     0, false,  1,  6,  3, false, 30000, 0x0028},
+    {0x5306, "COMMAND_AUTOMATIC_SELF_CALIBRATION",      true,     0,     1, false,  1,  1,  3, true, 200000, 0x003A},
+    {0x5204, "COMMAND_SET_FORCED_RECALIBRATION_FACTOR", true,   400,  2000, false,  1,  1,  3, true, 200000, 0x0039},
+    {0x5403, "COMMAND_SET_TEMPERATURE_OFFSET",          true,     0,    25, false, 100, 1,  3, true,  30000, 0x003B},
+    // 700 mbar ~ 3040M altitude, 1200mbar ~ -1520
+    {0x5102, "COMMAND_SET_ALTITUDE_COMPENSATION",       true, -1520,  3040, false,  1,  1,  3, true,  30000, 0x0038},
+    {0xD033, "CMD_READ_SERIALNBR",                      false,    0,     0, false,  1, SCD30_SERIAL_NUM_WORDS, 3, false, 30000,      0},
+    {0xD100, "CMD_GET_FW_LEVEL",                        false,    0,     0, false,  1,  1,  3, false, 30000, 0x0020},
+    {0xD304, "CMD_SOFT_RESET",                          false,    0,     0, false,  1,  0,  0, true,  30000, 0x0034},
+    {0xD025, "CMD_READ_ARTICLECODE",                    false,    0,     0, false,  1,  0,  3, false, 30000,      0},
+    {0x0006, "CMD_START_SINGLE_MEAS",                   true,   700,  1200, true,   1,  0,  0, true,  30000,      0},
+};
+
+/* command codes */
+constexpr uint16_t COMMAND_CONTINUOUS_MEASUREMENT = scd30_cmds[SCD30_CMD_START].code;
+constexpr uint16_t COMMAND_SET_MEASUREMENT_INTERVAL = scd30_cmds[SCD30_CMD_INTERVAL].code;
+constexpr uint16_t COMMAND_GET_DATA_READY = scd30_cmds[SCD30_CMD_DATA_READY].code;
+constexpr uint16_t COMMAND_READ_MEASUREMENT = scd30_cmds[SCD30_CMD_READ_MEAS].code;
+constexpr uint16_t COMMAND_AUTOMATIC_SELF_CALIBRATION = scd30_cmds[SCD30_CMD_ASC].code;
+constexpr uint16_t COMMAND_SET_FORCED_RECALIBRATION_FACTOR = scd30_cmds[SCD30_CMD_FRC].code;
+constexpr uint16_t COMMAND_SET_TEMPERATURE_OFFSET = scd30_cmds[SCD30_CMD_TEMP_OFFSET].code;
+constexpr uint16_t COMMAND_SET_ALTITUDE_COMPENSATION = scd30_cmds[SCD30_CMD_ALTITUDE].code;
+constexpr uint16_t CMD_READ_SERIALNBR = scd30_cmds[SCD30_CMD_SERIAL].code;
+constexpr uint16_t CMD_STOP_MEAS = scd30_cmds[SCD30_CMD_STOP].code;
+constexpr uint16_t CMD_SOFT_RESET = scd30_cmds[SCD30_CMD_SOFT_RESET].code;
+constexpr uint16_t CMD_GET_FW_LEVEL = scd30_cmds[SCD30_CMD_FW_LEVEL].code;
+
+/*********************************************************************
+ * @brief check the table : unique codes, answers fit the read buffer
+ *********************************************************************/
+constexpr bool scd30_cmd_check()
+{
+    for (int i = 0; i < SCD30_CMD_NUM; i++)
+    {
+        if (scd30_cmds[i].words * 3 > SCD30_ANSWER_MAX || scd30_cmds[i].scale == 0) return(false);
+        if (scd30_cmds[i].min > scd30_cmds[i].max) return(false);
+
+        for (int j = i + 1; j < SCD30_CMD_NUM; j++)
+        {
+            if (scd30_cmds[i].code == scd30_cmds[j].code) return(false);
+            if (scd30_cmds[i].modbus && scd30_cmds[i].modbus == scd30_cmds[j].modbus) return(false);
+        }
+    }
+
+    return(true);
+}
+
+static_assert(scd30_cmd_check(), "scd30_cmds[] : duplicate code, register or invalid entry");
+
+/*********************************************************************
+ * @brief find the descriptor of a command code
+ * @param code : command code
+ *
+ * @return descriptor or NULL if unknown
+ *********************************************************************/
+constexpr const scd30_cmd_desc *scd30_cmd_find(uint16_t code)
+{
+    for (int i = 0; i < SCD30_CMD_NUM; i++)
+        if (scd30_cmds[i].code == code) return(&scd30_cmds[i]);
+
+    return(nullptr);
+}
+
+/*********************************************************************
+ * @brief find the descriptor of a Modbus register
+ * @param reg : holding register
+ *
+ * @return descriptor or NULL if unknown
+ *********************************************************************/
+constexpr const scd30_cmd_desc *scd30_cmd_modbus(uint16_t reg)
+{
+    for (int i = 0; i < SCD30_CMD_NUM; i++)
+        if (reg && scd30_cmds[i].modbus == reg) return(&scd30_cmds[i]);
+
+    return(nullptr);
+}
+
+/*********************************************************************
+ * @brief check an argument (user units) against the command range
+ * @param id : command
+ * @param val : argument
+ *
+ * @return true if the command takes this argument
+ *********************************************************************/
+constexpr bool scd30_cmd_valid(scd30_cmd_id id, double val)
+{
+    return(scd30_cmds[id].arg &&
+        ((scd30_cmds[id].zero && val == 0) ||
+         (val >= scd30_cmds[id].min && val <= scd30_cmds[id].max)));
+}
+
+#endif  // End of definition check
@@ -0,0 +1,399 @@
+/*******************************************************************
+ *
+ * Control socket for the SCD30 monitor running in daemon mode.
+ *
+ * A local (unix domain) socket accepts one command per line. Each
+ * command is answered with a single reply starting with "OK" or "ERR".
+ *
+ * Example : echo "interval 30" | nc -U /tmp/scd30.sock
+ *
+ * The socket is only serviced during ctrl_wait(), which replaces the
+ * sleep in between the acquisition cycles. As such a command is never
+ * executed in the middle of reading the SCD30.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "SCD30.h"
+# include "scd30_ctrl.h"
+# include <errno.h>
+# include <fcntl.h>
+# include <sys/select.h>
+# include <sys/socket.h>
+# include <sys/un.h>
+
+/* listening socket */
+int ctrl_fd = -1;
+
+/* socket path (removed on close) */
+char ctrl_path[sizeof(((struct sockaddr_un *) 0)->sun_path)];
+
+/* connected clients */
+struct ctrl_client
+{
+    int     fd;                     // -1 is not in use
+    int     len;                    // bytes in buffer
+    char    buf[CTRL_MAXLINE];      // partial command line
+} ctrl_clients[CTRL_MAXCLIENT];
+
+/* other file descriptors to watch */
+int ctrl_watched[CTRL_MAXWATCH];
+int ctrl_num_watched = 0;
+
+/* command names */
+struct ctrl_name
+{
+    const char  *name;
+    ctrl_type   type;
+} ctrl_names[] =
+{
+    {"help",        CTRL_HELP},
+    {"interval",    CTRL_INTERVAL},
+    {"wait",        CTRL_WAIT},
+    {"frc",         CTRL_FRC},
+    {"asc",         CTRL_ASC},
+    {"altitude",    CTRL_ALTITUDE},
+    {"pressure",    CTRL_PRESSURE},
+    {"tempoffset",  CTRL_TEMPOFFSET},
+    {"get",         CTRL_GET},
+    {"stats",       CTRL_STATS},
+    {"reload",      CTRL_RELOAD},
+    {NULL,          CTRL_UNKNOWN}
+};
+
+/*********************************************************************
+ * @brief open the control socket
+ * @param path : socket path to create
+ *
+ * @return  true = OK, false is error
+ *********************************************************************/
+bool ctrl_open(char *path)
+{
+    struct sockaddr_un addr;
+    int i;
+
+    if (path == NULL) path = (char *) CTRL_SOCKET;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        p_printf(RED, (char *) "Control socket path too long : %s\n", path);
+        return(false);
+    }
+
+    for (i = 0; i < CTRL_MAXCLIENT; i++) ctrl_clients[i].fd = -1;
+
+    ctrl_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (ctrl_fd < 0)
+    {
+        p_printf(RED, (char *) "Can not create control socket\n");
+        return(false);
+    }
+
+    memset(&addr, 0x0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    /* remove left-over from an earlier run */
+    unlink(path);
+
+    if (bind(ctrl_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(ctrl_fd, CTRL_MAXCLIENT) < 0)
+    {
+        p_printf(RED, (char *) "Can not bind control socket %s\n", path);
+        ::close(ctrl_fd);
+        ctrl_fd = -1;
+        return(false);
+    }
+
+    /* accept() should never block the acquisition loop */
+    fcntl(ctrl_fd, F_SETFL, O_NONBLOCK);
+
+    strncpy(ctrl_path, path, sizeof(ctrl_path) - 1);
+
+    return(true);
+}
+
+/*********************************************************************
+ * @brief close the control socket and connected clients
+ *********************************************************************/
+void ctrl_close()
+{
+    int i;
+
+    if (ctrl_fd < 0) return;
+
+    for (i = 0; i < CTRL_MAXCLIENT; i++)
+    {
+        if (ctrl_clients[i].fd > -1) ::close(ctrl_clients[i].fd);
+        ctrl_clients[i].fd = -1;
+    }
+
+    ::close(ctrl_fd);
+    ctrl_fd = -1;
+
+    unlink(ctrl_path);
+}
+
+/*********************************************************************
+ * @brief parse a command line
+ * @param line : zero terminated command line
+ * @param cmd : to store the parsed command
+ *
+ * format : command [value] [target]  (in any order after command)
+ *********************************************************************/
+void ctrl_parse(char *line, struct ctrl_cmd *cmd)
+{
+    char    *word, *arg, *end;
+    int     i;
+    int32_t val;
+
+    cmd->type = CTRL_UNKNOWN;
+    cmd->has_value = false;
+    cmd->value = 0;
+    cmd->target[0] = 0x0;
+
+    word = strtok(line, " \t\r\n");
+    if (word == NULL) return;
+
+    for (i = 0; ctrl_names[i].name != NULL; i++)
+    {
+        if (strcasecmp(word, ctrl_names[i].name) == 0)
+        {
+            cmd->type = ctrl_names[i].type;
+            break;
+        }
+    }
+
+    while ((arg = strtok(NULL, " \t\r\n")) != NULL)
+    {
+        val = (int32_t) strtol(arg, &end, 10);
+
+        /* not a number : must be the target */
+        if (*end != 0x0)
+        {
+            if (cmd->target[0] != 0x0 || strlen(arg) >= CTRL_MAXNAME)
+            {
+                cmd->type = CTRL_UNKNOWN;
+                return;
+            }
+            strcpy(cmd->target, arg);
+        }
+        else if (cmd->has_value)
+        {
+            cmd->type = CTRL_UNKNOWN;
+            return;
+        }
+        else
+        {
+            cmd->value = val;
+            cmd->has_value = true;
+        }
+    }
+}
+
+/*********************************************************************
+ * @brief process the data received from a client
+ * @param cl : client
+ * @param handler : routine to execute a received command
+ * @param ctx : context pointer passed to handler
+ *********************************************************************/
+void ctrl_receive(struct ctrl_client *cl, ctrl_handler handler, void *ctx)
+{
+    char    reply[CTRL_MAXREPLY];
+    char    *nl;
+    int     num, len;
+    struct ctrl_cmd cmd;
+
+    num = read(cl->fd, cl->buf + cl->len, CTRL_MAXLINE - 1 - cl->len);
+
+    if (num <= 0)
+    {
+        if (num < 0 && errno == EINTR) return;
+        ::close(cl->fd);
+        cl->fd = -1;
+        return;
+    }
+
+    cl->len += num;
+    cl->buf[cl->len] = 0x0;
+
+    /* handle all complete lines */
+    while ((nl = strchr(cl->buf, '\n')) != NULL)
+    {
+        *nl = 0x0;
+        len = nl - cl->buf + 1;
+
+        ctrl_parse(cl->buf, &cmd);
+
+        reply[0] = 0x0;
+        handler(&cmd, reply, CTRL_MAXREPLY - 1, ctx);
+        strcat(reply, "\n");
+
+        /* do not get killed by SIGPIPE if the client has gone */
+        send(cl->fd, reply, strlen(reply), MSG_NOSIGNAL);
+
+        memmove(cl->buf, cl->buf + len, cl->len - len + 1);
+        cl->len -= len;
+    }
+
+    /* line too long : discard */
+    if (cl->len >= CTRL_MAXLINE - 1)
+    {
+        send(cl->fd, "ERR line too long\n", 18, MSG_NOSIGNAL);
+        cl->len = 0;
+    }
+}
+
+/*********************************************************************
+ * @brief accept a new client connection
+ *********************************************************************/
+void ctrl_accept()
+{
+    int fd, i;
+
+    fd = accept(ctrl_fd, NULL, NULL);
+    if (fd < 0) return;
+
+    for (i = 0; i < CTRL_MAXCLIENT; i++)
+    {
+        if (ctrl_clients[i].fd == -1)
+        {
+            ctrl_clients[i].fd = fd;
+            ctrl_clients[i].len = 0;
+            return;
+        }
+    }
+
+    send(fd, "ERR too many clients\n", 21, MSG_NOSIGNAL);
+    ::close(fd);
+}
+
+/*********************************************************************
+ * @brief add a file descriptor that will end ctrl_wait() when readable 
+ * @param fd : file descriptor to watch
+ *
+ * @return  true = OK, false is error
+ *********************************************************************/
+bool ctrl_watch(int fd)
+{
+    if (ctrl_num_watched == CTRL_MAXWATCH) return(false);
+    
+    ctrl_watched[ctrl_num_watched++] = fd;
+    
+    return(true);
+}
+
+/*********************************************************************
+ * @brief stop watching a file descriptor added with ctrl_watch()
+ * @param fd : file descriptor to remove
+ *********************************************************************/
+void ctrl_unwatch(int fd)
+{
+    int i;
+    
+    for (i = 0; i < ctrl_num_watched; i++)
+    {
+        if (ctrl_watched[i] != fd) continue;
+        
+        ctrl_watched[i] = ctrl_watched[--ctrl_num_watched];
+        return;
+    }
+}
+
+/*********************************************************************
+ * @brief wait while servicing control commands
+ * @param msec : time to wait in milli seconds
+ * @param handler : routine to execute a received command
+ * @param ctx : context pointer passed to handler
+ *
+ * if the control socket was not opened and nothing to watch, 
+ * this will just sleep.
+ *
+ * @return  0 : time elapsed
+ *         -1 : interrupted by a signal
+ *         else the watched file descriptor that is readable
+ *********************************************************************/
+int ctrl_wait(int msec, ctrl_handler handler, void *ctx)
+{
+    struct timespec now, end;
+    struct timeval tv;
+    fd_set  rfds;
+    int     i, maxfd, left, ret;
+
+    if (ctrl_fd < 0 && ctrl_num_watched == 0)
+    {
+        if (usleep(msec * 1000) < 0) return(-1);
+        return(0);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    end.tv_sec += msec / 1000;
+    end.tv_nsec += (msec % 1000) * 1000000;
+    if (end.tv_nsec >= 1000000000) { end.tv_sec++; end.tv_nsec -= 1000000000; }
+
+    while(1)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        left = (end.tv_sec - now.tv_sec) * 1000 + (end.tv_nsec - now.tv_nsec) / 1000000;
+        if (left <= 0) return(0);
+
+        FD_ZERO(&rfds);
+        maxfd = -1;
+        
+        if (ctrl_fd > -1)
+        {
+            FD_SET(ctrl_fd, &rfds);
+            maxfd = ctrl_fd;
+        }
+        
+        for (i = 0; i < ctrl_num_watched; i++)
+        {
+            FD_SET(ctrl_watched[i], &rfds);
+            if (ctrl_watched[i] > maxfd) maxfd = ctrl_watched[i];
+        }
+
+        for (i = 0; i < CTRL_MAXCLIENT; i++)
+        {
+            if (ctrl_clients[i].fd < 0) continue;
+            FD_SET(ctrl_clients[i].fd, &rfds);
+            if (ctrl_clients[i].fd > maxfd) maxfd = ctrl_clients[i].fd;
+        }
+
+        tv.tv_sec = left / 1000;
+        tv.tv_usec = (left % 1000) * 1000;
+
+        ret = select(maxfd + 1, &rfds, NULL, NULL, &tv);
+        
+        if (ret < 0 && errno == EINTR) return(-1);
+        if (ret <= 0) continue;
+
+        for (i = 0; i < ctrl_num_watched; i++)
+        {
+            if (FD_ISSET(ctrl_watched[i], &rfds)) return(ctrl_watched[i]);
+        }
+        
+        if (ctrl_fd > -1 && FD_ISSET(ctrl_fd, &rfds)) ctrl_accept();
+
+        for (i = 0; i < CTRL_MAXCLIENT; i++)
+        {
+            if (ctrl_clients[i].fd > -1 && FD_ISSET(ctrl_clients[i].fd, &rfds))
+                ctrl_receive(&ctrl_clients[i], handler, ctx);
+        }
+    }
+}
@@ -0,0 +1,121 @@
+/*******************************************************************
+ *
+ * Control socket for the SCD30 monitor running in daemon mode.
+ *
+ * A local (unix domain) socket accepts one command per line, like
+ * "interval 30" or "stats". The commands are serviced in between the
+ * acquisition cycles, so settings can be changed with the existing
+ * setters without restarting the program or re-initializing the bus.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_CTRL_H__
+#define __SCD30_CTRL_H__
+
+# include <stdint.h>
+
+/* default control socket */
+# define CTRL_SOCKET "/tmp/scd30.sock"
+
+/* max. number of control clients connected at the same time */
+# define CTRL_MAXCLIENT 4
+
+/* max. length of a command line */
+# define CTRL_MAXLINE 256
+
+/* max. length of a reply */
+# define CTRL_MAXREPLY 4096
+
+/* max. length of a target name */
+# define CTRL_MAXNAME 32
+
+/* max. number of other file descriptors to watch */
+# define CTRL_MAXWATCH 4
+
+/* command types */
+enum ctrl_type
+{
+    CTRL_UNKNOWN = 0,
+    CTRL_HELP,          // help
+    CTRL_INTERVAL,      // interval #     set measurement interval
+    CTRL_WAIT,          // wait #         set wait time between reads
+    CTRL_FRC,           // frc #          trigger forced recalibration
+    CTRL_ASC,           // asc 0|1        set automatic self calibration
+    CTRL_ALTITUDE,      // altitude #     set altitude compensation
+    CTRL_PRESSURE,      // pressure #     set ambient pressure
+    CTRL_TEMPOFFSET,    // tempoffset #   set temperature offset
+    CTRL_GET,           // get            query settings from SCD30
+    CTRL_STATS,         // stats          get statistics
+    CTRL_RELOAD         // reload         reload configuration file
+};
+
+struct ctrl_cmd
+{
+    ctrl_type   type;           // command requested
+    bool        has_value;      // value was provided
+    int32_t     value;          // value provided with command
+    char        target[CTRL_MAXNAME];   // sensor name (or empty)
+};
+
+/*! handler to execute a command
+ * @param cmd : parsed command
+ * @param reply : buffer to store the reply
+ * @param len : length of reply buffer
+ * @param ctx : context pointer as provided in ctrl_wait()
+ */
+typedef void (*ctrl_handler)(struct ctrl_cmd *cmd, char *reply, int len, void *ctx);
+
+/*! open the control socket
+ * @param path : socket path to create
+ *
+ * @return  true = OK, false is error
+ */
+bool ctrl_open(char *path);
+
+/*! close the control socket and remove the socket path */
+void ctrl_close();
+
+/*! add a file descriptor that will end ctrl_wait() when readable 
+ * @param fd : file descriptor to watch
+ *
+ * @return  true = OK, false is error
+ */
+bool ctrl_watch(int fd);
+
+/*! stop watching a file descriptor added with ctrl_watch()
+ * @param fd : file descriptor to remove
+ */
+void ctrl_unwatch(int fd);
+
+/*! wait while servicing control commands
+ * @param msec : time to wait in milli seconds
+ * @param handler : routine to execute a received command
+ * @param ctx : context pointer passed to handler
+ *
+ * if the control socket was not opened and nothing to watch, 
+ * this will just sleep.
+ *
+ * @return  0 : time elapsed
+ *         -1 : interrupted by a signal
+ *         else the watched file descriptor that is readable
+ */
+int ctrl_wait(int msec, ctrl_handler handler, void *ctx);
+
+#endif  // End of definition check
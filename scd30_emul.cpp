@@ -0,0 +1,261 @@
+/*******************************************************************
+ *
+ * Emulated SCD30 on command level.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "scd30_emul.h"
+# include "scd30_proto.h"
+
+/*********************************************************************
+ * @brief get monotonic time in milli seconds
+ *********************************************************************/
+uint64_t emul_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return((uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/*********************************************************************
+ * @brief power-on an emulated SCD30
+ * @param e : emulator
+ * @param instant : a sample is always available
+ *********************************************************************/
+void emul_init(struct scd30_emul *e, bool instant)
+{
+    memset(e, 0x0, sizeof(struct scd30_emul));
+
+    e->interval = 2;
+    e->asc = 1;
+    e->frc = 400;
+    strcpy(e->serial, "EMUL00000001");
+    e->instant = instant;
+}
+
+/*********************************************************************
+ * @brief set the measured values
+ * @param e : emulator
+ * @param co2 : CO2 in ppm
+ * @param temperature : temperature in *C
+ * @param humidity : relative humidity in %
+ *********************************************************************/
+void emul_set(struct scd30_emul *e, float co2, float temperature, float humidity)
+{
+    e->co2 = co2;
+    e->temperature = temperature;
+    e->humidity = humidity;
+    e->fixed = true;
+}
+
+/*********************************************************************
+ * @brief a sample is available
+ * @param e : emulator
+ *********************************************************************/
+bool emul_ready(struct scd30_emul *e)
+{
+    if (! e->measuring) return(false);
+
+    return(e->instant || emul_ms() >= e->next);
+}
+
+/*********************************************************************
+ * @brief write to the emulated SCD30
+ * @param e : emulator
+ * @param buf : bytes written
+ * @param len : number of bytes
+ *
+ * @return I2C_OK or I2C_SDA_NACK
+ *********************************************************************/
+Wstatus emul_write(struct scd30_emul *e, const char *buf, uint32_t len)
+{
+    const uint8_t *b = (const uint8_t *) buf;
+    const scd30_cmd_desc *desc;
+    uint16_t arg = 0;
+
+    e->writes++;
+
+    if (len != 2 && len != 5) goto nack;
+
+    e->command = b[0] << 8 | b[1];
+
+    if ((desc = scd30_cmd_find(e->command)) == NULL) goto nack;
+
+    if (len == 5)
+    {
+        if (! desc->arg || scd30_crc8(&b[2], 2) != b[4]) goto nack;
+        arg = b[2] << 8 | b[3];
+
+        /* the argument is sent as value * scale */
+        if (! scd30_cmd_valid((scd30_cmd_id) (desc - scd30_cmds), (double) arg / desc->scale)) goto nack;
+    }
+
+    switch(e->command)
+    {
+    case COMMAND_CONTINUOUS_MEASUREMENT:
+        e->measuring = true;
+        e->pressure = arg;
+        e->next = emul_ms() + e->interval * 1000;
+        break;
+
+    case CMD_STOP_MEAS:
+        e->measuring = false;
+        break;
+
+    case CMD_SOFT_RESET:
+        /* restarts with the stored settings */
+        e->next = emul_ms() + e->interval * 1000;
+        break;
+
+    case COMMAND_SET_MEASUREMENT_INTERVAL:
+        /* the next sample follows the new interval */
+        if (len == 5) e->interval = arg;
+        if (len == 5) e->next = emul_ms() + e->interval * 1000;
+        break;
+
+    case COMMAND_AUTOMATIC_SELF_CALIBRATION:
+        if (len == 5) e->asc = arg;
+        break;
+
+    case COMMAND_SET_FORCED_RECALIBRATION_FACTOR:
+        if (len == 5) e->frc = arg;
+        break;
+
+    case COMMAND_SET_TEMPERATURE_OFFSET:
+        if (len == 5) e->temp_offset = arg;
+        break;
+
+    case COMMAND_SET_ALTITUDE_COMPENSATION:
+        if (len == 5) e->altitude = arg;
+        break;
+
+    case COMMAND_GET_DATA_READY:
+    case COMMAND_READ_MEASUREMENT:
+    case CMD_READ_SERIALNBR:
+    case CMD_GET_FW_LEVEL:
+        break;
+
+    default:
+        goto nack;
+    }
+
+    return(I2C_OK);
+
+nack:
+    e->command = 0;
+    e->nacks++;
+    return(I2C_SDA_NACK);
+}
+
+/*********************************************************************
+ * @brief add a float as 2 words with CRC
+ * @param b : buffer
+ * @param val : value
+ *
+ * @return bytes added
+ *********************************************************************/
+int emul_float(uint8_t *b, float val)
+{
+    uint32_t u;
+
+    memcpy(&u, &val, sizeof(u));
+
+    b[0] = u >> 24;
+    b[1] = u >> 16;
+    b[2] = scd30_crc8(&b[0], 2);
+    b[3] = u >> 8;
+    b[4] = u;
+    b[5] = scd30_crc8(&b[3], 2);
+
+    return(6);
+}
+
+/*********************************************************************
+ * @brief read from the emulated SCD30
+ * @param e : emulator
+ * @param buf : to store the bytes read
+ * @param len : number of bytes
+ *
+ * @return I2C_OK or I2C_SDA_NACK (nothing to read)
+ *********************************************************************/
+Wstatus emul_read(struct scd30_emul *e, char *buf, uint32_t len)
+{
+    uint8_t ans[SCD30_SERIAL_NUM_WORDS * 3];
+    uint16_t val = 0;
+    uint32_t n = 3, i;
+    float   co2;
+
+    e->reads++;
+
+    switch(e->command)
+    {
+    case COMMAND_GET_DATA_READY:        val = emul_ready(e); break;
+    case COMMAND_SET_MEASUREMENT_INTERVAL: val = e->interval; break;
+    case COMMAND_AUTOMATIC_SELF_CALIBRATION: val = e->asc; break;
+    case COMMAND_SET_FORCED_RECALIBRATION_FACTOR: val = e->frc; break;
+    case COMMAND_SET_TEMPERATURE_OFFSET: val = e->temp_offset; break;
+    case COMMAND_SET_ALTITUDE_COMPENSATION: val = e->altitude; break;
+    case CMD_GET_FW_LEVEL:              val = EMUL_FW; break;
+
+    case COMMAND_READ_MEASUREMENT:
+        if (e->fixed) co2 = e->co2;
+        else co2 = 600 + 50 * sin((double) emul_ms() / 60000);
+
+        n = emul_float(&ans[0], co2);
+        n += emul_float(&ans[n], e->fixed ? e->temperature : 21.5);
+        n += emul_float(&ans[n], e->fixed ? e->humidity : 45);
+
+        /* the sample is taken */
+        if (emul_ready(e))
+        {
+            e->samples++;
+            e->next = emul_ms() + e->interval * 1000;
+        }
+        break;
+
+    case CMD_READ_SERIALNBR:
+        for (i = 0, n = 0; i < SCD30_SERIAL_NUM_WORDS; i++, n += 3)
+        {
+            ans[n] = e->serial[i * 2];
+            ans[n + 1] = e->serial[i * 2 + 1];
+            ans[n + 2] = scd30_crc8(&ans[n], 2);
+        }
+        break;
+
+    default:
+        e->nacks++;
+        return(I2C_SDA_NACK);
+    }
+
+    /* single word answer */
+    if (n == 3)
+    {
+        ans[0] = val >> 8;
+        ans[1] = val & 0xff;
+        ans[2] = scd30_crc8(ans, 2);
+    }
+
+    /* reading more than the answer returns 0xff, as on the bus */
+    for (i = 0; i < len; i++) buf[i] = i < n ? ans[i] : 0xff;
+
+    return(I2C_OK);
+}
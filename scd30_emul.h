@@ -0,0 +1,110 @@
+/*******************************************************************
+ *
+ * Emulated SCD30 on command level.
+ *
+ * The emulator takes the bytes written to the SCD30 and provides the
+ * bytes to read back, as the SCD30 does on I2C : a command (2 bytes),
+ * optionally followed by an argument word + CRC. After a command that
+ * has an answer, the answer is read as words each followed by a CRC.
+ *
+ * Supported are all commands in SCD30.h. Settings are kept as the
+ * SCD30 does. A new sample is available each measurement interval
+ * after the continuous measurement was started. With 'instant' set a
+ * sample is always available (benchmarks).
+ *
+ * The measured values can be set with emul_set(). Without that, CO2
+ * slowly varies around 600 ppm.
+ *
+ * An unknown command, an argument with a wrong CRC or outside the range
+ * in scd30_cmd.h is answered with a NACK, like the SCD30 does.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_EMUL_H__
+#define __SCD30_EMUL_H__
+
+# include "SCD30.h"
+
+/* firmware level reported */
+# define EMUL_FW 0x0342
+
+struct scd30_emul
+{
+    /* settings as stored in the SCD30 */
+    bool        measuring;              // continuous measurement started
+    uint16_t    interval;               // measurement interval
+    uint16_t    asc;                    // automatic self calibration
+    uint16_t    frc;                    // forced recalibration value
+    uint16_t    temp_offset;            // temperature offset
+    uint16_t    altitude;               // altitude compensation
+    uint16_t    pressure;               // ambient pressure (0 = none)
+    char        serial[SCD30_SERIAL_NUM_WORDS * 2 + 1];
+
+    /* behaviour */
+    bool        instant;                // a sample is always available
+    bool        fixed;                  // values set with emul_set()
+    float       co2;                    // measured values
+    float       temperature;
+    float       humidity;
+
+    /* state */
+    uint16_t    command;                // last command received
+    uint64_t    next;                   // mS next sample is available
+    uint32_t    samples;                // samples read
+
+    /* counters */
+    uint32_t    writes;                 // write transactions
+    uint32_t    reads;                  // read transactions
+    uint32_t    nacks;                  // not acknowledged
+};
+
+/*! power-on an emulated SCD30
+ * @param e : emulator
+ * @param instant : a sample is always available
+ */
+void emul_init(struct scd30_emul *e, bool instant);
+
+/*! set the measured values
+ * @param e : emulator
+ * @param co2 : CO2 in ppm
+ * @param temperature : temperature in *C
+ * @param humidity : relative humidity in %
+ */
+void emul_set(struct scd30_emul *e, float co2, float temperature, float humidity);
+
+/*! write to the emulated SCD30
+ * @param e : emulator
+ * @param buf : bytes written
+ * @param len : number of bytes
+ *
+ * @return I2C_OK or I2C_SDA_NACK
+ */
+Wstatus emul_write(struct scd30_emul *e, const char *buf, uint32_t len);
+
+/*! read from the emulated SCD30
+ * @param e : emulator
+ * @param buf : to store the bytes read
+ * @param len : number of bytes
+ *
+ * @return I2C_OK or I2C_SDA_NACK (nothing to read)
+ */
+Wstatus emul_read(struct scd30_emul *e, char *buf, uint32_t len);
+
+#endif  // End of definition check
@@ -0,0 +1,1943 @@
+/*******************************************************************
+ *
+ * Fleet of SCD30 sensors described in a configuration file.
+ *
+ * Each sensor in the configuration gets its own SCD30 instance and
+ * its own read schedule. Sensors on the same I2C bus share the bus
+ * (using a multiplexer channel each).
+ *
+ * Upon a reload the new configuration is compared with the previous
+ * one (as loaded from file) :
+ *  - removed sensors are stopped and their bus released
+ *  - new sensors are initialized
+ *  - sensors with changed bus settings are re-initialized
+ *  - sensors with changed SCD30 settings get only those settings
+ *    sent with the existing setters (no re-initialization)
+ *  - sensors without changes are not touched at all
+ *
+ * Settings that have been changed with the control socket are not
+ * reverted by a reload, unless that setting was changed in the file.
+ *
+ * Hot-plug : each sensor has a health supervisor (scd30_health.h).
+ * When that gives up, the sensor is detached. The bus stays open, so 
+ * a detached sensor costs only one probe per backoff period. When it 
+ * responds again, it is attached and configured. Other sensors keep 
+ * their schedule.
+ *
+ * Bus priority : the work for a bus goes through a transaction queue
+ * (scd30_busq.h). Measurement reads go first, attach attempts only in
+ * the gap before the next read on that bus. A control command waits
+ * for due reads on its bus. The queue wait per class is in 'stats'.
+ * The queue of a bus is released when its last sensor is removed or
+ * moved on a reload.
+ *
+ * Staggered start : a sensor added on a bus that is already in use
+ * is started later, so that its reads fall in the middle of the
+ * largest gap between the reads of the others. 'stats' shows the bus
+ * utilization and the peak number of reads due at the same moment.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "scd30_fleet.h"
+# include "scd30_ident.h"
+# include "scd30_health.h"
+# include "scd30_capture.h"
+# include "scd30_adapt.h"
+# include "scd30_busq.h"
+# include "scd30_usage.h"
+# include "scd30_speed.h"
+# include <libgen.h>
+# include <sys/inotify.h>
+
+#ifdef DYLOS
+# include "dylos.h"
+#endif
+
+/* runtime information of a sensor */
+struct fleet_sensor
+{
+    bool        used;                   // slot in use
+    bool        attached;               // SCD30 initialized
+    bool        staggered;              // waiting for its start phase
+    struct fleet_cfg cfg;               // configuration as loaded
+    SCD30       dev;                    // the SCD30
+    struct scd30_sink *sink;            // output
+    uint16_t    wait;                   // current seconds between reads
+    uint64_t    next;                   // next read (msec)
+    uint32_t    outputs;                // results written
+    bool        first;                  // first read after init
+    struct scd30_health health;         // health supervisor
+    struct scd30_capture cap;           // lossless capture
+    uint32_t    seq;                    // sequence number of sample to output
+    struct scd30_adapt adapt;           // adaptive interval
+    struct scd30_press press;           // ambient pressure source
+    struct scd30_speed speed;           // I2C speed tuning
+    uint16_t    co2;                    // last CO2 output
+    uint16_t    backoff;                // seconds until next attach attempt
+    uint32_t    attaches;               // times attached
+    uint32_t    detaches;               // times detached (gone)
+    struct scd30_ident ident;           // identity (valid once attached)
+};
+
+struct fleet_sensor fleet[FLEET_MAXSENSOR];
+
+/* transaction queue per bus */
+struct fleet_bus
+{
+    bool        used;
+    bool        I2C_interface;          // hardware I2C
+    uint8_t     sda;                    // software I2C
+    uint8_t     scl;
+    bool        modbus;                 // Modbus over UART
+    char        port[MODBUS_PORTLEN];
+    struct scd30_busq q;
+};
+
+struct fleet_bus fleet_busses[SCD30_MAXBUS];
+
+/* no free queue reported */
+bool        fleet_busq_warned = false;
+
+/* current configuration */
+struct fleet_conf fleet_cur;
+char        *fleet_config;
+struct fleet_opt *fleet_options;
+
+/* set by SIGHUP */
+volatile sig_atomic_t fleet_hup = 0;
+
+/* configuration file change notification */
+int         fleet_inotify = -1;
+
+/* Dylos */
+struct scd30_sink *fleet_dylos_sink = NULL;
+uint64_t    fleet_dylos_next;
+int         fleet_dylos_fd = -1;        // answer pending on this pipe
+
+/*********************************************************************
+ * @brief get monotonic time in milli seconds
+ *********************************************************************/
+uint64_t fleet_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return((uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/*********************************************************************
+ * @brief set sensor configuration defaults (same as command line)
+ * @param cfg : sensor configuration
+ * @param name : name of sensor
+ *********************************************************************/
+void fleet_default(struct fleet_cfg *cfg, char *name)
+{
+    memset(cfg, 0x0, sizeof(struct fleet_cfg));
+
+    strncpy(cfg->name, name, FLEET_NAMELEN - 1);
+    cfg->I2C_interface = soft_I2C;
+    cfg->sda = DEF_SDA;
+    cfg->scl = DEF_SCL;
+    cfg->baudrate = SCD30_SPEED;
+    cfg->speed_budget = SPEED_BUDGET;
+    cfg->pullup = false;
+    cfg->mux_address = NO_MUX;
+    cfg->mux_channel = 0;
+    cfg->lock_timeout = SCD30_LOCK_TIMEOUT;
+    cfg->interval = 2;
+    cfg->adapt_hold = ADAPT_HOLD;
+    cfg->press_threshold = PRESS_THRESHOLD;
+    cfg->press_hold = PRESS_HOLD;
+    cfg->asc = true;
+    cfg->frc = -1;
+    cfg->altitude = -1;
+    cfg->pressure = -1;
+    cfg->temp_offset = -1;
+    cfg->wait = 0;
+    strcpy(cfg->output, SINK_STDOUT);
+}
+
+/*********************************************************************
+ * @brief parse a yes/no value
+ * @param val : value
+ * @param res : to store the result
+ *
+ * @return  true = OK, false is error
+ *********************************************************************/
+bool fleet_bool(char *val, bool *res)
+{
+    if (strcasecmp(val, "yes") == 0 || strcasecmp(val, "on") == 0 || strcmp(val, "1") == 0)
+        *res = true;
+    else if (strcasecmp(val, "no") == 0 || strcasecmp(val, "off") == 0 || strcmp(val, "0") == 0)
+        *res = false;
+    else
+        return(false);
+
+    return(true);
+}
+
+/*********************************************************************
+ * @brief parse a number within limits
+ * @param val : value
+ * @param min : minimum value
+ * @param max : maximum value
+ * @param res : to store the result
+ *
+ * @return  true = OK, false is error
+ *********************************************************************/
+bool fleet_num(char *val, long min, long max, long *res)
+{
+    char *end;
+
+    *res = strtol(val, &end, 0);
+
+    if (*end != 0x0 || *res < min || *res > max) return(false);
+
+    return(true);
+}
+
+/*********************************************************************
+ * @brief handle a key in a sensor section
+ * @param cfg : sensor configuration
+ * @param key : key
+ * @param val : value
+ *
+ * @return  true = OK, false is error
+ *********************************************************************/
+bool fleet_sensor_key(struct fleet_cfg *cfg, char *key, char *val)
+{
+    long n;
+    char *p;
+
+    if (strcmp(key, "interface") == 0)
+    {
+        cfg->engine = cfg->modbus = false;
+
+        if (strcasecmp(val, "modbus") == 0) cfg->modbus = true;
+        else if (strcasecmp(val, "soft") == 0) cfg->I2C_interface = soft_I2C;
+        else if (strcasecmp(val, "hard") == 0) cfg->I2C_interface = hard_I2C;
+        else if (strcasecmp(val, "gpio") == 0)
+        {
+            cfg->I2C_interface = soft_I2C;
+            cfg->engine = true;
+        }
+        else return(false);
+    }
+    else if (strcmp(key, "port") == 0)
+    {
+        if (strlen(val) >= MODBUS_PORTLEN) return(false);
+        strcpy(cfg->port, val);
+    }
+    else if (strcmp(key, "sda") == 0)
+    {
+        if (! fleet_num(val, 2, 27, &n) || n == 4) return(false);
+        cfg->sda = n;
+    }
+    else if (strcmp(key, "scl") == 0)
+    {
+        if (! fleet_num(val, 2, 27, &n) || n == 4) return(false);
+        cfg->scl = n;
+    }
+    else if (strcmp(key, "speed") == 0)
+    {
+        if (! fleet_num(val, 1, 400, &n)) return(false);
+        cfg->baudrate = n;
+    }
+    else if (strcmp(key, "speedtune") == 0)
+    {
+        if (! fleet_num(val, 0, 400, &n) || (n > 0 && n < 10)) return(false);
+        cfg->speed_max = n;
+    }
+    else if (strcmp(key, "speedbudget") == 0)
+    {
+        if (! fleet_num(val, 1, 1000, &n)) return(false);
+        cfg->speed_budget = n;
+    }
+    else if (strcmp(key, "pullup") == 0)
+        return(fleet_bool(val, &cfg->pullup));
+
+    else if (strcmp(key, "mux") == 0)
+    {
+        if (! fleet_num(val, 0x8, 0x77, &n)) return(false);
+        cfg->mux_address = n;
+    }
+    else if (strcmp(key, "locktimeout") == 0)
+    {
+        if (! fleet_num(val, 0, 60000, &n)) return(false);
+        cfg->lock_timeout = n;
+    }
+    else if (strcmp(key, "channel") == 0)
+    {
+        if (! fleet_num(val, 0, MUX_CHANNELS - 1, &n)) return(false);
+        cfg->mux_channel = n;
+    }
+    else if (strcmp(key, "interval") == 0)
+    {
+        if (! fleet_num(val, scd30_cmds[SCD30_CMD_INTERVAL].min, scd30_cmds[SCD30_CMD_INTERVAL].max, &n)) return(false);
+        cfg->interval = n;
+    }
+    else if (strcmp(key, "wait") == 0)
+    {
+        if (! fleet_num(val, 1, 0xffff, &n)) return(false);
+        cfg->wait = n;
+    }
+    else if (strcmp(key, "capture") == 0)
+    {
+        if (! fleet_bool(val, &cfg->capture)) return(false);
+    }
+    else if (strcmp(key, "adaptive") == 0)
+    {
+        if ((p = strchr(val, ',')) == NULL) return(false);
+        *p++ = 0x0;
+        if (! fleet_num(val, scd30_cmds[SCD30_CMD_INTERVAL].min, scd30_cmds[SCD30_CMD_INTERVAL].max - 1, &n)) return(false);
+        cfg->adapt_min = n;
+        if (! fleet_num(p, cfg->adapt_min + 1, scd30_cmds[SCD30_CMD_INTERVAL].max, &n)) return(false);
+        cfg->adapt_max = n;
+    }
+    else if (strcmp(key, "adapthold") == 0)
+    {
+        if (! fleet_num(val, 1, 0xffff, &n)) return(false);
+        cfg->adapt_hold = n;
+    }
+    else if (strcmp(key, "asc") == 0)
+        return(fleet_bool(val, &cfg->asc));
+
+    else if (strcmp(key, "frc") == 0)
+    {
+        if (! fleet_num(val, scd30_cmds[SCD30_CMD_FRC].min, scd30_cmds[SCD30_CMD_FRC].max, &n)) return(false);
+        cfg->frc = n;
+    }
+    else if (strcmp(key, "altitude") == 0)
+    {
+        if (! fleet_num(val, scd30_cmds[SCD30_CMD_ALTITUDE].min, scd30_cmds[SCD30_CMD_ALTITUDE].max, &n)) return(false);
+        cfg->altitude = n;
+    }
+    else if (strcmp(key, "pressure") == 0)
+    {
+        // setting to zero will de-activate
+        if (! fleet_num(val, 0, scd30_cmds[SCD30_CMD_START].max, &n) || ! scd30_cmd_valid(SCD30_CMD_START, n)) return(false);
+        cfg->pressure = n;
+    }
+    else if (strcmp(key, "tempoffset") == 0)
+    {
+        if (! fleet_num(val, scd30_cmds[SCD30_CMD_TEMP_OFFSET].min, scd30_cmds[SCD30_CMD_TEMP_OFFSET].max, &n)) return(false);
+        cfg->temp_offset = n;
+    }
+    else if (strcmp(key, "pressuresource") == 0)
+    {
+        if (strlen(val) >= PRESS_SPECLEN) return(false);
+        strcpy(cfg->press_src, val);
+    }
+    else if (strcmp(key, "pressurethreshold") == 0)
+    {
+        if (! fleet_num(val, 1, 500, &n)) return(false);
+        cfg->press_threshold = n;
+    }
+    else if (strcmp(key, "pressurehold") == 0)
+    {
+        if (! fleet_num(val, 1, 0xffff, &n)) return(false);
+        cfg->press_hold = n;
+    }
+    else if (strcmp(key, "output") == 0)
+    {
+        if (strlen(val) >= SINK_PATHLEN) return(false);
+        strcpy(cfg->output, val);
+    }
+    else
+        return(false);
+
+    return(true);
+}
+
+/*********************************************************************
+ * @brief load the configuration file
+ * @param path : configuration file
+ * @param conf : to store the configuration
+ *
+ * @return  true = OK, false is error
+ *********************************************************************/
+bool fleet_load(char *path, struct fleet_conf *conf)
+{
+    FILE    *fp;
+    char    line[MAXBUF * 2], *p, *key, *val, *end;
+    int     lnr = 0, i;
+    long    n;
+    enum { SEC_NONE, SEC_GLOBAL, SEC_SENSOR, SEC_DYLOS } sec = SEC_NONE;
+    struct fleet_cfg *cfg = NULL;
+    bool    ok;
+
+    if ((fp = fopen(path, "r")) == NULL)
+    {
+        p_printf(RED, (char *) "Can not open configuration %s\n", path);
+        return(false);
+    }
+
+    memset(conf, 0x0, sizeof(struct fleet_conf));
+    conf->timestamp = fleet_options->timestamp;
+    conf->tempCel = fleet_options->tempCel;
+    conf->heatindex = fleet_options->heatindex;
+    conf->dewpoint = fleet_options->dewpoint;
+    conf->dylos_wait = 60;
+    strcpy(conf->dylos_output, SINK_STDOUT);
+
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        lnr++;
+
+        /* remove comment and white space */
+        if ((p = strchr(line, '#')) != NULL) *p = 0x0;
+        for (p = line; *p == ' ' || *p == '\t'; p++);
+        for (end = p + strlen(p); end > p && (end[-1] <= ' '); end--);
+        *end = 0x0;
+
+        if (*p == 0x0) continue;
+
+        /* section */
+        if (*p == '[')
+        {
+            if (end[-1] != ']') goto cfg_error;
+            end[-1] = 0x0;
+            p++;
+
+            if (strcasecmp(p, "global") == 0) sec = SEC_GLOBAL;
+
+            else if (strcasecmp(p, "dylos") == 0) sec = SEC_DYLOS;
+
+            else if (strncasecmp(p, "sensor", 6) == 0 && (p[6] == ' ' || p[6] == '\t'))
+            {
+                for (p += 6; *p == ' ' || *p == '\t'; p++);
+
+                if (*p == 0x0 || strlen(p) >= FLEET_NAMELEN || strpbrk(p, " \t") != NULL)
+                    goto cfg_error;
+
+                for (i = 0; i < conf->num; i++)
+                {
+                    if (strcmp(conf->sensor[i].name, p) == 0)
+                    {
+                        p_printf(RED, (char *) "%s line %d : duplicate sensor %s\n", path, lnr, p);
+                        fclose(fp);
+                        return(false);
+                    }
+                }
+
+                if (conf->num == FLEET_MAXSENSOR)
+                {
+                    p_printf(RED, (char *) "%s line %d : too many sensors (max %d)\n", path, lnr, FLEET_MAXSENSOR);
+                    fclose(fp);
+                    return(false);
+                }
+
+                cfg = &conf->sensor[conf->num++];
+                fleet_default(cfg, p);
+                sec = SEC_SENSOR;
+            }
+            else
+                goto cfg_error;
+
+            continue;
+        }
+
+        /* key = value */
+        if ((val = strchr(p, '=')) == NULL) goto cfg_error;
+
+        key = p;
+        for (end = val; end > key && (end[-1] == ' ' || end[-1] == '\t'); end--);
+        *end = 0x0;
+        for (val++; *val == ' ' || *val == '\t'; val++);
+
+        switch(sec)
+        {
+        case SEC_GLOBAL:
+            if (strcmp(key, "timestamp") == 0) ok = fleet_bool(val, &conf->timestamp);
+            else if (strcmp(key, "dewpoint") == 0) ok = fleet_bool(val, &conf->dewpoint);
+            else if (strcmp(key, "heatindex") == 0) ok = fleet_bool(val, &conf->heatindex);
+            else if (strcmp(key, "serial") == 0) ok = fleet_bool(val, &conf->serial);
+            else if (strcmp(key, "fahrenheit") == 0)
+            {
+                ok = fleet_bool(val, &conf->tempCel);
+                conf->tempCel = ! conf->tempCel;
+            }
+            else ok = false;
+            break;
+
+        case SEC_DYLOS:
+            if (strcmp(key, "port") == 0)
+            {
+                ok = strlen(val) < MAXBUF;
+                if (ok) strcpy(conf->dylos_port, val);
+            }
+            else if (strcmp(key, "wait") == 0)
+            {
+                ok = fleet_num(val, 1, 0xffff, &n);
+                if (ok) conf->dylos_wait = n;
+            }
+            else if (strcmp(key, "output") == 0)
+            {
+                ok = strlen(val) < SINK_PATHLEN;
+                if (ok) strcpy(conf->dylos_output, val);
+            }
+            else ok = false;
+            break;
+
+        case SEC_SENSOR:
+            ok = fleet_sensor_key(cfg, key, val);
+            break;
+
+        default:
+            ok = false;
+        }
+
+        if (! ok)
+        {
+            p_printf(RED, (char *) "%s line %d : invalid key or value '%s = %s'\n", path, lnr, key, val);
+            fclose(fp);
+            return(false);
+        }
+    }
+
+    fclose(fp);
+
+    /* cross checks */
+    for (i = 0; i < conf->num; i++)
+    {
+        cfg = &conf->sensor[i];
+
+        if (cfg->modbus && (cfg->port[0] == 0x0 || cfg->mux_address != NO_MUX || cfg->speed_max))
+        {
+            p_printf(RED, (char *) "%s : sensor %s Modbus needs a port, no mux or speedtune\n", path, cfg->name);
+            return(false);
+        }
+
+        if (cfg->I2C_interface == soft_I2C && cfg->sda == cfg->scl)
+        {
+            p_printf(RED, (char *) "%s : sensor %s SDA and SCL are the same\n", path, cfg->name);
+            return(false);
+        }
+
+        if (cfg->altitude != -1 && cfg->pressure != -1)
+        {
+            p_printf(RED, (char *) "%s : sensor %s either set altitude or pressure\n", path, cfg->name);
+            return(false);
+        }
+
+        /* FRC will overrule ASC */
+        if (cfg->frc != -1) cfg->asc = false;
+
+        /* start within the adaptive bounds */
+        if (cfg->adapt_max)
+        {
+            if (cfg->interval < cfg->adapt_min) cfg->interval = cfg->adapt_min;
+            if (cfg->interval > cfg->adapt_max) cfg->interval = cfg->adapt_max;
+        }
+    }
+
+#ifndef DYLOS
+    if (conf->dylos_port[0] != 0x0)
+        p_printf(RED, (char *) "Dylos is not supported in this build\n");
+#endif
+
+    return(true);
+
+cfg_error:
+    p_printf(RED, (char *) "%s line %d : syntax error\n", path, lnr);
+    fclose(fp);
+    return(false);
+}
+
+/*********************************************************************
+ * @brief remember the settings of a sensor in the identity cache
+ * @param fs : sensor
+ *********************************************************************/
+void fleet_remember(struct fleet_sensor *fs)
+{
+    struct fleet_cfg *cfg = &fs->cfg;
+    struct scd30_ident *id = &fs->ident;
+
+    if (! id->used) return;
+
+    id->interval = cfg->adapt_max ? fs->adapt.interval : cfg->interval;
+    id->asc = cfg->asc;
+    id->pressure = cfg->pressure;
+    if (cfg->altitude != -1) id->altitude = cfg->altitude;
+    if (cfg->frc != -1) id->frc = cfg->frc;
+    if (cfg->temp_offset != -1) id->temp_offset = cfg->temp_offset;
+
+    ident_put(id);
+}
+
+/*********************************************************************
+ * @brief send the SCD30 settings (after initialization)
+ * @param fs : sensor
+ * @param cached : identity was taken from the cache
+ *
+ * The altitude, FRC and temperature offset are stored in the SCD30.
+ * If the identity cache tells they have already been set, they are
+ * not sent again. The pressure is reset by begin() and always sent.
+ *
+ * @return  true = OK, false is error
+ *********************************************************************/
+bool fleet_settings(struct fleet_sensor *fs, bool cached)
+{
+    struct fleet_cfg *cfg = &fs->cfg;
+    struct scd30_ident *id = &fs->ident;
+
+    if (cfg->altitude != -1 && ! (cached && id->altitude == cfg->altitude) && 
+        ! fs->dev.setAltitudeCompensation(cfg->altitude)) return(false);
+
+    /* pressure will overrule altitude */
+    if (cfg->pressure != -1 && ! fs->dev.setAmbientPressure(cfg->pressure)) return(false);
+
+    /* will overrule ASC */
+    if (cfg->frc != -1 && ! (cached && id->frc == cfg->frc) && 
+        ! fs->dev.setForceRecalibration(cfg->frc)) return(false);
+
+    /* only impacts the temperature and humidity reading. NOT the CO2 */
+    if (cfg->temp_offset != -1 && ! (cached && id->temp_offset == cfg->temp_offset) && 
+        ! fs->dev.setTemperatureOffset(cfg->temp_offset)) return(false);
+
+    fleet_remember(fs);
+
+    return(true);
+}
+
+/*********************************************************************
+ * @brief schedule the next attach attempt of a sensor
+ * @param fs : sensor
+ *
+ * The period is doubled on each attempt, up to FLEET_RETRY seconds.
+ *********************************************************************/
+void fleet_backoff(struct fleet_sensor *fs)
+{
+    if (fs->backoff == 0) fs->backoff = FLEET_BACKOFF;
+    else if (fs->backoff * 2 > FLEET_RETRY) fs->backoff = FLEET_RETRY;
+    else fs->backoff *= 2;
+    
+    fs->next = fleet_ms() + fs->backoff * 1000;
+}
+
+/*********************************************************************
+ * @brief is a sensor on a bus
+ * @param b : bus (in use)
+ * @param cfg : sensor configuration
+ *
+ * Channels of a multiplexer are on the same bus.
+ *********************************************************************/
+bool fleet_onbus(struct fleet_bus *b, struct fleet_cfg *cfg)
+{
+    if (b->modbus != cfg->modbus) return(false);
+
+    if (b->modbus) return(strcmp(b->port, cfg->port) == 0);
+
+    if (b->I2C_interface != cfg->I2C_interface) return(false);
+
+    return(b->I2C_interface || (b->sda == cfg->sda && b->scl == cfg->scl));
+}
+
+/*********************************************************************
+ * @brief get the transaction queue of the bus of a sensor
+ * @param cfg : sensor configuration
+ *
+ * @return queue or NULL if too many busses
+ *********************************************************************/
+struct scd30_busq *fleet_busq(struct fleet_cfg *cfg)
+{
+    struct fleet_bus *b;
+    int i, free = -1;
+
+    for (i = 0; i < SCD30_MAXBUS; i++)
+    {
+        b = &fleet_busses[i];
+
+        if (! b->used)
+        {
+            if (free < 0) free = i;
+            continue;
+        }
+
+        if (fleet_onbus(b, cfg)) return(&b->q);
+    }
+
+    if (free < 0)
+    {
+        if (! fleet_busq_warned)
+            p_printf(RED, (char *) "sensor %s : more than %d busses, no transaction queue\n", cfg->name, SCD30_MAXBUS);
+
+        fleet_busq_warned = true;
+        return(NULL);
+    }
+
+    b = &fleet_busses[free];
+    b->used = true;
+    b->I2C_interface = cfg->I2C_interface;
+    b->sda = cfg->sda;
+    b->scl = cfg->scl;
+    b->modbus = cfg->modbus;
+    strcpy(b->port, cfg->port);
+    busq_init(&b->q);
+
+    return(&b->q);
+}
+
+/*********************************************************************
+ * @brief release the queues of busses without sensors
+ *
+ * After a sensor was removed or moved to an other bus. Work still
+ * queued is dropped (the sensor was removed or is queued on its new
+ * bus).
+ *********************************************************************/
+void fleet_busq_release()
+{
+    struct fleet_bus *b;
+    int i, j;
+
+    for (i = 0; i < SCD30_MAXBUS; i++)
+    {
+        b = &fleet_busses[i];
+
+        if (! b->used) continue;
+
+        for (j = 0; j < FLEET_MAXSENSOR; j++)
+            if (fleet[j].used && fleet_onbus(b, &fleet[j].cfg)) break;
+
+        if (j < FLEET_MAXSENSOR) continue;
+
+        b->used = false;
+        fleet_busq_warned = false;
+    }
+}
+
+/*********************************************************************
+ * @brief seconds between reads of a sensor
+ * @param cfg : sensor configuration
+ *********************************************************************/
+uint16_t fleet_period(struct fleet_cfg *cfg)
+{
+    if (cfg->wait && ! cfg->adapt_max && ! cfg->capture) return(cfg->wait);
+
+    return(cfg->interval);
+}
+
+/*********************************************************************
+ * @brief delay the start of a sensor to stagger the reads on its bus
+ * @param fs : sensor
+ *
+ * The reads of the other sensors on the bus are placed on a circle of
+ * the read period of this sensor. The first read (one period after the
+ * start) is placed in the middle of the largest gap between them.
+ *
+ * @return delay in mS (0 = alone on the bus)
+ *********************************************************************/
+uint32_t fleet_phase(struct fleet_sensor *fs)
+{
+    struct scd30_busq *q = fleet_busq(&fs->cfg);
+    struct fleet_sensor *o;
+    uint32_t period = fleet_period(&fs->cfg) * 1000, pt[FLEET_MAXSENSOR], gap, best = 0, at = 0, tmp;
+    uint64_t t;
+    int     i, j, n = 0;
+
+    if (q == NULL) return(0);
+
+    for (i = 0; i < FLEET_MAXSENSOR; i++)
+    {
+        o = &fleet[i];
+
+        if (! o->used || o == fs || fleet_busq(&o->cfg) != q) continue;
+
+        /* next read, or first read of a sensor waiting for its start */
+        if (o->attached) t = o->next;
+        else if (o->staggered) t = o->next + fleet_period(&o->cfg) * 1000;
+        else continue;
+
+        pt[n++] = t % period;
+    }
+
+    if (n == 0) return(0);
+
+    /* sort the read moments */
+    for (i = 1; i < n; i++)
+    {
+        for (j = i; j > 0 && pt[j - 1] > pt[j]; j--)
+        {
+            tmp = pt[j]; pt[j] = pt[j - 1]; pt[j - 1] = tmp;
+        }
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        gap = (i + 1 < n ? pt[i + 1] : pt[0] + period) - pt[i];
+
+        if (gap > best)
+        {
+            best = gap;
+            at = (pt[i] + gap / 2) % period;
+        }
+    }
+
+    return((at + period - fleet_ms() % period) % period);
+}
+
+/*********************************************************************
+ * @brief initialize a sensor
+ * @param fs : sensor
+ *
+ * @return  true = OK, false is error
+ *********************************************************************/
+bool fleet_attach(struct fleet_sensor *fs)
+{
+    struct fleet_cfg *cfg = &fs->cfg;
+    bool cached = false;
+
+    fs->dev.settings.I2C_interface = cfg->I2C_interface;
+    fs->dev.settings.engine = cfg->engine;
+    fs->dev.settings.modbus = cfg->modbus ? cfg->port : NULL;
+    fs->dev.settings.emul = cfg->emul;
+    fs->dev.settings.sda = cfg->sda;
+    fs->dev.settings.scl = cfg->scl;
+    fs->dev.settings.baudrate = cfg->baudrate;
+    fs->dev.settings.pullup = cfg->pullup;
+    fs->dev.settings.mux_address = cfg->mux_address;
+    fs->dev.settings.mux_channel = cfg->mux_channel;
+    fs->dev.settings.lock_timeout = cfg->lock_timeout;
+
+    fs->dev.setDebug(fleet_options->verbose);
+
+    /* begin() sets the configured interval and no pressure */
+    fs->adapt.interval = cfg->interval;
+    press_reset(&fs->press);
+
+    if (fleet_options->verbose) p_printf(YELLOW, (char *) "initialize sensor %s\n", cfg->name);
+
+    fs->staggered = false;
+    fs->attached = fs->dev.begin(cfg->asc, cfg->interval) && 
+        ident_get(&fs->dev, &fs->ident, &cached, fs->detaches != 0) && fleet_settings(fs, cached);
+    
+    if (fleet_options->verbose && fs->attached) 
+        p_printf(YELLOW, (char *) "sensor %s serial %s%s\n", cfg->name, fs->ident.serial, cached ? " (cached)" : "");
+
+    if (! fs->attached)
+    {
+        /* the bus is kept open (if that worked) for the presence checks */
+        fleet_backoff(fs);
+        
+        if (fleet_options->verbose || fs->backoff == FLEET_BACKOFF)
+            p_printf(RED, (char *) "Error during init sensor %s. Retry in %d seconds\n", cfg->name, fs->backoff);
+        
+        return(false);
+    }
+
+    if (fs->detaches) p_printf(GREEN, (char *) "sensor %s attached\n", cfg->name);
+    
+    /* cable or sensor can be different */
+    if (fs->speed.max) speed_calibrate(&fs->speed, &fs->dev);
+    
+    fs->wait = cfg->wait && ! cfg->adapt_max ? cfg->wait : cfg->interval;
+    fs->next = fleet_ms() + fs->wait * 1000;
+    fs->first = true;
+    health_init(&fs->health, &fs->dev, cfg->name, cfg->interval);
+    
+    /* the sequence continues after a re-attach */
+    if (cfg->capture)
+    {
+        capture_interval(&fs->cap, cfg->interval);
+        fs->next = fleet_ms() + capture_wait(&fs->cap);
+    }
+    fs->backoff = 0;
+    fs->attaches++;
+
+    return(true);
+}
+
+/*********************************************************************
+ * @brief a sensor stopped responding : detach
+ * @param fs : sensor
+ *
+ * The bus is not closed (might be shared) to allow presence checks.
+ *********************************************************************/
+void fleet_detach(struct fleet_sensor *fs)
+{
+    fs->attached = false;
+    fs->backoff = 0;
+    fs->detaches++;
+    
+    fleet_backoff(fs);
+    
+    p_printf(RED, (char *) "sensor %s is not responding : detached\n", fs->cfg.name);
+}
+
+/*********************************************************************
+ * @brief try to attach a detached sensor
+ * @param fs : sensor
+ *
+ * If the bus is open, a presence check is done first to prevent a
+ * complete initialization (with retries) on a missing sensor.
+ *********************************************************************/
+void fleet_probe(struct fleet_sensor *fs)
+{
+    if (fs->dev.settings.hw_initialized && ! fs->dev.probe())
+    {
+        if (fleet_options->verbose) p_printf(YELLOW, (char *) "%s : not present\n", fs->cfg.name);
+        fleet_backoff(fs);
+        return;
+    }
+    
+    fleet_attach(fs);
+}
+
+/*********************************************************************
+ * @brief stop a sensor and release the slot
+ * @param fs : sensor
+ *********************************************************************/
+void fleet_remove(struct fleet_sensor *fs)
+{
+    if (fleet_options->verbose) p_printf(YELLOW, (char *) "remove sensor %s\n", fs->cfg.name);
+
+    /* a detached sensor has the bus still open */
+    fs->dev.close();
+    sink_close(fs->sink);
+    press_close(&fs->press);
+
+    fs->sink = NULL;
+    fs->attached = false;
+    fs->used = false;
+}
+
+/*********************************************************************
+ * @brief open the ambient pressure source of a sensor (if any)
+ * @param fs : sensor
+ *********************************************************************/
+void fleet_press(struct fleet_sensor *fs)
+{
+    struct fleet_cfg *cfg = &fs->cfg;
+
+    memset(&fs->press, 0x0, sizeof(struct scd30_press));
+
+    if (cfg->press_src[0] == 0x0) return;
+
+    if (! press_open(&fs->press, cfg->press_src, cfg->press_threshold, cfg->press_hold))
+        p_printf(RED, (char *) "sensor %s : pressure source not used\n", cfg->name);
+}
+
+/*********************************************************************
+ * @brief add a new sensor
+ * @param cfg : sensor configuration
+ *
+ * @return  true = OK, false is error
+ *********************************************************************/
+bool fleet_add(struct fleet_cfg *cfg)
+{
+    uint32_t delay;
+    int i;
+    struct fleet_sensor *fs;
+
+    for (i = 0; i < FLEET_MAXSENSOR; i++)
+        if (! fleet[i].used) break;
+
+    if (i == FLEET_MAXSENSOR) return(false);
+
+    fs = &fleet[i];
+
+    memcpy(&fs->cfg, cfg, sizeof(struct fleet_cfg));
+    fs->dev = SCD30();
+    fs->used = true;
+    fs->outputs = 0;
+    fs->backoff = 0;
+    fs->attaches = 0;
+    fs->detaches = 0;
+    fs->ident.used = false;
+    memset(&fs->health, 0x0, sizeof(struct scd30_health));
+    memset(&fs->speed, 0x0, sizeof(struct scd30_speed));
+    speed_init(&fs->speed, fs->cfg.name, cfg->speed_max, cfg->speed_budget);
+    capture_init(&fs->cap, cfg->interval);
+    adapt_init(&fs->adapt, cfg->adapt_min, cfg->adapt_max, cfg->adapt_hold, cfg->interval);
+    fleet_press(fs);
+
+    if ((fs->sink = sink_open(cfg->output)) == NULL) fs->sink = sink_open(SINK_STDOUT);
+
+    /* stagger the reads on a shared bus : started from the loop */
+    fs->attached = false;
+    fs->staggered = false;
+
+    if ((delay = fleet_phase(fs)))
+    {
+        if (fleet_options->verbose) p_printf(YELLOW, (char *) "sensor %s starts in %u mS\n", cfg->name, delay);
+
+        fs->staggered = true;
+        fs->next = fleet_ms() + delay;
+        return(true);
+    }
+
+    /* if failed, retried later */
+    fleet_attach(fs);
+
+    return(true);
+}
+
+/*********************************************************************
+ * @brief apply a changed configuration to a sensor
+ * @param fs : sensor
+ * @param cfg : new sensor configuration
+ *********************************************************************/
+void fleet_update(struct fleet_sensor *fs, struct fleet_cfg *cfg)
+{
+    struct fleet_cfg *old = &fs->cfg;
+    struct scd30_sink *s;
+    uint32_t delay;
+    bool ok = true, bus;
+
+    if (memcmp(old, cfg, sizeof(struct fleet_cfg)) == 0) return;
+
+    if (fleet_options->verbose) p_printf(YELLOW, (char *) "update sensor %s\n", cfg->name);
+
+    /* output changed */
+    if (strcmp(old->output, cfg->output) != 0)
+    {
+        if ((s = sink_open(cfg->output)) != NULL)
+        {
+            sink_close(fs->sink);
+            fs->sink = s;
+        }
+    }
+
+    /* adaptive bounds changed : restart the controller */
+    if (old->adapt_min != cfg->adapt_min || old->adapt_max != cfg->adapt_max || old->adapt_hold != cfg->adapt_hold)
+        adapt_init(&fs->adapt, cfg->adapt_min, cfg->adapt_max, cfg->adapt_hold, fs->health.interval);
+
+    /* pressure source changed */
+    if (strcmp(old->press_src, cfg->press_src) != 0 || old->press_threshold != cfg->press_threshold ||
+        old->press_hold != cfg->press_hold)
+    {
+        press_close(&fs->press);
+        strcpy(old->press_src, cfg->press_src);
+        old->press_threshold = cfg->press_threshold;
+        old->press_hold = cfg->press_hold;
+        fleet_press(fs);
+    }
+
+    /* speed tuning changed */
+    if (old->speed_max != cfg->speed_max || old->speed_budget != cfg->speed_budget)
+        speed_init(&fs->speed, fs->cfg.name, cfg->speed_max, cfg->speed_budget);
+
+    bus = old->I2C_interface != cfg->I2C_interface || old->engine != cfg->engine || old->sda != cfg->sda ||
+        old->modbus != cfg->modbus || strcmp(old->port, cfg->port) != 0 ||
+        old->scl != cfg->scl || old->pullup != cfg->pullup || old->mux_address != cfg->mux_address ||
+        old->mux_channel != cfg->mux_channel || old->lock_timeout != cfg->lock_timeout;
+
+    /* waiting for its start phase on the same bus : attached later with the new settings */
+    if (fs->staggered && ! bus)
+    {
+        memcpy(old, cfg, sizeof(struct fleet_cfg));
+        return;
+    }
+
+    /* bus changed or not initialized : (re)initialize, staggered on a shared bus */
+    if (bus || ! fs->attached)
+    {
+        fs->dev.close();
+        memcpy(old, cfg, sizeof(struct fleet_cfg));
+        fs->backoff = 0;
+        fs->attached = false;
+        fs->staggered = false;
+
+        if ((delay = fleet_phase(fs)))
+        {
+            if (fleet_options->verbose) p_printf(YELLOW, (char *) "sensor %s starts in %u mS\n", cfg->name, delay);
+
+            fs->staggered = true;
+            fs->next = fleet_ms() + delay;
+            return;
+        }
+
+        fleet_attach(fs);
+        return;
+    }
+
+    /* speed is applied on the next transaction */
+    if ((old->speed_max != cfg->speed_max || old->speed_budget != cfg->speed_budget) && cfg->speed_max)
+        speed_calibrate(&fs->speed, &fs->dev);
+    
+    if (! cfg->speed_max) fs->dev.settings.baudrate = cfg->baudrate;
+
+    /* only send what changed */
+    if (old->interval != cfg->interval)
+    {
+        ok &= fs->dev.setMeasurementInterval(cfg->interval);
+        fs->health.interval = cfg->interval;
+        capture_interval(&fs->cap, cfg->interval);
+        adapt_set(&fs->adapt, cfg->interval);
+    }
+
+    if (old->asc != cfg->asc && cfg->frc == -1) ok &= fs->dev.setAutoSelfCalibration(cfg->asc);
+
+    if (old->altitude != cfg->altitude)
+        ok &= fs->dev.setAltitudeCompensation(cfg->altitude == -1 ? 0 : cfg->altitude);
+
+    if (old->pressure != cfg->pressure)
+        ok &= fs->dev.setAmbientPressure(cfg->pressure == -1 ? 0 : cfg->pressure);
+
+    if (old->frc != cfg->frc && cfg->frc != -1) ok &= fs->dev.setForceRecalibration(cfg->frc);
+
+    if (old->temp_offset != cfg->temp_offset)
+        ok &= fs->dev.setTemperatureOffset(cfg->temp_offset == -1 ? 0 : cfg->temp_offset);
+
+    if (! ok) p_printf(RED, (char *) "Error during update of sensor %s\n", cfg->name);
+
+    /* reschedule if the period changed */
+    if (old->wait != cfg->wait || old->interval != cfg->interval || old->capture != cfg->capture ||
+        old->adapt_max != cfg->adapt_max)
+    {
+        fs->wait = cfg->wait && ! cfg->adapt_max ? cfg->wait : fs->health.interval;
+        fs->next = fleet_ms() + (cfg->capture ? capture_wait(&fs->cap) : fs->wait * 1000);
+    }
+
+    memcpy(old, cfg, sizeof(struct fleet_cfg));
+
+    if (ok) fleet_remember(fs);
+}
+
+/*********************************************************************
+ * @brief find a sensor by name
+ * @param name : sensor name
+ *
+ * @return sensor or NULL if not found
+ *********************************************************************/
+struct fleet_sensor *fleet_find(const char *name)
+{
+    int i;
+
+    for (i = 0; i < FLEET_MAXSENSOR; i++)
+    {
+        if (fleet[i].used && strcmp(fleet[i].cfg.name, name) == 0) return(&fleet[i]);
+    }
+
+    return(NULL);
+}
+
+/*********************************************************************
+ * @brief apply a (new) configuration
+ * @param conf : configuration
+ *********************************************************************/
+void fleet_apply(struct fleet_conf *conf)
+{
+    struct fleet_sensor *fs;
+    struct scd30_sink *s;
+    int     i, j;
+
+    /* remove sensors that are no longer in the configuration */
+    for (i = 0; i < FLEET_MAXSENSOR; i++)
+    {
+        if (! fleet[i].used) continue;
+
+        for (j = 0; j < conf->num; j++)
+            if (strcmp(fleet[i].cfg.name, conf->sensor[j].name) == 0) break;
+
+        if (j == conf->num) fleet_remove(&fleet[i]);
+    }
+
+    fleet_busq_release();
+
+    /* update existing or add new sensors */
+    for (j = 0; j < conf->num; j++)
+    {
+        fs = fleet_find(conf->sensor[j].name);
+
+        if (fs) fleet_update(fs, &conf->sensor[j]);
+        else if (! fleet_add(&conf->sensor[j]))
+            p_printf(RED, (char *) "Can not add sensor %s\n", conf->sensor[j].name);
+    }
+
+    /* sensors moved to an other bus */
+    fleet_busq_release();
+
+#ifdef DYLOS
+    /* Dylos port changed */
+    if (strcmp(fleet_cur.dylos_port, conf->dylos_port) != 0)
+    {
+        if (fleet_dylos_fd > -1) ctrl_unwatch(fleet_dylos_fd);
+        fleet_dylos_fd = -1;
+
+        usage_child(0);
+        stop_dylos();
+
+        if (conf->dylos_port[0] != 0x0)
+        {
+            if (fleet_options->verbose) p_printf(YELLOW, (char *) "initialize Dylos %s\n", conf->dylos_port);
+
+            if (open_dylos(conf->dylos_port, fleet_options->verbose) != 0)
+                conf->dylos_port[0] = 0x0;
+            else
+                usage_child(dylos_pid());
+        }
+
+        fleet_dylos_next = fleet_ms() + conf->dylos_wait * 1000;
+    }
+
+    /* Dylos output changed */
+    if (fleet_dylos_sink == NULL || strcmp(fleet_cur.dylos_output, conf->dylos_output) != 0)
+    {
+        if ((s = sink_open(conf->dylos_output)) != NULL)
+        {
+            sink_close(fleet_dylos_sink);
+            fleet_dylos_sink = s;
+        }
+    }
+#else
+    (void) s;
+#endif
+
+    memcpy(&fleet_cur, conf, sizeof(struct fleet_conf));
+}
+
+/*********************************************************************
+ * @brief reload the configuration file
+ *
+ * in case of an error in the file, the current configuration remains
+ *********************************************************************/
+void fleet_reload()
+{
+    static struct fleet_conf conf;
+
+    p_printf(GREEN, (char *) "Reloading configuration %s\n", fleet_config);
+
+    if (! fleet_load(fleet_config, &conf))
+    {
+        p_printf(RED, (char *) "Configuration not changed\n");
+        return;
+    }
+
+    fleet_apply(&conf);
+}
+
+/*********************************************************************
+ * @brief output the results of a sensor
+ * @param fs : sensor
+ *********************************************************************/
+void fleet_output(struct fleet_sensor *fs)
+{
+    char buf[30], t;
+    float index, dew, temp, hum;
+    uint16_t co2;
+    int prev = usage_enter(USAGE_FORMAT);
+
+    if (fleet_cur.timestamp)
+    {
+        get_time_stamp(buf);
+        sink_printf(fs->sink, "%s: ", buf);
+    }
+
+    co2 = fs->dev.getCO2();
+    fs->co2 = co2;
+    hum = fs->dev.getHumidity();
+
+    if (fleet_cur.tempCel)   // Celsius
+    {
+        temp = fs->dev.getTemperature();
+        index = fs->dev.computeHeatIndex(temp, hum, false);
+        dew = fs->dev.calc_dewpoint(temp, hum, false);
+        t = 'C';
+    }
+    else     // Fahrenheit
+    {
+        temp = fs->dev.getTemperatureF();
+        index = fs->dev.computeHeatIndex(temp, hum, true);
+        dew = fs->dev.calc_dewpoint(temp, hum, true);
+        t = 'F';
+    }
+
+    if (fleet_cur.serial) sink_printf(fs->sink, "%s: ", fs->ident.serial);
+
+    if (fs->cfg.capture) sink_printf(fs->sink, "seq %u: ", fs->seq);
+
+    sink_printf(fs->sink, "%s: CO2: %4d PPM\tHumidity: %3.2f %%RH  Temperature: %3.2f *%c  ", fs->cfg.name, co2, hum, temp, t);
+
+    if (fleet_cur.heatindex) sink_printf(fs->sink, "heatindex: %3.2f *%c ", index, t);
+    if (fleet_cur.dewpoint)  sink_printf(fs->sink, "dew-point: %3.2f *%c ", dew, t);
+
+    sink_printf(fs->sink, "\n");
+
+    usage_leave(prev);
+    usage_sample();
+
+    fs->outputs++;
+}
+
+/*********************************************************************
+ * @brief read a sensor if due
+ * @param fs : sensor
+ * @param now : current time in msec
+ *********************************************************************/
+void fleet_poll(struct fleet_sensor *fs, uint64_t now)
+{
+    bool sample;
+    uint32_t gap;
+    uint16_t interval, mbar;
+
+    if (now < fs->next) return;
+
+    /* retry initialization */
+    if (! fs->attached)
+    {
+        fleet_probe(fs);
+        return;
+    }
+
+    sample = fs->dev.dataAvailable();
+
+    if (fs->cfg.capture)
+    {
+        fs->seq = capture_poll(&fs->cap, sample, &gap);
+
+        if (gap) sink_printf(fs->sink, "%s: GAP: %u samples missed before seq %u\n", fs->cfg.name, gap, fs->seq);
+    }
+
+    if (sample)
+    {
+        fleet_output(fs);
+        fs->first = false;
+    }
+    /* first results can take 4 seconds after a stop */
+    else if (! fs->first && ! fs->cfg.capture && fleet_options->verbose)
+        p_printf(YELLOW, (char *) "%s : no data available\n", fs->cfg.name);
+
+    /* adaptive interval : follow the rate of change of CO2 */
+    if (sample && fs->cfg.adapt_max && (interval = adapt_sample(&fs->adapt, fs->co2)))
+    {
+        if (fs->dev.setMeasurementInterval(interval))
+        {
+            sink_printf(fs->sink, "%s: interval %d -> %d seconds (rate %3.1f ppm/min, spread %3.1f ppm)\n",
+                fs->cfg.name, fs->health.interval, interval, fs->adapt.rate, fs->adapt.spread);
+
+            adapt_set(&fs->adapt, interval);
+            fs->ident.interval = fs->health.interval = fs->wait = interval;
+            if (fs->cfg.capture) capture_interval(&fs->cap, interval);
+        }
+        else
+            p_printf(RED, (char *) "%s : could not set measurement interval %d\n", fs->cfg.name, interval);
+    }
+
+    switch(health_check(&fs->health, &fs->dev, sample))
+    {
+    case HEALTH_RESET:
+    case HEALTH_REINIT:
+        if (fs->cfg.capture) capture_interval(&fs->cap, fs->health.interval);
+        press_reset(&fs->press);
+        fs->first = true;
+        break;
+
+    case HEALTH_DETACH:
+        fleet_detach(fs);
+        return;
+
+    default:
+        break;
+    }
+
+    /* errors rising : lower the I2C speed */
+    speed_check(&fs->speed, &fs->dev);
+
+    /* ambient pressure : restarts the measurement, only on a change */
+    if ((mbar = press_check(&fs->press)))
+    {
+        if (fs->dev.setAmbientPressure(mbar))
+        {
+            if (fleet_options->verbose) p_printf(YELLOW, (char *) "%s : ambient pressure %d mbar\n", fs->cfg.name, mbar);
+
+            press_applied(&fs->press, mbar);
+            fs->ident.pressure = mbar;
+            if (fs->cfg.capture) capture_interval(&fs->cap, fs->health.interval);
+        }
+        else
+            p_printf(RED, (char *) "%s : could not set ambient pressure %d\n", fs->cfg.name, mbar);
+    }
+
+    /* locked to the sample clock of the SCD30 */
+    if (fs->cfg.capture)
+    {
+        fs->next = fleet_ms() + capture_wait(&fs->cap);
+        return;
+    }
+
+    fs->next += fs->wait * 1000;
+
+    /* do not try to catch up after a delay */
+    if (fs->next <= now) fs->next = now + fs->wait * 1000;
+}
+
+/*********************************************************************
+ * @brief queued work of a sensor
+ * @param ctx : sensor
+ *********************************************************************/
+void fleet_task(void *ctx)
+{
+    struct fleet_sensor *fs = (struct fleet_sensor *) ctx;
+
+    int prev;
+
+    /* removed while queued */
+    if (! fs->used) return;
+
+    prev = usage_enter(USAGE_ACQ);
+    fleet_poll(fs, fleet_ms());
+    usage_leave(prev);
+}
+
+/*********************************************************************
+ * @brief time a due read or attach attempt should be started
+ * @param fs : sensor
+ *
+ * A read before the next sample overwrites it (half the interval
+ * gives margin), an attach attempt within one backoff period.
+ *********************************************************************/
+uint64_t fleet_deadline(struct fleet_sensor *fs)
+{
+    if (fs->attached) return(fs->next + fs->health.interval * 500);
+
+    return(fs->next + fs->backoff * 1000);
+}
+
+/*********************************************************************
+ * @brief queue the work of a sensor on its bus
+ * @param fs : sensor
+ * @param now : current time in msec
+ *
+ * A due read is queued as measurement, a due attach attempt as probe.
+ * A read that is not due yet is announced to keep the bus free.
+ * Without a queue (too many busses or full) the work is done now.
+ *********************************************************************/
+void fleet_queue(struct fleet_sensor *fs, uint64_t now)
+{
+    struct scd30_busq *q = fleet_busq(&fs->cfg);
+
+    if (now < fs->next)
+    {
+        if (q && fs->attached) busq_expect(q, fs->next);
+        return;
+    }
+
+    if (q && busq_submit(q, fs->attached ? BUSQ_MEAS : BUSQ_PROBE, fleet_deadline(fs), fleet_task, fs))
+        return;
+
+    fleet_task(fs);
+}
+
+/*********************************************************************
+ * @brief do the due reads on the bus of a sensor first
+ * @param q : queue of the bus
+ *********************************************************************/
+void fleet_flush(struct scd30_busq *q)
+{
+    uint64_t now = fleet_ms();
+    int i;
+
+    for (i = 0; i < FLEET_MAXSENSOR; i++)
+    {
+        if (fleet[i].used && fleet[i].attached && fleet_busq(&fleet[i].cfg) == q)
+            fleet_queue(&fleet[i], now);
+    }
+
+    busq_run(q, BUSQ_MEAS);
+}
+
+/*********************************************************************
+ * @brief add the queue statistics of all busses to a reply
+ * @param reply : to store the statistics
+ * @param len : length of reply buffer
+ *
+ * @return length added
+ *********************************************************************/
+int fleet_busq_stats(char *reply, int len)
+{
+    struct fleet_bus *b;
+    struct busq_stats *st;
+    int i, c, off = 0;
+
+    for (i = 0; i < SCD30_MAXBUS; i++)
+    {
+        b = &fleet_busses[i];
+
+        if (! b->used || off >= len) continue;
+
+        if (b->modbus) off += snprintf(reply + off, len - off, " bus %s:", b->port);
+        else if (b->I2C_interface) off += snprintf(reply + off, len - off, " bus I2C:");
+        else off += snprintf(reply + off, len - off, " bus sda%d/scl%d:", b->sda, b->scl);
+
+        if (off < len) off += snprintf(reply + off, len - off, " utilization %3.2f%% peak %u",
+            busq_utilization(&b->q) * 100, b->q.peak);
+
+        for (c = 0; c < BUSQ_CLASSES && off < len; c++)
+        {
+            st = &b->q.st[c];
+            off += snprintf(reply + off, len - off, " %s_runs %u %s_wait_mean %u %s_wait_max %u %s_late %u %s_deferred %u",
+                busq_name(c), st->runs, busq_name(c), st->runs ? (uint32_t) (st->wait_sum / st->runs) : 0,
+                busq_name(c), st->wait_max, busq_name(c), st->late, busq_name(c), st->deferred);
+        }
+
+        if (off < len) off += snprintf(reply + off, len - off, ";");
+    }
+
+    return(off);
+}
+
+#ifdef DYLOS
+/*********************************************************************
+ * @brief ask the Dylos reader for data if due
+ * @param now : current time in msec
+ *
+ * The answer is collected with fleet_dylos_read() once the pipe is 
+ * readable, so the sensors are not held up while waiting for it.
+ *********************************************************************/
+void fleet_dylos(uint64_t now)
+{
+    if (fleet_cur.dylos_port[0] == 0x0 || now < fleet_dylos_next) return;
+
+    fleet_dylos_next = now + fleet_cur.dylos_wait * 1000;
+
+    /* previous answer still pending */
+    if (fleet_dylos_fd > -1) return;
+
+    fleet_dylos_fd = request_dylos(fleet_options->verbose);
+
+    if (fleet_dylos_fd > -1 && ! ctrl_watch(fleet_dylos_fd))
+    {
+        /* can not wait for it : collect on the next request */
+        if (fleet_options->verbose) p_printf(RED, (char *) "Can not watch the Dylos reader\n");
+        fleet_dylos_fd = -1;
+    }
+}
+
+/*********************************************************************
+ * @brief output the Dylos answer now the pipe is readable
+ *********************************************************************/
+void fleet_dylos_read()
+{
+    uint16_t pm1, pm10;
+    char buf[30];
+
+    ctrl_unwatch(fleet_dylos_fd);
+    fleet_dylos_fd = -1;
+
+    if (! fetch_dylos_values(&pm1, &pm10, fleet_options->verbose)) return;
+
+    if (fleet_cur.timestamp)
+    {
+        get_time_stamp(buf);
+        sink_printf(fleet_dylos_sink, "%s: ", buf);
+    }
+
+    sink_printf(fleet_dylos_sink, "DYLOS: PM1 %4d PPM  PM10 %4d PPM\n", pm1, pm10);
+}
+#endif
+
+/*********************************************************************
+ * @brief execute a control command for the fleet
+ *
+ * Without a target, the command is applied to all sensors.
+ *
+ * @param cmd : command to execute
+ * @param reply : to store the reply
+ * @param len : length of reply buffer
+ * @param ctx : not used
+ *********************************************************************/
+void fleet_control(struct ctrl_cmd *cmd, char *reply, int len, void *ctx)
+{
+    struct fleet_sensor *fs;
+    struct scd30_busq *q;
+    scd30_stats st;
+    uint16_t interval, frc, offset, altitude, fw;
+    uint64_t arrived = fleet_ms(), start = 0;
+    int     i, num = 0, failed = 0, off;
+    bool    ret, bus;
+
+    (void) ctx;
+
+    switch(cmd->type)
+    {
+    case CTRL_RELOAD:
+        fleet_reload();
+        snprintf(reply, len, "OK");
+        return;
+
+    case CTRL_HELP:
+        snprintf(reply, len, "OK interval # | wait # | frc # | asc 0/1 | altitude # | "
+        "pressure # | tempoffset # | get | stats | reload  [sensor]");
+        return;
+
+    case CTRL_UNKNOWN:
+        snprintf(reply, len, "ERR unknown command");
+        return;
+
+    case CTRL_GET:
+    case CTRL_STATS:
+        break;
+
+    default:
+        if (! cmd->has_value)
+        {
+            snprintf(reply, len, "ERR missing value");
+            return;
+        }
+    }
+
+    if (cmd->target[0] != 0x0 && fleet_find(cmd->target) == NULL)
+    {
+        snprintf(reply, len, "ERR unknown sensor %s", cmd->target);
+        return;
+    }
+
+    off = snprintf(reply, len, "OK");
+
+    for (i = 0; i < FLEET_MAXSENSOR; i++)
+    {
+        fs = &fleet[i];
+
+        if (! fs->used) continue;
+        if (cmd->target[0] != 0x0 && strcmp(cmd->target, fs->cfg.name) != 0) continue;
+
+        num++;
+
+        /* not initialized sensors can only report statistics */
+        if (! fs->attached && cmd->type != CTRL_STATS)
+        {
+            failed++;
+            continue;
+        }
+
+        ret = false;
+
+        /* due reads on the same bus go first */
+        bus = cmd->type != CTRL_WAIT && cmd->type != CTRL_STATS;
+        q = bus ? fleet_busq(&fs->cfg) : NULL;
+
+        if (q)
+        {
+            fleet_flush(q);
+            start = busq_us();
+        }
+
+        switch(cmd->type)
+        {
+        case CTRL_INTERVAL:
+            if (! scd30_cmd_valid(SCD30_CMD_INTERVAL, cmd->value)) break;
+            ret = fs->dev.setMeasurementInterval(cmd->value);
+            if (ret) fs->ident.interval = fs->health.interval = cmd->value;
+            if (ret && fs->cfg.capture) capture_interval(&fs->cap, cmd->value);
+            if (ret && (fs->cfg.wait == 0 || fs->cfg.adapt_max)) fs->wait = cmd->value;
+            if (ret) adapt_set(&fs->adapt, cmd->value);
+            break;
+
+        case CTRL_WAIT:
+            if (cmd->value < 1 || cmd->value > 0xffff) break;
+            fs->wait = cmd->value;
+            fs->next = fleet_ms() + fs->wait * 1000;
+            ret = true;
+            break;
+
+        case CTRL_FRC:
+            if (! scd30_cmd_valid(SCD30_CMD_FRC, cmd->value)) break;
+            ret = fs->dev.setForceRecalibration(cmd->value);
+            if (ret) fs->ident.frc = cmd->value;
+            break;
+
+        case CTRL_ASC:
+            if (! scd30_cmd_valid(SCD30_CMD_ASC, cmd->value)) break;
+            ret = fs->dev.setAutoSelfCalibration(cmd->value == 1);
+            if (ret) fs->ident.asc = cmd->value == 1;
+            break;
+
+        case CTRL_ALTITUDE:
+            if (! scd30_cmd_valid(SCD30_CMD_ALTITUDE, cmd->value)) break;
+            ret = fs->dev.setAltitudeCompensation(cmd->value);
+            if (ret) fs->ident.altitude = cmd->value;
+            break;
+
+        case CTRL_PRESSURE:
+            if (! scd30_cmd_valid(SCD30_CMD_START, cmd->value)) break;
+            ret = fs->dev.setAmbientPressure(cmd->value);
+            if (ret) fs->ident.pressure = cmd->value ? cmd->value : -1;
+            break;
+
+        case CTRL_TEMPOFFSET:
+            if (! scd30_cmd_valid(SCD30_CMD_TEMP_OFFSET, cmd->value)) break;
+            ret = fs->dev.setTemperatureOffset(cmd->value);
+            if (ret) fs->ident.temp_offset = cmd->value;
+            break;
+
+        case CTRL_GET:
+            ret = fs->dev.getSettingValue(COMMAND_SET_MEASUREMENT_INTERVAL, &interval) &&
+                fs->dev.getSettingValue(COMMAND_SET_FORCED_RECALIBRATION_FACTOR, &frc) &&
+                fs->dev.getSettingValue(COMMAND_SET_TEMPERATURE_OFFSET, &offset) &&
+                fs->dev.getSettingValue(COMMAND_SET_ALTITUDE_COMPENSATION, &altitude) &&
+                fs->dev.getSettingValue(CMD_GET_FW_LEVEL, &fw);
+
+            if (ret && off < len)
+                off += snprintf(reply + off, len - off, " %s: serial %s interval %d frc %d tempoffset %d altitude %d wait %d firmware %d.%d;",
+                fs->cfg.name, fs->ident.serial, interval, frc, offset, altitude, fs->wait, fw >> 8 & 0xff, fw & 0xff);
+            break;
+
+        case CTRL_STATS:
+            fs->dev.getStats(&st);
+            if (off < len)
+                off += snprintf(reply + off, len - off, " %s: attached %d outputs %u samples %u not_ready %u "
+                "retries %u write_errors %u read_errors %u crc_errors %u soft_resets %u tr_max %u tr_mean %u stretch_timeouts %u speed %u speed_stepdowns %u lock_contended %u lock_foreign %u "
+                "attaches %u detaches %u probe_failures %u "
+                "fault_bus %u fault_sensor %u fault_stale %u fault_crc %u resets %u reinits %u "
+                "captured %u missed %u gaps %u interval %u shorter %u longer %u suppressed %u "
+                "pressure %u pressure_errors %u pressure_applies %u pressure_limited %u;",
+                fs->cfg.name, fs->attached, fs->outputs, st.samples, st.not_ready, st.retries,
+                st.write_errors, st.read_errors, st.crc_errors, st.soft_resets,
+                st.tr_max, st.tr_count ? (uint32_t) (st.tr_sum / st.tr_count) : 0,
+                st.stretch_timeouts, fs->dev.settings.baudrate, fs->speed.stepdowns, st.lock_contended, st.lock_foreign, fs->attaches, fs->detaches, st.probe_failures,
+                fs->health.faults[HEALTH_BUS], fs->health.faults[HEALTH_SENSOR], fs->health.faults[HEALTH_STALE],
+                fs->health.faults[HEALTH_CRC], fs->health.steps[HEALTH_RESET], fs->health.steps[HEALTH_REINIT],
+                fs->cap.captured, fs->cap.missed, fs->cap.gaps,
+                fs->health.interval, fs->adapt.shorter, fs->adapt.longer, fs->adapt.suppressed,
+                fs->press.applied, fs->press.errors, fs->press.applies, fs->press.limited);
+            ret = true;
+            break;
+
+        default:
+            break;
+        }
+
+        /* a settings dump is maintenance */
+        if (q) busq_account(q, cmd->type == CTRL_GET ? BUSQ_MAINT : BUSQ_SETTING, arrived, start);
+
+        if (! ret) failed++;
+
+        /* keep the identity cache up to date (written if changed) */
+        else if (fs->ident.used) ident_put(&fs->ident);
+    }
+
+    if (cmd->type == CTRL_STATS && off < len) off += fleet_busq_stats(reply + off, len - off);
+    if (cmd->type == CTRL_STATS && off < len) off += usage_stats(reply + off, len - off);
+
+    if (num == 0) snprintf(reply, len, "ERR no sensors");
+    else if (failed) snprintf(reply, len, "ERR failed on %d of %d sensors", failed, num);
+
+    if (fleet_options->verbose) p_printf(YELLOW, (char *) "control command %d value %d %s : %s\n", cmd->type, cmd->value, cmd->target, reply);
+}
+
+/*********************************************************************
+ * @brief catch SIGHUP to reload the configuration
+ *********************************************************************/
+void fleet_sighup(int sig_num)
+{
+    (void) sig_num;
+    fleet_hup = 1;
+}
+
+/*********************************************************************
+ * @brief watch the directory of the configuration file for changes
+ *
+ * The directory is watched, as many editors replace the file.
+ *********************************************************************/
+void fleet_watch()
+{
+    char dir[MAXBUF * 2];
+
+    fleet_inotify = inotify_init1(IN_NONBLOCK);
+    if (fleet_inotify < 0) return;
+
+    strncpy(dir, fleet_config, sizeof(dir) - 1);
+    dir[sizeof(dir) - 1] = 0x0;
+
+    if (inotify_add_watch(fleet_inotify, dirname(dir), IN_CLOSE_WRITE | IN_MOVED_TO) < 0 ||
+        ! ctrl_watch(fleet_inotify))
+    {
+        p_printf(RED, (char *) "Can not watch configuration for changes (use SIGHUP)\n");
+        ::close(fleet_inotify);
+        fleet_inotify = -1;
+    }
+}
+
+/*********************************************************************
+ * @brief check for a change of the configuration file
+ *
+ * @return true if the configuration file has changed
+ *********************************************************************/
+bool fleet_changed()
+{
+    char    buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    char    name[MAXBUF * 2];
+    const struct inotify_event *ev;
+    char    *p, *base;
+    int     num;
+    bool    changed = false;
+
+    strncpy(name, fleet_config, sizeof(name) - 1);
+    name[sizeof(name) - 1] = 0x0;
+    base = basename(name);
+
+    while ((num = read(fleet_inotify, buf, sizeof(buf))) > 0)
+    {
+        for (p = buf; p < buf + num; p += sizeof(struct inotify_event) + ev->len)
+        {
+            ev = (const struct inotify_event *) p;
+            if (ev->len && strcmp(ev->name, base) == 0) changed = true;
+        }
+    }
+
+    return(changed);
+}
+
+/*********************************************************************
+ * @brief run the fleet described in a configuration file (endless)
+ * @param config : configuration file
+ * @param opt : command line options
+ *********************************************************************/
+void fleet_run(char *config, struct fleet_opt *opt)
+{
+    static struct fleet_conf conf;
+    struct sigaction act;
+    uint64_t now, next;
+    int     i, ret;
+
+    fleet_config = config;
+    fleet_options = opt;
+
+    if (! fleet_load(config, &conf)) return;
+
+    /* SIGHUP : reload configuration */
+    memset(&act, 0x0, sizeof(act));
+    act.sa_handler = &fleet_sighup;
+    sigemptyset(&act.sa_mask);
+    sigaction(SIGHUP, &act, NULL);
+
+    if (opt->daemon && ! ctrl_open(opt->ctrl_socket)) return;
+
+    fleet_watch();
+
+    ident_open(opt->ident);
+
+    p_printf(GREEN, (char *) "Starting SCD30 fleet measurement with %d sensors:\n", conf.num);
+
+    fleet_apply(&conf);
+
+    while(1)
+    {
+        now = fleet_ms();
+        next = now + 1000;
+
+        fleet_step(false);
+
+        for (i = 0; i < FLEET_MAXSENSOR; i++)
+        {
+            if (! fleet[i].used) continue;
+
+            /* deferred to a gap : retry after the next read, at the latest on the deadline */
+            if (fleet[i].next <= now)
+            {
+                if (fleet_deadline(&fleet[i]) < next) next = fleet_deadline(&fleet[i]);
+            }
+            else if (fleet[i].next < next) next = fleet[i].next;
+        }
+
+#ifdef DYLOS
+        fleet_dylos(now);
+        if (fleet_cur.dylos_port[0] != 0x0 && fleet_dylos_next < next) next = fleet_dylos_next;
+#endif
+
+        now = fleet_ms();
+
+        ret = ctrl_wait(next > now ? next - now : 0, fleet_control, NULL);
+
+        usage_wakeup();
+
+#ifdef DYLOS
+        if (ret > -1 && ret == fleet_dylos_fd) fleet_dylos_read();
+#endif
+
+        if (fleet_hup || (ret > -1 && ret == fleet_inotify && fleet_changed()))
+        {
+            fleet_hup = 0;
+            fleet_reload();
+        }
+    }
+}
+
+/*********************************************************************
+ * @brief start the fleet with a configuration made by the caller
+ * @param conf : configuration
+ * @param opt : command line options
+ *
+ * Without file, signals, control socket or loop (used by the checks).
+ *********************************************************************/
+void fleet_start(struct fleet_conf *conf, struct fleet_opt *opt)
+{
+    fleet_config = NULL;
+    fleet_options = opt;
+
+    fleet_apply(conf);
+}
+
+/*********************************************************************
+ * @brief do the work of the sensors on their busses, as the loop does
+ * @param due : all attached sensors are due (checks : no waiting)
+ *
+ * @return results written by all sensors
+ *********************************************************************/
+uint32_t fleet_step(bool due)
+{
+    uint64_t now = fleet_ms();
+    uint32_t outputs = 0;
+    int     i;
+
+    for (i = 0; i < FLEET_MAXSENSOR; i++)
+    {
+        if (! fleet[i].used) continue;
+
+        if (due && fleet[i].attached) fleet[i].next = now;
+        fleet_queue(&fleet[i], now);
+    }
+
+    for (i = 0; i < SCD30_MAXBUS; i++)
+    {
+        if (fleet_busses[i].used) busq_run(&fleet_busses[i].q, BUSQ_MAINT);
+    }
+
+    for (i = 0; i < FLEET_MAXSENSOR; i++)
+    {
+        if (fleet[i].used) outputs += fleet[i].outputs;
+    }
+
+    return(outputs);
+}
+
+/*********************************************************************
+ * @brief stop all sensors of the fleet
+ *********************************************************************/
+void fleet_close()
+{
+    int i;
+
+    for (i = 0; i < FLEET_MAXSENSOR; i++)
+    {
+        if (fleet[i].used) fleet_remove(&fleet[i]);
+    }
+
+    sink_close(fleet_dylos_sink);
+    fleet_dylos_sink = NULL;
+
+    if (fleet_dylos_fd > -1) ctrl_unwatch(fleet_dylos_fd);
+    fleet_dylos_fd = -1;
+
+    if (fleet_inotify > -1) ::close(fleet_inotify);
+    fleet_inotify = -1;
+}
@@ -0,0 +1,208 @@
+/*******************************************************************
+ *
+ * Fleet of SCD30 sensors described in a configuration file.
+ *
+ * The configuration file describes each sensor in a section. Sending
+ * SIGHUP, the "reload" control command or changing the file will
+ * reload the configuration. Only the sensors and outputs that have
+ * changed are touched, all others keep their measurement schedule.
+ *
+ * Each sensor has a health supervisor (see scd30_health.h). A sensor
+ * it gives up on is detached and probed with a growing interval
+ * (FLEET_BACKOFF up to FLEET_RETRY seconds). Once it responds again
+ * it is attached and configured automatically.
+ *
+ * The identity (serial number, firmware level) of each sensor is
+ * taken from the identity cache (see scd30_ident.h). Settings that the
+ * cache reports as already stored in the SCD30 are not sent again.
+ *
+ * With an adaptive interval (see scd30_adapt.h) the sensor starts at
+ * 'interval' (within the bounds) after each attach.
+ *
+ * # comment
+ * [global]
+ * timestamp = yes                  add timestamp to output
+ * fahrenheit = no                  temperature in Fahrenheit
+ * dewpoint = no                    add dew-point to output
+ * heatindex = no                   add heat-index to output
+ * serial = no                      add serial number to output
+ *
+ * [sensor kitchen]
+ * interface = soft                 soft, gpio (soft with built-in engine), hard (I2C) or modbus
+ * port = /dev/ttyUSB0              UART port (modbus only, see scd30_modbus.h)
+ * sda = 2                          SDA GPIO (soft_I2C only)
+ * scl = 3                          SCL GPIO (soft_I2C only)
+ * speed = 100                      I2C speed in Khz
+ * speedtune = 100                  tune I2C speed up to Khz (see scd30_speed.h, 0 = off)
+ * speedbudget = 10                 max. I2C errors per 1000 attempts for speedtune
+ * pullup = no                      internal pullup resistor
+ * mux = 0x70                       multiplexer address (none if not set)
+ * channel = 0                      multiplexer channel 0 - 7
+ * locktimeout = 1000               max. mS to wait on bus lock (0 = no lock)
+ * interval = 2                     measurement interval 2 - 1800 seconds
+ * wait = 5                         seconds between reads (default interval)
+ * capture = no                     read every sample (wait is ignored), report gaps
+ * adaptive = 2,300                 adaptive interval min,max seconds (wait is ignored)
+ * adapthold = 600                  seconds between changes to a longer interval
+ * asc = yes                        automatic self calibration
+ * frc = 400                        forced recalibration 400 - 2000 ppm
+ * altitude = 100                   altitude compensation -1520 - 3040 meter
+ * pressure = 1013                  ambient pressure 700 - 1200 mbar
+ * pressuresource = udp:5000        ambient pressure source (see scd30_press.h)
+ * pressurethreshold = 3            mbar change before applying the source
+ * pressurehold = 300               seconds between applying the source
+ * tempoffset = 2                   temperature offset 0 - 25 *C
+ * output = /var/log/kitchen.log    file to append to (default stdout)
+ *
+ * [dylos]                          (only in DYLOS build)
+ * port = /dev/ttyUSB0              connected port
+ * wait = 60                        seconds between reads
+ * output = stdout                  output
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_FLEET_H__
+#define __SCD30_FLEET_H__
+
+# include "SCD30.h"
+# include "scd30_ctrl.h"
+# include "scd30_sink.h"
+# include "scd30_press.h"
+
+/* max. number of sensors in configuration */
+# define FLEET_MAXSENSOR 32
+
+/* max. length of sensor name */
+# define FLEET_NAMELEN CTRL_MAXNAME
+
+/* max. seconds between attempts to attach a sensor that failed */
+# define FLEET_RETRY 60
+
+/* first retry after a sensor was detached, doubled on each failure */
+# define FLEET_BACKOFF 2
+
+/* configuration of a sensor */
+struct fleet_cfg
+{
+    char        name[FLEET_NAMELEN];    // name of sensor
+
+    /* I2C bus */
+    bool        I2C_interface;          // hard_I2C or soft_I2C
+    bool        engine;                 // soft_I2C with the built-in engine
+    bool        modbus;                 // Modbus over UART instead of I2C
+    char        port[MODBUS_PORTLEN];   // UART port (modbus only)
+    struct scd30_emul *emul;            // emulated SCD30 (checks only, not in the file)
+    uint8_t     sda;                    // SDA GPIO (soft_I2C only)
+    uint8_t     scl;                    // SCL GPIO (soft_I2C only)
+    uint16_t    baudrate;               // speed
+    uint16_t    speed_max;              // tune speed up to (0 = not tuning)
+    uint16_t    speed_budget;           // errors per 1000 attempts
+    bool        pullup;                 // enable internal BCM2835 resistor
+    uint8_t     mux_address;            // multiplexer or NO_MUX
+    uint8_t     mux_channel;            // channel on multiplexer
+    uint16_t    lock_timeout;           // max. mS to wait on bus lock
+
+    /* SCD30 */
+    uint16_t    interval;               // sample interval. 2 <> 1800 seconds
+    bool        asc;                    // Automatic Self calibration
+    int16_t     frc;                    // forced recalibration or -1
+    int16_t     altitude;               // altitude in meters or -1
+    int16_t     pressure;               // pressure in mbar or -1
+    int16_t     temp_offset;            // temperature offset or -1
+    char        press_src[PRESS_SPECLEN]; // pressure source or empty
+    uint16_t    press_threshold;        // mbar change before applying
+    uint16_t    press_hold;             // seconds between applying
+
+    /* program */
+    uint16_t    wait;                   // seconds between reads
+    bool        capture;                // lossless capture
+    uint16_t    adapt_min;              // shortest interval (0 = not adaptive)
+    uint16_t    adapt_max;              // longest interval
+    uint16_t    adapt_hold;             // seconds between changes to longer
+    char        output[SINK_PATHLEN];   // output sink
+};
+
+/* complete configuration */
+struct fleet_conf
+{
+    /* global */
+    bool        timestamp;              // include timestamp in output
+    bool        tempCel;                // Celsius or Fahrenheit
+    bool        heatindex;              // add heatindex in output
+    bool        dewpoint;               // add dewpoint in output
+    bool        serial;                 // add serial number in output
+
+    /* Dylos */
+    char        dylos_port[MAXBUF];     // connected port or empty
+    uint16_t    dylos_wait;             // seconds between reads
+    char        dylos_output[SINK_PATHLEN]; // output sink
+
+    /* sensors */
+    int         num;
+    struct fleet_cfg sensor[FLEET_MAXSENSOR];
+};
+
+/* command line options for the fleet */
+struct fleet_opt
+{
+    bool        timestamp;              // default include timestamp
+    bool        tempCel;                // default Celsius or Fahrenheit
+    bool        heatindex;              // default add heatindex
+    bool        dewpoint;               // default add dewpoint
+    int         verbose;                // verbose level
+    bool        daemon;                 // open control socket
+    char        *ctrl_socket;           // control socket path
+    char        *ident;                 // identity cache file
+};
+
+/*! run the fleet described in a configuration file (endless)
+ * @param config : configuration file
+ * @param opt : command line options
+ */
+void fleet_run(char *config, struct fleet_opt *opt);
+
+/*! stop all sensors of the fleet */
+void fleet_close();
+
+/*! set sensor configuration defaults (same as command line)
+ * @param cfg : sensor configuration
+ * @param name : name of sensor
+ */
+void fleet_default(struct fleet_cfg *cfg, char *name);
+
+/*! start the fleet with a configuration made by the caller, without
+ * file, signals, control socket or loop (used by the checks)
+ * @param conf : configuration
+ * @param opt : command line options
+ */
+void fleet_start(struct fleet_conf *conf, struct fleet_opt *opt);
+
+/*! do the work of the sensors on their busses, as the loop does
+ * @param due : all attached sensors are due (checks : no waiting)
+ *
+ * @return results written by all sensors
+ */
+uint32_t fleet_step(bool due);
+
+/* provided by scd30.cpp */
+void get_time_stamp(char * buf);
+bool fetch_dylos_values(uint16_t *pm1, uint16_t *pm10, int verbose);
+
+#endif  // End of definition check
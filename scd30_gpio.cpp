@@ -0,0 +1,347 @@
+/*******************************************************************
+ *
+ * Built-in soft-I2C engine : register access and the mock check.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "SCD30.h"
+# include "scd30_gpio.h"
+# include <errno.h>
+# include <fcntl.h>
+# include <sys/mman.h>
+
+uint32_t gpio_clock_ns = 0;
+
+/* engine on the mock for gpio_check() */
+static SoftI2c<MockGpio> gpio_mock;
+
+/*********************************************************************
+ * @brief measure the cost of a clock read (once)
+ *
+ * The best of 5 runs is taken : a run can be interrupted, but never
+ * be faster than the clock reads.
+ *********************************************************************/
+void gpio_calibrate()
+{
+    struct timespec t, now;
+    uint32_t ns, best = UINT32_MAX;
+    int     r, i;
+
+    if (gpio_clock_ns) return;
+
+    for (r = 0; r < 5; r++)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        for (i = 0; i < 1000; i++) clock_gettime(CLOCK_MONOTONIC, &now);
+        if ((ns = gpio_ns(&t)) < best) best = ns;
+    }
+
+    gpio_clock_ns = best / 1000 ? best / 1000 : 1;
+}
+
+/*********************************************************************
+ * @brief map the GPIO registers
+ *
+ * @return true = OK, false is error
+ *********************************************************************/
+bool MmapGpio::open()
+{
+    void    *p;
+
+    if (reg) return(true);
+
+    if ((fd = ::open(GPIO_DEVICE, O_RDWR | O_SYNC | O_CLOEXEC)) < 0)
+    {
+        p_printf(RED, (char *) "Can not open %s : %s\n", GPIO_DEVICE, strerror(errno));
+        return(false);
+    }
+
+    p = mmap(NULL, GPIO_BLOCK, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (p == MAP_FAILED)
+    {
+        p_printf(RED, (char *) "Can not map %s : %s\n", GPIO_DEVICE, strerror(errno));
+        ::close(fd);
+        fd = -1;
+        return(false);
+    }
+
+    reg = (volatile uint32_t *) p;
+    return(true);
+}
+
+/*********************************************************************
+ * @brief unmap the GPIO registers
+ *********************************************************************/
+void MmapGpio::close()
+{
+    if (reg) munmap((void *) reg, GPIO_BLOCK);
+    if (fd > -1) ::close(fd);
+
+    reg = NULL;
+    fd = -1;
+}
+
+/*********************************************************************
+ * @brief clear the mock registers, all lines released
+ *********************************************************************/
+bool MockGpio::open()
+{
+    memset(reg, 0x0, sizeof(reg));
+    latch = held = 0;
+    prev = 0xffffffff;
+    scl = 0;
+    stretch_us = 0;
+    stretching = false;
+    reads = writes = 0;
+
+    return(true);
+}
+
+/*********************************************************************
+ * @brief lines driven low : output with latch 0
+ *********************************************************************/
+uint32_t MockGpio::driven()
+{
+    uint32_t low = 0, fsel;
+    int     pin, r;
+
+    for (r = 0; r < 4; r++)
+    {
+        for (pin = r * 10, fsel = reg[GPIO_FSEL0 + r]; fsel; pin++, fsel >>= 3)
+            if ((fsel & 7) == 1 && pin < 32 && ! (latch >> pin & 1)) low |= 1U << pin;
+    }
+
+    return(low);
+}
+
+/*********************************************************************
+ * @brief current levels of bank 0
+ *
+ * A line is low if it is driven low, held by the device model or
+ * (SCL) stretched.
+ *********************************************************************/
+uint32_t MockGpio::levels()
+{
+    uint32_t low = held | driven();
+
+    if (stretching)
+    {
+        if (gpio_ns(&stretch_start) / 1000 < stretch_us) low |= 1U << scl;
+        else stretching = false;
+    }
+
+    return(~low);
+}
+
+/*********************************************************************
+ * @brief register write
+ * @param r : register
+ * @param v : value
+ *
+ * A release of SCL starts a clock stretch (if set). The device model
+ * is told about each change of the levels.
+ *********************************************************************/
+void MockGpio::wr(int r, uint32_t v)
+{
+    uint32_t was = driven();
+
+    writes++;
+
+    if (r == GPIO_SET0) latch |= v;
+    else if (r == GPIO_CLR0) latch &= ~v;
+    else reg[r] = v;
+
+    /* SCL released by the engine */
+    if (stretch_us && (was >> scl & 1) && ! (driven() >> scl & 1))
+    {
+        clock_gettime(CLOCK_MONOTONIC, &stretch_start);
+        stretching = true;
+    }
+
+    update();
+}
+
+/*********************************************************************
+ * @brief levels, tell the device model if they changed
+ *
+ * Called on each write and each read of the levels (the end of a clock
+ * stretch is seen by a read).
+ *********************************************************************/
+uint32_t MockGpio::update()
+{
+    uint32_t lev = levels();
+
+    if (lev == prev) return(lev);
+
+    prev = lev;
+
+    if (change)
+    {
+        change(ctx, lev);
+        prev = lev = levels();
+    }
+
+    return(lev);
+}
+
+/* device model for the check : acknowledges every byte */
+struct gpio_acker
+{
+    uint8_t     sda;
+    uint8_t     scl;
+    bool        active;                 // between start and stop
+    int         clocks;                 // rising SCL edges since start
+    uint32_t    prev;
+    MockGpio    *gpio;
+};
+
+static struct gpio_acker acker;
+
+/*********************************************************************
+ * @brief hold SDA low during each 9th clock after start
+ * @param ctx : gpio_acker
+ * @param lev : levels
+ *********************************************************************/
+static void gpio_ack(void *ctx, uint32_t lev)
+{
+    struct gpio_acker *a = (struct gpio_acker *) ctx;
+    bool    scl = lev >> a->scl & 1, sda = lev >> a->sda & 1;
+    bool    scl_was = a->prev >> a->scl & 1, sda_was = a->prev >> a->sda & 1;
+
+    a->prev = lev;
+
+    /* start or stop : SDA changes while SCL is high */
+    if (scl && scl_was && sda != sda_was && ! (a->gpio->held >> a->sda & 1))
+    {
+        a->active = ! sda;
+        a->clocks = 0;
+        return;
+    }
+
+    if (! a->active) return;
+
+    if (scl && ! scl_was) a->clocks++;
+
+    /* SCL fell : the 9th bit is next, or it was done */
+    if (! scl && scl_was)
+    {
+        if (a->clocks % 9 == 8) a->gpio->held |= 1U << a->sda;
+        else a->gpio->held &= ~(1U << a->sda);
+    }
+}
+
+/*********************************************************************
+ * @brief show one result of the check
+ *********************************************************************/
+static bool gpio_result(bool ok, const char *what)
+{
+    p_printf(ok ? GREEN : RED, (char *) "%-40s %s\n", what, ok ? "PASSED" : "FAILED");
+    return(ok);
+}
+
+/*********************************************************************
+ * @brief check the engine on the mock register block
+ * @param khz : clock to check
+ *
+ * @return true = passed
+ *********************************************************************/
+bool gpio_check(uint32_t khz)
+{
+    SoftI2c<MockGpio> *e = &gpio_mock;
+    struct timespec t;
+    char    buf[6] = {0x02, 0x02, 0x00, 0x00, (char) 0x81, 0x00};
+    uint32_t us, expect, ns, i, bits;
+    uint32_t half;
+    bool    ok = true;
+    Wstatus r;
+
+    if (! e->begin(DEF_SDA, DEF_SCL)) return(false);
+
+    e->setSlave(SCD30_ADDRESS);
+    e->setClock(khz);
+
+    p_printf(WHITE, (char *) "clock read %u nS, register access %u nS, half clock %u nS at %u Khz\n",
+        gpio_clock_ns, e->io_ns, e->half, khz);
+
+    /* empty bus : address not acknowledged, start + 9 clocks + stop = 23 half periods */
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    r = e->i2c_write(buf, 1);
+    us = gpio_ns(&t) / 1000;
+    expect = 23 * e->half / 1000;
+
+    ok &= gpio_result(r == I2C_SDA_NACK, "empty bus : address NACK");
+    p_printf(WHITE, (char *) "address + NACK + stop in %u uS (expected %u uS)\n", us, expect);
+    ok &= gpio_result(us >= expect && us <= expect * 2 + 20, "timing");
+
+    /* device acknowledges */
+    acker.sda = DEF_SDA;
+    acker.scl = DEF_SCL;
+    acker.active = false;
+    acker.prev = 0xffffffff;
+    acker.gpio = &e->gpio;
+    e->gpio.ctx = &acker;
+    e->gpio.change = gpio_ack;
+
+    ok &= gpio_result(e->i2c_write(buf, 5) == I2C_OK, "write 5 bytes : ACK");
+    ok &= gpio_result(e->i2c_read(buf, 3) == I2C_OK && (uint8_t) buf[0] == 0xff, "read 3 bytes (released SDA)");
+
+    /* cost of the engine without delay */
+    half = e->half;
+    e->half = 0;
+    e->stats.bytes = 0;
+    e->gpio.reads = e->gpio.writes = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    for (i = 0; i < 2000; i++) e->i2c_write(buf, 2);
+    ns = gpio_ns(&t);
+    bits = e->stats.bytes * 9;
+    e->half = half;
+
+    p_printf(WHITE, (char *) "engine without delay : %u nS / bit, %u register accesses / bit (mock)\n",
+        ns / bits, (e->gpio.reads + e->gpio.writes) / (e->stats.bytes * 9));
+
+    /* clock stretched 2 mS at each clock : spins, then sleeps */
+    e->gpio.scl = DEF_SCL;
+    e->gpio.stretch_us = 2000;
+    e->setClockStretchLimit(200000);
+    e->stats.naps = e->stats.stretches = e->stats.stretch_max = 0;
+
+    r = e->i2c_write(buf, 1);
+    ok &= gpio_result(r == I2C_OK, "2 mS clock stretch");
+    p_printf(WHITE, (char *) "%u stretches, %u sleeps, longest %u uS\n",
+        e->stats.stretches, e->stats.naps, e->stats.stretch_max);
+    ok &= gpio_result(e->stats.naps > 0 && e->stats.naps < e->stats.stretches * 10, "yields while stretched");
+
+    /* stretched beyond the limit */
+    e->gpio.stretch_us = 50000;
+    e->setClockStretchLimit(10000);
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    r = e->i2c_write(buf, 1);
+    us = gpio_ns(&t) / 1000;
+
+    p_printf(WHITE, (char *) "stretch limit 10000 uS reached after %u uS\n", us);
+    ok &= gpio_result(r == I2C_SCL_CLKSTR && us < 20000, "clock stretch limit");
+
+    e->gpio.stretch_us = 0;
+    e->close();
+
+    return(ok);
+}
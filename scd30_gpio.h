@@ -0,0 +1,497 @@
+/*******************************************************************
+ *
+ * Built-in soft-I2C engine on the mapped GPIO registers.
+ *
+ * The engine toggles SDA and SCL through the BCM2835 GPIO register
+ * block as open drain lines : a line is driven low by making the pin
+ * an output (latch 0), it is released by making it an input, the
+ * pull-up resistor makes it high.
+ *
+ * The register access is a policy :
+ *
+ *  MmapGpio : /dev/gpiomem mapped (no root needed)
+ *  MockGpio : a register block in memory. Lines are high unless
+ *             driven low by the engine or held low by a device model
+ *             (clock stretch, ACK, simulator), see scd30_gpio.cpp
+ *
+ *   SoftI2c<MmapGpio> i2c;
+ *
+ *   i2c.begin(2, 3);
+ *   i2c.setSlave(SCD30_ADDRESS);
+ *   i2c.i2c_write(buf, 2);
+ *
+ * Timing : each half clock period ends at a deadline on CLOCK_MONOTONIC
+ * counted from the end of the previous one. The register accesses in
+ * between are part of the period and a change of the CPU clock by the
+ * governor does not change the I2C clock (a busy loop calibrated at
+ * start would). gpio_calibrate() measures the cost of a clock read,
+ * which is the resolution of the delay. A clock that is stretched by
+ * the slave is polled for GPIO_STRETCH_SPIN uS, then the engine sleeps
+ * between polls (GPIO_STRETCH_NAP uS, doubled up to GPIO_STRETCH_NAP_MAX)
+ * until the clock stretch limit. The time spun in the delays and the
+ * time the clock was stretched are counted in the statistics.
+ *
+ * SoftI2c has write() / read() / wait_us() as well, so it is a
+ * transport for the protocol layer (scd30_proto.h). The SCD30 driver
+ * uses it for soft_I2C with settings.engine (-O, fleet interface gpio).
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_GPIO_H__
+#define __SCD30_GPIO_H__
+
+# include <twowire.h>
+# include <stdint.h>
+# include <string.h>
+# include <time.h>
+# include <unistd.h>
+
+/* BCM2835 GPIO registers (32 bit word offset), bank 0 (GPIO 0 - 31) only */
+# define GPIO_FSEL0     0                   // function select, 3 bits per pin
+# define GPIO_SET0      7                   // output latch set
+# define GPIO_CLR0      10                  // output latch clear
+# define GPIO_LEV0      13                  // pin level
+# define GPIO_PUD       37                  // pull-up / down control
+# define GPIO_PUDCLK0   38                  // pull-up / down clock
+# define GPIO_REGS      41                  // registers used
+# define GPIO_BLOCK     4096                // bytes mapped
+
+# define GPIO_DEVICE    "/dev/gpiomem"
+
+/* highest GPIO on the 40 pin header */
+# define GPIO_MAXPIN    27
+
+/* clock stretch : spin, then sleep between polls */
+# define GPIO_STRETCH_SPIN 50               // uS polling
+# define GPIO_STRETCH_NAP 50                // first sleep in uS
+# define GPIO_STRETCH_NAP_MAX 1000          // longest sleep in uS
+
+/* nS to read CLOCK_MONOTONIC (set by gpio_calibrate()) */
+extern uint32_t gpio_clock_ns;
+
+/*! measure the cost of a clock read (once) */
+void gpio_calibrate();
+
+/*! nS since t */
+static inline uint32_t gpio_ns(struct timespec *t)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return((now.tv_sec - t->tv_sec) * 1000000000 + (now.tv_nsec - t->tv_nsec));
+}
+
+/* /dev/gpiomem */
+class MmapGpio
+{
+  public:
+    volatile uint32_t *reg;             // mapped register block (NULL = not open)
+
+    MmapGpio() { reg = NULL; fd = -1; }
+
+    /*! map the registers
+     * @return true = OK, false is error */
+    bool open();
+
+    /*! unmap the registers */
+    void close();
+
+    uint32_t rd(int r) { return(reg[r]); }
+    void wr(int r, uint32_t v) { reg[r] = v; }
+
+  private:
+    int         fd;
+};
+
+/* register block in memory */
+class MockGpio
+{
+  public:
+    uint32_t    reg[GPIO_REGS];         // as written by the engine
+    uint32_t    latch;                  // output latch (GPIO_SET0 / GPIO_CLR0)
+    uint32_t    held;                   // lines held low by a device model
+    uint32_t    prev;                   // levels at the last change
+
+    /* clock stretch : SCL is held low this long after each release */
+    uint8_t     scl;
+    uint32_t    stretch_us;
+    bool        stretching;
+    struct timespec stretch_start;
+
+    /* device model : called when a level changes (may set held) */
+    void        (*change)(void *ctx, uint32_t levels);
+    void        *ctx;
+
+    uint32_t    reads;                  // register reads
+    uint32_t    writes;                 // register writes
+
+    MockGpio() { change = NULL; ctx = NULL; open(); }
+
+    /*! clear the registers, all lines released */
+    bool open();
+    void close() { }
+
+    /*! current levels of bank 0 */
+    uint32_t levels();
+
+    /*! lines driven low by the engine */
+    uint32_t driven();
+
+    uint32_t rd(int r) { reads++; return(r == GPIO_LEV0 ? update() : reg[r]); }
+    void wr(int r, uint32_t v);
+
+  private:
+    /*! levels, tell the device model if they changed */
+    uint32_t update();
+};
+
+/* engine statistics */
+struct gpio_stats
+{
+    uint32_t    transactions;
+    uint32_t    bytes;                  // incl. address, acknowledged or not
+    uint32_t    nacks;                  // address not acknowledged
+    uint32_t    busy;                   // SDA low at start
+    uint32_t    stretches;              // clock stretched by the slave
+    uint32_t    naps;                   // sleeps while stretched
+    uint32_t    stretch_max;            // longest stretch in uS
+    uint32_t    stretch_timeouts;       // limit reached
+    uint64_t    busy_ns;                // time in transactions
+    uint64_t    spin_ns;                // busy-waiting for the half clock deadline
+    uint64_t    stretch_ns;             // waiting while the clock was stretched
+};
+
+template <class G> class SoftI2c
+{
+  public:
+    G           gpio;                   // register access
+    uint8_t     sda;
+    uint8_t     scl;
+    uint8_t     address;                // slave address
+    uint32_t    khz;                    // clock
+    uint32_t    half;                   // nS per half clock period
+    uint32_t    io_ns;                  // cost of a register access
+    uint32_t    stretch_us;             // clock stretch limit
+    struct gpio_stats stats;
+
+    SoftI2c()
+    {
+        sda = scl = address = 0;
+        khz = 100;
+        half = io_ns = 0;
+        stretch_us = 200000;
+        memset(&stats, 0x0, sizeof(stats));
+    }
+
+    /*! map the registers and release the lines
+     * @param sda_pin : SDA GPIO (0 - GPIO_MAXPIN)
+     * @param scl_pin : SCL GPIO (0 - GPIO_MAXPIN)
+     * @return true = OK, false is error */
+    bool begin(uint8_t sda_pin, uint8_t scl_pin)
+    {
+        struct timespec t;
+        int     i;
+
+        if (sda_pin > GPIO_MAXPIN || scl_pin > GPIO_MAXPIN || sda_pin == scl_pin || ! gpio.open()) return(false);
+
+        sda = sda_pin;
+        scl = scl_pin;
+
+        line(sda, false);
+        line(scl, false);
+        gpio.wr(GPIO_CLR0, 1U << sda | 1U << scl);
+
+        /* cost of a register access (a released line stays released) */
+        gpio_calibrate();
+        clock_gettime(CLOCK_MONOTONIC, &edge);
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        for (i = 0; i < 1000; i++) line(scl, false);
+        io_ns = gpio_ns(&t) / 2000;
+
+        setClock(khz);
+        return(true);
+    }
+
+    /*! release the lines and unmap */
+    void close()
+    {
+        if (scl == sda) return;
+        line(sda, false);
+        line(scl, false);
+        gpio.close();
+        sda = scl = 0;
+    }
+
+    /*! set the clock
+     * @param k : Khz */
+    void setClock(uint32_t k)
+    {
+        khz = k ? k : 1;
+        half = 500000 / khz;
+    }
+
+    void setClockStretchLimit(uint32_t us) { stretch_us = us; }
+    void setSlave(uint8_t a) { address = a; }
+
+    /*! enable the pull-up resistors (BCM2835 / BCM2837 sequence) */
+    void setPullup()
+    {
+        gpio.wr(GPIO_PUD, 2);
+        usleep(1);
+        gpio.wr(GPIO_PUDCLK0, 1U << sda | 1U << scl);
+        usleep(1);
+        gpio.wr(GPIO_PUD, 0);
+        gpio.wr(GPIO_PUDCLK0, 0);
+    }
+
+    /*! write to the slave
+     * @return I2C_OK, I2C_SDA_NACK (address), I2C_SDA_DATA (data NACK or
+     * bus busy), I2C_SCL_CLKSTR (stretch limit) */
+    Wstatus i2c_write(const char *buf, uint32_t len)
+    {
+        struct timespec t;
+        Wstatus ret;
+        uint32_t i;
+
+        clock_gettime(CLOCK_MONOTONIC, &t);
+
+        if ((ret = start()) == I2C_OK && (ret = put(address << 1)) == I2C_SDA_NACK) stats.nacks++;
+
+        for (i = 0; ret == I2C_OK && i < len; i++)
+            if ((ret = put(buf[i])) == I2C_SDA_NACK) ret = I2C_SDA_DATA;
+
+        return(done(ret, &t));
+    }
+
+    /*! read from the slave (all bytes acknowledged, except the last)
+     * @return as i2c_write() */
+    Wstatus i2c_read(char *buf, uint32_t len)
+    {
+        struct timespec t;
+        Wstatus ret;
+        uint32_t i;
+
+        clock_gettime(CLOCK_MONOTONIC, &t);
+
+        if ((ret = start()) == I2C_OK && (ret = put(address << 1 | 1)) == I2C_SDA_NACK) stats.nacks++;
+
+        for (i = 0; ret == I2C_OK && i < len; i++)
+            ret = get((uint8_t *) &buf[i], i < len - 1);
+
+        return(done(ret, &t));
+    }
+
+    /* transport for the protocol layer */
+    Wstatus write(const char *buf, uint32_t len) { return(i2c_write(buf, len)); }
+    Wstatus read(char *buf, uint32_t len) { return(i2c_read(buf, len)); }
+    void wait_us(uint32_t us) { usleep(us); }
+    void stretch(uint32_t us) { setClockStretchLimit(us); }
+
+  private:
+
+    /*! drive a line low or release it (open drain) */
+    inline void line(uint8_t pin, bool low)
+    {
+        int r = GPIO_FSEL0 + pin / 10, sh = (pin % 10) * 3;
+        uint32_t v = gpio.rd(r) & ~(7U << sh);
+
+        gpio.wr(r, low ? v | 1U << sh : v);
+    }
+
+    inline bool level(uint8_t pin) { return(gpio.rd(GPIO_LEV0) >> pin & 1); }
+
+    /* end of the last half clock period */
+    struct timespec edge;
+
+    /*! half a clock period after the last one */
+    inline void delay()
+    {
+        struct timespec now, first;
+
+        clock_gettime(CLOCK_MONOTONIC, &first);
+
+        for (now = first; (now.tv_sec - edge.tv_sec) * 1000000000 + (now.tv_nsec - edge.tv_nsec) < half; )
+            clock_gettime(CLOCK_MONOTONIC, &now);
+
+        stats.spin_ns += (now.tv_sec - first.tv_sec) * 1000000000 + (now.tv_nsec - first.tv_nsec);
+        edge = now;
+    }
+
+    /*! release SCL and wait for it to be high (clock stretch) */
+    Wstatus clock_high()
+    {
+        struct timespec t, nap;
+        uint32_t us, sleep_us = GPIO_STRETCH_NAP;
+
+        line(scl, false);
+
+        if (level(scl)) return(I2C_OK);
+
+        stats.stretches++;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+
+        while (! level(scl))
+        {
+            us = gpio_ns(&t) / 1000;
+
+            if (us >= stretch_us)
+            {
+                stats.stretch_ns += (uint64_t) us * 1000;
+                stats.stretch_timeouts++;
+                return(I2C_SCL_CLKSTR);
+            }
+
+            /* a long stretch : give the CPU away */
+            if (us >= GPIO_STRETCH_SPIN)
+            {
+                nap.tv_sec = 0;
+                nap.tv_nsec = sleep_us * 1000;
+                nanosleep(&nap, NULL);
+                stats.naps++;
+
+                if (sleep_us * 2 <= GPIO_STRETCH_NAP_MAX) sleep_us *= 2;
+            }
+        }
+
+        us = gpio_ns(&t) / 1000;
+        if (us > stats.stretch_max) stats.stretch_max = us;
+        stats.stretch_ns += (uint64_t) us * 1000;
+
+        /* the high period starts now */
+        clock_gettime(CLOCK_MONOTONIC, &edge);
+        return(I2C_OK);
+    }
+
+    /*! start condition : SDA low while SCL high */
+    Wstatus start()
+    {
+        clock_gettime(CLOCK_MONOTONIC, &edge);
+        line(sda, false);
+        if (clock_high() != I2C_OK) return(I2C_SCL_CLKSTR);
+
+        /* other master or slave holding the bus */
+        if (! level(sda))
+        {
+            stats.busy++;
+            return(I2C_SDA_DATA);
+        }
+
+        delay();
+        line(sda, true);
+        delay();
+        line(scl, true);
+        return(I2C_OK);
+    }
+
+    /*! stop condition : SDA high while SCL high, both released */
+    void stop()
+    {
+        line(sda, true);
+        delay();
+        clock_high();
+        delay();
+        line(sda, false);
+        delay();
+    }
+
+    /*! one bit out, SCL is low on entry and exit */
+    inline Wstatus bit_out(bool bit)
+    {
+        line(sda, ! bit);
+        delay();
+        if (clock_high() != I2C_OK) return(I2C_SCL_CLKSTR);
+        delay();
+        line(scl, true);
+        return(I2C_OK);
+    }
+
+    /*! one bit in, SCL is low on entry and exit */
+    inline Wstatus bit_in(bool *bit)
+    {
+        line(sda, false);
+        delay();
+        if (clock_high() != I2C_OK) return(I2C_SCL_CLKSTR);
+        *bit = level(sda);
+        delay();
+        line(scl, true);
+        return(I2C_OK);
+    }
+
+    /*! byte out, MSB first
+     * @return I2C_OK (ACK), I2C_SDA_NACK or I2C_SCL_CLKSTR */
+    Wstatus put(uint8_t b)
+    {
+        bool    nack;
+        int     i;
+
+        for (i = 7; i >= 0; i--)
+            if (bit_out(b >> i & 1) != I2C_OK) return(I2C_SCL_CLKSTR);
+
+        if (bit_in(&nack) != I2C_OK) return(I2C_SCL_CLKSTR);
+
+        stats.bytes++;
+        return(nack ? I2C_SDA_NACK : I2C_OK);
+    }
+
+    /*! byte in, MSB first, then ACK or NACK */
+    Wstatus get(uint8_t *b, bool ack)
+    {
+        bool    bit;
+        int     i;
+
+        for (i = 0, *b = 0; i < 8; i++)
+        {
+            if (bit_in(&bit) != I2C_OK) return(I2C_SCL_CLKSTR);
+            *b = *b << 1 | bit;
+        }
+
+        stats.bytes++;
+        return(bit_out(! ack));
+    }
+
+    /*! end of a transaction : stop (or only release after a stretch
+     * timeout, a stop would wait again) and statistics */
+    Wstatus done(Wstatus ret, struct timespec *t)
+    {
+        if (ret == I2C_SCL_CLKSTR)
+        {
+            line(sda, false);
+            line(scl, false);
+        }
+        else
+            stop();
+
+        stats.transactions++;
+        stats.busy_ns += gpio_ns(t);
+
+        return(ret);
+    }
+};
+
+/*! check the engine on the mock register block : timing, NACK, ACK,
+ * clock stretch and stretch limit
+ * @param khz : clock to check
+ *
+ * @return true = passed
+ */
+bool gpio_check(uint32_t khz);
+
+#endif  // End of definition check
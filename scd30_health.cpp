@@ -0,0 +1,190 @@
+/*******************************************************************
+ *
+ * Health supervisor for SCD30 sensors.
+ *
+ * The faults are derived from the change of the driver statistics
+ * since the previous check, so the supervisor does not add any
+ * transactions on a healthy sensor.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "scd30_health.h"
+
+const char *health_faults[HEALTH_FAULTS] = {"no", "bus", "sensor", "stale data", "CRC storm"};
+
+const char *health_steps[HEALTH_STEPS] = {"none", "retry", "probe", "soft reset", "re-initialize", "detach"};
+
+/*********************************************************************
+ * @brief get monotonic time in milli seconds
+ *********************************************************************/
+uint64_t health_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return((uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/*********************************************************************
+ * @brief fault class name
+ *********************************************************************/
+const char *health_fault_name(health_fault f)
+{
+    return(health_faults[f]);
+}
+
+/*********************************************************************
+ * @brief step name
+ *********************************************************************/
+const char *health_step_name(health_step s)
+{
+    return(health_steps[s]);
+}
+
+/*********************************************************************
+ * @brief take a snapshot of the error statistics
+ * @param h : supervisor
+ * @param st : driver statistics
+ *********************************************************************/
+void health_snapshot(struct scd30_health *h, scd30_stats *st)
+{
+    h->errors = st->write_errors + st->read_errors;
+    h->nacks = st->nack_errors;
+    h->crc = st->crc_errors;
+}
+
+/*********************************************************************
+ * @brief start supervising a (re)attached sensor
+ * @param h : supervisor
+ * @param dev : the SCD30
+ * @param name : sensor name for messages
+ * @param interval : measurement interval in seconds
+ *
+ * The counters are not reset (clear the structure before first use)
+ *********************************************************************/
+void health_init(struct scd30_health *h, SCD30 *dev, const char *name, uint16_t interval)
+{
+    scd30_stats st;
+
+    h->name = name;
+    h->interval = interval;
+    h->last_sample = health_ms();
+    h->hold = 0;
+    h->step = HEALTH_NONE;
+    h->fault = HEALTH_OK;
+
+    dev->getStats(&st);
+    health_snapshot(h, &st);
+}
+
+/*********************************************************************
+ * @brief check after a read attempt and take the next step if needed
+ * @param h : supervisor
+ * @param dev : the SCD30
+ * @param sample : a sample was read
+ *
+ * @return step taken. On HEALTH_DETACH the caller must detach.
+ *********************************************************************/
+health_step health_check(struct scd30_health *h, SCD30 *dev, bool sample)
+{
+    scd30_stats st;
+    uint32_t errors, nacks, crc;
+    uint64_t now = health_ms();
+    health_fault fault;
+    health_step step;
+
+    dev->getStats(&st);
+
+    errors = st.write_errors + st.read_errors - h->errors;
+    nacks = st.nack_errors - h->nacks;
+    crc = st.crc_errors - h->crc;
+
+    health_snapshot(h, &st);
+
+    /* classify */
+    if (crc >= HEALTH_CRC_STORM) fault = HEALTH_CRC;
+    else if (errors > nacks) fault = HEALTH_BUS;
+    else if (nacks > 0) fault = HEALTH_SENSOR;
+    else if (! sample && now - h->last_sample > (uint64_t) h->interval * 2000 + HEALTH_WARMUP) fault = HEALTH_STALE;
+    else fault = HEALTH_OK;
+
+    if (fault != HEALTH_OK) h->faults[fault]++;
+
+    /* a sample arrived : healthy */
+    if (sample)
+    {
+        if (h->step != HEALTH_NONE)
+            p_printf(GREEN, (char *) "%s : recovered after %s\n", h->name, health_step_name(h->step));
+
+        h->last_sample = now;
+        h->step = HEALTH_NONE;
+        h->fault = HEALTH_OK;
+        return(HEALTH_NONE);
+    }
+
+    /* not ready yet, but within the expected period */
+    if (fault == HEALTH_OK) return(HEALTH_NONE);
+
+    h->fault = fault;
+
+    /* give the previous step time to work */
+    if (now < h->hold) return(HEALTH_NONE);
+
+    step = (health_step) (h->step + 1);
+    if (step == HEALTH_STEPS) step = HEALTH_DETACH;
+
+    /* a soft reset will not solve a bus problem */
+    if (step == HEALTH_RESET && (fault == HEALTH_BUS || fault == HEALTH_CRC)) step = HEALTH_REINIT;
+
+    p_printf(step < HEALTH_RESET ? YELLOW : RED, (char *) "%s : %s fault, %s\n",
+        h->name, health_fault_name(fault), health_step_name(step));
+
+    switch(step)
+    {
+    case HEALTH_PROBE:
+        if (! dev->probe()) p_printf(RED, (char *) "%s : not responding\n", h->name);
+        break;
+
+    case HEALTH_RESET:
+        dev->SoftReset();
+        h->hold = now + (uint64_t) h->interval * 1000 + HEALTH_WARMUP;
+        h->last_sample = now;
+        break;
+
+    case HEALTH_REINIT:
+        dev->reinit();
+        h->hold = now + (uint64_t) h->interval * 1000 + HEALTH_WARMUP;
+        h->last_sample = now;
+        break;
+
+    default:
+        break;
+    }
+
+    /* the step itself can add errors */
+    dev->getStats(&st);
+    health_snapshot(h, &st);
+
+    h->steps[step]++;
+    h->step = step;
+
+    return(step);
+}
@@ -0,0 +1,122 @@
+/*******************************************************************
+ *
+ * Health supervisor for SCD30 sensors.
+ *
+ * After each read attempt the supervisor checks whether a sample
+ * arrived in time (based on the measurement interval) and what the
+ * driver statistics tell about the bus. Faults are classified as :
+ *
+ *  bus     : I2C errors other than NACK (clock stretch, data, mux)
+ *  sensor  : the SCD30 does not acknowledge
+ *  stale   : no errors, but no sample for 2 measurement intervals
+ *  crc     : HEALTH_CRC_STORM or more CRC errors in one read attempt
+ *
+ * "no data available" within the expected period is NOT a fault. A
+ * fault is handled with escalating steps, each logged and counted :
+ *
+ *  retry   : nothing, try again on the next read
+ *  probe   : check the SCD30 responds (firmware level read)
+ *  reset   : soft reset of the SCD30   (sensor / stale only)
+ *  reinit  : re-initialize the bus and the SCD30
+ *  detach  : give up, the caller detaches the sensor
+ *
+ * After a reset or reinit the next step is held back for one
+ * measurement interval + HEALTH_WARMUP, so the sensor can provide
+ * its first sample.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_HEALTH_H__
+#define __SCD30_HEALTH_H__
+
+# include "SCD30.h"
+
+/* CRC errors in one read attempt that are considered a storm */
+# define HEALTH_CRC_STORM 3
+
+/* mS for the SCD30 to start measuring after a reset */
+# define HEALTH_WARMUP 2000
+
+/* fault classes */
+enum health_fault
+{
+    HEALTH_OK = 0,
+    HEALTH_BUS,
+    HEALTH_SENSOR,
+    HEALTH_STALE,
+    HEALTH_CRC,
+    HEALTH_FAULTS           // number of classes
+};
+
+/* escalation steps */
+enum health_step
+{
+    HEALTH_NONE = 0,
+    HEALTH_RETRY,
+    HEALTH_PROBE,
+    HEALTH_RESET,
+    HEALTH_REINIT,
+    HEALTH_DETACH,
+    HEALTH_STEPS            // number of steps
+};
+
+struct scd30_health
+{
+    const char  *name;                  // sensor name for messages
+    uint16_t    interval;               // measurement interval in seconds
+    uint64_t    last_sample;            // mS of last sample (or (re)start)
+    uint64_t    hold;                   // no escalation before (mS)
+    health_step step;                   // last step taken
+    health_fault fault;                 // current fault
+
+    /* statistics at last check */
+    uint32_t    errors;                 // read + write errors
+    uint32_t    nacks;                  // NACK errors
+    uint32_t    crc;                    // CRC errors
+
+    /* counters */
+    uint32_t    faults[HEALTH_FAULTS];  // faults detected per class
+    uint32_t    steps[HEALTH_STEPS];    // steps taken
+};
+
+/*! start supervising a (re)attached sensor
+ * @param h : supervisor
+ * @param dev : the SCD30
+ * @param name : sensor name for messages
+ * @param interval : measurement interval in seconds
+ */
+void health_init(struct scd30_health *h, SCD30 *dev, const char *name, uint16_t interval);
+
+/*! check after a read attempt and take the next step if needed
+ * @param h : supervisor
+ * @param dev : the SCD30
+ * @param sample : a sample was read
+ *
+ * @return step taken. On HEALTH_DETACH the caller must detach.
+ */
+health_step health_check(struct scd30_health *h, SCD30 *dev, bool sample);
+
+/*! fault class name */
+const char *health_fault_name(health_fault f);
+
+/*! step name */
+const char *health_step_name(health_step s);
+
+#endif  // End of definition check
@@ -0,0 +1,344 @@
+/*******************************************************************
+ *
+ * Identity cache for SCD30 sensors.
+ *
+ * The cache is kept in memory and written to file (as a whole) after
+ * each change. The file is first written to a temporary file and then
+ * renamed, so a crash never leaves a half written cache.
+ *
+ * The validation is done with a firmware level read. That will detect
+ * a missing sensor or a sensor with an other firmware. The firmware
+ * level is the same on most sensors, so the settings that are stored
+ * in the SCD30 (altitude, FRC, temperature offset) and are known in the
+ * cache are read back as well. A sensor that was swapped for an other
+ * will (almost always) have other values and the serial number is read
+ * again. Only if all match the cached settings are trusted.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "scd30_ident.h"
+# include <ctype.h>
+
+/* cached identities */
+struct scd30_ident idents[IDENT_MAX];
+
+/* cache file (empty = not persistent) */
+char ident_path[MAXBUF];
+
+/* write error already reported */
+bool ident_warned = false;
+
+/*********************************************************************
+ * @brief set the unknown settings of an entry
+ * @param id : entry
+ *********************************************************************/
+void ident_clear(struct scd30_ident *id)
+{
+    id->interval = id->asc = id->altitude = -1;
+    id->pressure = id->temp_offset = id->frc = -1;
+}
+
+/*********************************************************************
+ * @brief load the identity cache
+ * @param path : cache file (NULL is IDENT_FILE)
+ *
+ * A missing file is not an error (empty cache).
+ *
+ * @return  true = OK, false is error in file (cache is empty)
+ *********************************************************************/
+bool ident_open(const char *path)
+{
+    FILE    *fp;
+    char    line[MAXBUF * 2], bus[MODBUS_PORTLEN + 7], serial[IDENT_SERIALLEN];
+    int     v[13], n = 0, lnr = 0;
+    struct scd30_ident *id;
+
+    if (path == NULL) path = IDENT_FILE;
+
+    memset(idents, 0x0, sizeof(idents));
+    strncpy(ident_path, path, MAXBUF - 1);
+
+    if ((fp = fopen(path, "r")) == NULL) return(true);
+
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        lnr++;
+
+        if (line[0] == '#' || line[0] == '\n') continue;
+
+        if (n == IDENT_MAX) break;
+
+        if (sscanf(line, "%70s %i %i %i %i %i %32s %i %i %i %i %i %i %i", bus, &v[0], &v[1],
+            &v[2], &v[3], &v[4], serial, &v[5], &v[6], &v[7], &v[8], &v[9], &v[10], &v[11]) != 14)
+        {
+            p_printf(RED, (char *) "%s line %d : invalid. Identity cache not used\n", path, lnr);
+            memset(idents, 0x0, sizeof(idents));
+            fclose(fp);
+            return(false);
+        }
+
+        id = &idents[n++];
+        id->used = true;
+        id->modbus = strncmp(bus, "modbus:", 7) == 0;
+        if (id->modbus) strcpy(id->port, bus + 7);  // fits : bus is max. 7 + MODBUS_PORTLEN - 1
+        id->I2C_interface = strcmp(bus, "hard") == 0 ? hard_I2C : soft_I2C;
+        id->sda = v[0];
+        id->scl = v[1];
+        id->mux_address = v[2];
+        id->mux_channel = v[3];
+        id->address = v[4];
+        strcpy(id->serial, serial);
+        id->fw = v[5];
+        id->interval = v[6];
+        id->asc = v[7];
+        id->altitude = v[8];
+        id->pressure = v[9];
+        id->temp_offset = v[10];
+        id->frc = v[11];
+    }
+
+    fclose(fp);
+
+    return(true);
+}
+
+/*********************************************************************
+ * @brief write the identity cache
+ *
+ * @return  true = OK, false is error
+ *********************************************************************/
+bool ident_save()
+{
+    FILE    *fp;
+    char    tmp[MAXBUF + 5];
+    int     i;
+    struct scd30_ident *id;
+
+    if (ident_path[0] == 0x0) return(true);
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", ident_path);
+
+    if ((fp = fopen(tmp, "w")) == NULL)
+    {
+        if (! ident_warned) p_printf(RED, (char *) "Can not write identity cache %s\n", tmp);
+        ident_warned = true;
+        return(false);
+    }
+
+    fprintf(fp, "# bus sda scl mux channel address serial firmware interval asc altitude pressure tempoffset frc\n");
+
+    for (i = 0; i < IDENT_MAX; i++)
+    {
+        id = &idents[i];
+        if (! id->used) continue;
+
+        fprintf(fp, "%s%s %d %d 0x%02x %d 0x%02x %s 0x%04x %d %d %d %d %d %d\n",
+            id->modbus ? "modbus:" : id->I2C_interface == hard_I2C ? "hard" : "soft",
+            id->modbus ? id->port : "", id->sda, id->scl,
+            id->mux_address, id->mux_channel, id->address, id->serial, id->fw,
+            id->interval, id->asc, id->altitude, id->pressure, id->temp_offset, id->frc);
+    }
+
+    if (fclose(fp) != 0 || rename(tmp, ident_path) != 0)
+    {
+        unlink(tmp);
+        return(false);
+    }
+
+    return(true);
+}
+
+/*********************************************************************
+ * @brief find the cache entry with the same key
+ * @param key : identity with the key to look for
+ *
+ * @return entry or NULL if not in cache
+ *********************************************************************/
+struct scd30_ident *ident_find(struct scd30_ident *key)
+{
+    int i;
+    struct scd30_ident *id;
+
+    for (i = 0; i < IDENT_MAX; i++)
+    {
+        id = &idents[i];
+
+        if (! id->used || id->modbus != key->modbus) continue;
+
+        /* Modbus : only the port */
+        if (id->modbus)
+        {
+            if (strcmp(id->port, key->port) == 0) return(id);
+            continue;
+        }
+
+        if (id->I2C_interface != key->I2C_interface) continue;
+
+        /* GPIO only matter for soft_I2C */
+        if (id->I2C_interface == soft_I2C && (id->sda != key->sda || id->scl != key->scl))
+            continue;
+
+        if (id->mux_address != key->mux_address || id->address != key->address)
+            continue;
+
+        if (id->mux_address != NO_MUX && id->mux_channel != key->mux_channel)
+            continue;
+
+        return(id);
+    }
+
+    return(NULL);
+}
+
+/*********************************************************************
+ * @brief store an identity and write the cache file if changed
+ * @param id : identity as obtained with ident_get()
+ *
+ * If the cache is full, the first entry is replaced.
+ *
+ * @return  true = OK, false is error
+ *********************************************************************/
+bool ident_put(struct scd30_ident *id)
+{
+    struct scd30_ident *e;
+    int i;
+
+    if ((e = ident_find(id)) == NULL)
+    {
+        for (i = 0; i < IDENT_MAX; i++)
+            if (! idents[i].used) break;
+
+        e = &idents[i == IDENT_MAX ? 0 : i];
+    }
+    else if (memcmp(e, id, sizeof(struct scd30_ident)) == 0)
+        return(true);
+
+    memcpy(e, id, sizeof(struct scd30_ident));
+    e->used = true;
+
+    return(ident_save());
+}
+
+/*********************************************************************
+ * @brief read back the stored settings that are known in the cache
+ * @param dev : SCD30 (after begin())
+ * @param e : cache entry
+ *
+ * A value that is still the factory default (altitude 0, FRC 400, 
+ * temperature offset 0) is the same on any other SCD30 : at least one
+ * known value that is not the default has to match to tell sensors 
+ * apart.
+ *
+ * @return  true = all match and one tells it apart, false if different, 
+ * no answer or nothing to tell it apart
+ *********************************************************************/
+bool ident_verify(SCD30 *dev, struct scd30_ident *e)
+{
+    uint16_t val;
+    bool    apart = false;
+
+    if (e->altitude != -1)
+    {
+        if (! dev->getSettingValue(COMMAND_SET_ALTITUDE_COMPENSATION, &val) ||
+            (int16_t) val != e->altitude) return(false);
+        
+        if (e->altitude != 0) apart = true;
+    }
+
+    if (e->frc != -1)
+    {
+        if (! dev->getSettingValue(COMMAND_SET_FORCED_RECALIBRATION_FACTOR, &val) ||
+            val != e->frc) return(false);
+        
+        if (e->frc != 400) apart = true;
+    }
+
+    if (e->temp_offset != -1)
+    {
+        if (! dev->getSettingValue(COMMAND_SET_TEMPERATURE_OFFSET, &val) ||
+            val != e->temp_offset * scd30_cmds[SCD30_CMD_TEMP_OFFSET].scale) return(false);
+        
+        if (e->temp_offset != 0) apart = true;
+    }
+
+    return(apart);
+}
+
+/*********************************************************************
+ * @brief obtain the identity of an initialized SCD30
+ * @param dev : SCD30 (after begin())
+ * @param id : to store the identity
+ * @param cached : set to true if taken from the cache
+ * @param reread : do not use the cache, read the serial number
+ *
+ * @return  true = OK, false if the SCD30 did not respond
+ *********************************************************************/
+bool ident_get(SCD30 *dev, struct scd30_ident *id, bool *cached, bool reread)
+{
+    char    buf[IDENT_SERIALLEN];
+    uint16_t fw;
+    int     i;
+    struct scd30_ident *e;
+
+    *cached = false;
+
+    memset(id, 0x0, sizeof(struct scd30_ident));
+    id->used = true;
+    id->modbus = dev->settings.modbus != NULL;
+    if (id->modbus) strncpy(id->port, dev->settings.modbus, MODBUS_PORTLEN - 1);
+    id->I2C_interface = dev->settings.I2C_interface;
+    id->sda = dev->settings.sda;
+    id->scl = dev->settings.scl;
+    id->mux_address = dev->settings.mux_address;
+    id->mux_channel = dev->settings.mux_channel;
+    id->address = dev->settings.I2C_Address;
+
+    /* the single read to validate (or fill) the cache */
+    if (! dev->getSettingValue(CMD_GET_FW_LEVEL, &fw)) return(false);
+
+    e = ident_find(id);
+
+    /* same firmware and the stored settings as cached : same sensor */
+    if (! reread && e && e->fw == fw && ident_verify(dev, e))
+    {
+        memcpy(id, e, sizeof(struct scd30_ident));
+        *cached = true;
+        return(true);
+    }
+
+    memset(buf, 0x0, sizeof(buf));
+
+    /* Modbus has no register for the serial number */
+    if (! id->modbus && ! dev->getSerialNumber(buf)) return(false);
+
+    /* padded with zero's. Must be one word in the file */
+    for (i = 0; buf[i] != 0x0; i++)
+        if (! isgraph(buf[i])) buf[i] = '?';
+
+    strcpy(id->serial, i ? buf : "-");
+    id->fw = fw;
+
+    /* new or other sensor : the settings are unknown */
+    ident_clear(id);
+
+    ident_put(id);
+
+    return(true);
+}
@@ -0,0 +1,121 @@
+/*******************************************************************
+ *
+ * Identity cache for SCD30 sensors.
+ *
+ * Reading the serial number takes 16 words (each with a CRC check).
+ * The identity (serial number, firmware level and the settings that
+ * were last sent) is kept in a file, keyed by the bus, multiplexer
+ * channel and I2C address of the sensor. On attach a firmware level
+ * read and a read back of the stored settings that are known validate
+ * the cached entry. That needs at least one setting that is not the 
+ * factory default (else any SCD30 matches). Only if that does not 
+ * match, and always after a sensor was detached, the serial number is 
+ * read again.
+ *
+ * File format : one line per sensor, # for comment
+ *
+ * # bus sda scl mux channel address serial firmware interval asc altitude pressure tempoffset frc
+ * soft 2 3 0x70 1 0x61 0CB1D2F3A4B5 0x0342 2 1 -1 -1 -1 -1
+ * modbus:/dev/ttyUSB0 2 3 0x00 0 0x61 - 0x0342 2 1 -1 -1 -1 -1
+ *
+ * A value of -1 is unknown (never sent). A sensor on Modbus is keyed by
+ * its port (the GPIO, multiplexer and address are not used). Modbus has
+ * no register for the serial number : it is '-' and the cached entry is
+ * validated with the read back of the settings only.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_IDENT_H__
+#define __SCD30_IDENT_H__
+
+# include "SCD30.h"
+
+/* default identity cache file */
+# define IDENT_FILE "/var/cache/scd30.ident"
+
+/* max. number of sensors in cache */
+# define IDENT_MAX 64
+
+/* max. length of serial number (+ termination) */
+# define IDENT_SERIALLEN ((SCD30_SERIAL_NUM_WORDS * 2) + 2)
+
+struct scd30_ident
+{
+    bool        used;                   // entry in use
+
+    /* key */
+    bool        modbus;                 // Modbus over UART (only port is used)
+    char        port[MODBUS_PORTLEN];   // UART port (modbus only)
+    bool        I2C_interface;          // hard_I2C or soft_I2C
+    uint8_t     sda;                    // SDA GPIO (soft_I2C only)
+    uint8_t     scl;                    // SCL GPIO (soft_I2C only)
+    uint8_t     mux_address;            // multiplexer or NO_MUX
+    uint8_t     mux_channel;            // channel on multiplexer
+    uint8_t     address;                // I2C address
+
+    /* identity */
+    char        serial[IDENT_SERIALLEN]; // serial number
+    uint16_t    fw;                     // firmware level
+
+    /* last settings sent (-1 = unknown) */
+    int16_t     interval;
+    int16_t     asc;
+    int16_t     altitude;
+    int16_t     pressure;
+    int16_t     temp_offset;
+    int16_t     frc;
+};
+
+/*! load the identity cache
+ * @param path : cache file (NULL is IDENT_FILE)
+ *
+ * A missing file is not an error (empty cache).
+ *
+ * @return  true = OK, false is error in file (cache is empty)
+ */
+bool ident_open(const char *path);
+
+/*! obtain the identity of an initialized SCD30
+ * @param dev : SCD30 (after begin())
+ * @param id : to store the identity
+ * @param cached : set to true if taken from the cache
+ * @param reread : do not use the cache, read the serial number (e.g. 
+ * the sensor was detached : it could have been swapped)
+ *
+ * @return  true = OK, false if the SCD30 did not respond
+ */
+bool ident_get(SCD30 *dev, struct scd30_ident *id, bool *cached, bool reread);
+
+/*! find the cache entry with the same key
+ * @param key : identity with the key to look for
+ *
+ * @return entry or NULL if not in cache
+ */
+struct scd30_ident *ident_find(struct scd30_ident *key);
+
+/*! store an identity (e.g. after changing the settings) and write 
+ * the cache file if it was changed
+ * @param id : identity as obtained with ident_get()
+ *
+ * @return  true = OK, false is error
+ */
+bool ident_put(struct scd30_ident *id);
+
+#endif  // End of definition check
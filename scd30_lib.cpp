@@ -36,6 +36,20 @@
  *   getTemperatureOffset, getAltitudeCompensation, getFirmwareLevel
  * - updates to streamline the library calls & typo's.
  * 
+ * Version 3.2.0 : October 2026
+ * - added driver statistics (getStats)
+ * - measured values and settings are kept per SCD30 instance
+ * - added support for multiple SCD30 on shared busses and I2C multiplexer
+ * - added I2C transaction timing to statistics
+ * - added advisory bus lock to share a bus with other programs
+ * - added probe() for hot-plug detection
+ * - fixed serial number termination outside the buffer
+ * - added reinit() and NACK statistics for the health supervisor
+ * - p_printf() formats on the stack instead of allocating memory
+ * - clock stretch limit per command instead of one 200 mS limit
+ * - soft_I2C can use the built-in engine instead of twowire
+ * - the SCD30 can be on Modbus over UART instead of I2C
+ * 
  * Resources / dependencies:
  * BCM2835 library (http://www.airspayce.com/mikem/bcm2835/)
  * twowire library (https://github.com/paulvha/twowire)
@@ -56,6 +70,13 @@
  **********************************************************************/
 
 #include "SCD30.h"
+#include "scd30_proto.h"
+#include "scd30_trace.h"
+#include "scd30_emul.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
 
 /*
  * 0 : no debug message
@@ -64,23 +85,10 @@
  */
 int SCD_DEBUG = 0;
 
-/* Global main info */
-float   _co2 = 0;
-float   _temperature = 0;
-float   _humidity = 0;
-bool    _asc = true;
-uint16_t _interval = 2;
-
-/* These track the staleness of the current data
- * This allows us to avoid calling readMeasurement() every time 
- * individual datums are requested */
- 
-bool co2HasBeenReported = true;
-bool humidityHasBeenReported = true;
-bool temperatureHasBeenReported = true;
-
-/* global constructor for I2C (hardware of software) */ 
-TwoWire TWI;
+/* I2C busses (hardware or software). An SCD30 has a fixed slave 
+ * address, so multiple SCD30 on the same bus are connected with a
+ * multiplexer. The bus is shared between those SCD30 instances */ 
+scd30_bus scd30_busses[SCD30_MAXBUS];
 
 /* used as part of p_printf() */
 bool NoColor=false;
@@ -96,6 +104,28 @@ SCD30::SCD30(void)
     settings.I2C_Address = SCD30_ADDRESS;
     settings.baudrate = SCD30_SPEED;
     settings.pullup = false;
+    settings.mux_address = NO_MUX;
+    settings.mux_channel = 0;
+    settings.lock_timeout = SCD30_LOCK_TIMEOUT;
+    settings.engine = false;
+    settings.modbus = NULL;
+    settings.emul = NULL;
+    settings.hw_initialized = false;
+    
+    memset(&_stats, 0x0, sizeof(_stats));
+    _stats.tr_min = UINT32_MAX;
+    
+    memset(_stretch, 0x0, sizeof(_stretch));
+    for (int i = 0; i < SCD30_CMD_NUM; i++) _stretch[i].budget = scd30_cmds[i].stretch_us;
+    _stretch_cmd = -1;
+    
+    _bus = NULL;
+    _co2 = _temperature = _humidity = 0;
+    _co2HasBeenReported = _humidityHasBeenReported = _temperatureHasBeenReported = true;
+    _asc = true;
+    _interval = 2;
+    _burst_ready = false;
+    _burst_first = BURST_FIRST;
 }
 
 /************************************************************** 
@@ -107,9 +137,105 @@ SCD30::SCD30(void)
  **************************************************************/
 bool SCD30::begin(bool asc, uint16_t interval) {
     
+    int i, fr = -1;
+    char path[MAXBUF];
+    
     _interval = interval;   // save interval period
     _asc = asc;             // save automatic Self Calibration
     
+    /* release current bus in case of re-initialize */
+    if (_bus) close();
+    
+    /* bus already in use by another SCD30 ? */
+    for (i = 0; i < SCD30_MAXBUS; i++)
+    {
+        if (scd30_busses[i].users == 0)
+        {
+            if (fr == -1) fr = i;
+            continue;
+        }
+        
+        if (scd30_busses[i].emul != settings.emul) continue;
+        
+        if (scd30_busses[i].modbus != (settings.modbus != NULL)) continue;
+        
+        if (settings.modbus) {
+            if (strcmp(scd30_busses[i].port, settings.modbus) != 0) continue;
+        }
+        else {
+            if (scd30_busses[i].I2C_interface != settings.I2C_interface) continue;
+            if (settings.I2C_interface == soft_I2C && scd30_busses[i].engine != settings.engine) continue;
+        }
+        
+        /* there is only one hard_I2C */
+        if (settings.emul || settings.modbus || settings.I2C_interface == hard_I2C ||
+          (scd30_busses[i].sda == settings.sda && scd30_busses[i].scl == settings.scl))
+        {
+            _bus = &scd30_busses[i];
+            _bus->users++;
+            settings.hw_initialized = true;
+            
+            if (SCD_DEBUG > 0) p_printf(YELLOW, (char *) "sharing I2C bus %d\n", i);
+            
+            /* initialize the SCD30 */
+            return(begin_scd30());
+        }
+    }
+    
+    if (fr == -1) {
+        if (SCD_DEBUG > 0) p_printf(RED, (char *) "Too many I2C busses !\n");
+        return(false);
+    }
+    
+    /* Modbus has no multiplexer */
+    if (settings.modbus && settings.mux_address != NO_MUX) {
+        if (SCD_DEBUG > 0) p_printf(RED, (char *) "No multiplexer on Modbus !\n");
+        return(false);
+    }
+    
+    _bus = &scd30_busses[fr];
+    
+    /* Other programs (like a second scd30 instance) can use the same 
+     * bus. An advisory lock file per bus is used to prevent that 
+     * both drive the bus at the same time. */
+    _bus->lock_fd = -1;
+    _bus->lock_depth = 0;
+    _bus->lock_gen = 0;
+    
+    if (settings.lock_timeout > 0 && ! settings.emul)
+    {
+        if (settings.modbus)
+            snprintf(path, MAXBUF, "%s/scd30-modbus-%s.lock", SCD30_LOCKDIR,
+                strrchr(settings.modbus, '/') ? strrchr(settings.modbus, '/') + 1 : settings.modbus);
+        else if (settings.I2C_interface == hard_I2C)
+            snprintf(path, MAXBUF, "%s/scd30-i2c-hard.lock", SCD30_LOCKDIR);
+        else
+            snprintf(path, MAXBUF, "%s/scd30-i2c-soft-%d-%d.lock", SCD30_LOCKDIR, settings.sda, settings.scl);
+        
+        _bus->lock_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+        
+        /* created by an other user : locking works read-only as well */
+        if (_bus->lock_fd < 0) _bus->lock_fd = open(path, O_RDONLY | O_CLOEXEC);
+        
+        if (_bus->lock_fd < 0) {
+            if (SCD_DEBUG > 0) p_printf(RED, (char *) "Can not open bus lock %s. Not locking\n", path);
+        }
+        else {
+            /* allow other users to share */
+            fchmod(_bus->lock_fd, 0666);
+            
+            if (pread(_bus->lock_fd, &_bus->lock_gen, sizeof(uint32_t), 0) != sizeof(uint32_t))
+                _bus->lock_gen = 0;
+        }
+    }
+    
+    /* pins are (re)configured during begin() */
+    if (! lockBus()) {
+        if (_bus->lock_fd > -1) ::close(_bus->lock_fd);
+        _bus = NULL;
+        return(false);
+    }
+    
     /* Enable internal BCM2835 pull-up resistors on the SDA and SCL
      * GPIO. BUT not on GPIO-2 and GPIO-3. The Raspberry has already 
      * external 1k8 pullup resistors on GPIO 2 and 3
@@ -120,32 +246,83 @@ bool SCD30::begin(bool asc, uint16_t interval) {
      * for signal quality. Hence pull-up is disabled by default.
      */
      
-    if (settings.pullup) TWI.setPullup();
+    _bus->emul = settings.emul;
+    _bus->modbus = settings.modbus != NULL && ! _bus->emul;
+    _bus->engine = settings.engine && settings.I2C_interface == soft_I2C && ! _bus->modbus && ! _bus->emul;
     
-    /* initialize the I2C hardware */
-    if (TWI.begin(settings.I2C_interface,settings.sda,settings.scl) != TW_SUCCESS){
+    if (settings.pullup && ! _bus->engine && ! _bus->modbus && ! _bus->emul) _bus->twi.setPullup();
+    
+    /* initialize the I2C hardware (or the built-in engine, or the UART) */
+    if (_bus->emul ? false :
+        _bus->modbus ? ! _bus->mb.open(settings.modbus) :
+        _bus->engine ? ! _bus->soft.begin(settings.sda, settings.scl) :
+        _bus->twi.begin(settings.I2C_interface,settings.sda,settings.scl) != TW_SUCCESS){
         if (SCD_DEBUG > 0) p_printf(RED, (char *) "Can't setup I2c !\n");
+        unlockBus();
+        if (_bus->lock_fd > -1) ::close(_bus->lock_fd);
+        _bus = NULL;
         return(false);
     }
+    
+    _bus->users = 1;
+    _bus->I2C_interface = settings.I2C_interface;
+    _bus->sda = settings.sda;
+    _bus->scl = settings.scl;
+    _bus->mux_address = NO_MUX;
+    settings.hw_initialized = true;
+    
+    if (_bus->emul) {
+        if (SCD_DEBUG > 0) p_printf(YELLOW, (char *) "emulated SCD30\n");
+    }
+    else if (_bus->modbus) {
+        strncpy(_bus->port, settings.modbus, MODBUS_PORTLEN - 1);
+        _bus->port[MODBUS_PORTLEN - 1] = 0x0;
+        if (SCD_DEBUG > 0) p_printf(YELLOW, (char *) "Modbus on %s\n", _bus->port);
+    }
+    else if (_bus->engine) {
+        if (settings.pullup) _bus->soft.setPullup();
+        if (SCD_DEBUG > 0) p_printf(YELLOW, (char *) "built-in soft-I2C engine\n");
+    }
+    else
+        _bus->twi.setDebug(SCD_DEBUG == 2);
   
     /* set baudrate */
-    TWI.setClock(settings.baudrate);
+    _bus->baudrate = settings.baudrate;
+    busClock(settings.baudrate);
    
     /* The SCD30 is using clock stretching for especially after a read ACK
      * This is documented in the interface guide.
      * 
      * The MINIMUM needed for the SCD30 is 14ms (or a value of 1400). 
-     * Setting it to max 200000 will allow for 200ms seconds as the interface 
-     * guide states it could be up to 150ms once a day during calibration 
+     * The interface guide states it could be up to 150ms once a day 
+     * during calibration. Each command sets its own limit (stretchSet()),
+     * until the first command allow for 200ms.
      */
      
-    if (SCD_DEBUG > 0) p_printf(YELLOW, (char *) "setting clock stretching to 20000 (~200ms)\n");
-    TWI.setClockStretchLimit(200000);
+    if (SCD_DEBUG > 0 && ! _bus->modbus && ! _bus->emul) p_printf(YELLOW, (char *) "setting clock stretching to %d (~200ms)\n", STRETCH_MAX);
+    busStretch(STRETCH_MAX);
+    _bus->stretch = STRETCH_MAX;
+    
+    unlockBus();
     
     /* initialize the SCD30 */
     return(begin_scd30());
 }
 
+/***********************************************************
+ * @brief re-initialize the bus and the SCD30
+ * 
+ * Uses the ASC and interval of the last begin(). If the bus is 
+ * shared with other SCD30, it is only re-initialized if this is the
+ * only user.
+ * 
+ * @return  true = OK, false is error 
+ ***********************************************************/
+bool SCD30::reinit() 
+{
+    return(begin(_asc, _interval));
+}
+
 /***********************************************************
  * @brief Initialize the SCD30 
  * 
@@ -155,6 +332,9 @@ bool SCD30::begin(bool asc, uint16_t interval) {
  ***********************************************************/
 bool SCD30::begin_scd30() 
 {
+    /* a burst has to configure again */
+    _burst_ready = false;
+    
     /* if continuous measurement is requested */
     if (_interval > 0)
     {
@@ -179,9 +359,176 @@ bool SCD30::begin_scd30()
  * 
  * There is NO change to the values stored on the SCD30. That could
  * be added here if needed.
+ * 
+ * If the bus is shared with other SCD30, it is only closed by the last.
  ********************************************************************/
 void SCD30::close(void) {
-    TWI.close();
+    
+    if (_bus == NULL) return;
+    
+    if (_bus->users == 1)
+    {
+        /* releasing the pins changes the bus for other programs : close 
+         * under the lock so the generation number tells them. On a 
+         * timeout it is closed anyway. */
+        lockBus();
+        
+        if (_bus->modbus) _bus->mb.close();
+        else if (_bus->engine) _bus->soft.close();
+        else if (! _bus->emul) _bus->twi.close();
+        
+        unlockBus();
+        
+        if (_bus->lock_fd > -1) ::close(_bus->lock_fd);
+        _bus->lock_fd = -1;
+    }
+    
+    _bus->users--;
+    _bus = NULL;
+    settings.hw_initialized = false;
+}
+
+/********************************************************************
+ * @brief obtain the advisory bus lock (shared with other programs)
+ * 
+ * Waits max. settings.lock_timeout mS. The lock can be nested (e.g.
+ * sending a command and reading the answer is one batch).
+ * 
+ * The lock file holds a generation number that is increased on each
+ * unlock. If that number was changed by an other program, the bus
+ * state (pins, multiplexer channel, speed) is re-applied.
+ * 
+ * @return  true = OK, false is timeout
+ ********************************************************************/
+bool SCD30::lockBus() {
+    
+    struct timespec start, now;
+    uint32_t us = 0, gen;
+    bool waited = false;
+    
+    if (_bus == NULL) return(false);
+    
+    if (_bus->lock_fd < 0) return(true);
+    
+    if (_bus->lock_depth++ > 0) return(true);
+    
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    while (flock(_bus->lock_fd, LOCK_EX | LOCK_NB) < 0)
+    {
+        if (errno == EINTR) continue;
+        
+        /* locking not supported : continue without */
+        if (errno != EWOULDBLOCK) break;
+        
+        waited = true;
+        
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        us = (now.tv_sec - start.tv_sec) * 1000000 + (now.tv_nsec - start.tv_nsec) / 1000;
+        
+        if (us >= (uint32_t) settings.lock_timeout * 1000)
+        {
+            if (SCD_DEBUG > 1) p_printf(RED, (char *) "timeout on bus lock\n");
+            _stats.lock_timeouts++;
+            _bus->lock_depth--;
+            return(false);
+        }
+        
+        usleep(500);
+    }
+    
+    _stats.lock_taken++;
+    
+    if (waited)
+    {
+        _stats.lock_contended++;
+        _stats.lock_wait += us;
+        if (us > _stats.lock_wait_max) _stats.lock_wait_max = us;
+    }
+    
+    /* was the bus used by an other program since ? */
+    if (pread(_bus->lock_fd, &gen, sizeof(gen), 0) == sizeof(gen) && gen != _bus->lock_gen)
+    {
+        if (SCD_DEBUG > 1) p_printf(YELLOW, (char *) "bus was used by an other program\n");
+        _stats.lock_foreign++;
+        _bus->lock_gen = gen;
+        
+        /* it could have released or changed the pins */
+        if (_bus->users > 0 && ! busReopen())
+            if (SCD_DEBUG > 0) p_printf(RED, (char *) "Can't setup I2c again !\n");
+        
+        _bus->mux_address = NO_MUX;     // select multiplexer channel again
+        _bus->baudrate = 0;             // set speed again
+        _bus->stretch = 0;              // set clock stretch limit again
+    }
+    
+    return(true);
+}
+
+/********************************************************************
+ * @brief release the advisory bus lock
+ ********************************************************************/
+void SCD30::unlockBus() {
+    
+    if (_bus == NULL || _bus->lock_fd < 0 || _bus->lock_depth == 0) return;
+    
+    if (--_bus->lock_depth > 0) return;
+    
+    /* tell other programs the bus was used (fails if read-only) */
+    _bus->lock_gen++;
+    if (pwrite(_bus->lock_fd, &_bus->lock_gen, sizeof(uint32_t), 0) != sizeof(uint32_t))
+        _bus->lock_gen--;
+    
+    flock(_bus->lock_fd, LOCK_UN);
+}
+
+/********************************************************************
+ * @brief select the bus before a transaction
+ * 
+ * Sets the slave address, the speed if an other SCD30 on the same bus 
+ * uses a different speed and the multiplexer channel (if any). The 
+ * multiplexer is only written if an other channel was selected last.
+ * 
+ * @return  true = OK, false is error 
+ ********************************************************************/
+bool SCD30::selectBus() {
+    
+    char ch;
+    
+    if (_bus == NULL) return(false);
+    
+    if (_bus->baudrate != settings.baudrate)
+    {
+        busClock(settings.baudrate);
+        _bus->baudrate = settings.baudrate;
+    }
+    
+    if (settings.mux_address != NO_MUX)
+    {
+        if (_bus->mux_address != settings.mux_address || _bus->mux_channel != settings.mux_channel)
+        {
+            if (SCD_DEBUG > 0)
+                p_printf(YELLOW, (char *) "select multiplexer 0x%x channel %d\n", settings.mux_address, settings.mux_channel);
+            
+            ch = 1 << settings.mux_channel;
+            busSlave(settings.mux_address);
+            
+            if (busWrite(&ch, 1) != I2C_OK)
+            {
+                if (SCD_DEBUG > 1) p_printf(RED, (char *) "multiplexer write error\n");
+                _bus->mux_address = NO_MUX;
+                _stats.write_errors++;
+                return(false);
+            }
+            
+            _bus->mux_address = settings.mux_address;
+            _bus->mux_channel = settings.mux_channel;
+        }
+    }
+    
+    busSlave(settings.I2C_Address);
+    
+    return(true);
 }
 
 // boolean isFahrenheit: True == Fahrenheit; False == Celcius
@@ -256,10 +603,10 @@ float SCD30::calc_dewpoint(float in_temperature, float hum, bool isFahrenheit) {
 uint16_t SCD30::getCO2(void) {
     
   /* trigger new read if needed */  
-  if (co2HasBeenReported == true) 
+  if (_co2HasBeenReported == true) 
     readMeasurement(); //Pull in new co2, humidity, and temp into global vars
 
-  co2HasBeenReported = true;
+  _co2HasBeenReported = true;
 
   return (uint16_t)_co2; //Cut off decimal as co2 is 0 to 10,000
 }
@@ -272,10 +619,10 @@ uint16_t SCD30::getCO2(void) {
 float SCD30::getHumidity(void) {
   
   /* trigger new read if needed */  
-  if (humidityHasBeenReported == true) 
+  if (_humidityHasBeenReported == true) 
     readMeasurement(); //Pull in new co2, humidity, and temp into global vars
 
-  humidityHasBeenReported = true;
+  _humidityHasBeenReported = true;
 
   return(_humidity);
 }
@@ -288,10 +635,10 @@ float SCD30::getHumidity(void) {
 float SCD30::getTemperature(void) {
   
   /* trigger new read if needed */    
-  if (temperatureHasBeenReported == true)
+  if (_temperatureHasBeenReported == true)
     readMeasurement(); //Pull in new co2, humidity, and temp into global vars
 
-  temperatureHasBeenReported = true;
+  _temperatureHasBeenReported = true;
 
   return(_temperature);
 }
@@ -323,7 +670,7 @@ bool SCD30::getSerialNumber(char *val) {
   // request from SCD30
   if (ReadFromSCD30(CMD_READ_SERIALNBR, (uint8_t *) val, SCD30_SERIAL_NUM_WORDS * 2) != SCD30_SERIAL_NUM_WORDS * 2) return(false);
 
-  val[(SCD30_SERIAL_NUM_WORDS * 2) + 1] = 0x0; // terminate
+  val[SCD30_SERIAL_NUM_WORDS * 2] = 0x0; // terminate
 
   return(true);
 }
@@ -339,39 +686,41 @@ bool SCD30::getSerialNumber(char *val) {
  */
 uint8_t SCD30::ReadFromSCD30(uint16_t command, uint8_t *val, uint8_t cnt)
 {
-    uint8_t buff[60],data[2];
-    int     x, y;
+    uint8_t buff[SCD30_ANSWER_MAX];
+    const scd30_cmd_desc *desc = scd30_cmd_find(command);
+    int     x;
+    
+    /* command and reading the answer is one batch on the bus */
+    if (! lockBus()) return(0);
 
-    if (! sendCommand(command) ) return(0);
+    if (! sendCommand(command) ) goto rd_error;
 
-    usleep (3); // datasheet may 2020
+    usleep (desc ? desc->wait_us : 3); // datasheet may 2020
            
     // start reading
-    if ( ! readbytes((char *) buff, (cnt / 2) *3) ) return(0);
+    if ( ! readbytes((char *) buff, (cnt / 2) *3) ) goto rd_error;
+    
+    unlockBus();
  
-    if (SCD_DEBUG > 0)  p_printf(YELLOW, (char *) "\nReceiving: " );
+    if (SCD_DEBUG > 0)
+    {
+      p_printf(YELLOW, (char *) "\nReceiving: " );
+      for (x = 0 ; x < (cnt / 2) *3 ; x++) printf("0x%02X ", buff[x]);
+      printf("\n");
+    }
     
-    for (x = 0, y = 0 ; x < (cnt / 2) *3 ; x++)
+    /* remove the CRC of each word (shared with the protocol layer) */
+    if ((x = scd30_unpack(buff, val, cnt)) > -1)
     {
-      if (SCD_DEBUG > 0) printf("0x%02X ", buff[x]);
-       
-      if (y == 2) {           // handle CRC
-          
-        if (! checkCrc(data, 2, buff[x])) return(0);
-        y = 0;
-       
-      }
-      else {                  // handle data
-        
-        *val++ = buff[x];
-        data[y++] = buff[x];
-
-       }
-     }
-        
-     if (SCD_DEBUG > 0) printf("\n");
+      checkCrc(&buff[x - 2], 2, buff[x]);     // statistics and trace
+      return(0);
+    }
 
      return(cnt);
+     
+rd_error:
+     unlockBus();
+     return(0);
 }
 
 /**********************************************************
@@ -385,8 +734,12 @@ uint8_t SCD30::ReadFromSCD30(uint16_t command, uint8_t *val, uint8_t cnt)
 bool SCD30::getSettingValue(uint16_t command, uint16_t *val)
 {
   uint8_t tmp[2];
+  const scd30_cmd_desc *desc = scd30_cmd_find(command);
   *val = 0;
 
+  // only for commands with a single word answer
+  if (desc == NULL || desc->words != 1) return(false);
+
   // request from SCD30
   if (ReadFromSCD30(command, tmp, 2) != 2) return(false);
 
@@ -395,6 +748,31 @@ bool SCD30::getSettingValue(uint16_t command, uint16_t *val)
   return(true);
 } 
 
+/**********************************************************
+ * @brief check the SCD30 is present
+ * 
+ * A firmware level read is the cheapest command that is always 
+ * answered, independent of the measurement state. It does not change
+ * anything on the SCD30.
+ * 
+ * @return
+ * true is SCD30 responded, false not present or bus not initialized
+ *********************************************************/
+bool SCD30::probe()
+{
+  uint16_t fw;
+  
+  if (_bus == NULL) return(false);
+  
+  _stats.probes++;
+  
+  if (getSettingValue(CMD_GET_FW_LEVEL, &fw)) return(true);
+  
+  _stats.probe_failures++;
+  
+  return(false);
+}
+
 /****************************************************************
  * @brief enables or disables the ASC See 1.3.6
  *
@@ -410,14 +788,15 @@ bool SCD30::getSettingValue(uint16_t command, uint16_t *val)
 bool SCD30::setAutoSelfCalibration(bool enable) {
     
     _asc = enable;
+    _burst_ready = false;
     
     if (_asc)
     {
-        return(sendCommand(COMMAND_AUTOMATIC_SELF_CALIBRATION, 1)); //Activate continuous ASC
+        return(send<SCD30_CMD_ASC, 1>()); //Activate continuous ASC
     }
     else
     {
-        return(sendCommand(COMMAND_AUTOMATIC_SELF_CALIBRATION, 0)); //Deactivate continuous ASC
+        return(send<SCD30_CMD_ASC, 0>()); //Deactivate continuous ASC
     }
 }
 
@@ -440,14 +819,10 @@ bool SCD30::setAutoSelfCalibration(bool enable) {
  *****************************************************************/
 bool SCD30::setTemperatureOffset(float tempOffset) {
   
-  /* can not be negative number */
-  if (tempOffset < 0) return(false);
-
-  int16_t tickOffset = tempOffset * 100;
-  
-  if (SCD_DEBUG > 0) p_printf(YELLOW,(char *) "set temperature offset %d\n",tickOffset);
+  /* can not be negative number (range check in send) */
+  if (SCD_DEBUG > 0) p_printf(YELLOW,(char *) "set temperature offset %d\n", (int16_t) (tempOffset * 100));
   
-  return (sendCommand(COMMAND_SET_TEMPERATURE_OFFSET, tickOffset));
+  return (send<SCD30_CMD_TEMP_OFFSET>(tempOffset));
 }
 
 /******************************************************************
@@ -465,10 +840,8 @@ bool SCD30::setTemperatureOffset(float tempOffset) {
  ***************************************************************/
 bool SCD30::setAltitudeCompensation(uint16_t altitude) {
     
-  // 700 mbar ~ 3040M altitude, 1200mbar ~ -1520
-  if (altitude < -1520 || altitude > 3040) return(false);
-  
-  return(sendCommand(COMMAND_SET_ALTITUDE_COMPENSATION, altitude));
+  // range check in send
+  return(send<SCD30_CMD_ALTITUDE>(altitude));
 }
 
 /***************************************************************
@@ -503,11 +876,10 @@ bool SCD30::setAmbientPressure(uint16_t pressure_mbar) {
  ******************************************************************/
 bool SCD30::setForceRecalibration(uint16_t val) {
 
-    if(val < 400 || val > 2000) return(false);   //Error check
-    
     if (SCD_DEBUG > 0) p_printf(YELLOW, (char *) "set forced calibration %d ppm\n", val);
 
-    return (sendCommand(COMMAND_SET_FORCED_RECALIBRATION_FACTOR, val));
+    // range check in send
+    return (send<SCD30_CMD_FRC>(val));
 }
 
 /*****************************************************************
@@ -525,12 +897,12 @@ bool SCD30::setForceRecalibration(uint16_t val) {
 bool SCD30::beginMeasuring(uint16_t pressureOffset) {
   
   /* Error check */ 
-  if(pressureOffset < 700 || pressureOffset > 1200) pressureOffset = 0; 
+  if (! scd30_cmd_valid(SCD30_CMD_START, pressureOffset)) pressureOffset = 0;
   
   if (SCD_DEBUG > 0) 
     p_printf(YELLOW, (char *) "Begin measuring with pressure offset %d\n", pressureOffset);
 
-  return(sendCommand(COMMAND_CONTINUOUS_MEASUREMENT, pressureOffset));
+  return(send<SCD30_CMD_START>(pressureOffset));
 }
 
 //Overload - no pressureOffset
@@ -549,10 +921,16 @@ bool SCD30::beginMeasuring(void) {
  *********************************************************************/
 bool SCD30::SoftReset(void) {
     
-  if (sendCommand(CMD_SOFT_RESET) != true) return(false);
+  bool ret;
+  
+  _stats.soft_resets++;
   
   // reload parameters
-  return( begin_scd30() );
+  ret = send<SCD30_CMD_SOFT_RESET>() && begin_scd30();
+  
+  SCD30_TRACE1(soft_reset, ret);
+  
+  return(ret);
 }
 
 /*******************************************************************
@@ -566,7 +944,7 @@ bool SCD30::SoftReset(void) {
  * 
  *********************************************************************/
 bool SCD30::StopMeasurement(void) {
-  return(sendCommand(CMD_STOP_MEAS));
+  return(send<SCD30_CMD_STOP>());
 }
 
 /*******************************************************************
@@ -577,7 +955,7 @@ bool SCD30::StopMeasurement(void) {
  ******************************************************************/
 bool SCD30::setMeasurementInterval(uint16_t interval) {
     
-  if (interval < 2 || interval > 1800) 
+  if (! scd30_cmd_valid(SCD30_CMD_INTERVAL, interval)) 
   {
     if (SCD_DEBUG > 0) p_printf(RED, (char *) "invalid measurement interval %d\n", interval);
     return(false);
@@ -585,8 +963,9 @@ bool SCD30::setMeasurementInterval(uint16_t interval) {
 
   // save new setting
   _interval = interval;
+  _burst_ready = false;
 
-  return(sendCommand(COMMAND_SET_MEASUREMENT_INTERVAL, _interval));
+  return(send<SCD30_CMD_INTERVAL>(_interval));
 }
 
 /****************************************************************
@@ -618,6 +997,7 @@ bool SCD30::setMeasurementInterval(uint16_t interval) {
  *  stop continuous
  * 
  * it will take max. 4 seconds for the first result !
+ * (October 2026 : done with a Burst() of one sample)
  * 
  * The user program should NOT check for data_available(), but
  * get the CO2, temperature and humidity upon a return of true
@@ -631,48 +1011,197 @@ bool SCD30::StartSingleMeasurement(void) {
      /* see remark above */
     //return(sendCommand(CMD_START_SINGLE_MEAS, 0x0000));
   
-    int retry = 10;
-    bool stat = false;
+    return(Burst(1, BURST_LAST, NULL));
+}
+
+/*********************************************************************
+ * @brief get monotonic time in milli seconds
+ *********************************************************************/
+static uint64_t burst_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return((uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/*********************************************************************
+ * @brief reduce the samples of a burst
+ * @param val : samples
+ * @param num : number of samples
+ * @param reduce : how to reduce
+ *********************************************************************/
+static float burst_reduce_val(float *val, uint8_t num, burst_reduce reduce)
+{
+    float   s[BURST_MAX], t, sum = 0;
+    uint8_t i, j;
     
-    /* save current ASC and interval setting */
-    bool save_asc = _asc;
-    uint16_t save_interval = _interval;
+    if (reduce == BURST_AVERAGE)
+    {
+        for (i = 0; i < num; i++) sum += val[i];
+        return(sum / num);
+    }
     
-    /* start continuous */
-    _asc = false;
-    _interval = 2;
+    if (reduce == BURST_MEDIAN)
+    {
+        /* insertion sort, a burst is short */
+        for (i = 0; i < num; i++)
+        {
+            t = val[i];
+            for (j = i; j > 0 && s[j - 1] > t; j--) s[j] = s[j - 1];
+            s[j] = t;
+        }
+        
+        if (num & 1) return(s[num / 2]);
+        return((s[num / 2 - 1] + s[num / 2]) / 2);
+    }
     
-    if (! begin_scd30() )  goto stop_sm;
+    return(val[num - 1]);
+}
 
-    /* wait for max x times for data available from SCD30 */
-    do
+/*********************************************************************
+ * @brief perform a burst of measurements
+ * @param num : number of samples (1 - BURST_MAX)
+ * @param reduce : how to reduce the samples
+ * @param b : to store the samples and timing (can be NULL)
+ *
+ * Polling starts 1/8 of the expected time before the sample is
+ * expected. The spacing grows with BURST_POLL_MIN on each miss, so a
+ * sample is read shortly after it became ready. The expected time to
+ * the first sample is learned from the earlier bursts.
+ * 
+ * @return  true = OK, false is error 
+ *********************************************************************/
+bool SCD30::Burst(uint8_t num, burst_reduce reduce, scd30_burst *b)
+{
+    scd30_burst tmp;
+    uint64_t start, now, due, poll;
+    uint32_t spacing = BURST_POLL_MIN;
+    bool    save_asc = _asc, stat;
+    uint16_t save_interval = _interval;
+    
+    if (b == NULL) b = &tmp;
+    
+    memset(b, 0x0, sizeof(scd30_burst));
+    
+    if (num < 1 || num > BURST_MAX) return(false);
+    
+    start = burst_ms();
+    
+    /* configured before : only start */
+    if (_burst_ready) stat = beginMeasuring();
+    else
     {
-        // check for data
-        stat = dataAvailable();
+        _asc = false;
+        _interval = 2;
         
-        // if not available
-        if (stat == false)  
+        stat = begin_scd30();
+        
+        /* restore requested settings (for a next begin) */
+        _asc = save_asc;
+        _interval = save_interval;
+        
+        b->configured = true;
+        _burst_ready = stat;
+    }
+    
+    if (! stat) goto stop_burst;
+    
+    due = start + _burst_first;
+    poll = due - _burst_first / 8;
+    
+    while (b->count < num)
+    {
+        now = burst_ms();
+        
+        if (now < poll)
         {
-            sleep(1);
-            
-            if (retry-- == 0) goto stop_sm;
+            usleep((poll - now) * 1000);
+            continue;
+        }
+        
+        if (now > due + BURST_TIMEOUT)
+        {
+            stat = false;
+            goto stop_burst;
+        }
+        
+        b->polls++;
+        
+        if (! dataAvailable())
+        {
+            if (spacing < BURST_POLL_MAX) spacing += BURST_POLL_MIN;
+            poll = now + spacing;
+            continue;
         }
         
-    } while (stat == false);
+        if (! readValues())
+        {
+            stat = false;
+            goto stop_burst;
+        }
+        
+        b->co2[b->count] = _co2;
+        b->temperature[b->count] = _temperature;
+        b->humidity[b->count] = _humidity;
+        
+        /* learn the time to the first sample */
+        if (b->count++ == 0)
+        {
+            b->first_ms = now - start;
+            _burst_first = (_burst_first * 3 + b->first_ms) / 4;
+        }
+        
+        due = now + BURST_PERIOD;
+        poll = due - BURST_PERIOD / 8;
+        spacing = BURST_POLL_MIN;
+    }
     
-    /* if data available, read it */    
-    if (stat == true) stat = readMeasurement();
-
-stop_sm:
+    _co2 = burst_reduce_val(b->co2, b->count, reduce);
+    _temperature = burst_reduce_val(b->temperature, b->count, reduce);
+    _humidity = burst_reduce_val(b->humidity, b->count, reduce);
+    
+    _co2HasBeenReported = false;
+    _humidityHasBeenReported = false;
+    _temperatureHasBeenReported = false;
+    
+stop_burst:
+    
+    /* stop measurement : shortest on-time */
+    if (! StopMeasurement()) stat = false;
+    
+    b->on_ms = burst_ms() - start;
     
-    /* stop measurement and restore */
-    StopMeasurement();   
-    _asc = save_asc;
-    _interval = save_interval;
-
     return(stat);
 }
 
+/****************************************************************
+ * @brief read the latest measurement without checking data ready
+ * @param co2 : to store CO2 in ppm
+ * @param temperature : to store temperature in *C
+ * @param humidity : to store relative humidity in %
+ * 
+ * The values are marked as reported : a next getCO2() etc. 
+ * will read a new measurement.
+ * 
+ * @return true if OK, false in case of error
+ ****************************************************************/
+bool SCD30::getMeasurement(float *co2, float *temperature, float *humidity) {
+    
+  if (! readValues()) return(false);
+  
+  *co2 = _co2;
+  *temperature = _temperature;
+  *humidity = _humidity;
+  
+  _co2HasBeenReported = true;
+  _humidityHasBeenReported = true;
+  _temperatureHasBeenReported = true;
+  
+  return(true);
+}
+
 /****************************************************************
  * @brief checks the data ready status register. see 1.3.4
  * 
@@ -684,10 +1213,12 @@ bool SCD30::dataAvailable() {
   uint8_t tmp[2];
 
   // request from SCD30
-  if (ReadFromSCD30(COMMAND_GET_DATA_READY, tmp, 2) != 2) return(false);
+  if (! read<SCD30_CMD_DATA_READY>(tmp)) return(false);
 
   if (tmp[1] == 1) return(true);
 
+  _stats.not_ready++;
+  
   return (false);
 }
 
@@ -706,48 +1237,54 @@ bool SCD30::dataAvailable() {
 bool SCD30::readbytes(char *buff, uint8_t len) {
     
     Wstatus result;
-    int retry = 3;
+    BusTransport bus(this);
+    uint32_t us;
+    struct timespec start;
     
     /* set slave address for SCD30 */
-    TWI.setSlave(settings.I2C_Address);
+    if (! selectBus()) return(false);
     
     if (SCD_DEBUG > 0)
        p_printf(YELLOW, (char *) "read from I2C address 0x%x, %d bytes\n",settings.I2C_Address, len);
+    
+    _stats.reads++;
+    
+    /* same budget as the command that is answered */
+    stretchSet();
+    
+    clock_gettime(CLOCK_MONOTONIC, &start);
       
-    while(1)
-    {
-        /* read results from I2C */
-        result = TWI.i2c_read(buff, len);
-        
-        /* if failure, then retry as long as retrycount has not been reached */
-        if (result != I2C_OK)
-        {
-            if (SCD_DEBUG > 1) p_printf(YELLOW, (char *) " read retrying. result %d\n", result);
-            if (retry-- > 0) continue;
-        }
+    /* read results from I2C, retry on failure (not on a stretch timeout) */
+    result = scd30_retry(bus, true, buff, len, &_stats.retries, true);
+    
+    if (result != I2C_OK) _stats.read_errors++;
+    
+    us = timeTransaction(&start);
+    stretchDone(us, result);
+    SCD30_TRACE3(read_done, len, result, us);
  
-        /* process result */
-        switch(result)
-        {
-            case I2C_OK:
-                return(true);
-                
-            case I2C_SDA_NACK :
-                if (SCD_DEBUG > 1) p_printf(RED, (char *) "Read NACK error\n");
-                return(false);
+    /* process result */
+    switch(result)
+    {
+        case I2C_OK:
+            return(true);
+            
+        case I2C_SDA_NACK :
+            if (SCD_DEBUG > 1) p_printf(RED, (char *) "Read NACK error\n");
+            _stats.nack_errors++;
+            return(false);
     
-            case I2C_SCL_CLKSTR :
-                if (SCD_DEBUG > 1) p_printf(RED, (char *) "Read Clock stretch error\n");
-                return(false);
-                
-            case I2C_SDA_DATA :
-                if (SCD_DEBUG > 1) p_printf(RED, (char *) "not all data has been read\n");
-                return(false);
-                
-            default:
-                if (SCD_DEBUG > 1) p_printf(RED, (char *) "unkown return code\n");
-                return(false);
-        }
+        case I2C_SCL_CLKSTR :
+            if (SCD_DEBUG > 1) p_printf(RED, (char *) "Read Clock stretch error\n");
+            return(false);
+            
+        case I2C_SDA_DATA :
+            if (SCD_DEBUG > 1) p_printf(RED, (char *) "not all data has been read\n");
+            return(false);
+            
+        default:
+            if (SCD_DEBUG > 1) p_printf(RED, (char *) "unkown return code\n");
+            return(false);
     }
 }
 
@@ -768,6 +1305,8 @@ bool SCD30::checkCrc(uint8_t *data, uint8_t len, uint8_t crc_rec) {
       if (crc_rec != crc)
       {
         if (SCD_DEBUG > 1) p_printf(RED, (char *) "crc error: expected %x, got %x\n", crc, crc_rec);
+        _stats.crc_errors++;
+        SCD30_TRACE2(crc_error, crc, crc_rec);
         return(false);
       } 
       
@@ -784,16 +1323,27 @@ bool SCD30::checkCrc(uint8_t *data, uint8_t len, uint8_t crc_rec) {
  ****************************************************************/
 bool SCD30::readMeasurement(){
     
+    /* Verify we have data from the sensor */
+    if (! dataAvailable() )   return (false);
+    
+    return(readValues());
+}
+
+/****************************************************************
+ * @brief read CO2, Temperature and humidity without checking 
+ * data ready first.
+ * 
+ * @return true if OK, false in case of error
+ ****************************************************************/
+bool SCD30::readValues(){
+    
     uint32_t tempCO2 = 0;
     uint32_t tempHumidity = 0;
     uint32_t tempTemperature = 0;
     uint8_t  temp[12];
 
-    /* Verify we have data from the sensor */
-    if (! dataAvailable() )   return (false);
-    
     // request from SCD30
-    if (ReadFromSCD30(COMMAND_READ_MEASUREMENT, temp, 12) != 12) return(false);
+    if (! read<SCD30_CMD_READ_MEAS>(temp)) return(false);
   
     tempCO2 = temp[0] << 24 | temp[1] << 16 | temp[2] << 8 | temp[3];
     tempTemperature = temp[4] << 24 | temp[5] << 16 | temp[6] << 8 | temp[7];
@@ -804,10 +1354,14 @@ bool SCD30::readMeasurement(){
     memcpy(&_temperature, &tempTemperature, sizeof(_temperature));
     memcpy(&_humidity, &tempHumidity, sizeof(_humidity));
   
+    _stats.samples++;
+    
+    SCD30_TRACE3(sample, (int32_t) (_co2 * 100), (int32_t) (_temperature * 100), (int32_t) (_humidity * 100));
+    
     /* Mark our global variables as fresh */
-    co2HasBeenReported = false;
-    humidityHasBeenReported = false;
-    temperatureHasBeenReported = false;
+    _co2HasBeenReported = false;
+    _humidityHasBeenReported = false;
+    _temperatureHasBeenReported = false;
     
     return (true); //Success! New data available in globals.
 }
@@ -827,8 +1381,7 @@ void SCD30::setDebug(int val) {
     SCD_DEBUG = val;
     
     // if level 2 enable I2C driver messages
-    if (SCD_DEBUG == 2) TWI.setDebug(true);
-    else TWI.setDebug(false);
+    if (_bus && ! _bus->engine && ! _bus->modbus && ! _bus->emul) _bus->twi.setDebug(SCD_DEBUG == 2);
     
 }
 
@@ -838,60 +1391,220 @@ void SCD30::setDebug(int val) {
  *******************************************************/
 void SCD30::debug_cmd(uint16_t command) {
     
-    p_printf(YELLOW, (char *) "Command 0x%04x : ", command);
+    const scd30_cmd_desc *desc = scd30_cmd_find(command);
+    
+    p_printf(YELLOW, (char *) "Command 0x%04x : %s", command, desc ? desc->name : "COMMAND_UNKNOWN");
+}
+
+/**************************************************
+ * @brief Display the clock stretch info for debug
+ **************************************************/
+void SCD30::DispClockStretch() {
+    
+    struct gpio_stats *st;
+    struct modbus_stats *mb;
+    
+    if (_bus == NULL) return;
+    
+    if (_bus->emul) {
+        p_printf(YELLOW, (char *) "emulated SCD30 %u writes, %u reads, %u NACK\n",
+            _bus->emul->writes, _bus->emul->reads, _bus->emul->nacks);
+        return;
+    }
+    
+    if (_bus->modbus) {
+        mb = &_bus->mb.stats;
+        p_printf(YELLOW, (char *) "Modbus %u requests, %u exceptions, %u timeouts, %u CRC errors, %u not supported, answer avg %lu uS max %u uS\n",
+            mb->requests, mb->exceptions, mb->timeouts, mb->crc_errors, mb->unsupported,
+            (unsigned long) (mb->requests ? mb->wait_us / mb->requests : 0), mb->wait_max);
+        return;
+    }
+    
+    if (! _bus->engine) {
+        _bus->twi.DispClockStretch();
+        return;
+    }
+    
+    st = &_bus->soft.stats;
+    p_printf(YELLOW, (char *) "clock stretched %u times, longest %u uS, %u sleeps, %u timeouts\n",
+        st->stretches, st->stretch_max, st->naps, st->stretch_timeouts);
+}
+
+/**************************************************
+ * @brief I2C through twowire, the built-in engine, Modbus or to an
+ * emulated SCD30
+ **************************************************/
+Wstatus SCD30::busWrite(const char *buf, uint32_t len) {
+    if (_bus->emul) return(emul_write(_bus->emul, buf, len));
+    if (_bus->modbus) return(_bus->mb.write(buf, len));
+    if (_bus->engine) return(_bus->soft.i2c_write(buf, len));
+    return(_bus->twi.i2c_write((char *) buf, len));
+}
 
-    switch(command)
+Wstatus SCD30::busRead(char *buf, uint32_t len) {
+    if (_bus->emul) return(emul_read(_bus->emul, buf, len));
+    if (_bus->modbus) return(_bus->mb.read(buf, len));
+    if (_bus->engine) return(_bus->soft.i2c_read(buf, len));
+    return(_bus->twi.i2c_read(buf, len));
+}
+
+/**************************************************
+ * @brief set up the pins again after an other program used the bus
+ * 
+ * An other program can leave the pins in an other function (closing 
+ * hard_I2C returns SDA / SCL to input). Modbus and an emulated SCD30
+ * have no pins to set up.
+ **************************************************/
+bool SCD30::busReopen() {
+    if (_bus->modbus || _bus->emul) return(true);
+    
+    if (_bus->engine) {
+        _bus->soft.close();
+        if (! _bus->soft.begin(_bus->sda, _bus->scl)) return(false);
+        if (settings.pullup) _bus->soft.setPullup();
+        return(true);
+    }
+    
+    _bus->twi.close();
+    if (settings.pullup) _bus->twi.setPullup();
+    return(_bus->twi.begin(_bus->I2C_interface, _bus->sda, _bus->scl) == TW_SUCCESS);
+}
+
+void SCD30::busSlave(uint8_t address) {
+    if (_bus->modbus || _bus->emul) return;
+    if (_bus->engine) _bus->soft.setSlave(address);
+    else _bus->twi.setSlave(address);
+}
+
+void SCD30::busClock(uint16_t khz) {
+    if (_bus->modbus || _bus->emul) return;
+    if (_bus->engine) _bus->soft.setClock(khz);
+    else _bus->twi.setClock(khz);
+}
+
+void SCD30::busStretch(uint32_t us) {
+    if (_bus->modbus || _bus->emul) return;
+    if (_bus->engine) _bus->soft.setClockStretchLimit(us);
+    else _bus->twi.setClockStretchLimit(us);
+}
+
+/**************************************************
+ * @brief add a transaction time to the statistics
+ * @param start : start time of transaction
+ * 
+ * @return transaction time in uS
+ **************************************************/
+uint32_t SCD30::timeTransaction(struct timespec *start) {
+    
+    struct timespec now;
+    uint32_t us;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    us = (now.tv_sec - start->tv_sec) * 1000000 + (now.tv_nsec - start->tv_nsec) / 1000;
+    
+    _stats.tr_count++;
+    _stats.tr_sum += us;
+    _stats.tr_sumsq += (uint64_t) us * us;
+    if (us < _stats.tr_min) _stats.tr_min = us;
+    if (us > _stats.tr_max) _stats.tr_max = us;
+    
+    return(us);
+}
+
+/**************************************************
+ * @brief set the clock stretch limit for the command in progress
+ * 
+ * The limit is kept per bus, twowire is only called when it changes
+ * (e.g. between a quick data ready and a forced recalibration).
+ **************************************************/
+void SCD30::stretchSet() {
+    
+    uint32_t limit = _stretch_cmd < 0 ? STRETCH_MAX : _stretch[_stretch_cmd].budget;
+    
+    if (_bus->stretch == limit) return;
+    
+    if (SCD_DEBUG > 1) p_printf(YELLOW, (char *) "clock stretch limit %u uS\n", limit);
+    
+    busStretch(limit);
+    _bus->stretch = limit;
+}
+
+/**************************************************
+ * @brief add a transaction to the clock stretch budget
+ * @param us : transaction time
+ * @param result : twowire status
+ * 
+ * A stretch timeout doubles the budget for the next attempt. Every 
+ * STRETCH_ADAPT transactions the budget is set to STRETCH_MARGIN times 
+ * the upper bound of the histogram bucket that holds STRETCH_PERMILLE
+ * of the transactions, not lower than the table (scd30_cmd.h) and not 
+ * higher than STRETCH_MAX. The histogram is then halved, so a long 
+ * stretch once a day does not keep the budget high.
+ **************************************************/
+void SCD30::stretchDone(uint32_t us, Wstatus result) {
+    
+    scd30_stretch *st;
+    uint32_t budget, n = 0, sum = 0;
+    int i;
+    
+    if (_stretch_cmd < 0) return;
+    
+    st = &_stretch[_stretch_cmd];
+    
+    if (result == I2C_SCL_CLKSTR)
     {
-        case 0x0010:
-            p_printf(YELLOW, (char *)"COMMAND_CONTINUOUS_MEASUREMENT");
-            break;
-        case 0x0104:
-            p_printf(YELLOW, (char *)"CMD_STOP_MEAS");
-            break;
-        case 0x4600:
-            p_printf(YELLOW, (char *)"COMMAND_SET_MEASUREMENT_INTERVAL");
-            break;
-        case 0x0202:
-            p_printf(YELLOW, (char *)"COMMAND_GET_DATA_READY");
-            break;
-        case 0x300:
-            p_printf(YELLOW, (char *)"COMMAND_READ_MEASUREMENT");
-            break;
-        case 0x5306:
-            p_printf(YELLOW, (char *)"COMMAND_AUTOMATIC_SELF_CALIBRATION");
-            break;
-        case 0x5204:
-            p_printf(YELLOW, (char *)"COMMAND_SET_FORCED_RECALIBRATION_FACTOR");
-            break;
-        case 0x5403:
-            p_printf(YELLOW, (char *)"COMMAND_SET_TEMPERATURE_OFFSET");
-            break;
-        case 0x5102:
-            p_printf(YELLOW, (char *)"COMMAND_SET_ALTITUDE_COMPENSATION");
-            break;
-        case 0xD033:
-            p_printf(YELLOW, (char *)"CMD_READ_SERIALNBR");
-            break;
-        case 0xD025:
-            p_printf(YELLOW, (char *)"CMD_READ_ARTICLECODE");
-            break;
-        case 0x0006:
-            p_printf(YELLOW, (char *)"CMD_START_SINGLE_MEAS");
-            break;
-        case 0xD100:
-            p_printf(YELLOW, (char *)"CMD_GET_FW_LEVEL");
-            break;
-        default:
-            p_printf(YELLOW, (char *)"COMMAND_UNKNOWN");
-            break;
+        st->timeouts++;
+        _stats.stretch_timeouts++;
+        budget = st->budget * 2 > STRETCH_MAX ? STRETCH_MAX : st->budget * 2;
     }
+    else
+    {
+        i = us ? 31 - __builtin_clz(us) : 0;
+        st->hist[i < STRETCH_BUCKETS ? i : STRETCH_BUCKETS - 1]++;
+        
+        if (++st->count % STRETCH_ADAPT) return;
+        
+        for (i = 0; i < STRETCH_BUCKETS; i++) n += st->hist[i];
+        
+        for (i = 0; i < STRETCH_BUCKETS - 1; i++)
+        {
+            sum += st->hist[i];
+            if ((uint64_t) sum * 1000 >= (uint64_t) n * STRETCH_PERMILLE) break;
+        }
+        
+        budget = (2U << i) * STRETCH_MARGIN;
+        
+        if (budget < scd30_cmds[_stretch_cmd].stretch_us) budget = scd30_cmds[_stretch_cmd].stretch_us;
+        if (budget > STRETCH_MAX) budget = STRETCH_MAX;
+        
+        for (i = 0; i < STRETCH_BUCKETS; i++) st->hist[i] /= 2;
+    }
+    
+    if (budget == st->budget) return;
+    
+    if (SCD_DEBUG > 0) p_printf(YELLOW, (char *) "%s : clock stretch budget %u -> %u uS\n",
+        scd30_cmds[_stretch_cmd].name, st->budget, budget);
+    
+    st->budget = budget;
+    _stats.stretch_changes++;
 }
 
 /**************************************************
- * @brief Display the clock stretch info for debug
+ * @brief obtain the clock stretch budget of a command
+ * @param id : command
+ * @param st : to store the budget
  **************************************************/
-void SCD30::DispClockStretch() {
-    TWI.DispClockStretch();
+void SCD30::getStretch(scd30_cmd_id id, scd30_stretch *st) {
+    memcpy(st, &_stretch[id], sizeof(scd30_stretch));
+}
+
+/**************************************************
+ * @brief obtain the driver statistics
+ * @param st : to store the statistics
+ **************************************************/
+void SCD30::getStats(scd30_stats *st) {
+    memcpy(st, &_stats, sizeof(scd30_stats));
 }
 
 /*******************************************************
@@ -903,7 +1616,16 @@ void SCD30::DispClockStretch() {
  * @return true if OK, false in case of error
  ********************************************************/
 bool SCD30::sendCommand(uint16_t command, uint16_t arguments) {
-    return(sendCommand(command, arguments, 5));
+    
+    bool ret;
+    
+    if (! lockBus()) return(false);
+    
+    ret = sendCommand(command, arguments, 5);
+    
+    unlockBus();
+    
+    return(ret);
 }
 
 /**********************************************************
@@ -914,7 +1636,16 @@ bool SCD30::sendCommand(uint16_t command, uint16_t arguments) {
  * @return true if OK, false in case of error
  **********************************************************/
 bool SCD30::sendCommand(uint16_t command) {
-    return(sendCommand(command, 0x0, 2));
+    
+    bool ret;
+    
+    if (! lockBus()) return(false);
+    
+    ret = sendCommand(command, 0x0, 2);
+    
+    unlockBus();
+    
+    return(ret);
 }
 
 /*******************************************************
@@ -931,11 +1662,20 @@ bool SCD30::sendCommand(uint16_t command) {
 bool SCD30::sendCommand(uint16_t command, uint16_t arguments, uint8_t len)
 {
     uint8_t buff[5];
-    int retry = 3, x;
+    int x;
+    uint32_t us;
     Wstatus result;
+    BusTransport bus(this);
+    struct timespec start;
+    const scd30_cmd_desc *desc;
     
     /* set slave address for SCD30 */
-    TWI.setSlave(settings.I2C_Address);
+    if (! selectBus()) return(false);
+    
+    /* clock stretch budget of this command (and the read of the answer) */
+    desc = scd30_cmd_find(command);
+    _stretch_cmd = desc ? desc - scd30_cmds : -1;
+    stretchSet();
 
     buff[0] = (command >> 8); //MSB
     buff[1] = (command & 0xFF); //LSB
@@ -961,39 +1701,42 @@ bool SCD30::sendCommand(uint16_t command, uint16_t arguments, uint8_t len)
        printf("\n");
     }
     
-    while (1)
-    {
-        // perform a write of data
-        result = TWI.i2c_write((char *) buff, len);
+    _stats.commands++;
     
-        // if error, perform retry (if not exceeded)
-        if (result != I2C_OK)
-        {
-            if (SCD_DEBUG > 1) printf(" send retrying %d\n", result);
-            if (retry-- > 0) continue;
-        }
+    SCD30_TRACE2(cmd_entry, command, len);
+    
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    // perform a write of data, retry on error (not on a stretch timeout)
+    result = scd30_retry(bus, false, (char *) buff, len, &_stats.retries, true);
+    
+    if (result != I2C_OK) _stats.write_errors++;
+    
+    us = timeTransaction(&start);
+    stretchDone(us, result);
+    SCD30_TRACE4(cmd_exit, command, len, result, us);
   
-        switch(result)
-        {
-            case I2C_OK:
-                return(true);
-            
-            case I2C_SDA_NACK :
-                if (SCD_DEBUG > 1) p_printf(RED, (char *) "write NACK error\n");
-                return(false);
-
-            case I2C_SCL_CLKSTR :
-                if (SCD_DEBUG > 1) p_printf(RED, (char *) "write Clock stretch error\n");
-                return(false);
-
-            case I2C_SDA_DATA :
-                if (SCD_DEBUG > 1) p_printf(RED, (char *) "write not all data has been sent\n");
-                return(false);
-
-            default :
-                if (SCD_DEBUG > 1) p_printf(RED, (char *) "Unkown error during writing\n");
-                return(false);
-        }
+    switch(result)
+    {
+        case I2C_OK:
+            return(true);
+        
+        case I2C_SDA_NACK :
+            if (SCD_DEBUG > 1) p_printf(RED, (char *) "write NACK error\n");
+            _stats.nack_errors++;
+            return(false);
+
+        case I2C_SCL_CLKSTR :
+            if (SCD_DEBUG > 1) p_printf(RED, (char *) "write Clock stretch error\n");
+            return(false);
+
+        case I2C_SDA_DATA :
+            if (SCD_DEBUG > 1) p_printf(RED, (char *) "write not all data has been sent\n");
+            return(false);
+
+        default :
+            if (SCD_DEBUG > 1) p_printf(RED, (char *) "Unkown error during writing\n");
+            return(false);
     }
 }
 
@@ -1013,22 +1756,8 @@ bool SCD30::sendCommand(uint16_t command, uint16_t arguments, uint8_t len)
  ***********************************************************************/
 uint8_t SCD30::computeCRC8(uint8_t data[], uint8_t len) {
     
-  uint8_t crc = 0xFF; //Init with 0xFF
-
-  for (uint8_t x = 0 ; x < len ; x++)
-  {
-    crc ^= data[x]; // XOR-in the next input byte
-
-    for (uint8_t i = 0 ; i < 8 ; i++)
-    {
-      if ((crc & 0x80) != 0)
-        crc = (uint8_t)((crc << 1) ^ 0x31);
-      else
-        crc <<= 1;
-    }
-  }
-
-  return crc; //No output reflection
+  /* shared with the protocol layer and emulator */
+  return(scd30_crc8(data, len));
 }
 
 /*********************************************************************
@@ -1037,18 +1766,16 @@ uint8_t SCD30::computeCRC8(uint8_t data[], uint8_t len) {
  *                 same as printf
  * @param level :  1 = RED, 2 = GREEN, 3 = YELLOW 4 = BLUE 5 = WHITE
  * 
- * if NoColor was set, output is always WHITE.
+ * if NoColor was set, output is always WHITE. No memory is allocated :
+ * a format that does not fit the buffer is shown without color.
  *********************************************************************/
 void p_printf(int level, char *format, ...) {
     
-    char    *col;
+    char    col[MAXBUF * 4];
     int     coll=level;
     va_list arg;
     
-    //allocate memory
-    col = (char *) malloc(strlen(format) + 20);
-    
-    if (NoColor) coll = WHITE;
+    if (NoColor || strlen(format) + 20 > sizeof(col)) coll = WHITE;
                 
     switch(coll)
     {
@@ -1065,15 +1792,12 @@ void p_printf(int level, char *format, ...) {
         sprintf(col,BLUSTR, format);
         break;
     default:
-        sprintf(col,"%s",format);
+        col[0] = 0x0;
     }
 
     va_start (arg, format);
-    vfprintf (stdout, col, arg);
+    vfprintf (stdout, col[0] ? col : format, arg);
     va_end (arg);
 
     fflush(stdout);
-
-    // release memory
-    free(col);
 }
@@ -0,0 +1,742 @@
+/*******************************************************************
+ *
+ * SCD30 on Modbus RTU over UART : transport, pty emulator and check.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "SCD30.h"
+# include "scd30_modbus.h"
+# include "scd30_emul.h"
+# include "scd30_proto.h"
+# include "scd30_fleet.h"
+# include "scd30_ident.h"
+# include <errno.h>
+# include <fcntl.h>
+# include <poll.h>
+
+/* emulated SCD30 and driver for modbus_check() */
+static struct scd30_emul mb_emul;
+static struct modbus_emul mb_pty;
+static SCD30 mb_dev;
+static struct fleet_conf mb_conf;
+static struct fleet_opt mb_opt;
+
+/*********************************************************************
+ * @brief uS since a time
+ *********************************************************************/
+static uint32_t modbus_us(struct timespec *t)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return((now.tv_sec - t->tv_sec) * 1000000 + (now.tv_nsec - t->tv_nsec) / 1000);
+}
+
+/*********************************************************************
+ * @brief set a serial port raw 8N1 at speed (as the Dylos port)
+ * @param fd : open port
+ * @param speed : B19200 etc.
+ * @param old : to store the current settings (NULL = not needed)
+ *
+ * @return true = OK, false is error
+ *********************************************************************/
+static bool modbus_serial(int fd, speed_t speed, struct termios *old)
+{
+    struct termios options;
+
+    if (tcgetattr(fd, &options) < 0) return(false);
+    if (old) *old = options;
+
+    cfsetispeed(&options, speed);
+    cfsetospeed(&options, speed);
+
+    options.c_cflag &= ~CSIZE;
+    options.c_cflag |= CS8;             // 8 bit
+    options.c_cflag &= ~CSTOPB;         // 1 stopbit
+    options.c_cflag &= ~CRTSCTS;        // no flow control
+    options.c_cflag &= ~PARENB;         // no parity
+
+    options.c_iflag &= ~(IXON | IXOFF); // no flow control
+
+    /* reads are done after poll() */
+    options.c_cc[VMIN] = 0;
+    options.c_cc[VTIME] = 0;
+
+    options.c_cflag |= CREAD | CLOCAL;  // turn on READ & ignore ctrl lines
+    options.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
+    options.c_iflag &= ~(ISTRIP | IGNCR | INLCR | ICRNL | IGNBRK | BRKINT | PARMRK);
+
+    options.c_oflag &= ~(OPOST);
+
+    return(tcsetattr(fd, TCSANOW, &options) == 0);
+}
+
+/*********************************************************************
+ * @brief open and configure the serial port
+ * @param port : device (e.g. /dev/ttyUSB0)
+ *
+ * @return true = OK, false is error
+ *********************************************************************/
+bool ModbusTransport::open(const char *port)
+{
+    if (fd > -1) return(true);
+
+    if ((fd = ::open(port, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC)) < 0)
+    {
+        p_printf(RED, (char *) "Can not open %s : %s\n", port, strerror(errno));
+        return(false);
+    }
+
+    if (! modbus_serial(fd, MODBUS_BAUD, &old))
+    {
+        p_printf(RED, (char *) "Can not configure %s : %s\n", port, strerror(errno));
+        ::close(fd);
+        fd = -1;
+        return(false);
+    }
+
+    /* flush any pending input or output data */
+    tcflush(fd, TCIOFLUSH);
+
+    reg = count = 0;
+    clock_gettime(CLOCK_MONOTONIC, &last);
+
+    return(true);
+}
+
+/*********************************************************************
+ * @brief restore the port settings and close
+ *********************************************************************/
+void ModbusTransport::close()
+{
+    if (fd < 0) return;
+
+    tcsetattr(fd, TCSANOW, &old);
+    ::close(fd);
+
+    fd = -1;
+}
+
+/*********************************************************************
+ * @brief receive an answer frame
+ * @param ans : to store the frame
+ * @param len : to store the length
+ *
+ * The length follows from the function code (and byte count).
+ *
+ * @return true = complete, false is timeout
+ *********************************************************************/
+bool ModbusTransport::receive(uint8_t *ans, uint32_t *len)
+{
+    struct pollfd pfd;
+    struct timespec start;
+    uint32_t got = 0, need = 5, us;
+    int     r;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while (got < need)
+    {
+        us = modbus_us(&start);
+        if (us >= MODBUS_TIMEOUT * 1000) break;
+
+        r = poll(&pfd, 1, MODBUS_TIMEOUT - us / 1000);
+
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+
+        if ((r = ::read(fd, &ans[got], need - got)) <= 0)
+        {
+            if (r < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+            break;
+        }
+
+        got += r;
+
+        /* length from the header */
+        if (got >= 3)
+        {
+            if (ans[1] & MODBUS_EXCEPTION) need = 5;
+            else if (ans[1] == MODBUS_WRITE_SINGLE) need = 8;
+            else need = ans[2] + 5 < MODBUS_FRAME ? ans[2] + 5 : MODBUS_FRAME;
+        }
+    }
+
+    *len = got;
+    return(got == need);
+}
+
+/*********************************************************************
+ * @brief send a request and receive the answer
+ * @param func : function code
+ * @param reg : register
+ * @param val : value to write or number of registers to read
+ * @param ans : to store the answer frame
+ * @param len : to store the length
+ *
+ * @return I2C_OK, I2C_SDA_NACK (exception, no answer) or I2C_SDA_DATA
+ *********************************************************************/
+Wstatus ModbusTransport::request(uint8_t func, uint16_t reg, uint16_t val, uint8_t *ans, uint32_t *len)
+{
+    struct timespec start;
+    uint8_t req[8];
+    uint16_t crc;
+    uint32_t us;
+
+    req[0] = address;
+    req[1] = func;
+    req[2] = reg >> 8;
+    req[3] = reg & 0xff;
+    req[4] = val >> 8;
+    req[5] = val & 0xff;
+    crc = modbus_crc16(req, 6);
+    req[6] = crc & 0xff;
+    req[7] = crc >> 8;
+
+    /* silence between frames */
+    if ((us = modbus_us(&last)) < MODBUS_GAP_US) usleep(MODBUS_GAP_US - us);
+
+    /* an answer that came too late belongs to an earlier request */
+    tcflush(fd, TCIFLUSH);
+
+    stats.requests++;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (::write(fd, req, sizeof(req)) != sizeof(req))
+    {
+        clock_gettime(CLOCK_MONOTONIC, &last);
+        return(I2C_SDA_NACK);
+    }
+
+    if (! receive(ans, len))
+    {
+        clock_gettime(CLOCK_MONOTONIC, &last);
+        stats.timeouts++;
+        return(*len ? I2C_SDA_DATA : I2C_SDA_NACK);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &last);
+
+    us = modbus_us(&start);
+    stats.wait_us += us;
+    if (us > stats.wait_max) stats.wait_max = us;
+
+    crc = modbus_crc16(ans, *len - 2);
+
+    if (ans[0] != address || ans[*len - 2] != (crc & 0xff) || ans[*len - 1] != crc >> 8 ||
+        (ans[1] & ~MODBUS_EXCEPTION) != func)
+    {
+        stats.crc_errors++;
+        return(I2C_SDA_DATA);
+    }
+
+    if (ans[1] & MODBUS_EXCEPTION)
+    {
+        if (SCD_DEBUG > 1) p_printf(RED, (char *) "Modbus exception %d on register 0x%04x\n", ans[2], reg);
+        stats.exceptions++;
+        return(I2C_SDA_NACK);
+    }
+
+    /* write single is echoed, read has the byte count asked */
+    if ((func == MODBUS_WRITE_SINGLE && memcmp(ans, req, 6) != 0) ||
+        (func != MODBUS_WRITE_SINGLE && ans[2] != val * 2))
+    {
+        stats.crc_errors++;
+        return(I2C_SDA_DATA);
+    }
+
+    return(I2C_OK);
+}
+
+/*********************************************************************
+ * @brief I2C command frame to Modbus
+ * @param buf : command (2 bytes) and optional argument + CRC
+ * @param len : 2 or 5
+ *
+ * A command with an answer is only remembered, read() requests it.
+ *
+ * @return I2C_OK, I2C_SDA_NACK or I2C_SDA_DATA
+ *********************************************************************/
+Wstatus ModbusTransport::write(const char *buf, uint32_t len)
+{
+    const uint8_t *b = (const uint8_t *) buf;
+    const scd30_cmd_desc *desc;
+    uint8_t ans[MODBUS_FRAME];
+    uint32_t n;
+
+    reg = 0;
+
+    if (len != 2 && len != 5) return(I2C_SDA_NACK);
+
+    desc = scd30_cmd_find(b[0] << 8 | b[1]);
+
+    if (desc == NULL || desc->modbus == 0)
+    {
+        stats.unsupported++;
+        return(I2C_SDA_NACK);
+    }
+
+    if (len == 5)
+    {
+        if (scd30_crc8(&b[2], 2) != b[4]) return(I2C_SDA_DATA);
+        return(request(MODBUS_WRITE_SINGLE, desc->modbus, b[2] << 8 | b[3], ans, &n));
+    }
+
+    if (desc->words == 0) return(request(MODBUS_WRITE_SINGLE, desc->modbus, 1, ans, &n));
+
+    reg = desc->modbus;
+    count = desc->words;
+
+    return(I2C_OK);
+}
+
+/*********************************************************************
+ * @brief read the answer of the last command
+ * @param buf : to store the words, each followed by the I2C CRC
+ * @param len : number of bytes
+ *
+ * @return I2C_OK, I2C_SDA_NACK or I2C_SDA_DATA
+ *********************************************************************/
+Wstatus ModbusTransport::read(char *buf, uint32_t len)
+{
+    uint8_t ans[MODBUS_FRAME], *b = (uint8_t *) buf;
+    uint32_t n, words = len / 3, i;
+    Wstatus ret;
+
+    if (reg == 0 || words == 0 || words > count) return(I2C_SDA_NACK);
+
+    if ((ret = request(MODBUS_READ_HOLDING, reg, words, ans, &n)) != I2C_OK) return(ret);
+
+    for (i = 0; i < words; i++)
+    {
+        b[i * 3] = ans[3 + i * 2];
+        b[i * 3 + 1] = ans[4 + i * 2];
+        b[i * 3 + 2] = scd30_crc8(&b[i * 3], 2);
+    }
+
+    return(I2C_OK);
+}
+
+/*********************************************************************
+ * @brief answer one request on the emulated SCD30
+ * @param m : emulator
+ * @param req : request frame (8 bytes, CRC checked)
+ * @param ans : to store the answer
+ *
+ * The request is given to the emulator as the I2C command, the I2C
+ * answer is returned without the CRC.
+ *
+ * @return length of the answer (0 = not for us)
+ *********************************************************************/
+static uint32_t modbus_emul_answer(struct modbus_emul *m, const uint8_t *req, uint8_t *ans)
+{
+    const scd30_cmd_desc *desc;
+    uint8_t cmd[5], rd[SCD30_ANSWER_MAX];
+    uint16_t reg = req[2] << 8 | req[3], val = req[4] << 8 | req[5], crc;
+    uint32_t n, i;
+    uint8_t exc = 0;
+
+    if (req[0] != MODBUS_ADDRESS) return(0);
+
+    desc = scd30_cmd_modbus(reg);
+
+    cmd[0] = desc ? desc->code >> 8 : 0;
+    cmd[1] = desc ? desc->code & 0xff : 0;
+
+    switch(req[1])
+    {
+    case MODBUS_WRITE_SINGLE:
+        if (desc == NULL) exc = MODBUS_ILLEGAL_ADDRESS;
+        else if (desc->arg)
+        {
+            cmd[2] = val >> 8;
+            cmd[3] = val & 0xff;
+            cmd[4] = scd30_crc8(&cmd[2], 2);
+            if (emul_write(m->emul, (char *) cmd, 5) != I2C_OK) exc = MODBUS_ILLEGAL_VALUE;
+        }
+        else if (desc->words || val != 1) exc = MODBUS_ILLEGAL_VALUE;
+        else if (emul_write(m->emul, (char *) cmd, 2) != I2C_OK) exc = MODBUS_ILLEGAL_VALUE;
+
+        /* echo */
+        memcpy(ans, req, 8);
+        n = 8;
+        break;
+
+    case MODBUS_READ_HOLDING:
+    case MODBUS_READ_INPUT:
+        if (desc == NULL || desc->words == 0) exc = MODBUS_ILLEGAL_ADDRESS;
+        else if (val == 0 || val > desc->words) exc = MODBUS_ILLEGAL_VALUE;
+        else if (emul_write(m->emul, (char *) cmd, 2) != I2C_OK ||
+            emul_read(m->emul, (char *) rd, val * 3) != I2C_OK) exc = MODBUS_ILLEGAL_VALUE;
+
+        ans[0] = req[0];
+        ans[1] = req[1];
+        ans[2] = val * 2;
+
+        for (i = 0, n = 3; ! exc && i < val; i++)
+        {
+            ans[n++] = rd[i * 3];
+            ans[n++] = rd[i * 3 + 1];
+        }
+
+        n += 2;
+        break;
+
+    default:
+        exc = MODBUS_ILLEGAL_FUNCTION;
+        n = 0;
+    }
+
+    if (exc)
+    {
+        ans[0] = req[0];
+        ans[1] = req[1] | MODBUS_EXCEPTION;
+        ans[2] = exc;
+        n = 5;
+        m->exceptions++;
+    }
+
+    crc = modbus_crc16(ans, n - 2);
+    ans[n - 2] = crc & 0xff;
+    ans[n - 1] = crc >> 8;
+
+    m->frames++;
+
+    /* line noise */
+    if (m->corrupt && m->frames % m->corrupt == 0) ans[n - 1] ^= 0x5a;
+
+    return(n);
+}
+
+/*********************************************************************
+ * @brief emulator thread : read requests from the pty, answer them
+ * @param arg : modbus_emul
+ *
+ * A request is 8 bytes. Bytes followed by silence longer than a frame
+ * gap, or with a wrong CRC, are dropped.
+ *********************************************************************/
+static void *modbus_emul_run(void *arg)
+{
+    struct modbus_emul *m = (struct modbus_emul *) arg;
+    struct pollfd pfd;
+    uint8_t req[8], ans[MODBUS_FRAME];
+    uint32_t got = 0, n;
+    uint16_t crc;
+    int     r;
+
+    pfd.fd = m->master;
+    pfd.events = POLLIN;
+
+    while (! m->stop)
+    {
+        r = poll(&pfd, 1, got ? MODBUS_GAP_US / 1000 + 1 : 50);
+
+        if (r < 0 && errno == EINTR) continue;
+
+        /* silence in the middle of a frame */
+        if (r == 0)
+        {
+            if (got) m->dropped++;
+            got = 0;
+            continue;
+        }
+
+        if (r < 0 || (r = ::read(m->master, &req[got], sizeof(req) - got)) <= 0)
+        {
+            if (r < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+            usleep(1000);
+            continue;
+        }
+
+        if ((got += r) < sizeof(req)) continue;
+
+        got = 0;
+        crc = modbus_crc16(req, 6);
+
+        if (req[6] != (crc & 0xff) || req[7] != crc >> 8)
+        {
+            m->dropped++;
+            continue;
+        }
+
+        if ((n = modbus_emul_answer(m, req, ans)) > 0)
+        {
+            if (::write(m->master, ans, n) != (ssize_t) n) m->dropped++;
+        }
+    }
+
+    return(NULL);
+}
+
+/*********************************************************************
+ * @brief start an emulated SCD30 answering Modbus on a pseudo terminal
+ * @param m : emulator, m->port is the port to use
+ * @param e : emulated SCD30 (emul_init() done)
+ *
+ * @return true = OK, false is error
+ *********************************************************************/
+bool modbus_emul_open(struct modbus_emul *m, struct scd30_emul *e)
+{
+    char    *name;
+    int     slave;
+
+    memset(m, 0x0, sizeof(struct modbus_emul));
+    m->emul = e;
+
+    if ((m->master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC)) < 0 ||
+        grantpt(m->master) < 0 || unlockpt(m->master) < 0 || (name = ptsname(m->master)) == NULL)
+    {
+        p_printf(RED, (char *) "Can not create pseudo terminal : %s\n", strerror(errno));
+        if (m->master > -1) ::close(m->master);
+        return(false);
+    }
+
+    strncpy(m->port, name, MODBUS_PORTLEN - 1);
+
+    /* raw before the first byte, no echo of the requests */
+    if ((slave = ::open(m->port, O_RDWR | O_NOCTTY | O_CLOEXEC)) > -1)
+    {
+        modbus_serial(slave, MODBUS_BAUD, NULL);
+        ::close(slave);
+    }
+
+    if (pthread_create(&m->thread, NULL, modbus_emul_run, m) != 0)
+    {
+        p_printf(RED, (char *) "Can not start Modbus emulator\n");
+        ::close(m->master);
+        return(false);
+    }
+
+    return(true);
+}
+
+/*********************************************************************
+ * @brief stop the emulator and close the pseudo terminal
+ * @param m : emulator
+ *********************************************************************/
+void modbus_emul_close(struct modbus_emul *m)
+{
+    m->stop = true;
+    pthread_join(m->thread, NULL);
+    ::close(m->master);
+}
+
+/*********************************************************************
+ * @brief show one result of the check
+ *********************************************************************/
+static bool modbus_result(bool ok, const char *what)
+{
+    p_printf(ok ? GREEN : RED, (char *) "%-40s %s\n", what, ok ? "PASSED" : "FAILED");
+    return(ok);
+}
+
+/*********************************************************************
+ * @brief a fleet sensor with 'interface = modbus' on the emulated SCD30
+ *
+ * The identity cache (a temporary file) holds a soft_I2C sensor on the
+ * default GPIO and address with the settings of the emulated SCD30 : it
+ * must not be taken for the sensor on the port. After an other SCD30
+ * (other stored settings) is connected to the port, the settings are
+ * sent again. The cache is not used with factory defaults only, nor 
+ * after a detach.
+ *
+ * @return true = passed
+ *********************************************************************/
+static bool modbus_fleet()
+{
+    struct fleet_cfg *cfg = &mb_conf.sensor[0];
+    struct scd30_ident key, *e;
+    char    path[MAXBUF];
+    int     i;
+    bool    ok = true, cached;
+
+    snprintf(path, sizeof(path), "/tmp/scd30-modbus-%d.ident", (int) getpid());
+    unlink(path);
+    ident_open(path);
+
+    memset(&key, 0x0, sizeof(key));
+    key.used = true;
+    key.I2C_interface = soft_I2C;
+    key.sda = DEF_SDA;
+    key.scl = DEF_SCL;
+    key.mux_address = NO_MUX;
+    key.address = SCD30_ADDRESS;
+    strcpy(key.serial, "SOFT00000001");
+    key.fw = EMUL_FW;
+    key.interval = 2;
+    key.asc = 1;
+    key.altitude = mb_emul.altitude = 100;
+    key.temp_offset = 2;
+    mb_emul.temp_offset = 200;
+    key.pressure = key.frc = -1;
+    ident_put(&key);
+
+    /* as a configuration file with one sensor on the port */
+    memset(&mb_conf, 0x0, sizeof(mb_conf));
+    mb_conf.dylos_wait = 60;
+    strcpy(mb_conf.dylos_output, SINK_STDOUT);
+    mb_conf.num = 1;
+
+    fleet_default(cfg, (char *) "modbus");
+    cfg->modbus = true;
+    strcpy(cfg->port, mb_pty.port);
+    cfg->lock_timeout = 0;
+    cfg->altitude = 250;
+    cfg->temp_offset = 3;
+    strcpy(cfg->output, "/dev/null");
+
+    fleet_start(&mb_conf, &mb_opt);
+    for (i = 0; i < 5; i++) fleet_step(true);
+
+    ok &= modbus_result(fleet_step(true) > 0, "fleet : attached and read");
+
+    memset(&key, 0x0, sizeof(key));
+    key.modbus = true;
+    strcpy(key.port, mb_pty.port);
+
+    e = ident_find(&key);
+    ok &= modbus_result(e && strcmp(e->serial, "-") == 0 && e->altitude == 250, "fleet : identity keyed by port");
+    ok &= modbus_result(mb_emul.altitude == 250 && mb_emul.temp_offset == 300, "fleet : settings sent");
+
+    /* an other SCD30 on the port */
+    fleet_close();
+    mb_emul.altitude = 0;
+    mb_emul.temp_offset = 0;
+
+    fleet_start(&mb_conf, &mb_opt);
+    for (i = 0; i < 5; i++) fleet_step(true);
+
+    ok &= modbus_result(mb_emul.altitude == 250 && mb_emul.temp_offset == 300, "fleet : other SCD30 : settings sent");
+
+    fleet_close();
+
+    /* only a setting that is not the factory default tells sensors apart */
+    mb_dev.begin(true, 2);
+
+    e = ident_find(&key);
+    if (e) e->temp_offset = e->frc = -1;
+    ok &= modbus_result(e && ident_get(&mb_dev, &key, &cached, false) && cached, "ident : cached (altitude 250)");
+
+    e = ident_find(&key);
+    if (e) e->altitude = mb_emul.altitude = 0;
+    ok &= modbus_result(e && ident_get(&mb_dev, &key, &cached, false) && ! cached, "ident : not cached (defaults only)");
+
+    /* the previous one was not cached : all other settings unknown */
+    e = ident_find(&key);
+    if (e) e->altitude = mb_emul.altitude = 250;
+    ok &= modbus_result(e && ident_get(&mb_dev, &key, &cached, true) && ! cached, "ident : not cached after detach");
+
+    mb_dev.close();
+    unlink(path);
+
+    return(ok);
+}
+
+/*********************************************************************
+ * @brief check the driver over Modbus on the emulated SCD30
+ * @param samples : number of measurements to read
+ *
+ * @return true = passed
+ *********************************************************************/
+bool modbus_check(uint32_t samples)
+{
+    SCD30   *dev = &mb_dev;
+    scd30_stats st;
+    float   co2, temperature, humidity;
+    uint16_t val;
+    uint32_t i, bad = 0;
+    char    serial[SCD30_SERIAL_NUM_WORDS * 2 + 1];
+    bool    ok = true;
+
+    emul_init(&mb_emul, true);
+    emul_set(&mb_emul, 812, 22.5, 48.25);
+
+    if (! modbus_emul_open(&mb_pty, &mb_emul)) return(false);
+
+    p_printf(WHITE, (char *) "emulated SCD30 on Modbus at %s\n", mb_pty.port);
+
+    dev->settings.modbus = mb_pty.port;
+    dev->settings.lock_timeout = 0;
+
+    ok &= modbus_result(dev->begin(true, 2), "begin : start measurement, interval, ASC");
+    ok &= modbus_result(mb_emul.measuring && mb_emul.interval == 2 && mb_emul.asc == 1, "settings stored");
+
+    ok &= modbus_result(dev->getSettingValue(CMD_GET_FW_LEVEL, &val) && val == EMUL_FW, "firmware level");
+
+    ok &= modbus_result(dev->setMeasurementInterval(5) &&
+        dev->getSettingValue(COMMAND_SET_MEASUREMENT_INTERVAL, &val) && val == 5, "set / get interval");
+
+    ok &= modbus_result(dev->setTemperatureOffset(1.5) &&
+        dev->getSettingValue(COMMAND_SET_TEMPERATURE_OFFSET, &val) && val == 150, "set / get temperature offset");
+
+    ok &= modbus_result(! dev->setForceRecalibration(100), "FRC out of range : not sent");
+
+    ok &= modbus_result(! dev->getSerialNumber(serial), "serial number : no Modbus register");
+
+    for (i = 0; i < samples; i++)
+    {
+        if (! dev->dataAvailable() || ! dev->getMeasurement(&co2, &temperature, &humidity) ||
+            co2 != 812 || temperature != 22.5 || humidity != 48.25) bad++;
+    }
+
+    p_printf(WHITE, (char *) "%u samples, %u wrong\n", samples, bad);
+    ok &= modbus_result(bad == 0, "measurements");
+
+    /* line noise : the driver retries */
+    mb_pty.corrupt = 7;
+
+    for (i = 0, bad = 0; i < samples; i++)
+    {
+        if (! dev->dataAvailable() || ! dev->getMeasurement(&co2, &temperature, &humidity)) bad++;
+    }
+
+    mb_pty.corrupt = 0;
+    dev->getStats(&st);
+
+    p_printf(WHITE, (char *) "each 7th answer corrupted : %u samples, %u failed, %u retries\n", samples, bad, st.retries);
+    ok &= modbus_result(bad == 0 && st.retries > 0, "retry on CRC error");
+
+    ok &= modbus_result(dev->StopMeasurement() && ! mb_emul.measuring, "stop measurement");
+
+    dev->getStats(&st);
+
+    p_printf(WHITE, (char *) "emulator : %u frames answered, %u exceptions, %u dropped\n",
+        mb_pty.frames, mb_pty.exceptions, mb_pty.dropped);
+
+    dev->DispClockStretch();
+
+    if (st.tr_count)
+        p_printf(WHITE, (char *) "transaction average %lu uS, max %u uS (pty : no line time)\n",
+            (unsigned long) (st.tr_sum / st.tr_count), st.tr_max);
+
+    dev->close();
+
+    ok &= modbus_fleet();
+
+    ok &= modbus_result(mb_pty.dropped == 0, "no dropped requests");
+
+    modbus_emul_close(&mb_pty);
+
+    return(ok);
+}
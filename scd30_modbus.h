@@ -0,0 +1,203 @@
+/*******************************************************************
+ *
+ * SCD30 on Modbus RTU over UART.
+ *
+ * The SCD30 can be connected to a UART instead of I2C (SEL pin high,
+ * 3V3 levels or an RS485 / USB adapter). Modbus has no clock stretching
+ * and works over longer cables. The line is 19200 baud, 8 data bits,
+ * no parity, 1 stop bit and the SCD30 answers on address 0x61.
+ *
+ * ModbusTransport is a transport policy (see scd30_transport.h) : it
+ * takes the I2C frames of the driver and protocol layer and maps each
+ * command from scd30_cmd.h on its Modbus holding register :
+ *
+ *  command + argument       : write single register (0x06)
+ *  command without answer   : write single register (0x06) value 1
+ *  command with answer      : remembered, the read that follows is
+ *                             a read holding registers (0x03) of the
+ *                             number of words. Each word is returned
+ *                             with the I2C CRC.
+ *
+ * The serial number and article code have no Modbus register and are
+ * not acknowledged (the identity cache keys a Modbus sensor on its port). A Modbus exception or no answer (MODBUS_TIMEOUT) is
+ * returned as I2C_SDA_NACK, a frame with a wrong CRC as I2C_SDA_DATA.
+ * Before each request the line is silent for 3.5 characters.
+ *
+ * The serial port is set up as the Dylos port (dylos.c) : raw 8N1, no
+ * flow control, the modem lines are ignored.
+ *
+ * For tests without a sensor, modbus_emul_open() starts an emulated
+ * SCD30 (scd30_emul.h) answering Modbus on a pseudo terminal. Its
+ * slave side is used as port.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_MODBUS_H__
+#define __SCD30_MODBUS_H__
+
+# include <twowire.h>
+# include <stdint.h>
+# include <termios.h>
+# include <pthread.h>
+
+struct scd30_emul;
+
+/* line settings */
+# define MODBUS_ADDRESS 0x61
+# define MODBUS_BAUD B19200
+# define MODBUS_CHAR_US 573             // 11 bits at 19200 baud
+
+/* silence between frames : 3.5 characters */
+# define MODBUS_GAP_US (MODBUS_CHAR_US * 7 / 2)
+
+/* max. mS for an answer */
+# define MODBUS_TIMEOUT 200
+
+/* function codes */
+# define MODBUS_READ_HOLDING 0x03
+# define MODBUS_READ_INPUT 0x04
+# define MODBUS_WRITE_SINGLE 0x06
+# define MODBUS_EXCEPTION 0x80
+
+/* exception codes */
+# define MODBUS_ILLEGAL_FUNCTION 0x01
+# define MODBUS_ILLEGAL_ADDRESS 0x02
+# define MODBUS_ILLEGAL_VALUE 0x03
+
+/* max. frame : address, function, count, 2 x 16 words, CRC */
+# define MODBUS_FRAME 40
+
+/* port name */
+# define MODBUS_PORTLEN 64
+
+/*! Modbus CRC16 (polynomial 0xA001 reflected, initial 0xffff)
+ * @param data : frame
+ * @param len : number of bytes
+ *
+ * @return CRC (sent low byte first)
+ */
+static inline uint16_t modbus_crc16(const uint8_t *data, uint32_t len)
+{
+    uint16_t crc = 0xffff;
+    uint32_t i;
+    int     b;
+
+    for (i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+
+        for (b = 0; b < 8; b++)
+            crc = crc & 1 ? (crc >> 1) ^ 0xA001 : crc >> 1;
+    }
+
+    return(crc);
+}
+
+struct modbus_stats
+{
+    uint32_t    requests;               // frames sent
+    uint32_t    exceptions;             // exception answers
+    uint32_t    timeouts;               // no (complete) answer
+    uint32_t    crc_errors;             // answer with wrong CRC or format
+    uint32_t    unsupported;            // command without Modbus register
+    uint64_t    wait_us;                // total request to answer time
+    uint32_t    wait_max;               // longest
+};
+
+/* Modbus RTU transport */
+class ModbusTransport
+{
+  public:
+    int         fd;                     // -1 is not open
+    uint8_t     address;                // Modbus address
+    struct modbus_stats stats;
+
+    ModbusTransport() { fd = -1; address = MODBUS_ADDRESS; reg = count = 0; }
+
+    /*! open and configure the serial port
+     * @param port : device (e.g. /dev/ttyUSB0)
+     * @return true = OK, false is error */
+    bool open(const char *port);
+
+    /*! restore the port settings and close */
+    void close();
+
+    /*! I2C command frame (2 bytes or 5 with argument and CRC)
+     * @return I2C_OK, I2C_SDA_NACK or I2C_SDA_DATA */
+    Wstatus write(const char *buf, uint32_t len);
+
+    /*! answer of the last command, each word followed by its I2C CRC
+     * @return as write() */
+    Wstatus read(char *buf, uint32_t len);
+
+    /* the answer is requested by read() : nothing to wait for */
+    void wait_us(uint32_t us) { }
+
+    /* the SCD30 stretches on its side of the Modbus bridge */
+    void stretch(uint32_t us) { }
+
+  private:
+    uint16_t    reg;                    // register of command with answer (0 = none)
+    uint16_t    count;                  // words of that answer
+    struct timespec last;               // end of last frame
+    struct termios old;                 // port settings to restore
+
+    Wstatus request(uint8_t func, uint16_t reg, uint16_t val, uint8_t *ans, uint32_t *len);
+    bool receive(uint8_t *ans, uint32_t *len);
+};
+
+/* emulated SCD30 on a pseudo terminal */
+struct modbus_emul
+{
+    int         master;                 // master side of the pty
+    char        port[MODBUS_PORTLEN];   // slave side to open
+    pthread_t   thread;
+    volatile bool stop;
+    struct scd30_emul *emul;            // emulated SCD30
+    uint32_t    corrupt;                // corrupt the CRC of each n-th answer (0 = none)
+
+    /* counters */
+    uint32_t    frames;                 // requests answered
+    uint32_t    exceptions;             // exceptions sent
+    uint32_t    dropped;                // incomplete or wrong CRC
+};
+
+/*! start an emulated SCD30 answering Modbus on a pseudo terminal
+ * @param m : emulator, m->port is the port to use
+ * @param e : emulated SCD30 (emul_init() done)
+ *
+ * @return true = OK, false is error
+ */
+bool modbus_emul_open(struct modbus_emul *m, struct scd30_emul *e);
+
+/*! stop the emulator and close the pseudo terminal
+ * @param m : emulator
+ */
+void modbus_emul_close(struct modbus_emul *m);
+
+/*! check the driver over Modbus on the emulated SCD30 and the attach of
+ * a fleet sensor with 'interface = modbus'
+ * @param samples : number of measurements to read
+ *
+ * @return true = passed
+ */
+bool modbus_check(uint32_t samples);
+
+#endif  // End of definition check
@@ -0,0 +1,295 @@
+/*******************************************************************
+ *
+ * Ambient pressure compensation from an external source.
+ *
+ * The UDP socket is non-blocking : on each check all datagrams that
+ * were received are read and the last valid one is used. The file is
+ * opened and read on each check, so it can be replaced by an other
+ * program (write to temporary file + rename).
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "SCD30.h"
+# include "scd30_press.h"
+# include <fcntl.h>
+# include <math.h>
+# include <arpa/inet.h>
+# include <netinet/in.h>
+# include <sys/socket.h>
+
+/*********************************************************************
+ * @brief get monotonic time in milli seconds
+ *********************************************************************/
+uint64_t press_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return((uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/*********************************************************************
+ * @brief set the defaults of a feeder
+ *********************************************************************/
+void press_init(struct scd30_press *p, uint16_t threshold, uint16_t hold)
+{
+    memset(p, 0x0, sizeof(struct scd30_press));
+
+    p->fd = -1;
+    p->scale = 1;
+    p->threshold = threshold ? threshold : PRESS_THRESHOLD;
+    p->hold = hold ? hold : PRESS_HOLD;
+}
+
+/*********************************************************************
+ * @brief open an UDP source
+ * @param p : feeder
+ * @param spec : [addr:]port
+ *
+ * @return true = OK, false is error
+ *********************************************************************/
+bool press_udp(struct scd30_press *p, const char *spec)
+{
+    struct sockaddr_in addr;
+    char    host[INET_ADDRSTRLEN], *end;
+    const char *port = strrchr(spec, ':');
+    long    n;
+
+    memset(&addr, 0x0, sizeof(addr));
+    addr.sin_family = AF_INET;
+
+    if (port == NULL)
+    {
+        strcpy(host, "127.0.0.1");
+        port = spec;
+    }
+    else
+    {
+        if (port - spec >= INET_ADDRSTRLEN) return(false);
+        strncpy(host, spec, port - spec);
+        host[port - spec] = 0x0;
+        port++;
+    }
+
+    n = strtol(port, &end, 10);
+
+    if (*end != 0x0 || n < 1 || n > 0xffff || inet_pton(AF_INET, host, &addr.sin_addr) != 1)
+        return(false);
+
+    addr.sin_port = htons(n);
+
+    if ((p->fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) return(false);
+
+    if (bind(p->fd, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+    {
+        ::close(p->fd);
+        p->fd = -1;
+        return(false);
+    }
+
+    /* never block the acquisition loop */
+    fcntl(p->fd, F_SETFL, O_NONBLOCK);
+
+    return(true);
+}
+
+/*********************************************************************
+ * @brief open a source
+ * @param p : feeder
+ * @param spec : source spec (see scd30_press.h)
+ * @param threshold : mbar change before applying (0 = PRESS_THRESHOLD)
+ * @param hold : seconds between applying (0 = PRESS_HOLD)
+ *
+ * @return true = OK, false is invalid spec or could not open
+ *********************************************************************/
+bool press_open(struct scd30_press *p, const char *spec, uint16_t threshold, uint16_t hold)
+{
+    char    *s;
+
+    press_init(p, threshold, hold);
+
+    if (strncmp(spec, "file:", 5) == 0)
+    {
+        if (strlen(spec + 5) >= PRESS_SPECLEN || spec[5] == 0x0) goto spec_error;
+
+        strcpy(p->path, spec + 5);
+
+        if ((s = strrchr(p->path, ',')) != NULL)
+        {
+            *s++ = 0x0;
+            p->scale = strtof(s, &s);
+            if (*s != 0x0 || p->scale <= 0) goto spec_error;
+        }
+
+        p->type = PRESS_FILE;
+        return(true);
+    }
+
+    if (strncmp(spec, "udp:", 4) == 0)
+    {
+        if (! press_udp(p, spec + 4))
+        {
+            p_printf(RED, (char *) "Can not open pressure source %s\n", spec);
+            return(false);
+        }
+
+        p->type = PRESS_UDP;
+        return(true);
+    }
+
+spec_error:
+    p_printf(RED, (char *) "Invalid pressure source %s. Must be file:path[,scale] or udp:[addr:]port\n", spec);
+    p->type = PRESS_NONE;
+    return(false);
+}
+
+/*********************************************************************
+ * @brief use a pressure driver as source
+ * @param p : feeder
+ * @param fn : driver function
+ * @param ctx : passed to the driver function
+ * @param threshold : mbar change before applying (0 = PRESS_THRESHOLD)
+ * @param hold : seconds between applying (0 = PRESS_HOLD)
+ *********************************************************************/
+void press_driver(struct scd30_press *p, press_fn fn, void *ctx, uint16_t threshold, uint16_t hold)
+{
+    press_init(p, threshold, hold);
+
+    p->type = PRESS_DRIVER;
+    p->fn = fn;
+    p->ctx = ctx;
+}
+
+/*********************************************************************
+ * @brief close the source
+ *********************************************************************/
+void press_close(struct scd30_press *p)
+{
+    if (p->type == PRESS_UDP) ::close(p->fd);
+
+    p->fd = -1;
+    p->type = PRESS_NONE;
+}
+
+/*********************************************************************
+ * @brief read the source
+ * @param p : feeder
+ * @param mbar : to store the reading
+ *
+ * @return true if a new reading, false if none
+ *********************************************************************/
+bool press_read(struct scd30_press *p, float *mbar)
+{
+    FILE    *fp;
+    char    buf[32];
+    ssize_t len;
+    bool    ret = false;
+
+    switch(p->type)
+    {
+    case PRESS_FILE:
+        if ((fp = fopen(p->path, "r")) == NULL) return(false);
+
+        ret = fscanf(fp, "%f", mbar) == 1;
+        fclose(fp);
+
+        *mbar *= p->scale;
+        return(ret);
+
+    case PRESS_UDP:
+        while ((len = recv(p->fd, buf, sizeof(buf) - 1, 0)) > 0)
+        {
+            buf[len] = 0x0;
+            if (sscanf(buf, "%f", mbar) == 1) ret = true;
+        }
+        return(ret);
+
+    case PRESS_DRIVER:
+        return(p->fn(p->ctx, mbar));
+
+    default:
+        return(false);
+    }
+}
+
+/*********************************************************************
+ * @brief read the source
+ * @param p : feeder
+ *
+ * @return pressure in mbar to apply, 0 if nothing to apply. Call
+ * press_applied() once the SCD30 accepted it.
+ *********************************************************************/
+uint16_t press_check(struct scd30_press *p)
+{
+    float   mbar;
+    uint16_t val;
+
+    if (p->type == PRESS_NONE) return(0);
+
+    if (! press_read(p, &mbar))
+    {
+        /* an UDP source only sends now and then */
+        if (p->type != PRESS_UDP) p->errors++;
+        return(0);
+    }
+
+    if (mbar == 0 || ! scd30_cmd_valid(SCD30_CMD_START, mbar))
+    {
+        p->errors++;
+        return(0);
+    }
+
+    p->reads++;
+    p->value = mbar;
+    val = (uint16_t) lroundf(mbar);
+
+    if (p->applied == 0) return(val);
+
+    if (abs(val - p->applied) < p->threshold) return(0);
+
+    if (press_ms() - p->applied_ms < (uint64_t) p->hold * 1000)
+    {
+        p->limited++;
+        return(0);
+    }
+
+    return(val);
+}
+
+/*********************************************************************
+ * @brief the pressure was applied
+ * @param p : feeder
+ * @param mbar : pressure applied
+ *********************************************************************/
+void press_applied(struct scd30_press *p, uint16_t mbar)
+{
+    p->applied = mbar;
+    p->applied_ms = press_ms();
+    p->applies++;
+}
+
+/*********************************************************************
+ * @brief the SCD30 was (re)started without pressure : apply on next check
+ *********************************************************************/
+void press_reset(struct scd30_press *p)
+{
+    p->applied = 0;
+}
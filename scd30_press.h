@@ -0,0 +1,133 @@
+/*******************************************************************
+ *
+ * Ambient pressure compensation from an external source.
+ *
+ * The SCD30 compensates the CO2 reading for the ambient pressure. The
+ * pressure can only be set by restarting the continuous measurement,
+ * so it is not sent on each cycle. The feeder reads the pressure from
+ * a source and tells when it should be applied :
+ *
+ *  - the first valid reading is applied straight away
+ *  - next, only if it differs threshold mbar or more from the value
+ *    applied, and not within 'hold' seconds of the previous apply.
+ *
+ * Sources (spec as given with -E or the fleet key pressuresource) :
+ *
+ *  file:path[,scale]   first number in file * scale (default 1). e.g.
+ *                      a Linux IIO barometer reports kPa :
+ *                      file:/sys/bus/iio/devices/iio:device0/in_pressure_input,10
+ *  udp:[addr:]port     last number received as UDP datagram (default
+ *                      address is 127.0.0.1)
+ *
+ * An other pressure driver in the same program can be plugged in with
+ * press_driver().
+ *
+ * A reading outside 700 - 1200 mbar is ignored (counted as error).
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_PRESS_H__
+#define __SCD30_PRESS_H__
+
+# include <stdint.h>
+
+/* max. length of a source spec */
+# define PRESS_SPECLEN 100
+
+/* default mbar change before applying */
+# define PRESS_THRESHOLD 3
+
+/* default seconds between applying */
+# define PRESS_HOLD 300
+
+/* type of source */
+enum press_type
+{
+    PRESS_NONE = 0,
+    PRESS_FILE,
+    PRESS_UDP,
+    PRESS_DRIVER
+};
+
+/*! pressure driver : store pressure in mbar. Return false if no reading */
+typedef bool (*press_fn)(void *ctx, float *mbar);
+
+struct scd30_press
+{
+    press_type  type;                   // source type
+    char        path[PRESS_SPECLEN];    // file to read
+    float       scale;                  // file value * scale = mbar
+    int         fd;                     // UDP socket
+    press_fn    fn;                     // driver
+    void        *ctx;                   // driver context
+
+    uint16_t    threshold;              // mbar change before applying
+    uint16_t    hold;                   // seconds between applying
+    float       value;                  // last reading (mbar)
+    uint16_t    applied;                // value applied (0 = none)
+    uint64_t    applied_ms;             // mS of last apply
+
+    /* counters */
+    uint32_t    reads;                  // valid readings
+    uint32_t    errors;                 // failed or invalid readings
+    uint32_t    applies;                // times applied
+    uint32_t    limited;                // checks held back (hold)
+};
+
+/*! open a source
+ * @param p : feeder
+ * @param spec : source spec (see above)
+ * @param threshold : mbar change before applying (0 = PRESS_THRESHOLD)
+ * @param hold : seconds between applying (0 = PRESS_HOLD)
+ *
+ * @return true = OK, false is invalid spec or could not open
+ */
+bool press_open(struct scd30_press *p, const char *spec, uint16_t threshold, uint16_t hold);
+
+/*! use a pressure driver as source
+ * @param p : feeder
+ * @param fn : driver function
+ * @param ctx : passed to the driver function
+ * @param threshold : mbar change before applying (0 = PRESS_THRESHOLD)
+ * @param hold : seconds between applying (0 = PRESS_HOLD)
+ */
+void press_driver(struct scd30_press *p, press_fn fn, void *ctx, uint16_t threshold, uint16_t hold);
+
+/*! close the source (a cleared feeder has no source) */
+void press_close(struct scd30_press *p);
+
+/*! read the source
+ * @param p : feeder
+ *
+ * @return pressure in mbar to apply, 0 if nothing to apply. Call
+ * press_applied() once the SCD30 accepted it.
+ */
+uint16_t press_check(struct scd30_press *p);
+
+/*! the pressure was applied
+ * @param p : feeder
+ * @param mbar : pressure applied
+ */
+void press_applied(struct scd30_press *p, uint16_t mbar);
+
+/*! the SCD30 was (re)started without pressure : apply on next check */
+void press_reset(struct scd30_press *p);
+
+#endif  // End of definition check
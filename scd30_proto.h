@@ -0,0 +1,348 @@
+/*******************************************************************
+ *
+ * SCD30 protocol layer as template over a transport policy.
+ *
+ * The SCD30 class handles any bus at run time (hard / soft I2C,
+ * multiplexer, bus lock). Programs where the bus is known at compile
+ * time can use SCD30Proto<Transport> instead : the transport calls
+ * are inlined and the debug messages are compiled away if Debug is 0.
+ *
+ * A transport policy is a class with :
+ *
+ *   Wstatus write(const char *buf, uint32_t len);
+ *   Wstatus read(char *buf, uint32_t len);
+ *   void wait_us(uint32_t us);
+ *   void stretch(uint32_t us);     clock stretch limit (if the bus has one)
+ *
+ * The retry and the CRC check (scd30_retry(), scd30_unpack()) are shared
+ * with the SCD30 driver. The protocol layer sets the clock stretch limit
+ * of each command from the table in scd30_cmd.h, the driver adapts it 
+ * to what it observes (see SCD30::stretchDone()).
+ *
+ * See scd30_transport.h for the available transports.
+ *
+ *   SCD30Proto<I2cDevTransport> scd;
+ *
+ *   scd.bus.open(1, SCD30_ADDRESS);
+ *   scd.send<SCD30_CMD_START, 0>();
+ *
+ * The commands are described in scd30_cmd.h.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_PROTO_H__
+#define __SCD30_PROTO_H__
+
+# include "SCD30.h"
+
+/* debug level of the SCD30 driver (see setDebug()) */
+extern int SCD_DEBUG;
+
+/* I2C retries on a failed transaction */
+# define PROTO_RETRY 3
+
+/*********************************************************************
+ * @brief calculate the Sensirion CRC8 (x^8+x^5+x^4+1, init 0xFF)
+ * @param data : bytes to calculate CRC from
+ * @param len : number of bytes in data
+ *********************************************************************/
+static inline uint8_t scd30_crc8(const uint8_t *data, uint8_t len)
+{
+    uint8_t crc = 0xFF;
+
+    for (uint8_t x = 0; x < len; x++)
+    {
+        crc ^= data[x];
+
+        for (uint8_t i = 0; i < 8; i++)
+        {
+            if ((crc & 0x80) != 0) crc = (uint8_t)((crc << 1) ^ 0x31);
+            else crc <<= 1;
+        }
+    }
+
+    return(crc);
+}
+
+/*********************************************************************
+ * @brief run a bus transaction with retry
+ * @param bus : transport policy
+ * @param rd : true is read, false is write
+ * @param buf : bytes to write or to store the bytes read
+ * @param len : number of bytes
+ * @param retried : incremented on each retry
+ * @param debug : show the retries (SCD_DEBUG > 1)
+ *
+ * A clock stretch timeout is not retried : it would block the bus 
+ * again.
+ *
+ * @return status of the last attempt
+ *********************************************************************/
+template <class T> static inline Wstatus scd30_retry(T &bus, bool rd, char *buf, uint32_t len, 
+    uint32_t *retried, bool debug)
+{
+    Wstatus result;
+    int     retry = PROTO_RETRY;
+
+    while ((result = rd ? bus.read(buf, len) : bus.write(buf, len)) != I2C_OK)
+    {
+        if (debug && SCD_DEBUG > 1) p_printf(YELLOW, (char *) " %s retrying. result %d\n", rd ? "read" : "send", result);
+
+        if (result == I2C_SCL_CLKSTR || retry-- == 0) break;
+
+        (*retried)++;
+    }
+
+    return(result);
+}
+
+/*********************************************************************
+ * @brief check the CRC of each word of an answer and remove it
+ * @param buff : answer as received, each word followed by its CRC
+ * @param val : to store the data bytes
+ * @param cnt : number of data bytes
+ *
+ * @return -1 if OK, else the offset in buff of the CRC that is wrong
+ *********************************************************************/
+static inline int scd30_unpack(const uint8_t *buff, uint8_t *val, uint8_t cnt)
+{
+    int     x, y;
+
+    for (x = 0, y = 0; y < cnt; x += 3, y += 2)
+    {
+        if (scd30_crc8(&buff[x], 2) != buff[x + 2]) return(x + 2);
+
+        val[y] = buff[x];
+        val[y + 1] = buff[x + 1];
+    }
+
+    return(-1);
+}
+
+/* protocol statistics */
+struct scd30_proto_stats
+{
+    uint32_t    commands;               // commands sent
+    uint32_t    reads;                  // read transactions
+    uint32_t    retries;                // I2C retries
+    uint32_t    write_errors;           // failed writes (after retry)
+    uint32_t    read_errors;            // failed reads (after retry)
+    uint32_t    crc_errors;             // CRC mismatch on received data
+};
+
+template <class Transport, int Debug = 0>
+class SCD30Proto
+{
+  public:
+
+    /*! the transport (open it before use) */
+    Transport   bus;
+
+    /*! statistics */
+    scd30_proto_stats stats;
+
+    SCD30Proto() { memset(&stats, 0x0, sizeof(stats)); limit = 0; }
+
+    /*! Sends just a command, no arguments, no CRC
+     * @return true if OK, false in case of error */
+    bool sendCommand(uint16_t command)
+    {
+        return(send(command, 0x0, 2));
+    }
+
+    /*! Sends a command along with arguments and CRC
+     * @return true if OK, false in case of error */
+    bool sendCommand(uint16_t command, uint16_t arguments)
+    {
+        return(send(command, arguments, 5));
+    }
+
+    /*! send a command without argument
+     * @return true if OK, false in case of error */
+    template <scd30_cmd_id C> bool send()
+    {
+        static_assert(! scd30_cmds[C].arg, "command needs an argument");
+        return(send(scd30_cmds[C].code, 0x0, 2));
+    }
+
+    /*! send a command with argument (user units, range checked)
+     * @return true if OK, false in case of error or out of range */
+    template <scd30_cmd_id C> bool send(double val)
+    {
+        static_assert(scd30_cmds[C].arg, "command has no argument");
+        if (! scd30_cmd_valid(C, val)) return(false);
+        return(send(scd30_cmds[C].code, (uint16_t) (int32_t) (val * scd30_cmds[C].scale), 5));
+    }
+
+    /*! send a command with a constant argument (checked at compile time)
+     * @return true if OK, false in case of error */
+    template <scd30_cmd_id C, int32_t V> bool send()
+    {
+        static_assert(scd30_cmd_valid(C, V), "argument out of range");
+        return(send(scd30_cmds[C].code, (uint16_t) (V * scd30_cmds[C].scale), 5));
+    }
+
+    /*! read the answer of a command (CRC removed)
+     * @param val : buffer of exactly the answer size
+     * @return true if OK, false in case of error */
+    template <scd30_cmd_id C> bool read(uint8_t (&val)[scd30_cmds[C].words * 2])
+    {
+        static_assert(scd30_cmds[C].words > 0, "command has no answer");
+        return(answer(scd30_cmds[C].code, val, sizeof(val), scd30_cmds[C].wait_us) == sizeof(val));
+    }
+
+    /*! read bytes with retry
+     * @param buff : buffer to hold the data read
+     * @param len : number of bytes to read
+     *
+     * @return true if OK, false in case of error */
+    bool readbytes(char *buff, uint8_t len)
+    {
+        stats.reads++;
+
+        if (scd30_retry(bus, true, buff, len, &stats.retries, Debug) == I2C_OK) return(true);
+
+        stats.read_errors++;
+        return(false);
+    }
+
+    /*! send command and read the answer (CRC removed)
+     * @param command : SCD30 command
+     * @param val : to store the data received
+     * @param cnt : number of data bytes requested
+     *
+     * @return number of bytes read or 0 in case of error */
+    uint8_t ReadFromSCD30(uint16_t command, uint8_t *val, uint8_t cnt)
+    {
+        const scd30_cmd_desc *desc = scd30_cmd_find(command);
+
+        return(answer(command, val, cnt, desc ? desc->wait_us : 3));
+    }
+
+    /*! read a 16 bit setting
+     * @return true if OK, false in case of error */
+    bool getSettingValue(uint16_t command, uint16_t *val)
+    {
+        const scd30_cmd_desc *desc = scd30_cmd_find(command);
+        uint8_t tmp[2];
+
+        if (desc == NULL || desc->words != 1) return(false);
+
+        if (answer(command, tmp, 2, desc->wait_us) != 2) return(false);
+
+        *val = tmp[0] << 8 | tmp[1];
+
+        return(true);
+    }
+
+    /*! read CO2, temperature and humidity (check data ready first)
+     * @return true if OK, false in case of error */
+    bool readMeasurement(float *co2, float *temperature, float *humidity)
+    {
+        uint8_t  tmp[scd30_cmds[SCD30_CMD_READ_MEAS].words * 2];
+        uint32_t u;
+
+        if (! read<SCD30_CMD_READ_MEAS>(tmp)) return(false);
+
+        u = tmp[0] << 24 | tmp[1] << 16 | tmp[2] << 8 | tmp[3];
+        memcpy(co2, &u, sizeof(u));
+        u = tmp[4] << 24 | tmp[5] << 16 | tmp[6] << 8 | tmp[7];
+        memcpy(temperature, &u, sizeof(u));
+        u = tmp[8] << 24 | tmp[9] << 16 | tmp[10] << 8 | tmp[11];
+        memcpy(humidity, &u, sizeof(u));
+
+        return(true);
+    }
+
+  private:
+
+    /*! clock stretch limit set on the transport (0 = not yet) */
+    uint32_t    limit;
+
+    /*! send command and read the answer (CRC removed)
+     * @param wait : uS between command and reading the answer */
+    uint8_t answer(uint16_t command, uint8_t *val, uint8_t cnt, uint16_t wait)
+    {
+        uint8_t buff[SCD30_ANSWER_MAX];
+        int     x;
+
+        if (! sendCommand(command)) return(0);
+
+        bus.wait_us(wait);  // datasheet may 2020
+
+        if (! readbytes((char *) buff, (cnt / 2) * 3)) return(0);
+
+        if ((x = scd30_unpack(buff, val, cnt)) > -1)
+        {
+            if (Debug && SCD_DEBUG > 1) p_printf(RED, (char *) "crc error on byte %d\n", x);
+            stats.crc_errors++;
+            return(0);
+        }
+
+        if (Debug && SCD_DEBUG > 0)
+        {
+            p_printf(YELLOW, (char *) "Receiving: ");
+            for (x = 0; x < cnt; x++) printf("0x%02X ", val[x]);
+            printf("\n");
+        }
+
+        return(cnt);
+    }
+
+    /*! send command (len 2) or command + argument + CRC (len 5) */
+    bool send(uint16_t command, uint16_t arguments, uint8_t len)
+    {
+        uint8_t buff[5];
+        const scd30_cmd_desc *desc = scd30_cmd_find(command);
+        uint32_t us = desc ? desc->stretch_us : STRETCH_MAX;
+
+        /* budget of this command (and the read of the answer) */
+        if (us != limit)
+        {
+            bus.stretch(us);
+            limit = us;
+        }
+
+        buff[0] = command >> 8;
+        buff[1] = command & 0xff;
+
+        if (len > 2)
+        {
+            buff[2] = arguments >> 8;
+            buff[3] = arguments & 0xff;
+            buff[4] = scd30_crc8(&buff[2], 2);
+        }
+
+        if (Debug && SCD_DEBUG > 0)
+        {
+            p_printf(YELLOW, (char *) "sending command 0x%04x %s, %d bytes\n", command,
+                desc ? desc->name : "COMMAND_UNKNOWN", len);
+        }
+
+        stats.commands++;
+
+        if (scd30_retry(bus, false, (char *) buff, len, &stats.retries, Debug) == I2C_OK) return(true);
+
+        stats.write_errors++;
+        return(false);
+    }
+};
+
+#endif  // End of definition check
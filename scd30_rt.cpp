@@ -0,0 +1,171 @@
+/*******************************************************************
+ *
+ * Real-time execution profile for the SCD30 monitor.
+ *
+ * see scd30_rt.h for details.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "scd30_rt.h"
+# include <sched.h>
+# include <malloc.h>
+# include <sys/mman.h>
+
+/*********************************************************************
+ * @brief pre-fault the stack
+ * 
+ * Touch the stack, so the pages are present (and locked with 
+ * mlockall) before the first deep call during a transaction.
+ *********************************************************************/
+void rt_prefault_stack()
+{
+    volatile char buf[RT_STACK_PREFAULT];
+    int i;
+
+    for (i = 0; i < RT_STACK_PREFAULT; i += 1024) buf[i] = 0;
+    
+    (void) buf[0];
+}
+
+/*********************************************************************
+ * @brief enable the real-time profile 
+ * @param prio : SCHED_FIFO priority 1 - 99
+ * @param cpu : CPU to pin to or -1 to not pin
+ *
+ * @return  true = OK, false is error
+ *********************************************************************/
+bool rt_enable(int prio, int cpu)
+{
+    struct sched_param sp;
+    cpu_set_t set;
+
+    /* do not return freed memory and do not use mmap() for large 
+     * allocations : both would cause page faults later */
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    /* lock current (incl. all static buffers) and future pages */
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+    {
+        p_printf(RED, (char *) "Can not lock memory\n");
+        return(false);
+    }
+
+    rt_prefault_stack();
+
+    if (cpu > -1)
+    {
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+
+        if (sched_setaffinity(0, sizeof(set), &set) < 0)
+        {
+            p_printf(RED, (char *) "Can not pin to CPU %d\n", cpu);
+            return(false);
+        }
+    }
+
+    /* child processes (Dylos reader) are set back to normal */
+    memset(&sp, 0x0, sizeof(sp));
+    sp.sched_priority = prio;
+
+    if (sched_setscheduler(0, SCHED_FIFO | SCHED_RESET_ON_FORK, &sp) < 0)
+    {
+        p_printf(RED, (char *) "Can not set SCHED_FIFO priority %d\n", prio);
+        return(false);
+    }
+
+    return(true);
+}
+
+/*********************************************************************
+ * @brief compare for qsort()
+ *********************************************************************/
+int rt_cmp(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+
+    return(x < y ? -1 : x > y);
+}
+
+/*********************************************************************
+ * @brief measure the transaction jitter with data ready checks
+ * @param dev : SCD30 to use
+ * @param count : number of checks (max RT_JITTER_SAMPLES)
+ * @param res : to store the result
+ *
+ * The data ready check is one write and one read of 3 bytes. It is 
+ * the most frequent transaction and does not disturb the measurement.
+ *********************************************************************/
+void rt_measure(SCD30 *dev, int count, struct rt_jitter *res)
+{
+    uint32_t tm[RT_JITTER_SAMPLES];
+    struct timespec start, end;
+    scd30_stats before, after;
+    uint64_t sum = 0, sumsq = 0;
+    int i;
+
+    if (count > RT_JITTER_SAMPLES) count = RT_JITTER_SAMPLES;
+    if (count < 1) count = 1;
+
+    memset(res, 0x0, sizeof(struct rt_jitter));
+    
+    dev->getStats(&before);
+
+    for (i = 0; i < count; i++)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        dev->dataAvailable();
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        tm[i] = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
+        sum += tm[i];
+        sumsq += (uint64_t) tm[i] * tm[i];
+
+        /* do not keep the bus busy all the time */
+        usleep(10000);
+    }
+
+    dev->getStats(&after);
+
+    qsort(tm, count, sizeof(uint32_t), rt_cmp);
+
+    res->count = count;
+    res->min = tm[0];
+    res->max = tm[count - 1];
+    /* nearest rank : with RT_JITTER_SAMPLES a p99 would just be the max */
+    res->p90 = tm[(count * 90 + 99) / 100 - 1];
+    res->mean = sum / count;
+    res->stddev = sqrt((double) sumsq / count - (double) res->mean * res->mean);
+    res->retries = after.retries - before.retries;
+    res->crc_errors = after.crc_errors - before.crc_errors;
+    res->errors = (after.read_errors - before.read_errors) + (after.write_errors - before.write_errors);
+}
+
+/*********************************************************************
+ * @brief display jitter measurement
+ * @param title : to display
+ * @param res : result of rt_measure()
+ *********************************************************************/
+void rt_report(const char *title, struct rt_jitter *res)
+{
+    p_printf(YELLOW, (char *) "%-10s %d checks (uS) min %u mean %u max %u p90 %u stddev %u  retries %u crc errors %u errors %u\n",
+    title, res->count, res->min, res->mean, res->max, res->p90, res->stddev, res->retries, res->crc_errors, res->errors);
+}
@@ -0,0 +1,84 @@
+/*******************************************************************
+ *
+ * Real-time execution profile for the SCD30 monitor.
+ *
+ * soft_I2C is bit-banged by the program itself. If the program is 
+ * preempted in the middle of a transaction, the timing is disturbed
+ * which results in clock stretch, NACK and CRC errors and retries. 
+ * 
+ * The RT profile (opt-in) will :
+ *  - set SCHED_FIFO priority (children like the Dylos reader are reset
+ *    to normal scheduling as they are busy polling)
+ *  - pin the program to a CPU
+ *  - lock all memory (mlockall) and stop returning freed memory to
+ *    the kernel, so there are no page faults during a transaction
+ *  - pre-fault the stack
+ * 
+ * This requires root permission.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_RT_H__
+#define __SCD30_RT_H__
+
+# include "SCD30.h"
+
+/* bytes of stack to pre-fault */
+# define RT_STACK_PREFAULT (64 * 1024)
+
+/* number of transactions to measure jitter */
+# define RT_JITTER_SAMPLES 50
+
+/* result of jitter measurement (times in uS) */
+struct rt_jitter
+{
+    int         count;          // data ready checks measured
+    uint32_t    min;            // shortest
+    uint32_t    max;            // longest
+    uint32_t    mean;           // average
+    uint32_t    stddev;         // standard deviation
+    uint32_t    p90;            // 90 percentile
+    uint32_t    retries;        // I2C retries during measurement
+    uint32_t    crc_errors;     // CRC errors during measurement
+    uint32_t    errors;         // read / write errors during measurement
+};
+
+/*! enable the real-time profile 
+ * @param prio : SCHED_FIFO priority 1 - 99
+ * @param cpu : CPU to pin to or -1 to not pin
+ *
+ * @return  true = OK, false is error
+ */
+bool rt_enable(int prio, int cpu);
+
+/*! measure the transaction jitter with data ready checks
+ * @param dev : SCD30 to use
+ * @param count : number of checks (max RT_JITTER_SAMPLES)
+ * @param res : to store the result
+ */
+void rt_measure(SCD30 *dev, int count, struct rt_jitter *res);
+
+/*! display jitter measurement
+ * @param title : to display
+ * @param res : result of rt_measure()
+ */
+void rt_report(const char *title, struct rt_jitter *res);
+
+#endif  // End of definition check
@@ -0,0 +1,466 @@
+/*******************************************************************
+ *
+ * Bit-level virtual I2C bus with a simulated SCD30.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "scd30_sim.h"
+# include "scd30_proto.h"
+# include <errno.h>
+
+/* VCD identifiers */
+# define SIM_VCD_SCL 1                  // '!'
+# define SIM_VCD_SDA 2                  // '"'
+# define SIM_VCD_DEV 4                  // '#' SDA released by the SCD30
+
+/*********************************************************************
+ * @brief write the levels to the VCD file if they changed
+ * @param sim : simulator
+ *********************************************************************/
+static void sim_vcd(struct scd30_sim *sim)
+{
+    struct timespec now;
+    uint32_t lev, val;
+
+    if (sim->vcd == NULL) return;
+
+    lev = sim->gpio->levels();
+
+    val = (lev >> sim->scl & 1 ? SIM_VCD_SCL : 0) | (lev >> sim->sda & 1 ? SIM_VCD_SDA : 0) |
+        (sim->gpio->held >> sim->sda & 1 ? 0 : SIM_VCD_DEV);
+
+    if (val == sim->vcd_prev) return;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    fprintf(sim->vcd, "#%lu\n", (unsigned long) ((now.tv_sec - sim->t0.tv_sec) * 1000000000UL +
+        now.tv_nsec - sim->t0.tv_nsec));
+
+    if ((val ^ sim->vcd_prev) & SIM_VCD_SCL) fprintf(sim->vcd, "%d!\n", val & SIM_VCD_SCL ? 1 : 0);
+    if ((val ^ sim->vcd_prev) & SIM_VCD_SDA) fprintf(sim->vcd, "%d\"\n", val & SIM_VCD_SDA ? 1 : 0);
+    if ((val ^ sim->vcd_prev) & SIM_VCD_DEV) fprintf(sim->vcd, "%d#\n", val & SIM_VCD_DEV ? 1 : 0);
+
+    sim->vcd_prev = val;
+}
+
+/*********************************************************************
+ * @brief hold SDA low or release it
+ * @param sim : simulator
+ * @param high : release
+ *********************************************************************/
+static void sim_sda(struct scd30_sim *sim, bool high)
+{
+    if (high) sim->gpio->held &= ~(1U << sim->sda);
+    else sim->gpio->held |= 1U << sim->sda;
+}
+
+/*********************************************************************
+ * @brief execute a command without argument (at stop or repeated start)
+ * @param sim : simulator
+ *********************************************************************/
+static void sim_execute(struct scd30_sim *sim)
+{
+    if (sim->state == SIM_WRITE && sim->wlen == 2 && ! sim->done)
+    {
+        if (emul_write(&sim->emul, (char *) sim->wbuf, 2) == I2C_OK) sim->commands++;
+    }
+
+    sim->wlen = 0;
+}
+
+/*********************************************************************
+ * @brief 8 bits done : ACK or NACK on the 9th clock
+ * @param sim : simulator
+ *********************************************************************/
+static void sim_byte(struct scd30_sim *sim)
+{
+    const scd30_cmd_desc *desc;
+
+    sim->cnt.bytes++;
+    sim->nack = false;
+
+    switch(sim->state)
+    {
+    case SIM_ADDR:
+        /* not addressed : off the bus until the stop */
+        if ((sim->shift >> 1) != SIM_ADDRESS)
+        {
+            sim->state = SIM_IDLE;
+            return;
+        }
+
+        /* read : the answer of the last command */
+        if ((sim->rd = sim->shift & 1))
+            sim->nack = emul_read(&sim->emul, (char *) sim->rbuf, sizeof(sim->rbuf)) != I2C_OK;
+        break;
+
+    case SIM_WRITE:
+        if (sim->wlen >= sizeof(sim->wbuf))
+        {
+            sim->nack = true;
+            break;
+        }
+
+        sim->wbuf[sim->wlen++] = sim->shift;
+
+        /* first byte of the command */
+        if (sim->wlen < 2) break;
+
+        desc = scd30_cmd_find(sim->wbuf[0] << 8 | sim->wbuf[1]);
+
+        if (desc == NULL) sim->nack = true;
+        else if (sim->wlen == 2) break;
+        else if (sim->wlen < 5) sim->nack = ! desc->arg;
+        else if (emul_write(&sim->emul, (char *) sim->wbuf, 5) != I2C_OK) sim->nack = true;
+        else
+        {
+            sim->done = true;
+            sim->commands++;
+        }
+        break;
+
+    case SIM_READ:
+        /* the master acknowledges */
+        sim_sda(sim, true);
+        return;
+
+    default:
+        return;
+    }
+
+    if (sim->nack) sim->cnt.nacks++;
+    else
+    {
+        sim->cnt.acks++;
+        sim_sda(sim, false);
+    }
+}
+
+/*********************************************************************
+ * @brief 9th clock done : next byte
+ * @param sim : simulator
+ *********************************************************************/
+static void sim_next(struct scd30_sim *sim)
+{
+    sim->bit = 0;
+    sim->shift = 0;
+
+    switch(sim->state)
+    {
+    case SIM_ADDR:
+        if (sim->nack) sim->state = SIM_IDLE;
+        else if (sim->rd)
+        {
+            sim->state = SIM_READ;
+            sim->rpos = 0;
+
+            /* preparing the answer : the next clock is stretched */
+            sim->gpio->stretch_us = sim->stretch_us;
+            sim_sda(sim, sim->rbuf[0] >> 7 & 1);
+            return;
+        }
+        else
+        {
+            sim->state = SIM_WRITE;
+            sim->wlen = 0;
+            sim->done = false;
+        }
+        break;
+
+    case SIM_WRITE:
+        if (sim->nack) sim->state = SIM_IDLE;
+        break;
+
+    case SIM_READ:
+        /* NACK of the master : last byte */
+        if (sim->nack || sim->rpos + 1 >= sizeof(sim->rbuf)) sim->state = SIM_IDLE;
+        else
+        {
+            sim->rpos++;
+            sim_sda(sim, sim->rbuf[sim->rpos] >> 7 & 1);
+            return;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    sim_sda(sim, true);
+}
+
+/*********************************************************************
+ * @brief the SCD30 on the bus : called on each change of the levels
+ * @param ctx : simulator
+ * @param lev : levels
+ *********************************************************************/
+static void sim_change(void *ctx, uint32_t lev)
+{
+    struct scd30_sim *sim = (struct scd30_sim *) ctx;
+    bool    scl = lev >> sim->scl & 1, sda = lev >> sim->sda & 1;
+    bool    scl_was = sim->prev >> sim->scl & 1, sda_was = sim->prev >> sim->sda & 1;
+
+    sim->prev = lev;
+
+    if (scl != scl_was) sim->cnt.scl_edges++;
+    if (sda != sda_was) sim->cnt.sda_edges++;
+
+    /* start or stop : the SCD30 itself only changes SDA while SCL is low */
+    if (scl && scl_was && sda != sda_was)
+    {
+        sim_execute(sim);
+
+        if (! sda)
+        {
+            sim->starts++;
+            sim->state = SIM_ADDR;
+            sim->bit = -1;
+            sim->shift = 0;
+        }
+        else
+        {
+            sim->stops++;
+            sim->state = SIM_IDLE;
+        }
+
+        sim_sda(sim, true);
+    }
+    else if (sim->state != SIM_IDLE)
+    {
+        /* rising : sample a bit of the master or its ACK */
+        if (scl && ! scl_was)
+        {
+            if (sim->bit >= 0 && sim->bit < 8 && sim->state != SIM_READ) sim->shift = sim->shift << 1 | sda;
+            else if (sim->bit == 8 && sim->state == SIM_READ) sim->nack = sda;
+
+            /* a stretch ends with the rising edge */
+            sim->gpio->stretch_us = 0;
+        }
+
+        /* falling : the SCD30 sets SDA for the next bit */
+        else if (! scl && scl_was)
+        {
+            sim->bit++;
+
+            if (sim->bit == 8) sim_byte(sim);
+            else if (sim->bit == 9) sim_next(sim);
+            else if (sim->state == SIM_READ && sim->bit > 0)
+                sim_sda(sim, sim->rbuf[sim->rpos] >> (7 - sim->bit) & 1);
+        }
+    }
+
+    sim_vcd(sim);
+}
+
+/*********************************************************************
+ * @brief connect a simulated SCD30 to the lines of a mock register block
+ * @param sim : simulator
+ * @param gpio : mock register block (opened)
+ * @param sda : SDA line
+ * @param scl : SCL line
+ * @param vcd : VCD file to write (NULL = none)
+ *
+ * @return true = OK, false is error
+ *********************************************************************/
+bool sim_init(struct scd30_sim *sim, MockGpio *gpio, uint8_t sda, uint8_t scl, const char *vcd)
+{
+    memset(sim, 0x0, sizeof(struct scd30_sim));
+
+    sim->gpio = gpio;
+    sim->sda = sda;
+    sim->scl = scl;
+    sim->state = SIM_IDLE;
+    emul_init(&sim->emul, true);
+
+    clock_gettime(CLOCK_MONOTONIC, &sim->t0);
+
+    if (vcd)
+    {
+        if ((sim->vcd = fopen(vcd, "w")) == NULL)
+        {
+            p_printf(RED, (char *) "Can not create %s : %s\n", vcd, strerror(errno));
+            return(false);
+        }
+
+        fprintf(sim->vcd, "$version scd30 I2C simulator $end\n$timescale 1 ns $end\n");
+        fprintf(sim->vcd, "$scope module i2c $end\n");
+        fprintf(sim->vcd, "$var wire 1 ! SCL $end\n$var wire 1 \" SDA $end\n$var wire 1 # SDA_SCD30 $end\n");
+        fprintf(sim->vcd, "$upscope $end\n$enddefinitions $end\n");
+        fprintf(sim->vcd, "$dumpvars\n1!\n1\"\n1#\n$end\n");
+        sim->vcd_prev = SIM_VCD_SCL | SIM_VCD_SDA | SIM_VCD_DEV;
+    }
+
+    sim->prev = gpio->levels();
+    gpio->scl = scl;
+    gpio->stretch_us = 0;
+    gpio->ctx = sim;
+    gpio->change = sim_change;
+
+    return(true);
+}
+
+/*********************************************************************
+ * @brief disconnect and close the VCD file
+ * @param sim : simulator
+ *********************************************************************/
+void sim_close(struct scd30_sim *sim)
+{
+    sim->gpio->change = NULL;
+    sim->gpio->ctx = NULL;
+    sim->gpio->held = 0;
+    sim->gpio->stretch_us = 0;
+
+    if (sim->vcd) fclose(sim->vcd);
+    sim->vcd = NULL;
+}
+
+/* engine on the virtual bus, counters per transaction */
+class SimTransport
+{
+  public:
+    SoftI2c<MockGpio> i2c;
+    struct scd30_sim *sim;
+    const char  *name;                  // last command written
+
+    /* totals */
+    uint32_t    transactions;
+    uint32_t    edges;
+    uint64_t    busy_ns;
+    uint64_t    spin_ns;
+
+    SimTransport() { sim = NULL; name = ""; transactions = edges = 0; busy_ns = spin_ns = 0; }
+
+    Wstatus write(const char *buf, uint32_t len) { return(transfer(false, (char *) buf, len)); }
+    Wstatus read(char *buf, uint32_t len) { return(transfer(true, buf, len)); }
+    void wait_us(uint32_t us) { usleep(us); }
+    void stretch(uint32_t us) { i2c.setClockStretchLimit(us); }
+
+    /*! one transaction, show its counters
+     * @param rd : read
+     * @param buf : bytes to write or to store the bytes read
+     * @param len : number of bytes
+     * @return as i2c_write() */
+    Wstatus transfer(bool rd, char *buf, uint32_t len)
+    {
+        const scd30_cmd_desc *desc;
+        struct gpio_stats st = i2c.stats;
+        uint32_t io = i2c.gpio.reads + i2c.gpio.writes;
+        Wstatus ret;
+
+        if (! rd && len >= 2)
+            name = (desc = scd30_cmd_find((uint8_t) buf[0] << 8 | (uint8_t) buf[1])) ? desc->name : "unknown";
+
+        memset(&sim->cnt, 0x0, sizeof(struct sim_count));
+
+        ret = rd ? i2c.i2c_read(buf, len) : i2c.i2c_write(buf, len);
+
+        p_printf(WHITE, (char *) "%-5s %-40.40s %3u %3u %3u %4u %3u %8.1f %8.1f %8.1f %5u %s\n",
+            rd ? "read" : "write", name, sim->cnt.bytes, sim->cnt.acks, sim->cnt.nacks,
+            sim->cnt.scl_edges, sim->cnt.sda_edges,
+            (double) (i2c.stats.busy_ns - st.busy_ns) / 1000, (double) (i2c.stats.spin_ns - st.spin_ns) / 1000,
+            (double) (i2c.stats.stretch_ns - st.stretch_ns) / 1000,
+            i2c.gpio.reads + i2c.gpio.writes - io, ret == I2C_OK ? "OK" : ret == I2C_SDA_NACK ? "NACK" : "ERROR");
+
+        transactions++;
+        edges += sim->cnt.scl_edges + sim->cnt.sda_edges;
+        busy_ns += i2c.stats.busy_ns - st.busy_ns;
+        spin_ns += i2c.stats.spin_ns - st.spin_ns;
+
+        return(ret);
+    }
+};
+
+/* simulated SCD30 and protocol layer for sim_run() */
+static struct scd30_sim sim;
+static SCD30Proto<SimTransport> sim_scd;
+
+/*********************************************************************
+ * @brief show one result of the run
+ *********************************************************************/
+static bool sim_result(bool ok, const char *what)
+{
+    p_printf(ok ? GREEN : RED, (char *) "%-40s %s\n", what, ok ? "PASSED" : "FAILED");
+    return(ok);
+}
+
+/*********************************************************************
+ * @brief run a measurement cycle through the engine on the simulated
+ * SCD30, show the counters per transaction
+ * @param khz : clock of the engine
+ * @param stretch_us : clock stretch after a read address
+ * @param vcd : VCD file to write (NULL = none)
+ *
+ * @return true = all transactions and values correct
+ *********************************************************************/
+bool sim_run(uint32_t khz, uint32_t stretch_us, const char *vcd)
+{
+    SimTransport *bus = &sim_scd.bus;
+    const char bad_crc[5] = {0x46, 0x00, 0x00, 0x02, 0x00};
+    uint8_t ready[2];
+    uint16_t fw;
+    float   co2, temperature, humidity;
+    bool    ok = true;
+
+    if (! bus->i2c.begin(DEF_SDA, DEF_SCL)) return(false);
+
+    bus->i2c.setSlave(SIM_ADDRESS);
+    bus->i2c.setClock(khz);
+    bus->i2c.setClockStretchLimit(STRETCH_MAX);
+
+    if (! sim_init(&sim, &bus->i2c.gpio, DEF_SDA, DEF_SCL, vcd)) return(false);
+
+    bus->sim = &sim;
+    sim.stretch_us = stretch_us;
+    emul_set(&sim.emul, 812, 22.5, 48.25);
+
+    p_printf(YELLOW, (char *) "simulated SCD30 at %u Khz, clock stretch %u uS after a read address%s%s\n",
+        khz, stretch_us, vcd ? ", waveform to " : "", vcd ? vcd : "");
+    p_printf(YELLOW, (char *) "%-5s %-40s %3s %3s %3s %4s %3s %8s %8s %8s %5s\n", "", "command",
+        "byt", "ack", "nak", "scl", "sda", "uS", "spin uS", "strch uS", "regs");
+
+    ok &= sim_result(sim_scd.send<SCD30_CMD_START, 0>(), "start measurement");
+    ok &= sim_result(sim_scd.send<SCD30_CMD_INTERVAL, 2>() && sim.emul.interval == 2, "set interval");
+    ok &= sim_result(sim_scd.read<SCD30_CMD_DATA_READY>(ready) && ready[1] == 1, "data ready");
+    ok &= sim_result(sim_scd.readMeasurement(&co2, &temperature, &humidity) &&
+        co2 == 812 && temperature == 22.5 && humidity == 48.25, "read measurement (CRC checked)");
+    ok &= sim_result(sim_scd.getSettingValue(CMD_GET_FW_LEVEL, &fw) && fw == EMUL_FW, "firmware level");
+
+    /* NACK on the CRC byte */
+    ok &= sim_result(bus->write(bad_crc, sizeof(bad_crc)) == I2C_SDA_DATA, "argument with wrong CRC : NACK");
+
+    /* an other address */
+    bus->i2c.setSlave(SIM_ADDRESS + 1);
+    ok &= sim_result(bus->write(bad_crc, 2) == I2C_SDA_NACK, "other address : NACK");
+    bus->i2c.setSlave(SIM_ADDRESS);
+
+    ok &= sim_result(sim_scd.send<SCD30_CMD_STOP>() && ! sim.emul.measuring, "stop measurement");
+
+    ok &= sim_result(sim.starts == sim.stops && sim.starts == bus->transactions, "start / stop per transaction");
+
+    p_printf(WHITE, (char *) "%u transactions, %u edges, %u commands executed, %.1f uS on the bus, %.1f uS busy-waiting\n",
+        bus->transactions, bus->edges, sim.commands, (double) bus->busy_ns / 1000, (double) bus->spin_ns / 1000);
+    p_printf(WHITE, (char *) "clock stretched %u times, longest %u uS, %u sleeps\n",
+        bus->i2c.stats.stretches, bus->i2c.stats.stretch_max, bus->i2c.stats.naps);
+
+    sim_close(&sim);
+    bus->i2c.close();
+
+    return(ok);
+}
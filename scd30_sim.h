@@ -0,0 +1,144 @@
+/*******************************************************************
+ *
+ * Bit-level virtual I2C bus with a simulated SCD30.
+ *
+ * The built-in soft-I2C engine (scd30_gpio.h) drives the open drain
+ * SDA / SCL lines of a mock register block (MockGpio). On each change
+ * of the levels the SCD30 state machine below is called, as the SCD30
+ * sees the bus :
+ *
+ *  start / stop   : SDA falls / rises while SCL is high
+ *  address        : 7 bits + R/W sampled on the rising SCL edges, ACK
+ *                   (SDA held low on the 9th clock) for SIM_ADDRESS,
+ *                   otherwise the SCD30 stays off the bus until a stop
+ *  write          : command (2 bytes) and argument + CRC. An unknown
+ *                   command, a wrong CRC or an argument out of range is
+ *                   NACKed on that byte
+ *  read           : answer words + CRC from the emulated SCD30
+ *                   (scd30_emul.h), each bit set on the falling SCL
+ *                   edge. The SCD30 stops on the NACK of the master
+ *  clock stretch  : SCL is held low stretch_us after the ACK of a read
+ *                   address, while the SCD30 prepares the answer
+ *
+ * The commands are executed by the emulated SCD30 : a write with
+ * argument on the ACK of the CRC byte, a command without argument at
+ * the stop (or repeated start).
+ *
+ * Each change of SCL, SDA and the SDA held by the SCD30 can be written
+ * to a VCD file (any waveform viewer, e.g. GTKWave) with the time in
+ * nS. The end of a clock stretch is recorded when the engine reads the
+ * levels. Per transaction (start to stop) the edges, bytes, time,
+ * busy-wait time and register accesses of the engine are counted.
+ *
+ * Nothing of the hardware is used : soft-I2C changes can be checked
+ * and compared on any Linux machine (-V).
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_SIM_H__
+#define __SCD30_SIM_H__
+
+# include "SCD30.h"
+# include "scd30_emul.h"
+
+/* address the simulated SCD30 answers */
+# define SIM_ADDRESS SCD30_ADDRESS
+
+/* default clock stretch after a read address in uS */
+# define SIM_STRETCH 1000
+
+enum sim_state
+{
+    SIM_IDLE,                           // no transaction or not addressed
+    SIM_ADDR,                           // receiving the address
+    SIM_WRITE,                          // receiving command bytes
+    SIM_READ                            // sending the answer
+};
+
+/* counters of a transaction (start to stop) */
+struct sim_count
+{
+    uint32_t    scl_edges;
+    uint32_t    sda_edges;
+    uint32_t    bytes;                  // incl. address
+    uint32_t    acks;                   // sent by the SCD30
+    uint32_t    nacks;
+};
+
+struct scd30_sim
+{
+    MockGpio    *gpio;                  // bus lines
+    uint8_t     sda;
+    uint8_t     scl;
+    struct scd30_emul emul;             // executes the commands
+    uint32_t    stretch_us;             // after a read address (0 = none)
+
+    /* state machine */
+    uint32_t    prev;                   // levels at the last call
+    enum sim_state state;
+    int         bit;                    // bit in the byte (-1 after start, 8 = ACK)
+    uint8_t     shift;                  // byte received
+    bool        nack;                   // byte is not acknowledged
+    bool        rd;                     // read transaction
+    uint8_t     wbuf[5];                // command received
+    uint32_t    wlen;
+    bool        done;                   // command with argument executed
+    uint8_t     rbuf[SCD30_ANSWER_MAX]; // answer
+    uint32_t    rpos;
+
+    /* statistics */
+    struct sim_count cnt;               // current transaction
+    uint32_t    starts;
+    uint32_t    stops;
+    uint32_t    commands;               // executed by the emulated SCD30
+
+    /* waveform */
+    FILE        *vcd;                   // NULL = not recorded
+    uint32_t    vcd_prev;               // values last written
+    struct timespec t0;                 // time 0
+};
+
+/*! connect a simulated SCD30 to the lines of a mock register block
+ * @param sim : simulator
+ * @param gpio : mock register block (opened)
+ * @param sda : SDA line
+ * @param scl : SCL line
+ * @param vcd : VCD file to write (NULL = none)
+ *
+ * @return true = OK, false is error
+ */
+bool sim_init(struct scd30_sim *sim, MockGpio *gpio, uint8_t sda, uint8_t scl, const char *vcd);
+
+/*! disconnect and close the VCD file
+ * @param sim : simulator
+ */
+void sim_close(struct scd30_sim *sim);
+
+/*! run a measurement cycle through the engine on the simulated SCD30,
+ * show the counters per transaction
+ * @param khz : clock of the engine
+ * @param stretch_us : clock stretch after a read address
+ * @param vcd : VCD file to write (NULL = none)
+ *
+ * @return true = all transactions and values correct
+ */
+bool sim_run(uint32_t khz, uint32_t stretch_us, const char *vcd);
+
+#endif  // End of definition check
@@ -0,0 +1,154 @@
+/*******************************************************************
+ *
+ * Output sinks for the SCD30 monitor.
+ *
+ * A sink is either stdout or a file that is appended to. Sinks are
+ * shared : multiple sensors writing to the same path use the same sink,
+ * which is only closed once the last user has released it.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "SCD30.h"
+# include "scd30_sink.h"
+# include "scd30_usage.h"
+# include "scd30_trace.h"
+
+/* available sinks */
+struct scd30_sink sinks[SINK_MAX];
+
+/*********************************************************************
+ * @brief obtain a sink
+ * @param path : file to append to or SINK_STDOUT
+ *
+ * if the sink is already open, it is shared.
+ *
+ * @return pointer to sink or NULL in case of error
+ *********************************************************************/
+struct scd30_sink *sink_open(const char *path)
+{
+    int i, fr = -1;
+
+    if (path == NULL || *path == 0x0) path = SINK_STDOUT;
+
+    if (strlen(path) >= SINK_PATHLEN)
+    {
+        p_printf(RED, (char *) "Output path too long : %s\n", path);
+        return(NULL);
+    }
+
+    for (i = 0; i < SINK_MAX; i++)
+    {
+        if (sinks[i].users == 0)
+        {
+            if (fr == -1) fr = i;
+        }
+        else if (strcmp(sinks[i].path, path) == 0)
+        {
+            sinks[i].users++;
+            return(&sinks[i]);
+        }
+    }
+
+    if (fr == -1)
+    {
+        p_printf(RED, (char *) "Too many outputs open\n");
+        return(NULL);
+    }
+
+    if (strcmp(path, SINK_STDOUT) == 0)
+        sinks[fr].fp = stdout;
+
+    else if ((sinks[fr].fp = fopen(path, "a")) == NULL)
+    {
+        p_printf(RED, (char *) "Can not open output %s\n", path);
+        return(NULL);
+    }
+
+    /* flushed at the end of each line by sink_printf() */
+    else setvbuf(sinks[fr].fp, sinks[fr].buf, _IOFBF, SINK_BUFSIZE);
+
+    strcpy(sinks[fr].path, path);
+    sinks[fr].users = 1;
+    sinks[fr].lines = sinks[fr].errors = 0;
+
+    return(&sinks[fr]);
+}
+
+/*********************************************************************
+ * @brief release a sink
+ * @param s : sink obtained with sink_open()
+ *********************************************************************/
+void sink_close(struct scd30_sink *s)
+{
+    if (s == NULL || s->users == 0) return;
+
+    if (--s->users > 0) return;
+
+    if (s->fp != stdout) fclose(s->fp);
+    else fflush(stdout);
+
+    s->fp = NULL;
+}
+
+/*********************************************************************
+ * @brief write formatted output to a sink (same as printf)
+ * @param s : sink obtained with sink_open()
+ * @param format : format + arguments
+ *
+ * A sink is flushed at the end of each line, so that a reader
+ * (like tail -f) sees complete results.
+ *********************************************************************/
+void sink_printf(struct scd30_sink *s, const char *format, ...)
+{
+    va_list arg;
+
+    if (s == NULL || s->fp == NULL) return;
+
+    va_start (arg, format);
+    if (vfprintf (s->fp, format, arg) < 0) s->errors++;
+    va_end (arg);
+
+    if (format[strlen(format) - 1] == '\n')
+    {
+        s->lines++;
+        sink_flush(s);
+    }
+}
+
+/*********************************************************************
+ * @brief flush a sink
+ * @param s : sink obtained with sink_open()
+ *********************************************************************/
+void sink_flush(struct scd30_sink *s)
+{
+    int prev;
+
+    if (s == NULL || s->fp == NULL) return;
+
+    SCD30_TRACE_CLOCK(start);
+
+    prev = usage_enter(USAGE_SINK);
+
+    if (fflush(s->fp) != 0) s->errors++;
+
+    SCD30_TRACE3(sink_flush, s->lines, s->errors, SCD30_TRACE_US(start));
+
+    usage_leave(prev);
+}
@@ -0,0 +1,84 @@
+/*******************************************************************
+ *
+ * Output sinks for the SCD30 monitor.
+ *
+ * A sink is either stdout or a file that is appended to. Sinks are
+ * shared : multiple sensors writing to the same path use the same sink,
+ * which is only closed once the last user has released it.
+ *
+ * A file sink writes through its own buffer in the sink table, so no
+ * memory is allocated once it is open.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_SINK_H__
+#define __SCD30_SINK_H__
+
+# include <stdio.h>
+# include <stdint.h>
+
+/* max. number of sinks open at the same time */
+# define SINK_MAX 16
+
+/* max. length of sink path */
+# define SINK_PATHLEN 100
+
+/* output buffer of a file sink */
+# define SINK_BUFSIZE 4096
+
+/* sink name for standard output */
+# define SINK_STDOUT "stdout"
+
+struct scd30_sink
+{
+    int         users;                  // number of users (0 = free)
+    char        path[SINK_PATHLEN];     // file or SINK_STDOUT
+    FILE        *fp;                    // output stream
+    uint32_t    lines;                  // lines written
+    uint32_t    errors;                 // write errors
+    char        buf[SINK_BUFSIZE];      // stream buffer (file)
+};
+
+/*! obtain a sink
+ * @param path : file to append to or SINK_STDOUT
+ *
+ * if the sink is already open, it is shared.
+ *
+ * @return pointer to sink or NULL in case of error
+ */
+struct scd30_sink *sink_open(const char *path);
+
+/*! release a sink
+ * @param s : sink obtained with sink_open()
+ */
+void sink_close(struct scd30_sink *s);
+
+/*! write formatted output to a sink (same as printf)
+ * @param s : sink obtained with sink_open()
+ * @param format : format + arguments
+ */
+void sink_printf(struct scd30_sink *s, const char *format, ...);
+
+/*! flush a sink
+ * @param s : sink obtained with sink_open()
+ */
+void sink_flush(struct scd30_sink *s);
+
+#endif  // End of definition check
@@ -0,0 +1,186 @@
+/*******************************************************************
+ *
+ * I2C speed tuning with error feedback.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "scd30_speed.h"
+
+static const uint16_t speed_rates[SPEED_NUM] = SPEED_RATES;
+
+/*********************************************************************
+ * @brief I2C attempts and errors from the driver statistics
+ * @param dev : the SCD30
+ * @param attempts : to store transactions + retries
+ * @param errors : to store retries, read / write errors and CRC errors
+ *
+ * A retry is an attempt that failed, a read or write error is the last
+ * attempt that failed (NACK, clock stretch or data).
+ *********************************************************************/
+static void speed_count(SCD30 *dev, uint32_t *attempts, uint32_t *errors)
+{
+    scd30_stats st;
+
+    dev->getStats(&st);
+
+    *attempts = st.tr_count + st.retries;
+    *errors = st.retries + st.write_errors + st.read_errors + st.crc_errors;
+}
+
+/*********************************************************************
+ * @brief set the maximum speed and error budget
+ * @param sp : speed tuning
+ * @param name : sensor name for messages
+ * @param max : fastest speed in Khz
+ * @param budget : errors per 1000 I2C attempts
+ *
+ * The counters are not reset (clear the structure before first use)
+ *********************************************************************/
+void speed_init(struct scd30_speed *sp, const char *name, uint16_t max, uint16_t budget)
+{
+    sp->name = name;
+    sp->max = max;
+    sp->budget = budget;
+    sp->rate = 0;
+}
+
+/*********************************************************************
+ * @brief speed in use
+ * @param sp : speed tuning
+ *
+ * @return Khz
+ *********************************************************************/
+uint16_t speed_rate(struct scd30_speed *sp)
+{
+    return(speed_rates[sp->rate]);
+}
+
+/*********************************************************************
+ * @brief find the fastest speed under the error budget and set it
+ * @param sp : speed tuning
+ * @param dev : the SCD30 (must be initialized)
+ *
+ * Only reads are done : data ready, measurement interval and firmware
+ * level. The measurement continues.
+ *
+ * @return speed in Khz that is set
+ *********************************************************************/
+uint16_t speed_calibrate(struct scd30_speed *sp, SCD30 *dev)
+{
+    uint32_t a0, e0, attempts, errors, e;
+    uint16_t val, fw, first_fw = 0;
+    bool    have_fw = false;
+    int     i, r, best = -1;
+
+    sp->calibrations++;
+
+    for (i = 0; i < SPEED_NUM && speed_rates[i] <= sp->max; i++)
+    {
+        /* applied by the driver on the next transaction */
+        dev->settings.baudrate = speed_rates[i];
+
+        speed_count(dev, &a0, &e0);
+
+        for (r = 0, errors = 0; r < SPEED_ROUNDS; r++)
+        {
+            dev->getSettingValue(COMMAND_GET_DATA_READY, &val);
+            dev->getSettingValue(COMMAND_SET_MEASUREMENT_INTERVAL, &val);
+
+            if (! dev->getSettingValue(CMD_GET_FW_LEVEL, &fw)) continue;
+
+            /* passed the CRC, but not what was read before */
+            if (! have_fw) first_fw = fw;
+            else if (fw != first_fw) errors++;
+            have_fw = true;
+        }
+
+        speed_count(dev, &attempts, &e);
+
+        attempts -= a0;
+        errors += e - e0;
+
+        p_printf(YELLOW, (char *) "%s : I2C speed %d Khz, %u errors in %u attempts\n",
+            sp->name, speed_rates[i], errors, attempts);
+
+        /* higher speeds will not do better */
+        if (attempts == 0 || errors * 1000 > attempts * sp->budget) break;
+
+        best = i;
+    }
+
+    if (best < 0)
+    {
+        p_printf(RED, (char *) "%s : I2C errors over the budget at all speeds, using %d Khz\n", sp->name, speed_rates[0]);
+        best = 0;
+    }
+    else
+        p_printf(GREEN, (char *) "%s : I2C speed set to %d Khz\n", sp->name, speed_rates[best]);
+
+    sp->rate = best;
+    dev->settings.baudrate = speed_rates[best];
+
+    /* start monitoring */
+    speed_count(dev, &sp->attempts, &sp->errors);
+
+    return(speed_rates[best]);
+}
+
+/*********************************************************************
+ * @brief check the errors after a read attempt, step down if over budget
+ * @param sp : speed tuning
+ * @param dev : the SCD30
+ *
+ * The errors are compared with the budget of a full window, so a burst
+ * of errors steps down before the window is complete.
+ *
+ * @return true if the speed was lowered
+ *********************************************************************/
+bool speed_check(struct scd30_speed *sp, SCD30 *dev)
+{
+    uint32_t attempts, errors, window;
+
+    if (sp->max == 0) return(false);
+
+    speed_count(dev, &attempts, &errors);
+
+    attempts -= sp->attempts;
+    errors -= sp->errors;
+    window = attempts > SPEED_WINDOW ? attempts : SPEED_WINDOW;
+
+    if (errors * 1000 <= window * sp->budget)
+    {
+        /* start a new window */
+        if (attempts >= SPEED_WINDOW) speed_count(dev, &sp->attempts, &sp->errors);
+        return(false);
+    }
+
+    speed_count(dev, &sp->attempts, &sp->errors);
+
+    if (sp->rate == 0) return(false);
+
+    sp->rate--;
+    sp->stepdowns++;
+    dev->settings.baudrate = speed_rates[sp->rate];
+
+    p_printf(RED, (char *) "%s : %u I2C errors in %u attempts, speed lowered to %d Khz\n",
+        sp->name, errors, attempts, speed_rates[sp->rate]);
+
+    return(true);
+}
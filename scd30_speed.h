@@ -0,0 +1,110 @@
+/*******************************************************************
+ *
+ * I2C speed tuning with error feedback.
+ *
+ * On long cables the I2C speed (-q / 'speed =') is often set low just
+ * to be safe. With speed tuning each SCD30 runs at the fastest speed
+ * that stays under an error budget (errors per 1000 I2C attempts) :
+ *
+ *  calibrate : at each speed from SPEED_RATES, up to the maximum,
+ *              SPEED_ROUNDS rounds of data ready, interval and firmware
+ *              reads are done. Retries, read / write errors (NACK,
+ *              clock stretch, data) and CRC errors are counted from the
+ *              driver statistics and a firmware level that differs from
+ *              the first read counts as error. The first speed over the
+ *              budget ends the pass, the fastest speed under it is used.
+ *
+ *  monitor   : after each read attempt the errors since the start of a
+ *              window of SPEED_WINDOW attempts are checked. When they
+ *              pass the budget of a full window, the speed is stepped
+ *              down one rate and a new window is started.
+ *
+ * The speed is per SCD30 (settings.baudrate) : the driver sets it on
+ * the bus for each transaction, so sensors sharing a bus each run at
+ * their own speed. The data sheet specifies max. 100 Khz.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_SPEED_H__
+#define __SCD30_SPEED_H__
+
+# include "SCD30.h"
+
+/* speeds tried in Khz, ascending */
+# define SPEED_RATES {10, 20, 50, 100, 200, 300, 400}
+# define SPEED_NUM 7
+
+/* rounds of reads per speed during calibration */
+# define SPEED_ROUNDS 20
+
+/* default errors per 1000 I2C attempts */
+# define SPEED_BUDGET 10
+
+/* I2C attempts in a monitoring window */
+# define SPEED_WINDOW 500
+
+struct scd30_speed
+{
+    const char  *name;                  // sensor name for messages
+    uint16_t    max;                    // fastest speed to use (Khz, 0 = not tuning)
+    uint16_t    budget;                 // errors per 1000 attempts
+    int         rate;                   // index of speed in use
+
+    /* statistics at start of window */
+    uint32_t    attempts;
+    uint32_t    errors;
+
+    /* counters */
+    uint32_t    calibrations;           // calibration passes
+    uint32_t    stepdowns;              // speed lowered while monitoring
+};
+
+/*! set the maximum speed and error budget (clear the structure first)
+ * @param sp : speed tuning
+ * @param name : sensor name for messages
+ * @param max : fastest speed in Khz
+ * @param budget : errors per 1000 I2C attempts
+ */
+void speed_init(struct scd30_speed *sp, const char *name, uint16_t max, uint16_t budget);
+
+/*! find the fastest speed under the error budget and set it
+ * @param sp : speed tuning
+ * @param dev : the SCD30 (must be initialized)
+ *
+ * @return speed in Khz that is set
+ */
+uint16_t speed_calibrate(struct scd30_speed *sp, SCD30 *dev);
+
+/*! check the errors after a read attempt, step down if over budget
+ * @param sp : speed tuning
+ * @param dev : the SCD30
+ *
+ * @return true if the speed was lowered
+ */
+bool speed_check(struct scd30_speed *sp, SCD30 *dev);
+
+/*! speed in use
+ * @param sp : speed tuning
+ *
+ * @return Khz
+ */
+uint16_t speed_rate(struct scd30_speed *sp);
+
+#endif  // End of definition check
@@ -0,0 +1,499 @@
+/*******************************************************************
+ *
+ * Work-stealing task executor for emulated sensor workloads.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "scd30_steal.h"
+# include "scd30_transport.h"
+# include "scd30_proto.h"
+# include <sched.h>
+
+/* worker of the calling thread (-1 = not a worker) */
+static __thread int steal_self = -1;
+
+/*********************************************************************
+ * @brief get monotonic time in nano seconds
+ *********************************************************************/
+static uint64_t steal_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return((uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+/*********************************************************************
+ * @brief take the last task from the own deque
+ * @param w : worker
+ * @param t : to store the task
+ *
+ * @return true = task, false is empty
+ *********************************************************************/
+static bool steal_pop(struct steal_worker *w, struct steal_task *t)
+{
+    bool ret = false;
+
+    pthread_mutex_lock(&w->lock);
+
+    if (w->bottom != w->top)
+    {
+        w->bottom--;
+        *t = w->task[w->bottom % STEAL_DEPTH];
+        ret = true;
+    }
+
+    pthread_mutex_unlock(&w->lock);
+
+    return(ret);
+}
+
+/*********************************************************************
+ * @brief take the oldest task from another worker
+ * @param w : worker (thief)
+ * @param t : to store the task
+ *
+ * Victims are tried from a random start. Pinned tasks are skipped :
+ * the oldest task that is not pinned is taken and the pinned tasks
+ * above it move up one place, keeping their order.
+ *
+ * @return true = task, false is nothing to steal
+ *********************************************************************/
+static bool steal_take(struct steal_worker *w, struct steal_task *t)
+{
+    struct steal_pool *p = w->pool;
+    struct steal_worker *v;
+    uint32_t j, k;
+    int     i, start;
+    bool    ret;
+
+    if (p->num < 2) return(false);
+
+    start = rand_r(&w->seed) % p->num;
+
+    for (i = 0; i < p->num; i++)
+    {
+        v = &p->worker[(start + i) % p->num];
+
+        if (v == w || v->bottom == v->top) continue;
+
+        ret = false;
+
+        pthread_mutex_lock(&v->lock);
+
+        for (j = v->top; j != v->bottom; j++)
+        {
+            if (v->task[j % STEAL_DEPTH].pinned) continue;
+
+            *t = v->task[j % STEAL_DEPTH];
+
+            for (k = j; k != v->top; k--) v->task[k % STEAL_DEPTH] = v->task[(k - 1) % STEAL_DEPTH];
+
+            v->top++;
+            ret = true;
+            break;
+        }
+
+        pthread_mutex_unlock(&v->lock);
+
+        if (ret)
+        {
+            w->steals++;
+            return(true);
+        }
+    }
+
+    return(false);
+}
+
+/*********************************************************************
+ * @brief worker thread
+ * @param arg : worker
+ *********************************************************************/
+static void *steal_worker_run(void *arg)
+{
+    struct steal_worker *w = (struct steal_worker *) arg;
+    struct steal_task t;
+    uint64_t start;
+    int     idle = 0;
+
+    steal_self = w->id;
+
+    while (! w->pool->stop)
+    {
+        if (steal_pop(w, &t) || steal_take(w, &t))
+        {
+            start = steal_ns();
+            t.fn(t.ctx, w->id);
+            w->busy_ns += steal_ns() - start;
+            w->tasks++;
+
+            __atomic_sub_fetch(&w->pool->pending, 1, __ATOMIC_RELEASE);
+            idle = 0;
+            continue;
+        }
+
+        if (idle++ < STEAL_SPIN) sched_yield();
+        else usleep(STEAL_IDLE_US);
+    }
+
+    return(NULL);
+}
+
+/*********************************************************************
+ * @brief start a pool
+ * @param p : pool
+ * @param num : number of workers (1 - STEAL_MAXWORKER)
+ *
+ * @return true = OK, false is error
+ *********************************************************************/
+bool steal_start(struct steal_pool *p, int num)
+{
+    int i;
+
+    if (num < 1 || num > STEAL_MAXWORKER) return(false);
+
+    memset(p, 0x0, sizeof(struct steal_pool));
+
+    p->num = num;
+    p->started = steal_ns();
+
+    for (i = 0; i < num; i++)
+    {
+        p->worker[i].pool = p;
+        p->worker[i].id = i;
+        p->worker[i].seed = i + 1;
+        pthread_mutex_init(&p->worker[i].lock, NULL);
+    }
+
+    for (i = 0; i < num; i++)
+    {
+        if (pthread_create(&p->worker[i].thread, NULL, steal_worker_run, &p->worker[i]) != 0)
+        {
+            p->num = i;
+            steal_stop(p);
+            return(false);
+        }
+    }
+
+    return(true);
+}
+
+/*********************************************************************
+ * @brief submit a task
+ * @param p : pool
+ * @param fn : task function
+ * @param ctx : passed to fn
+ * @param worker : deque to add to (-1 = own deque from a worker,
+ *                 else round robin)
+ * @param pinned : never stolen
+ *
+ * @return true = OK, false is the deque is full
+ *********************************************************************/
+bool steal_submit(struct steal_pool *p, steal_fn fn, void *ctx, int worker, bool pinned)
+{
+    struct steal_worker *w;
+    bool ret = false;
+
+    if (worker < 0 || worker >= p->num)
+    {
+        if (steal_self > -1 && steal_self < p->num) worker = steal_self;
+        else worker = __atomic_fetch_add(&p->next, 1, __ATOMIC_RELAXED) % p->num;
+    }
+
+    w = &p->worker[worker];
+
+    /* counted before it can run */
+    __atomic_add_fetch(&p->pending, 1, __ATOMIC_ACQUIRE);
+
+    pthread_mutex_lock(&w->lock);
+
+    if (w->bottom - w->top < STEAL_DEPTH)
+    {
+        w->task[w->bottom % STEAL_DEPTH].fn = fn;
+        w->task[w->bottom % STEAL_DEPTH].ctx = ctx;
+        w->task[w->bottom % STEAL_DEPTH].pinned = pinned;
+        w->bottom++;
+        ret = true;
+    }
+
+    pthread_mutex_unlock(&w->lock);
+
+    if (! ret) __atomic_sub_fetch(&p->pending, 1, __ATOMIC_RELEASE);
+
+    return(ret);
+}
+
+/*********************************************************************
+ * @brief wait until all submitted tasks are done
+ * @param p : pool
+ *********************************************************************/
+void steal_wait(struct steal_pool *p)
+{
+    while (__atomic_load_n(&p->pending, __ATOMIC_ACQUIRE) > 0) usleep(STEAL_IDLE_US);
+}
+
+/*********************************************************************
+ * @brief stop the workers
+ * @param p : pool
+ *********************************************************************/
+void steal_stop(struct steal_pool *p)
+{
+    int i;
+
+    p->stop = 1;
+
+    for (i = 0; i < p->num; i++)
+    {
+        pthread_join(p->worker[i].thread, NULL);
+        pthread_mutex_destroy(&p->worker[i].lock);
+    }
+}
+
+/*********************************************************************
+ * @brief utilization of the workers since the start
+ * @param p : pool
+ *
+ * @return busy time / (workers * elapsed time), 0 - 1
+ *********************************************************************/
+double steal_utilization(struct steal_pool *p)
+{
+    uint64_t busy = 0, elapsed = steal_ns() - p->started;
+    int i;
+
+    for (i = 0; i < p->num; i++) busy += p->worker[i].busy_ns;
+
+    if (elapsed == 0) return(0);
+
+    return((double) busy / ((double) elapsed * p->num));
+}
+
+/*********************************************************************
+ * emulated sensor pipeline
+ *********************************************************************/
+
+/* samples handled per task, then the task is re-submitted */
+# define STEAL_BATCH 50
+
+/* samples per rollup */
+# define STEAL_ROLLUP 60
+
+/* each STEAL_PIN th sensor is pinned to its home worker */
+# define STEAL_PIN 4
+
+struct steal_sensor
+{
+    struct scd30_emul emul;
+    SCD30Proto<EmulTransport> scd;
+    struct steal_pool *pool;
+    int         todo;                   // samples to go
+    int         home;                   // worker it started on
+    bool        pinned;                 // always runs on home
+
+    /* rollup */
+    uint32_t    n;
+    float       co2_min, co2_max;
+    double      co2_sum, dew_sum;
+
+    /* sink */
+    uint32_t    samples;
+    uint32_t    rollups;
+    uint32_t    errors;
+    uint32_t    strays;                 // pinned, but run on an other worker
+    double      check;                  // sum of rollup values
+};
+
+/*********************************************************************
+ * @brief dew point (Magnus formula)
+ *********************************************************************/
+static float steal_dewpoint(float t, float rh)
+{
+    float g = log(rh / 100) + 17.62 * t / (243.12 + t);
+
+    return(243.12 * g / (17.62 - g));
+}
+
+/*********************************************************************
+ * @brief handle a batch of samples of an emulated sensor (task)
+ * @param ctx : sensor
+ * @param worker : running worker
+ *********************************************************************/
+static void steal_sensor_task(void *ctx, int worker)
+{
+    struct steal_sensor *s = (struct steal_sensor *) ctx;
+    float   co2, temperature, humidity, dew;
+    uint8_t ready[2];
+    int     i;
+
+    if (s->pinned && worker != s->home) s->strays++;
+
+    for (i = 0; i < STEAL_BATCH && s->todo > 0; i++, s->todo--)
+    {
+        /* the emulated values drift a little each sample */
+        emul_set(&s->emul, 600 + (s->todo % 200), 21 + (s->todo % 7) * 0.1, 45 + (s->todo % 11) * 0.2);
+
+        /* acquire and decode */
+        if (! s->scd.read<SCD30_CMD_DATA_READY>(ready) || ! ready[1] ||
+            ! s->scd.readMeasurement(&co2, &temperature, &humidity))
+        {
+            s->errors++;
+            continue;
+        }
+
+        /* derived values */
+        dew = steal_dewpoint(temperature, humidity);
+
+        /* rollup */
+        if (s->n == 0 || co2 < s->co2_min) s->co2_min = co2;
+        if (s->n == 0 || co2 > s->co2_max) s->co2_max = co2;
+        s->co2_sum += co2;
+        s->dew_sum += dew;
+        s->samples++;
+
+        /* sink */
+        if (++s->n == STEAL_ROLLUP)
+        {
+            s->check += s->co2_sum / s->n + s->dew_sum / s->n + s->co2_max - s->co2_min;
+            s->rollups++;
+            s->n = 0;
+            s->co2_sum = s->dew_sum = 0;
+        }
+    }
+
+    /* next batch : stays on this worker unless stolen (never if pinned) */
+    if (s->todo > 0 && ! steal_submit(s->pool, steal_sensor_task, s, worker, s->pinned))
+        steal_sensor_task(ctx, worker);
+}
+
+/*********************************************************************
+ * @brief run the pipeline once
+ * @param sensor : emulated sensors
+ * @param sensors : number of sensors
+ * @param samples : samples per sensor
+ * @param workers : number of workers
+ * @param pool : pool to use
+ *
+ * @return samples per second, 0 is error
+ *********************************************************************/
+static double steal_bench_run(struct steal_sensor *sensor, int sensors, int samples, int workers,
+    struct steal_pool *pool)
+{
+    uint64_t start, end;
+    int     i;
+
+    for (i = 0; i < sensors; i++)
+    {
+        emul_init(&sensor[i].emul, true);
+        sensor[i].emul.measuring = true;
+        sensor[i].scd.bus.emul = &sensor[i].emul;
+        sensor[i].pool = pool;
+        sensor[i].todo = samples;
+        sensor[i].home = i % workers;
+        sensor[i].pinned = i % STEAL_PIN == 0;
+    }
+
+    if (! steal_start(pool, workers)) return(0);
+
+    start = steal_ns();
+
+    /* each sensor starts on its home worker */
+    for (i = 0; i < sensors; i++)
+    {
+        if (! steal_submit(pool, steal_sensor_task, &sensor[i], sensor[i].home, sensor[i].pinned))
+            steal_sensor_task(&sensor[i], sensor[i].home);
+    }
+
+    steal_wait(pool);
+
+    end = steal_ns();
+
+    return((double) sensors * samples * 1e9 / (end - start));
+}
+
+/*********************************************************************
+ * @brief run the emulated sensor pipeline with 1, 2, 4 .. workers
+ * @param workers : max. number of workers
+ * @param sensors : number of emulated sensors
+ * @param samples : samples per sensor
+ *********************************************************************/
+void steal_bench(int workers, int sensors, int samples)
+{
+    struct steal_sensor *sensor;
+    struct steal_pool *pool;
+    double  rate, base = 0, check;
+    uint32_t steals, errors, strays;
+    int     n, i, last = 0;
+
+    if (workers > STEAL_MAXWORKER) workers = STEAL_MAXWORKER;
+
+    sensor = (struct steal_sensor *) calloc(sensors, sizeof(struct steal_sensor));
+    pool = (struct steal_pool *) calloc(1, sizeof(struct steal_pool));
+
+    if (sensor == NULL || pool == NULL)
+    {
+        p_printf(RED, (char *) "can not allocate memory for %d sensors\n", sensors);
+        free(sensor);
+        free(pool);
+        return;
+    }
+
+    p_printf(GREEN, (char *) "pipeline throughput, %d emulated sensors (%d pinned) x %d samples :\n", sensors,
+        (sensors + STEAL_PIN - 1) / STEAL_PIN, samples);
+    p_printf(WHITE, (char *) "workers   samples/s  speedup  efficiency  utilization  steals\n");
+
+    for (n = 1; last < workers; n *= 2)
+    {
+        if (n > workers) n = workers;
+        last = n;
+
+        memset((void *) sensor, 0x0, sensors * sizeof(struct steal_sensor));
+
+        rate = steal_bench_run(sensor, sensors, samples, n, pool);
+
+        if (rate == 0)
+        {
+            p_printf(RED, (char *) "can not start %d workers\n", n);
+            break;
+        }
+
+        for (i = 0, steals = 0; i < n; i++) steals += pool->worker[i].steals;
+        for (i = 0, errors = 0, strays = 0, check = 0; i < sensors; i++)
+        {
+            errors += sensor[i].errors;
+            strays += sensor[i].strays;
+            check += sensor[i].check;
+        }
+
+        if (n == 1) base = rate;
+
+        p_printf(WHITE, (char *) "%7d  %10.0f  %6.2fx  %9.1f%%  %10.1f%%  %6u\n", n, rate, rate / base,
+            rate / base / n * 100, steal_utilization(pool) * 100, steals);
+
+        steal_stop(pool);
+
+        if (errors) p_printf(RED, (char *) "%u read errors\n", errors);
+        if (strays) p_printf(RED, (char *) "%u pinned tasks run on an other worker\n", strays);
+        if (SCD_DEBUG > 0) p_printf(YELLOW, (char *) "rollup check %f\n", check);
+    }
+
+    free(sensor);
+    free(pool);
+}
@@ -0,0 +1,145 @@
+/*******************************************************************
+ *
+ * Work-stealing task executor for emulated sensor workloads.
+ *
+ * A pool has a number of worker threads, each with its own task
+ * deque. A worker takes tasks from the bottom of its own deque (last
+ * submitted, cache warm). An idle worker steals from the top of the
+ * deque of another worker (oldest task). Tasks submitted from a
+ * worker go to its own deque, so a sensor task that re-submits itself
+ * stays on the same worker unless another worker runs out of work.
+ * A task can be pinned : it is never stolen (e.g. it uses a bus owned
+ * by that worker). A thief skips it and takes the oldest task that is
+ * not pinned.
+ *
+ * Each worker counts the tasks run, the steals and the time busy, to
+ * report the utilization.
+ *
+ * steal_bench() (-W) runs emulated SCD30s (scd30_emul.h) through a
+ * processing pipeline : read through the protocol layer, decode,
+ * derived values (dew point), rollups and a sink, and reports the
+ * throughput for an increasing number of workers. Every STEAL_PIN th
+ * sensor is pinned to the worker it started on.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_STEAL_H__
+#define __SCD30_STEAL_H__
+
+# include <stdint.h>
+# include <pthread.h>
+
+/* max. workers in a pool */
+# define STEAL_MAXWORKER 64
+
+/* tasks per worker deque */
+# define STEAL_DEPTH 1024
+
+/* idle rounds with sched_yield() before sleeping STEAL_IDLE_US */
+# define STEAL_SPIN 64
+# define STEAL_IDLE_US 100
+
+/* task function : ctx as submitted, worker that runs it */
+typedef void (*steal_fn)(void *ctx, int worker);
+
+struct steal_task
+{
+    steal_fn    fn;
+    void        *ctx;
+    bool        pinned;                 // never stolen
+};
+
+struct steal_pool;
+
+struct steal_worker
+{
+    struct steal_pool *pool;
+    int         id;
+    pthread_t   thread;
+
+    /* deque : owner at bottom, thieves at top */
+    pthread_mutex_t lock;
+    uint32_t    top;
+    uint32_t    bottom;
+    struct steal_task task[STEAL_DEPTH];
+
+    uint32_t    seed;                   // victim selection
+
+    /* counters */
+    uint64_t    busy_ns;                // running tasks
+    uint32_t    tasks;                  // tasks run
+    uint32_t    steals;                 // tasks stolen from others
+};
+
+struct steal_pool
+{
+    int         num;                    // workers
+    volatile int stop;
+    uint32_t    pending;                // submitted, not finished
+    uint32_t    next;                   // round robin for outside submits
+    uint64_t    started;                // nS pool started
+    struct steal_worker worker[STEAL_MAXWORKER];
+};
+
+/*! start a pool
+ * @param p : pool
+ * @param num : number of workers (1 - STEAL_MAXWORKER)
+ *
+ * @return true = OK, false is error
+ */
+bool steal_start(struct steal_pool *p, int num);
+
+/*! submit a task
+ * @param p : pool
+ * @param fn : task function
+ * @param ctx : passed to fn
+ * @param worker : deque to add to (-1 = round robin)
+ * @param pinned : never stolen
+ *
+ * @return true = OK, false is the deque is full
+ */
+bool steal_submit(struct steal_pool *p, steal_fn fn, void *ctx, int worker, bool pinned);
+
+/*! wait until all submitted tasks are done
+ * @param p : pool
+ */
+void steal_wait(struct steal_pool *p);
+
+/*! stop the workers
+ * @param p : pool
+ */
+void steal_stop(struct steal_pool *p);
+
+/*! utilization of the workers since the start
+ * @param p : pool
+ *
+ * @return busy time / (workers * elapsed time), 0 - 1
+ */
+double steal_utilization(struct steal_pool *p);
+
+/*! run the emulated sensor pipeline with 1, 2, 4 .. workers and show
+ * the throughput
+ * @param workers : max. number of workers
+ * @param sensors : number of emulated sensors
+ * @param samples : samples per sensor
+ */
+void steal_bench(int workers, int sensors, int samples);
+
+#endif  // End of definition check
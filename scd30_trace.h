@@ -0,0 +1,86 @@
+/*******************************************************************
+ *
+ * Static user space tracepoints (USDT) for perf and bpftrace.
+ *
+ * Build with 'make TRACE=1' (defines SCD30_USDT, needs sys/sdt.h from
+ * systemtap-sdt-dev). Each tracepoint is a single nop in the binary
+ * with a note section describing its arguments. Nothing is executed
+ * until a tracer attaches. Without SCD30_USDT they compile to nothing.
+ *
+ * provider scd30 :
+ *
+ *  cmd_entry (command, len)                sendCommand() start
+ *  cmd_exit  (command, len, result, uS)    sendCommand() done
+ *  read_done (len, result, uS)             readbytes() done
+ *  crc_error (expected, received)          CRC mismatch
+ *  sample    (co2, temperature, humidity)  readMeasurement() OK, * 100
+ *  soft_reset (result)                     SoftReset() done
+ *  dylos     (pm1, pm10, bytes, uS)        Dylos line parsed
+ *  sink_flush (lines, errors, uS)          sink flushed
+ *
+ * result is the twowire status (0 = I2C_OK) or 1 / 0 for true / false.
+ *
+ * e.g. : perf probe -x ./scd30 sdt_scd30:cmd_exit
+ *        bpftrace -e 'usdt:./scd30:scd30:read_done { @[arg1] = hist(arg2); }'
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_TRACE_H__
+#define __SCD30_TRACE_H__
+
+#ifdef SCD30_USDT
+
+# include <sys/sdt.h>
+# include <stdint.h>
+# include <time.h>
+
+/*! uS since t */
+static inline uint32_t trace_us(struct timespec *t)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return((now.tv_sec - t->tv_sec) * 1000000 + (now.tv_nsec - t->tv_nsec) / 1000);
+}
+
+# define SCD30_TRACE1(name, a)          DTRACE_PROBE1(scd30, name, a)
+# define SCD30_TRACE2(name, a, b)       DTRACE_PROBE2(scd30, name, a, b)
+# define SCD30_TRACE3(name, a, b, c)    DTRACE_PROBE3(scd30, name, a, b, c)
+# define SCD30_TRACE4(name, a, b, c, d) DTRACE_PROBE4(scd30, name, a, b, c, d)
+
+/* start time for a duration, only taken in a trace build */
+# define SCD30_TRACE_CLOCK(t)           struct timespec t; clock_gettime(CLOCK_MONOTONIC, &t)
+# define SCD30_TRACE_US(t)              trace_us(&t)
+
+#else
+
+/* the arguments are not evaluated, only marked as used */
+# define SCD30_TRACE1(name, a)          do { (void) sizeof(a); } while (0)
+# define SCD30_TRACE2(name, a, b)       do { (void) sizeof(a); (void) sizeof(b); } while (0)
+# define SCD30_TRACE3(name, a, b, c)    do { (void) sizeof(a); (void) sizeof(b); (void) sizeof(c); } while (0)
+# define SCD30_TRACE4(name, a, b, c, d) do { (void) sizeof(a); (void) sizeof(b); (void) sizeof(c); (void) sizeof(d); } while (0)
+
+# define SCD30_TRACE_CLOCK(t)
+# define SCD30_TRACE_US(t)              0
+
+#endif  // SCD30_USDT
+
+#endif  // End of definition check
@@ -0,0 +1,226 @@
+/*******************************************************************
+ *
+ * Transport policies for the SCD30 protocol layer.
+ *
+ * The i2c-dev transport uses plain read() and write() on the device
+ * after selecting the slave address with the I2C_SLAVE ioctl. The
+ * kernel driver does the clock stretching of the SCD30.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "scd30_transport.h"
+# include "scd30_proto.h"
+# include <errno.h>
+# include <fcntl.h>
+# include <sys/ioctl.h>
+# include <linux/i2c-dev.h>
+
+/*********************************************************************
+ * @brief open /dev/i2c-<bus> for slave address
+ * @param bus : I2C bus number
+ * @param address : slave address
+ *
+ * @return true = OK, false is error
+ *********************************************************************/
+bool I2cDevTransport::open(int bus, uint8_t address)
+{
+    char dev[20];
+
+    snprintf(dev, sizeof(dev), "/dev/i2c-%d", bus);
+
+    if ((fd = ::open(dev, O_RDWR)) < 0) return(false);
+
+    if (ioctl(fd, I2C_SLAVE, address) < 0)
+    {
+        close();
+        return(false);
+    }
+
+    return(true);
+}
+
+/*********************************************************************
+ * @brief close the device
+ *********************************************************************/
+void I2cDevTransport::close()
+{
+    if (fd > -1) ::close(fd);
+    fd = -1;
+}
+
+/*********************************************************************
+ * @brief translate an i2c-dev error to twowire status
+ *********************************************************************/
+static Wstatus i2cdev_status(ssize_t ret, uint32_t len)
+{
+    if (ret == (ssize_t) len) return(I2C_OK);
+
+    /* no acknowledge from the slave */
+    if (ret < 0 && (errno == ENXIO || errno == EREMOTEIO)) return(I2C_SDA_NACK);
+
+    /* bus timeout (clock stretch) */
+    if (ret < 0 && errno == ETIMEDOUT) return(I2C_SCL_CLKSTR);
+
+    return(I2C_SDA_DATA);
+}
+
+Wstatus I2cDevTransport::write(const char *buf, uint32_t len)
+{
+    return(i2cdev_status(::write(fd, buf, len), len));
+}
+
+Wstatus I2cDevTransport::read(char *buf, uint32_t len)
+{
+    return(i2cdev_status(::read(fd, buf, len), len));
+}
+
+void I2cDevTransport::stretch(uint32_t us)
+{
+    ioctl(fd, I2C_TIMEOUT, (us + 9999) / 10000);
+}
+
+/*********************************************************************
+ * run time tables
+ *********************************************************************/
+static Wstatus twi_write(void *ctx, const char *buf, uint32_t len)
+{
+    return(((TwiTransport *) ctx)->write(buf, len));
+}
+
+static Wstatus twi_read(void *ctx, char *buf, uint32_t len)
+{
+    return(((TwiTransport *) ctx)->read(buf, len));
+}
+
+static Wstatus i2cdev_write(void *ctx, const char *buf, uint32_t len)
+{
+    return(((I2cDevTransport *) ctx)->write(buf, len));
+}
+
+static Wstatus i2cdev_read(void *ctx, char *buf, uint32_t len)
+{
+    return(((I2cDevTransport *) ctx)->read(buf, len));
+}
+
+static Wstatus emultr_write(void *ctx, const char *buf, uint32_t len)
+{
+    return(((EmulTransport *) ctx)->write(buf, len));
+}
+
+static Wstatus emultr_read(void *ctx, char *buf, uint32_t len)
+{
+    return(((EmulTransport *) ctx)->read(buf, len));
+}
+
+static void twi_stretch(void *ctx, uint32_t us)
+{
+    ((TwiTransport *) ctx)->stretch(us);
+}
+
+static void i2cdev_stretch(void *ctx, uint32_t us)
+{
+    ((I2cDevTransport *) ctx)->stretch(us);
+}
+
+static void no_stretch(void *ctx, uint32_t us)
+{
+}
+
+static void sleep_us(void *ctx, uint32_t us)
+{
+    usleep(us);
+}
+
+static void no_wait(void *ctx, uint32_t us)
+{
+}
+
+const struct scd30_transport_ops twi_ops = { twi_write, twi_read, sleep_us, twi_stretch };
+const struct scd30_transport_ops i2cdev_ops = { i2cdev_write, i2cdev_read, sleep_us, i2cdev_stretch };
+const struct scd30_transport_ops emul_ops = { emultr_write, emultr_read, no_wait, no_stretch };
+
+/*********************************************************************
+ * @brief time n data ready reads
+ * @param scd : protocol layer
+ * @param n : number of transactions
+ *
+ * @return nS per transaction (write + read)
+ *********************************************************************/
+template <class P>
+static double bench_run(P *scd, uint32_t n)
+{
+    struct timespec start, end;
+    uint8_t val[2];
+    uint32_t i;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (i = 0; i < n; i++) scd->template read<SCD30_CMD_DATA_READY>(val);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return(((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / n);
+}
+
+/*********************************************************************
+ * @brief compare the per-transaction overhead of the static policies
+ * and the run time interface on the emulator
+ * @param n : number of transactions per variant
+ *
+ * Each variant is run 3 times, the best is reported. The emulator
+ * answers 'not ready' straight away, so mainly the protocol layer and
+ * the dispatch are measured.
+ *********************************************************************/
+void transport_bench(uint32_t n)
+{
+    struct scd30_emul emul;
+    SCD30Proto<EmulTransport, 0> st;
+    SCD30Proto<EmulTransport, 1> st_dbg;
+    SCD30Proto<DynTransport, 0> dyn;
+    SCD30Proto<DynTransport, 1> dyn_dbg;
+    EmulTransport et;
+    double  best[4], t;
+    int     i, r;
+    const char *name[4] = {"static", "static + debug", "run time", "run time + debug"};
+
+    emul_init(&emul, true);
+
+    et.emul = st.bus.emul = st_dbg.bus.emul = &emul;
+    dyn.bus.ops = dyn_dbg.bus.ops = &emul_ops;
+    dyn.bus.ctx = dyn_dbg.bus.ctx = &et;
+
+    for (i = 0; i < 4; i++) best[i] = 1e12;
+
+    for (r = 0; r < 3; r++)
+    {
+        if ((t = bench_run(&st, n)) < best[0]) best[0] = t;
+        if ((t = bench_run(&st_dbg, n)) < best[1]) best[1] = t;
+        if ((t = bench_run(&dyn, n)) < best[2]) best[2] = t;
+        if ((t = bench_run(&dyn_dbg, n)) < best[3]) best[3] = t;
+    }
+
+    p_printf(GREEN, (char *) "transport overhead, %u transactions (emulator) :\n", n);
+
+    for (i = 0; i < 4; i++)
+        p_printf(WHITE, (char *) "%-18s %7.1f nS / transaction  %+6.1f nS\n", name[i], best[i], best[i] - best[0]);
+
+    if (st.stats.read_errors + dyn.stats.read_errors + st.stats.crc_errors + dyn.stats.crc_errors)
+        p_printf(RED, (char *) "errors during benchmark\n");
+}
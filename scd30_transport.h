@@ -0,0 +1,127 @@
+/*******************************************************************
+ *
+ * Transport policies for the SCD30 protocol layer (scd30_proto.h).
+ *
+ *  TwiTransport    : twowire library (hard or soft I2C), opened by
+ *                    the caller
+ *  I2cDevTransport : Linux i2c-dev (/dev/i2c-N), no BCM2835 needed
+ *  EmulTransport   : emulated SCD30 (scd30_emul.h)
+ *  ModbusTransport : Modbus RTU over UART (scd30_modbus.h)
+ *  DynTransport    : any of the above, selected at run time through a
+ *                    table of functions (scd30_transport_ops)
+ *
+ * DynTransport is the run time interface : each call goes through a
+ * function pointer, as a virtual function would. It is used to compare
+ * the overhead against the static policies (-T).
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_TRANSPORT_H__
+#define __SCD30_TRANSPORT_H__
+
+# include "SCD30.h"
+# include "scd30_emul.h"
+
+/* twowire library */
+class TwiTransport
+{
+  public:
+    TwoWire     *twi;                   // opened and slave address set
+
+    TwiTransport() { twi = NULL; }
+
+    Wstatus write(const char *buf, uint32_t len) { return(twi->i2c_write((char *) buf, len)); }
+    Wstatus read(char *buf, uint32_t len) { return(twi->i2c_read(buf, len)); }
+    void wait_us(uint32_t us) { usleep(us); }
+    void stretch(uint32_t us) { twi->setClockStretchLimit(us); }
+};
+
+/* Linux i2c-dev */
+class I2cDevTransport
+{
+  public:
+    int         fd;                     // -1 is not open
+
+    I2cDevTransport() { fd = -1; }
+
+    /*! open /dev/i2c-<bus> for slave address
+     * @return true = OK, false is error */
+    bool open(int bus, uint8_t address);
+
+    /*! close the device */
+    void close();
+
+    Wstatus write(const char *buf, uint32_t len);
+    Wstatus read(char *buf, uint32_t len);
+    void wait_us(uint32_t us) { usleep(us); }
+
+    /*! bus timeout (the adapter has 10 mS steps) */
+    void stretch(uint32_t us);
+};
+
+/* emulated SCD30 */
+class EmulTransport
+{
+  public:
+    struct scd30_emul *emul;            // emulator to use
+
+    EmulTransport() { emul = NULL; }
+
+    Wstatus write(const char *buf, uint32_t len) { return(emul_write(emul, buf, len)); }
+    Wstatus read(char *buf, uint32_t len) { return(emul_read(emul, buf, len)); }
+    void wait_us(uint32_t us) { }
+    void stretch(uint32_t us) { }
+};
+
+/* transport selected at run time */
+struct scd30_transport_ops
+{
+    Wstatus (*write)(void *ctx, const char *buf, uint32_t len);
+    Wstatus (*read)(void *ctx, char *buf, uint32_t len);
+    void    (*wait_us)(void *ctx, uint32_t us);
+    void    (*stretch)(void *ctx, uint32_t us);
+};
+
+/* tables for the transports above (ctx is the transport) */
+extern const struct scd30_transport_ops twi_ops;
+extern const struct scd30_transport_ops i2cdev_ops;
+extern const struct scd30_transport_ops emul_ops;
+
+class DynTransport
+{
+  public:
+    const struct scd30_transport_ops *ops;
+    void        *ctx;
+
+    DynTransport() { ops = NULL; ctx = NULL; }
+
+    Wstatus write(const char *buf, uint32_t len) { return(ops->write(ctx, buf, len)); }
+    Wstatus read(char *buf, uint32_t len) { return(ops->read(ctx, buf, len)); }
+    void wait_us(uint32_t us) { ops->wait_us(ctx, us); }
+    void stretch(uint32_t us) { ops->stretch(ctx, us); }
+};
+
+/*! compare the per-transaction overhead of the static policies and
+ * the run time interface on the emulator
+ * @param n : number of transactions per variant
+ */
+void transport_bench(uint32_t n);
+
+#endif  // End of definition check
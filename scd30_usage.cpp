@@ -0,0 +1,243 @@
+/*******************************************************************
+ *
+ * Resource usage per processing stage.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+# include "SCD30.h"
+# include "scd30_usage.h"
+# include <sys/resource.h>
+
+static struct scd30_usage usage_acc;
+
+static const char *usage_names[USAGE_STAGES] = { "acq", "dylos", "format", "sink", "other" };
+
+/*********************************************************************
+ * @brief get monotonic time in milli seconds
+ *********************************************************************/
+static uint64_t usage_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return((uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/*********************************************************************
+ * @brief charge the usage since the last mark to the current stage
+ *********************************************************************/
+static void usage_charge()
+{
+    struct timespec ts;
+    struct rusage ru;
+    struct usage_stat *st = &usage_acc.st[usage_acc.cur];
+    uint64_t cpu;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    getrusage(RUSAGE_THREAD, &ru);
+
+    cpu = (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+    st->cpu_ns += cpu - usage_acc.cpu_mark;
+    st->vcsw += ru.ru_nvcsw - usage_acc.vcsw_mark;
+    st->ivcsw += ru.ru_nivcsw - usage_acc.ivcsw_mark;
+
+    usage_acc.cpu_mark = cpu;
+    usage_acc.vcsw_mark = ru.ru_nvcsw;
+    usage_acc.ivcsw_mark = ru.ru_nivcsw;
+}
+
+/*********************************************************************
+ * @brief charge the CPU time of the Dylos reader since the last mark
+ *********************************************************************/
+static void usage_charge_child()
+{
+    struct timespec ts;
+    uint64_t cpu;
+
+    if (usage_acc.child == 0 || clock_gettime(usage_acc.child_clk, &ts) != 0) return;
+
+    cpu = (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+    usage_acc.st[USAGE_DYLOS].cpu_ns += cpu - usage_acc.child_mark;
+    usage_acc.child_mark = cpu;
+}
+
+/*********************************************************************
+ * @brief charge the CPU time of the Dylos reader process
+ * @param pid : process id (0 = stopped : charge the last part)
+ *
+ * Must be called before the process is waited for, else its clock
+ * is gone.
+ *********************************************************************/
+void usage_child(int pid)
+{
+    struct timespec ts;
+
+    if (! usage_acc.enabled) return;
+
+    usage_charge_child();
+    usage_acc.child = 0;
+
+    if (pid <= 0 || clock_getcpuclockid(pid, &usage_acc.child_clk) != 0 ||
+        clock_gettime(usage_acc.child_clk, &ts) != 0) return;
+
+    usage_acc.child = pid;
+    usage_acc.child_mark = (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*********************************************************************
+ * @brief enable the accounting
+ * @param period : seconds between summary lines (0 = only in stats)
+ *********************************************************************/
+void usage_init(uint32_t period)
+{
+    memset(&usage_acc, 0x0, sizeof(struct scd30_usage));
+
+    usage_acc.cur = USAGE_OTHER;
+    usage_acc.period = period;
+    usage_acc.started = usage_ms();
+    usage_acc.next = usage_acc.started + period * 1000;
+
+    /* start the marks */
+    usage_charge();
+    memset(usage_acc.st, 0x0, sizeof(usage_acc.st));
+
+    usage_acc.enabled = true;
+}
+
+/*********************************************************************
+ * @brief start a stage
+ * @param stage : usage_stage
+ *
+ * @return stage that was running
+ *********************************************************************/
+int usage_enter(int stage)
+{
+    int prev = usage_acc.cur;
+
+    if (! usage_acc.enabled || stage == prev) return(prev);
+
+    usage_charge();
+    usage_acc.cur = stage;
+    usage_acc.st[stage].entries++;
+
+    return(prev);
+}
+
+/*********************************************************************
+ * @brief end a stage
+ * @param prev : as returned by usage_enter()
+ *********************************************************************/
+void usage_leave(int prev)
+{
+    if (! usage_acc.enabled || prev == usage_acc.cur) return;
+
+    usage_charge();
+    usage_acc.cur = prev;
+}
+
+/*********************************************************************
+ * @brief count a sample that was output
+ *********************************************************************/
+void usage_sample()
+{
+    if (usage_acc.enabled) usage_acc.samples++;
+}
+
+/*********************************************************************
+ * @brief show the summary line
+ *
+ * Per stage : part of the CPU time, CPU time and context switches
+ * per sample.
+ *********************************************************************/
+static void usage_summary()
+{
+    uint64_t total = 0;
+    uint32_t n = usage_acc.samples ? usage_acc.samples : 1;
+    char    buf[MAXBUF * 4];
+    int     i, off;
+
+    usage_charge();
+    usage_charge_child();
+
+    for (i = 0; i < USAGE_STAGES; i++) total += usage_acc.st[i].cpu_ns;
+
+    off = snprintf(buf, sizeof(buf), "usage: %u samples %u wakeups (%3.1f / sample) cpu %3.3f mS / sample :",
+        usage_acc.samples, usage_acc.wakeups, (double) usage_acc.wakeups / n, (double) total / n / 1000000);
+
+    for (i = 0; i < USAGE_STAGES && off < (int) sizeof(buf); i++)
+    {
+        off += snprintf(buf + off, sizeof(buf) - off, " %s %3.1f%% %3.3f mS %3.1f/%3.1f csw",
+            usage_names[i], total ? (double) usage_acc.st[i].cpu_ns * 100 / total : 0,
+            (double) usage_acc.st[i].cpu_ns / n / 1000000,
+            (double) usage_acc.st[i].vcsw / n, (double) usage_acc.st[i].ivcsw / n);
+    }
+
+    p_printf(YELLOW, (char *) "%s\n", buf);
+}
+
+/*********************************************************************
+ * @brief count a wakeup of the main loop, show the summary if due
+ *********************************************************************/
+void usage_wakeup()
+{
+    uint64_t now;
+
+    if (! usage_acc.enabled) return;
+
+    usage_acc.wakeups++;
+
+    if (usage_acc.period == 0 || (now = usage_ms()) < usage_acc.next) return;
+
+    usage_acc.next = now + usage_acc.period * 1000;
+
+    usage_summary();
+}
+
+/*********************************************************************
+ * @brief add the usage to a stats reply
+ * @param reply : to store the usage
+ * @param len : length of reply buffer
+ *
+ * @return length added (0 if not enabled)
+ *********************************************************************/
+int usage_stats(char *reply, int len)
+{
+    int i, off;
+
+    if (! usage_acc.enabled || len < 1) return(0);
+
+    usage_charge();
+    usage_charge_child();
+
+    off = snprintf(reply, len, " usage_seconds %lu usage_samples %u usage_wakeups %u",
+        (unsigned long) (usage_ms() - usage_acc.started) / 1000, usage_acc.samples, usage_acc.wakeups);
+
+    for (i = 0; i < USAGE_STAGES && off < len; i++)
+    {
+        off += snprintf(reply + off, len - off, " %s_cpu_us %lu %s_entries %u %s_vcsw %u %s_ivcsw %u",
+            usage_names[i], (unsigned long) (usage_acc.st[i].cpu_ns / 1000), usage_names[i], usage_acc.st[i].entries,
+            usage_names[i], usage_acc.st[i].vcsw, usage_names[i], usage_acc.st[i].ivcsw);
+    }
+
+    return(off < len ? off : len - 1);
+}
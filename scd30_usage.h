@@ -0,0 +1,127 @@
+/*******************************************************************
+ *
+ * Resource usage per processing stage.
+ *
+ * On battery or Pi Zero nodes the CPU time and the wakeups per sample
+ * matter. With -U the thread CPU time (CLOCK_THREAD_CPUTIME_ID) and the
+ * voluntary / involuntary context switches (getrusage(RUSAGE_THREAD))
+ * are charged to the stage that is running :
+ *
+ *  acq     : SCD30 acquisition (bus, health, interval, pressure)
+ *  dylos   : reading the Dylos
+ *  format  : computing and formatting the results
+ *  sink    : writing the results
+ *  other   : main loop, control commands
+ *
+ * The Dylos is read by a forked child (dylos.c) that runs until it is
+ * stopped : RUSAGE_CHILDREN only counts children that were waited for.
+ * Its CPU time is taken from its process CPU clock and charged to the
+ * dylos stage as well. Its context switches are not counted.
+ *
+ * Stages nest : usage_enter() returns the stage that is interrupted,
+ * usage_leave() continues it. A voluntary context switch is a blocking
+ * system call that had to wait (I2C delay, serial read, write), which
+ * is the part of the system calls that costs a wakeup. The main loop
+ * counts its own wakeups.
+ *
+ * The result is added to the 'stats' control command and shown as a
+ * summary line every -U seconds.
+ *
+ ******************************************************************
+ * October 2026 : created for Raspberry Pi
+ * by Paul van Haastrecht (paulvha@hotmail.com)
+ *
+ * *****************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef __SCD30_USAGE_H__
+#define __SCD30_USAGE_H__
+
+# include <stdint.h>
+# include <time.h>
+
+enum usage_stage
+{
+    USAGE_ACQ = 0,                      // SCD30 acquisition
+    USAGE_DYLOS,                        // Dylos read
+    USAGE_FORMAT,                       // compute and format results
+    USAGE_SINK,                         // write results
+    USAGE_OTHER,                        // main loop, control
+    USAGE_STAGES
+};
+
+struct usage_stat
+{
+    uint64_t    cpu_ns;                 // thread CPU time
+    uint32_t    entries;                // times entered
+    uint32_t    vcsw;                   // voluntary context switches
+    uint32_t    ivcsw;                  // involuntary context switches
+};
+
+struct scd30_usage
+{
+    bool        enabled;
+    int         cur;                    // stage running
+    uint64_t    cpu_mark;               // at last stage change
+    long        vcsw_mark;
+    long        ivcsw_mark;
+    uint32_t    samples;                // results output
+    uint32_t    wakeups;                // main loop wakeups
+    uint32_t    period;                 // seconds between summaries (0 = none)
+    uint64_t    started;                // mS enabled
+    uint64_t    next;                   // mS next summary
+    int         child;                  // Dylos reader process (0 = none)
+    clockid_t   child_clk;              // its CPU clock
+    uint64_t    child_mark;             // its CPU time at last charge
+    struct usage_stat st[USAGE_STAGES];
+};
+
+/*! enable the accounting
+ * @param period : seconds between summary lines (0 = only in stats)
+ */
+void usage_init(uint32_t period);
+
+/*! start a stage
+ * @param stage : usage_stage
+ *
+ * @return stage that was running (for usage_leave())
+ */
+int usage_enter(int stage);
+
+/*! end a stage
+ * @param prev : as returned by usage_enter()
+ */
+void usage_leave(int prev);
+
+/*! charge the CPU time of the Dylos reader process to the dylos stage
+ * @param pid : process id (0 = stopped : charge the last part)
+ */
+void usage_child(int pid);
+
+/*! count a sample that was output */
+void usage_sample();
+
+/*! count a wakeup of the main loop, show the summary if due */
+void usage_wakeup();
+
+/*! add the usage to a stats reply
+ * @param reply : to store the usage
+ * @param len : length of reply buffer
+ *
+ * @return length added (0 if not enabled)
+ */
+int usage_stats(char *reply, int len);
+
+#endif  // End of definition check